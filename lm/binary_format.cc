@@ -15,7 +15,7 @@
 namespace lm {
 namespace ngram {
 
-const char *kModelNames[6] = {"probing hash tables", "probing hash tables with rest costs", "trie", "trie with quantization", "trie with array-compressed pointers", "trie with quantization and array-compressed pointers"};
+const char *kModelNames[7] = {"probing hash tables", "probing hash tables with rest costs", "trie", "trie with quantization", "trie with array-compressed pointers", "trie with quantization and array-compressed pointers", "minimal perfect hash with quantization"};
 
 namespace {
 const char kMagicBeforeVersion[] = "mmap lm http://kheafield.com/code format version";
@@ -17,7 +17,7 @@
 namespace lm {
 namespace ngram {
 
-extern const char *kModelNames[6];
+extern const char *kModelNames[7];
 
 /*Inspect a file to determine if it is a binary lm.  If not, return false.
  * If so, return true and set recognized to the type.  This is the only API in
@@ -23,7 +23,7 @@ namespace ngram {
 namespace {
 
 void Usage(const char *name, const char *default_mem) {
-  std::cerr << "Usage: " << name << " [-u log10_unknown_probability] [-s] [-i] [-w mmap|after] [-p probing_multiplier] [-T trie_temporary] [-S trie_building_mem] [-q bits] [-b bits] [-a bits] [type] input.arpa [output.mmap]\n\n"
+  std::cerr << "Usage: " << name << " [-u log10_unknown_probability] [-s] [-i] [-w mmap|after] [-p probing_multiplier] [-T trie_temporary] [-S trie_building_mem] [-j threads] [-q bits] [-b bits] [-a bits] [-f bits] [type] input.arpa [output.mmap]\n\n"
 "-u sets the log10 probability for <unk> if the ARPA file does not have one.\n"
 "   Default is -100.  The ARPA file will always take precedence.\n"
 "-s allows models to be built even if they do not have <s> and </s>.\n"
@@ -35,7 +35,7 @@ void Usage(const char *name, const char *default_mem) {
 "   model files.  order1.arpa must be an ARPA file.  All others may be ARPA or\n"
 "   the same data structure as being built.  All files must have the same\n"
 "   vocabulary.  For probing, the unigrams must be in the same order.\n\n"
-"type is either probing or trie.  Default is probing.\n\n"
+"type is probing, trie, or perfect.  Default is probing.\n\n"
 "probing uses a probing hash table.  It is the fastest but uses the most memory.\n"
 "-p sets the space multiplier and must be >1.0.  The default is 1.5.\n\n"
 "trie is a straightforward trie with bit-level packing.  It uses the least\n"
@@ -46,11 +46,19 @@ void Usage(const char *name, const char *default_mem) {
 "   with GNU sort.  The number is followed by a unit: \% for percent of physical\n"
 "   memory, b for bytes, K for Kilobytes, M for megabytes, then G,T,P,E,Z,Y.  \n"
 "   Default unit is K for Kilobytes.\n"
+"-j sets the number of threads for parsing the ARPA file and, for trie, sorting.\n"
+"   Default is 1.  The output does not depend on it.\n"
 "-q turns quantization on and sets the number of bits (e.g. -q 8).\n"
 "-b sets backoff quantization bits.  Requires -q and defaults to that value.\n"
 "-a compresses pointers using an array of offsets.  The parameter is the\n"
 "   maximum number of bits encoded by the array.  Memory is minimized subject\n"
 "   to the maximum, so pick 255 to minimize memory.\n\n"
+"perfect keeps n-grams in minimal perfect hash tables with quantized values.\n"
+"It is a little larger than a quantized trie and about as fast as probing,\n"
+"but an n-gram that is not in the model is mistaken for one that is with\n"
+"probability 2^-bits.  Building uses probing hash tables, so -p applies.\n"
+"-q and -b set quantization bits.  Default is 8.\n"
+"-f sets the fingerprint bits, at most 57.  Default is 32.\n\n"
 "-h print this help message.\n\n"
 "Get a memory estimate by passing an ARPA file without an output file name.\n";
   exit(1);
@@ -91,7 +99,7 @@ void ParseFileList(const char *from, std::vector<std::string> &to) {
 }
 
 void ProbingQuantizationUnsupported() {
-  std::cerr << "Quantization is only implemented in the trie data structure." << std::endl;
+  std::cerr << "Quantization is only implemented in the trie and perfect data structures." << std::endl;
   exit(1);
 }
 
@@ -112,7 +120,7 @@ int main(int argc, char *argv[]) {
     lm::ngram::Config config;
     config.building_memory = util::ParseSize(default_mem);
     int opt;
-    while ((opt = getopt(argc, argv, "q:b:a:u:p:t:T:m:S:w:sir:h")) != -1) {
+    while ((opt = getopt(argc, argv, "q:b:a:f:u:p:t:T:m:S:j:w:sir:h")) != -1) {
       switch(opt) {
         case 'q':
           config.prob_bits = ParseBitCount(optarg);
@@ -127,6 +135,9 @@ int main(int argc, char *argv[]) {
           config.pointer_bhiksha_bits = ParseBitCount(optarg);
           bhiksha = true;
           break;
+        case 'f':
+          config.fingerprint_bits = ParseUInt(optarg);
+          break;
         case 'u':
           config.unknown_missing_logprob = ParseFloat(optarg);
           break;
@@ -144,6 +155,9 @@ int main(int argc, char *argv[]) {
         case 'S':
           config.building_memory = std::min(static_cast<uint64_t>(std::numeric_limits<std::size_t>::max()), util::ParseSize(optarg));
           break;
+        case 'j':
+          config.building_threads = ParseUInt(optarg);
+          break;
         case 'w':
           set_write_method = true;
           if (!strcmp(optarg, "mmap")) {
@@ -220,6 +234,17 @@ int main(int argc, char *argv[]) {
           TrieModel(from_file, config);
         }
       }
+    } else if (!strcmp(model_type, "perfect")) {
+      if (rest) {
+        std::cerr << "Rest + perfect is not supported yet." << std::endl;
+        return 1;
+      }
+      if (bhiksha) {
+        std::cerr << "Array pointer compression (-a) is only for trie." << std::endl;
+        return 1;
+      }
+      if (!set_write_method) config.write_method = Config::WRITE_AFTER;
+      PerfectHashModel(from_file, config);
     } else {
       Usage(argv[0], default_mem);
     }
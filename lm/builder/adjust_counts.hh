@@ -30,6 +30,22 @@ struct DiscountConfig {
   WarningAction bad_action;
 };
 
+// Counts of adjusted counts for one order.
+struct OrderStat {
+  // n_1 in equation 26 of Chen and Goodman etc
+  uint64_t n[5];
+  uint64_t count;
+  uint64_t count_pruned;
+};
+
+// Sets counts, counts_pruned, and discounts from the statistics of each order.
+void CalculateDiscounts(
+    const std::vector<OrderStat> &stats,
+    const DiscountConfig &config,
+    std::vector<uint64_t> &counts,
+    std::vector<uint64_t> &counts_pruned,
+    std::vector<Discount> &discounts);
+
 /* Compute adjusted counts.
  * Input: unique suffix sorted N-grams (and just the N-grams) with raw counts.
  * Output: [1,N]-grams with adjusted counts.
@@ -42,15 +58,19 @@ class AdjustCounts {
     // counts_pruned: output
     // discounts: mostly output.  If the input already has entries, they will be kept.
     // prune_thresholds: input.  n-grams with normal (not adjusted) count below this will be pruned.
+    // stats: optional output.  If set, the statistics go here and discounts
+    //   are left alone, for when they depend on more than these n-grams.
     AdjustCounts(
         const std::vector<uint64_t> &prune_thresholds,
         std::vector<uint64_t> &counts,
         std::vector<uint64_t> &counts_pruned,
         const std::vector<bool> &prune_words,
         const DiscountConfig &discount_config,
-        std::vector<Discount> &discounts)
+        std::vector<Discount> &discounts,
+        std::vector<OrderStat> *stats = NULL)
       : prune_thresholds_(prune_thresholds), counts_(counts), counts_pruned_(counts_pruned),
-        prune_words_(prune_words), discount_config_(discount_config), discounts_(discounts)
+        prune_words_(prune_words), discount_config_(discount_config), discounts_(discounts),
+        stats_(stats)
     {}
 
     void Run(const util::stream::ChainPositions &positions);
@@ -63,6 +83,8 @@ class AdjustCounts {
 
     DiscountConfig discount_config_;
     std::vector<Discount> &discounts_;
+
+    std::vector<OrderStat> *stats_;
 };
 
 } // namespace builder
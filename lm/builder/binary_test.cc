@@ -0,0 +1,179 @@
+#include "lm/builder/output.hh"
+#include "lm/builder/pipeline.hh"
+#include "lm/model.hh"
+
+#include "util/file.hh"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#define BOOST_TEST_MODULE BinaryTest
+#include <boost/test/unit_test.hpp>
+
+namespace lm { namespace builder { namespace {
+
+class Random {
+  public:
+    Random() : state_(1) {}
+
+    // Product of two uniform draws below bound, so low numbers are frequent.
+    uint32_t Skewed(uint32_t bound) {
+      uint32_t a = Next() % bound;
+      return a * (Next() % bound) / bound;
+    }
+
+    uint32_t Next() {
+      state_ = state_ * 1103515245 + 12345;
+      return state_ >> 16;
+    }
+
+  private:
+    uint32_t state_;
+};
+
+// About the size of lm/test.arpa: a few dozen words, with recurring sentences
+// so that there are n-grams of every order.
+std::string Corpus() {
+  Random random;
+  std::vector<std::string> sentences(20);
+  for (std::size_t i = 0; i < sentences.size(); ++i) {
+    std::stringstream sentence;
+    for (std::size_t j = 0; j < 3 + i % 5; ++j) {
+      sentence << (j ? " " : "") << 'w' << random.Skewed(30);
+    }
+    sentences[i] = sentence.str();
+  }
+
+  std::stringstream out;
+  for (unsigned line = 0; line < 400; ++line) {
+    if (line % 2 == 0) {
+      out << sentences[random.Skewed(sentences.size())] << '\n';
+      continue;
+    }
+    std::size_t length = 1 + line % 7;
+    for (std::size_t i = 0; i < length; ++i) {
+      out << 'w' << random.Skewed(40) << (i + 1 == length ? '\n' : ' ');
+    }
+  }
+  return out.str();
+}
+
+// The corpus is too small for higher order discounts, so as lmplz
+// --discount_fallback.
+PipelineConfig Config(std::size_t order) {
+  PipelineConfig config;
+  config.order = order;
+  config.sort.temp_prefix = "binary_test_";
+  config.sort.buffer_size = 1 << 16;
+  config.sort.total_memory = 1 << 24;
+  config.initial_probs.adder_in.total_memory = 32768;
+  config.initial_probs.adder_in.block_count = 2;
+  config.initial_probs.adder_out.total_memory = 32768;
+  config.initial_probs.adder_out.block_count = 2;
+  config.initial_probs.interpolate_unigrams = true;
+  config.read_backoffs = config.initial_probs.adder_out;
+  config.vocab_estimate = 1000;
+  config.minimum_block = 8192;
+  config.block_count = 2;
+  config.prune_thresholds.resize(order, 0);
+  config.prune_vocab = false;
+  config.renumber_vocabulary = false;
+  config.discount.bad_action = COMPLAIN;
+  config.discount.fallback.amount[0] = 0.0;
+  config.discount.fallback.amount[1] = 0.5;
+  config.discount.fallback.amount[2] = 1.0;
+  config.discount.fallback.amount[3] = 1.5;
+  config.output_q = false;
+  config.vocab_size_for_unk = 0;
+  config.disallowed_symbol_action = THROW_UP;
+  return config;
+}
+
+std::string ReadFile(const std::string &name) {
+  util::scoped_fd file(util::OpenReadOrThrow(name.c_str()));
+  std::string ret(util::SizeOrThrow(file.get()), '\0');
+  if (!ret.empty()) util::ReadOrThrow(file.get(), &ret[0], ret.size());
+  return ret;
+}
+
+// Estimate from text, writing the model with hook.
+void Estimate(PipelineConfig config, const std::string &text, OutputHook *hook) {
+  util::scoped_fd in(util::MakeTemp(config.TempPrefix() + "in"));
+  util::WriteOrThrow(in.get(), text.data(), text.size());
+  util::SeekOrThrow(in.get(), 0);
+  Output output(config.TempPrefix(), false, false);
+  output.Add(hook);
+  Pipeline(config, in.release(), output);
+}
+
+// lmplz --binary must write the same file as lmplz | build_binary, given the
+// same options.  bits is build_binary -q and lmplz --quantize.
+void Compare(ngram::ModelType type, unsigned int bits = 0) {
+  std::string text(Corpus());
+  char dir[] = "binary_test_dirXXXXXX";
+  BOOST_REQUIRE(mkdtemp(dir));
+  const std::string arpa(std::string(dir) + "/arpa");
+  const std::string direct(std::string(dir) + "/direct");
+  const std::string built(std::string(dir) + "/built");
+
+  // As lmplz without --binary.
+  PipelineConfig config(Config(5));
+  Estimate(config, text, new PrintHook(util::CreateOrThrow(arpa.c_str()), false));
+
+  // As lmplz --binary --binary_type, which renumbers for the trie.
+  ngram::Config binary;
+  binary.building_memory = config.sort.total_memory;
+  if (bits) binary.prob_bits = binary.backoff_bits = bits;
+  if (type == ngram::PROBING) {
+    binary.write_method = ngram::Config::WRITE_AFTER;
+  } else {
+    config.renumber_vocabulary = true;
+    binary.write_method = ngram::Config::WRITE_MMAP;
+  }
+  binary.temporary_directory_prefix = config.sort.temp_prefix;
+  Estimate(config, text, new BinaryHook(direct, type, binary));
+
+  // As build_binary, which picks the same write method for each type.
+  binary.write_mmap = built.c_str();
+  switch (type) {
+    case ngram::PROBING:
+      ngram::ProbingModel(arpa.c_str(), binary);
+      break;
+    case ngram::TRIE:
+      ngram::TrieModel(arpa.c_str(), binary);
+      break;
+    case ngram::QUANT_TRIE:
+      ngram::QuantTrieModel(arpa.c_str(), binary);
+      break;
+    default:
+      BOOST_FAIL("No build_binary equivalent for model type " << type);
+  }
+
+  std::string from_lmplz(ReadFile(direct)), from_arpa(ReadFile(built));
+  BOOST_REQUIRE(!from_arpa.empty());
+  BOOST_CHECK_EQUAL(from_arpa.size(), from_lmplz.size());
+  BOOST_CHECK(from_arpa == from_lmplz);
+
+  BOOST_CHECK_EQUAL(0, unlink(arpa.c_str()));
+  BOOST_CHECK_EQUAL(0, unlink(direct.c_str()));
+  BOOST_CHECK_EQUAL(0, unlink(built.c_str()));
+  BOOST_CHECK_EQUAL(0, rmdir(dir));
+}
+
+BOOST_AUTO_TEST_CASE(Probing) {
+  Compare(ngram::PROBING);
+}
+
+BOOST_AUTO_TEST_CASE(Trie) {
+  Compare(ngram::TRIE);
+}
+
+BOOST_AUTO_TEST_CASE(QuantizedTrie) {
+  Compare(ngram::QUANT_TRIE, 8);
+}
+
+}}} // namespaces
@@ -1,6 +1,7 @@
 #ifndef LM_BUILDER_CORPUS_COUNT_H
 #define LM_BUILDER_CORPUS_COUNT_H
 
+#include "lm/builder/shard.hh"
 #include "lm/lm_exception.hh"
 #include "lm/word_index.hh"
 #include "util/scoped.hh"
@@ -30,7 +31,9 @@ class CorpusCount {
 
     // token_count: out.
     // type_count aka vocabulary size.  Initialize to an estimate.  It is set to the exact value.
-    CorpusCount(util::FilePiece &from, int vocab_write, uint64_t &token_count, WordIndex &type_count, std::vector<bool> &prune_words, const std::string& prune_vocab_filename, std::size_t entries_per_block, WarningAction disallowed_symbol);
+    // shard: only n-grams ending with a word the shard owns are counted.  The
+    // vocabulary and token count are still those of the whole corpus.
+    CorpusCount(util::FilePiece &from, int vocab_write, uint64_t &token_count, WordIndex &type_count, std::vector<bool> &prune_words, const std::string& prune_vocab_filename, std::size_t entries_per_block, WarningAction disallowed_symbol, const ShardConfig &shard = ShardConfig());
 
     void Run(const util::stream::ChainPosition &position);
 
@@ -46,6 +49,8 @@ class CorpusCount {
     util::scoped_malloc dedupe_mem_;
 
     WarningAction disallowed_symbol_action_;
+
+    ShardConfig shard_;
 };
 
 } // namespace builder
@@ -3,14 +3,20 @@
 #include "lm/builder/discount.hh"
 #include "lm/builder/hash_gamma.hh"
 #include "lm/builder/payload.hh"
+#include "lm/builder/shard.hh"
 #include "lm/common/special.hh"
 #include "lm/common/ngram_stream.hh"
 #include "util/murmur_hash.hh"
 #include "util/file.hh"
+#include "util/file_stream.hh"
+#include "util/fixed_array.hh"
+#include "util/mmap.hh"
 #include "util/stream/chain.hh"
 #include "util/stream/io.hh"
 #include "util/stream/stream.hh"
 
+#include <queue>
+#include <string>
 #include <vector>
 
 namespace lm { namespace builder {
@@ -28,6 +34,20 @@ struct HashBufferEntry : public BufferEntry {
   uint64_t hash_value;
 };
 
+// counts[i] is the number of extensions with adjusted count i (3 for 3+).
+void SetBufferEntry(const Discount &discount, uint64_t denominator, const uint64_t counts[4], uint64_t normalizer, BufferEntry &entry) {
+  entry.denominator = static_cast<float>(denominator);
+  entry.gamma = 0.0;
+  for (unsigned i = 1; i <= 3; ++i) {
+    entry.gamma += discount.Get(i) * static_cast<float>(counts[i]);
+  }
+
+  // Makes model sum to 1 with pruning (I hope).
+  entry.gamma += normalizer;
+
+  entry.gamma /= entry.denominator;
+}
+
 // Reads all entries in order like NGramStream does.
 // But deletes any entries that have CutoffCount below or equal to pruning
 // threshold.
@@ -177,16 +197,7 @@ class AddRight {
         } while (++in && !memcmp(previous_raw, in->begin(), size));
 
         BufferEntry &entry = *reinterpret_cast<BufferEntry*>(out.Get());
-        entry.denominator = static_cast<float>(denominator);
-        entry.gamma = 0.0;
-        for (unsigned i = 1; i <= 3; ++i) {
-          entry.gamma += discount_.Get(i) * static_cast<float>(counts[i]);
-        }
-
-        // Makes model sum to 1 with pruning (I hope).
-        entry.gamma += normalizer;
-
-        entry.gamma /= entry.denominator;
+        SetBufferEntry(discount_, denominator, counts, normalizer, entry);
 
         if(pruning_) {
           // If pruning is enabled the stream actually contains HashBufferEntry, see InitialProbabilities(...),
@@ -273,6 +284,178 @@ class MergeRight {
     const SpecialVocab specials_;
 };
 
+const std::size_t kShardBufferSize = 1 << 16;
+
+/* AddRight for a shard, which only has some of each context's extensions.
+ * Every shard sends its sums for a context to the shard that owns the
+ * context's last word.  The owner adds them up, keeps gamma for
+ * interpolation (its contexts are the ones Interpolate will want), and sends
+ * the totals back.  Each shard then outputs the totals in the order AddRight
+ * would have.
+ */
+class ShardAddRight {
+  public:
+    ShardAddRight(const ShardConfig &shard, const std::string &temp_prefix, const Discount &discount, const util::stream::ChainPosition &input, const util::stream::ChainPosition &gamma_out)
+      : shard_(shard), temp_prefix_(temp_prefix), discount_(discount), input_(input), gamma_out_(gamma_out) {}
+
+    void Run(const util::stream::ChainPosition &output) {
+      const std::size_t order = NGram<BuildingPayload>::OrderFromSize(input_.GetChain().EntrySize());
+      // Owner of each context, in order.
+      util::scoped_fd owners(util::MakeTemp(temp_prefix_));
+      Send(order, owners.get());
+      Total(order);
+      Receive(order, owners.get(), output);
+    }
+
+  private:
+    // Each record is ContextSums followed by the context.
+    struct ContextSums {
+      uint64_t denominator;
+      // Extensions with adjusted count 1, 2, and 3+.  0 is unused.
+      uint64_t counts[4];
+    };
+
+    // Orders records by context, suffix first, with the least on top of a priority queue.
+    class GreaterContext {
+      public:
+        explicit GreaterContext(std::size_t words) : words_(words) {}
+
+        bool operator()(const SharedRecords *first, const SharedRecords *second) const {
+          const WordIndex *f = Context(first->Get()), *s = Context(second->Get());
+          for (std::size_t i = words_; i;) {
+            --i;
+            if (f[i] != s[i]) return f[i] > s[i];
+          }
+          return false;
+        }
+
+      private:
+        std::size_t words_;
+    };
+
+    static const WordIndex *Context(const void *record) {
+      return reinterpret_cast<const WordIndex*>(static_cast<const uint8_t*>(record) + sizeof(ContextSums));
+    }
+
+    void Send(std::size_t order, int owners_file) {
+      util::FixedArray<util::scoped_fd> files(shard_.count);
+      util::FixedArray<util::FileStream> to(shard_.count);
+      for (std::size_t i = 0; i < shard_.count; ++i) {
+        files.push_back(CreateShared(shard_.File("sums", order, shard_.index, i)));
+        to.push_back(files.back().get(), kShardBufferSize);
+      }
+      util::FileStream owners(owners_file, kShardBufferSize);
+
+      NGramStream<BuildingPayload> in(input_);
+      std::vector<WordIndex> previous(order - 1);
+      void *const previous_raw = previous.empty() ? NULL : static_cast<void*>(&previous[0]);
+      const std::size_t size = sizeof(WordIndex) * previous.size();
+      while (in) {
+        memcpy(previous_raw, in->begin(), size);
+        ContextSums sums;
+        memset(&sums, 0, sizeof(sums));
+        do {
+          sums.denominator += in->Value().UnmarkedCount();
+          if (in->Value().CutoffCount() > 0)
+            ++sums.counts[std::min(in->Value().CutoffCount(), static_cast<uint64_t>(3))];
+        } while (++in && !memcmp(previous_raw, in->begin(), size));
+
+        // The empty context of unigrams belongs to shard 0.
+        const uint32_t owner = previous.empty() ? 0 : shard_.Owner(previous.back());
+        to[owner].write(&sums, sizeof(ContextSums));
+        if (size) to[owner].write(previous_raw, size);
+        owners.write(&owner, sizeof(owner));
+      }
+      owners.flush();
+      for (std::size_t i = 0; i < shard_.count; ++i) {
+        to[i].flush();
+        PublishShared(shard_.File("sums", order, shard_.index, i));
+      }
+    }
+
+    void Total(std::size_t order) {
+      const std::size_t size = sizeof(WordIndex) * (order - 1);
+      util::FixedArray<SharedRecords> from(shard_.count);
+      util::FixedArray<util::scoped_fd> files(shard_.count);
+      util::FixedArray<util::FileStream> back(shard_.count);
+      std::priority_queue<SharedRecords*, std::vector<SharedRecords*>, GreaterContext> queue((GreaterContext(order - 1)));
+      for (std::size_t i = 0; i < shard_.count; ++i) {
+        from.push_back(shard_.File("sums", order, i, shard_.index), sizeof(ContextSums) + size);
+        if (from.back()) queue.push(&from.back());
+        files.push_back(CreateShared(shard_.File("totals", order, shard_.index, i)));
+        back.push_back(files.back().get(), kShardBufferSize);
+      }
+
+      util::stream::Stream gammas(gamma_out_);
+      if (order == 2 && shard_.index) {
+        // Every shard has the <s> unigram, so Interpolate wants its backoff
+        // first.  Only shard 0's <s> is kept, so anything will do.
+        *static_cast<float*>(gammas.Get()) = 0.0;
+        ++gammas;
+      }
+      std::vector<WordIndex> context(order - 1);
+      void *const context_raw = context.empty() ? NULL : static_cast<void*>(&context[0]);
+      std::vector<std::size_t> senders;
+      while (!queue.empty()) {
+        memcpy(context_raw, Context(queue.top()->Get()), size);
+        ContextSums total;
+        memset(&total, 0, sizeof(total));
+        senders.clear();
+        do {
+          SharedRecords *top = queue.top();
+          queue.pop();
+          ContextSums sums;
+          memcpy(&sums, top->Get(), sizeof(ContextSums));
+          total.denominator += sums.denominator;
+          for (unsigned i = 1; i <= 3; ++i) {
+            total.counts[i] += sums.counts[i];
+          }
+          senders.push_back(top - from.begin());
+          if (++*top) queue.push(top);
+        } while (!queue.empty() && !memcmp(context_raw, Context(queue.top()->Get()), size));
+
+        BufferEntry entry;
+        SetBufferEntry(discount_, total.denominator, total.counts, 0, entry);
+        for (std::vector<std::size_t>::const_iterator i = senders.begin(); i != senders.end(); ++i) {
+          back[*i].write(&entry, sizeof(BufferEntry));
+        }
+        *static_cast<float*>(gammas.Get()) = entry.gamma;
+        ++gammas;
+      }
+      gammas.Poison();
+      for (std::size_t i = 0; i < shard_.count; ++i) {
+        back[i].flush();
+        PublishShared(shard_.File("totals", order, shard_.index, i));
+      }
+    }
+
+    void Receive(std::size_t order, int owners_file, const util::stream::ChainPosition &output) {
+      util::FixedArray<SharedRecords> from(shard_.count);
+      for (std::size_t i = 0; i < shard_.count; ++i) {
+        from.push_back(shard_.File("totals", order, i, shard_.index), sizeof(BufferEntry));
+      }
+      const uint64_t contexts = util::SizeOrThrow(owners_file) / sizeof(uint32_t);
+      util::scoped_memory owners;
+      if (contexts) util::MapRead(util::LAZY, owners_file, 0, contexts * sizeof(uint32_t), owners);
+
+      util::stream::Stream out(output);
+      const uint32_t *const owners_begin = static_cast<const uint32_t*>(owners.get());
+      for (const uint32_t *owner = owners_begin; owner != owners_begin + contexts; ++owner, ++out) {
+        SharedRecords &totals = from[*owner];
+        UTIL_THROW_IF(!totals, util::Exception, "Shard " << *owner << " returned fewer " << order << "-gram context totals than shard " << shard_.index << " sent.");
+        memcpy(out.Get(), totals.Get(), sizeof(BufferEntry));
+        ++totals;
+      }
+      out.Poison();
+    }
+
+    const ShardConfig &shard_;
+    const std::string temp_prefix_;
+    const Discount &discount_;
+    const util::stream::ChainPosition input_;
+    const util::stream::ChainPosition gamma_out_;
+};
+
 } // namespace
 
 void InitialProbabilities(
@@ -303,4 +486,31 @@ void InitialProbabilities(
   }
 }
 
+void ShardInitialProbabilities(
+    const InitialProbabilitiesConfig &config,
+    const ShardConfig &shard,
+    const std::string &temp_prefix,
+    const std::vector<Discount> &discounts,
+    util::stream::Chains &primary,
+    util::stream::Chains &second_in,
+    util::stream::Chains &totals,
+    util::stream::Chains &gamma_out,
+    const SpecialVocab &specials) {
+  for (size_t i = 0; i < primary.size(); ++i) {
+    util::stream::ChainConfig totals_config = config.adder_out;
+    totals_config.entry_size = sizeof(BufferEntry);
+    util::stream::ChainConfig gamma_config = config.adder_out;
+    gamma_config.entry_size = sizeof(float);
+
+    util::stream::ChainPosition second(second_in[i].Add());
+    second_in[i] >> util::stream::kRecycle;
+    gamma_out.push_back(gamma_config);
+    totals.push_back(totals_config);
+    totals[i] >> ShardAddRight(shard, temp_prefix, discounts[i], second, gamma_out[i].Add());
+
+    primary[i] >> MergeRight(config.interpolate_unigrams, totals[i].Add(), discounts[i], specials);
+    totals[i] >> util::stream::kRecycle;
+  }
+}
+
 }} // namespaces
@@ -5,6 +5,7 @@
 #include "lm/word_index.hh"
 #include "util/stream/config.hh"
 
+#include <string>
 #include <vector>
 
 namespace util { namespace stream { class Chains; } }
@@ -13,6 +14,8 @@ namespace lm {
 class SpecialVocab;
 namespace builder {
 
+struct ShardConfig;
+
 struct InitialProbabilitiesConfig {
   // These should be small buffers to keep the adder from getting too far ahead
   util::stream::ChainConfig adder_in;
@@ -39,6 +42,23 @@ void InitialProbabilities(
     bool prune_vocab,
     const SpecialVocab &vocab);
 
+/* The same for one of several shards (see shard.hh), without pruning.
+ * totals: carries the sums over each context's extensions, including other
+ *   shards', to primary.  Must stay in scope until primary is done.
+ * gamma_out: bare float gamma values for the contexts this shard owns, which
+ *   are the ones Interpolate on this shard needs.
+ */
+void ShardInitialProbabilities(
+    const InitialProbabilitiesConfig &config,
+    const ShardConfig &shard,
+    const std::string &temp_prefix,
+    const std::vector<Discount> &discounts,
+    util::stream::Chains &primary,
+    util::stream::Chains &second_in,
+    util::stream::Chains &totals,
+    util::stream::Chains &gamma_out,
+    const SpecialVocab &vocab);
+
 } // namespace builder
 } // namespace lm
 
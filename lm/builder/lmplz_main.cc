@@ -72,7 +72,8 @@ int main(int argc, char *argv[]) {
     po::options_description options("Language model building options");
     lm::builder::PipelineConfig pipeline;
 
-    std::string text, intermediate, arpa;
+    std::string text, intermediate, arpa, binary, binary_type;
+    unsigned int quantize, array_bits;
     std::vector<std::string> pruning;
     std::vector<std::string> discount_fallback;
     std::vector<std::string> discount_fallback_default;
@@ -101,6 +102,13 @@ int main(int argc, char *argv[]) {
       ("text", po::value<std::string>(&text), "Read text from a file instead of stdin")
       ("arpa", po::value<std::string>(&arpa), "Write ARPA to a file instead of stdout")
       ("intermediate", po::value<std::string>(&intermediate), "Write ngrams to intermediate files.  Turns off ARPA output (which can be reactivated by --arpa file).  Forces --renumber on.")
+      ("binary", po::value<std::string>(&binary), "Write a binary model, as build_binary would, without writing and parsing an ARPA file.  Turns off ARPA output (which can be reactivated by --arpa file).")
+      ("binary_type", po::value<std::string>(&binary_type)->default_value("probing"), "Data structure of the binary model: probing, trie, or perfect.  trie forces --renumber on.")
+      ("quantize", po::value<unsigned int>(&quantize)->default_value(0), "Quantize probabilities and backoffs in the trie or perfect hash to this many bits, like build_binary -q and -b.  Default is no quantization.")
+      ("array", po::value<unsigned int>(&array_bits)->default_value(0), "Compress trie pointers using an array of offsets with up to this many bits, like build_binary -a.  Default is not to.")
+      ("shards", po::value<std::size_t>(&pipeline.shard.count)->default_value(1), "Split the work among this many lmplz processes, run with the same options except --shard_index.  They can run on different machines that share --shard_dir and can all read the corpus.  Only shard 0 writes the model.")
+      ("shard_index", po::value<std::size_t>(&pipeline.shard.index)->default_value(0), "Which of the --shards this process is, counting from 0.")
+      ("shard_dir", po::value<std::string>(&pipeline.shard.dir), "Empty directory through which the --shards exchange their data.")
       ("renumber", po::bool_switch(&pipeline.renumber_vocabulary), "Rrenumber the vocabulary identifiers so that they are monotone with the hash of each string.  This is consistent with the ordering used by the trie data structure.")
       ("collapse_values", po::bool_switch(&pipeline.output_q), "Collapse probability and backoff into a single value, q that yields the same sentence-level probabilities.  See http://kheafield.com/professional/edinburgh/rest_paper.pdf for more details, including a proof.")
       ("prune", po::value<std::vector<std::string> >(&pruning)->multitoken(), "Prune n-grams with count less than or equal to the given threshold.  Specify one value for each order i.e. 0 0 1 to prune singleton trigrams and above.  The sequence of values must be non-decreasing and the last value applies to any remaining orders. Default is to not prune, which is equivalent to --prune 0.")
@@ -193,19 +201,64 @@ int main(int argc, char *argv[]) {
     if (vm.count("text")) {
       in.reset(util::OpenReadOrThrow(text.c_str()));
     }
-    if (vm.count("arpa")) {
+    if (vm.count("arpa") && !pipeline.shard.index) {
       out.reset(util::CreateOrThrow(arpa.c_str()));
     }
 
+    lm::ngram::ModelType binary_model_type = lm::ngram::PROBING;
+    lm::ngram::Config binary_config;
+    bool writing_binary = vm.count("binary");
+    if (writing_binary) {
+      UTIL_THROW_IF(pipeline.output_q, util::Exception, "--binary can't be combined with --collapse_values");
+      if (binary_type == "probing") {
+        UTIL_THROW_IF(quantize || array_bits, util::Exception, "Quantization is only supported by --binary_type trie or perfect and pointer compression by trie");
+        binary_config.write_method = lm::ngram::Config::WRITE_AFTER;
+      } else if (binary_type == "trie") {
+        // Same order as the trie's vocabulary, so the n-grams arrive mostly sorted.
+        pipeline.renumber_vocabulary = true;
+        binary_model_type = lm::ngram::TRIE;
+        if (quantize) {
+          binary_config.prob_bits = binary_config.backoff_bits = quantize;
+          binary_model_type = static_cast<lm::ngram::ModelType>(binary_model_type + lm::ngram::kQuantAdd);
+        }
+        if (array_bits) {
+          binary_config.pointer_bhiksha_bits = array_bits;
+          binary_model_type = static_cast<lm::ngram::ModelType>(binary_model_type + lm::ngram::kArrayAdd);
+        }
+        binary_config.write_method = lm::ngram::Config::WRITE_MMAP;
+      } else if (binary_type == "perfect") {
+        UTIL_THROW_IF(array_bits, util::Exception, "Pointer compression is only supported by --binary_type trie");
+        binary_model_type = lm::ngram::PERFECT_HASH;
+        if (quantize) binary_config.prob_bits = binary_config.backoff_bits = quantize;
+        binary_config.write_method = lm::ngram::Config::WRITE_AFTER;
+      } else {
+        UTIL_THROW(util::Exception, "Unknown --binary_type " << binary_type << ".  Use probing, trie, or perfect.");
+      }
+      binary_config.temporary_directory_prefix = pipeline.sort.temp_prefix;
+      binary_config.building_memory = pipeline.sort.total_memory;
+    }
+
+    if (pipeline.shard.Enabled()) {
+      UTIL_THROW_IF(pipeline.shard.index >= pipeline.shard.count, util::Exception, "--shard_index " << pipeline.shard.index << " should be less than --shards " << pipeline.shard.count);
+      UTIL_THROW_IF(pipeline.shard.dir.empty(), util::Exception, "--shards requires --shard_dir");
+      UTIL_THROW_IF(pipeline.order < 2, util::Exception, "--shards requires order 2 or more");
+      UTIL_THROW_IF(pipeline.prune_vocab || pipeline.prune_thresholds.back(), util::Exception, "--shards can't be combined with --prune or --limit_vocab_file");
+      // Each shard would renumber only the words it has.
+      UTIL_THROW_IF(pipeline.renumber_vocabulary || vm.count("intermediate"), util::Exception, "--shards can't be combined with --renumber or options that force it: --intermediate and --binary_type trie");
+    }
+
     try {
       bool writing_intermediate = vm.count("intermediate");
       if (writing_intermediate) {
         pipeline.renumber_vocabulary = true;
       }
       lm::builder::Output output(writing_intermediate ? intermediate : pipeline.sort.temp_prefix, writing_intermediate, pipeline.output_q);
-      if (!writing_intermediate || vm.count("arpa")) {
+      if ((!writing_intermediate && !writing_binary) || vm.count("arpa")) {
         output.Add(new lm::builder::PrintHook(out.release(), verbose_header));
       }
+      if (writing_binary) {
+        output.Add(new lm::builder::BinaryHook(binary, binary_model_type, binary_config));
+      }
       lm::builder::Pipeline(pipeline, in.release(), output);
     } catch (const util::MallocException &e) {
       std::cerr << e.what() << std::endl;
@@ -1,14 +1,122 @@
 #include "lm/builder/output.hh"
 
 #include "lm/common/model_buffer.hh"
+#include "lm/common/ngram_stream.hh"
 #include "lm/common/print.hh"
+#include "lm/model.hh"
+#include "lm/read_arpa.hh"
 #include "util/file_stream.hh"
 #include "util/stream/multi_stream.hh"
 
+#include <boost/scoped_ptr.hpp>
+
 #include <iostream>
 
 namespace lm { namespace builder {
 
+namespace {
+
+// N-grams for the model builders, read in the order PrintARPA would print them.
+// Like PrintARPA, an order's stream is only opened once the lower orders are
+// done, so both can be on the same chains.
+class StreamSource : public NGramSource {
+  public:
+    StreamSource(const util::stream::ChainPositions &positions, int vocab_file, const std::vector<uint64_t> &counts)
+      : positions_(positions), vocab_(vocab_file), counts_(counts), order_(0), index_(0) {}
+
+    void ReadCounts(std::vector<uint64_t> &number) {
+      number = counts_;
+    }
+
+    void BeginOrder(unsigned int length) {
+      UTIL_THROW_IF(length != order_ + 1, util::Exception, "Asked for " << length << "-grams after " << order_ << "-grams");
+      UTIL_THROW_IF(length > positions_.size(), util::Exception, "Asked for " << length << "-grams from a " << positions_.size() << "-gram model");
+      if (order_) FinishOrder();
+      order_ = length;
+      index_ = 0;
+      stream_.reset(new NGramStream<ProbBackoff>(positions_[order_ - 1]));
+    }
+
+    void Next() {
+      // The previous n-gram is not passed on until the next is asked for.
+      if (index_) ++*stream_;
+      UTIL_THROW_IF(!*stream_, util::Exception, "There are more " << order_ << "-grams in the counts than the stream");
+      ++index_;
+    }
+
+    StringPiece Word(unsigned int index) const {
+      return vocab_.LookupPiece((*stream_)->begin()[index]);
+    }
+
+    float Prob() const { return (*stream_)->Value().prob; }
+
+    float Backoff() const { return (*stream_)->Value().backoff; }
+
+    uint64_t Offset() const { return index_; }
+
+    void End() {
+      UTIL_THROW_IF(order_ != positions_.size(), util::Exception, "Stopped reading at " << order_ << "-grams of a " << positions_.size() << "-gram model");
+      FinishOrder();
+    }
+
+  private:
+    void FinishOrder() {
+      if (index_) ++*stream_;
+      UTIL_THROW_IF(*stream_, util::Exception, "There are more " << order_ << "-grams in the stream than the counts");
+    }
+
+    const util::stream::ChainPositions &positions_;
+    boost::scoped_ptr<NGramStream<ProbBackoff> > stream_;
+    VocabReconstitute vocab_;
+    std::vector<uint64_t> counts_;
+    unsigned int order_;
+    uint64_t index_;
+};
+
+class BuildBinary {
+  public:
+    // Does not take ownership of vocab_file.
+    BuildBinary(const std::string &file, ngram::ModelType model_type, const ngram::Config &config, int vocab_file, const std::vector<uint64_t> &counts)
+      : file_(file), model_type_(model_type), config_(config), vocab_file_(vocab_file), counts_(counts) {}
+
+    void Run(const util::stream::ChainPositions &positions) {
+      StreamSource source(positions, vocab_file_, counts_);
+      ngram::Config config(config_);
+      config.write_mmap = file_.c_str();
+      switch (model_type_) {
+        case ngram::PROBING:
+          ngram::ProbingModel(file_.c_str(), source, config);
+          break;
+        case ngram::TRIE:
+          ngram::TrieModel(file_.c_str(), source, config);
+          break;
+        case ngram::QUANT_TRIE:
+          ngram::QuantTrieModel(file_.c_str(), source, config);
+          break;
+        case ngram::ARRAY_TRIE:
+          ngram::ArrayTrieModel(file_.c_str(), source, config);
+          break;
+        case ngram::QUANT_ARRAY_TRIE:
+          ngram::QuantArrayTrieModel(file_.c_str(), source, config);
+          break;
+        case ngram::PERFECT_HASH:
+          ngram::PerfectHashModel(file_.c_str(), source, config);
+          break;
+        default:
+          UTIL_THROW(util::Exception, "lmplz can't build " << ngram::kModelNames[model_type_] << " models");
+      }
+    }
+
+  private:
+    std::string file_;
+    ngram::ModelType model_type_;
+    ngram::Config config_;
+    int vocab_file_;
+    std::vector<uint64_t> counts_;
+};
+
+} // namespace
+
 OutputHook::~OutputHook() {}
 
 Output::Output(StringPiece file_base, bool keep_buffer, bool output_q)
@@ -25,7 +133,12 @@ void Output::SinkProbs(util::stream::Chains &chains) {
   chains >> util::stream::kRecycle;
   chains.Wait(false);
   if (Have(PROB_SEQUENTIAL_HOOK)) {
-    std::cerr << "=== 5/5 Writing ARPA model ===" << std::endl;
+    std::cerr << "=== 5/5 Writing ";
+    for (boost::ptr_vector<OutputHook>::const_iterator i = outputs_[PROB_SEQUENTIAL_HOOK].begin(); i != outputs_[PROB_SEQUENTIAL_HOOK].end(); ++i) {
+      if (i != outputs_[PROB_SEQUENTIAL_HOOK].begin()) std::cerr << " and ";
+      std::cerr << i->Name();
+    }
+    std::cerr << " ===" << std::endl;
     buffer_.Source(chains);
     Apply(PROB_SEQUENTIAL_HOOK, chains);
     chains >> util::stream::kRecycle;
@@ -49,4 +162,8 @@ void PrintHook::Sink(const HeaderInfo &info, int vocab_file, util::stream::Chain
   chains >> PrintARPA(vocab_file, file_.get(), info.counts_pruned);
 }
 
+void BinaryHook::Sink(const HeaderInfo &info, int vocab_file, util::stream::Chains &chains) {
+  chains >> BuildBinary(file_, model_type_, config_, vocab_file, info.counts_pruned);
+}
+
 }} // namespaces
@@ -3,6 +3,8 @@
 
 #include "lm/builder/header_info.hh"
 #include "lm/common/model_buffer.hh"
+#include "lm/config.hh"
+#include "lm/model_type.hh"
 #include "util/file.hh"
 
 #include <boost/ptr_container/ptr_vector.hpp>
@@ -31,6 +33,9 @@ class OutputHook {
 
     HookType Type() const { return type_; }
 
+    // What is written, for the progress message.
+    virtual const char *Name() const { return "model"; }
+
   private:
     HookType type_;
 };
@@ -75,11 +80,33 @@ class PrintHook : public OutputHook {
 
     void Sink(const HeaderInfo &info, int vocab_file, util::stream::Chains &chains);
 
+    const char *Name() const { return "ARPA model"; }
+
   private:
     util::scoped_fd file_;
     bool verbose_header_;
 };
 
+/* Builds a binary model, as build_binary would from the ARPA file, but reads
+ * the n-grams straight from the chains instead of parsing text.  This supports
+ * every model type except rest costs.
+ */
+class BinaryHook : public OutputHook {
+  public:
+    // config.write_mmap is ignored; the model is written to file.
+    BinaryHook(const std::string &file, ngram::ModelType model_type, const ngram::Config &config)
+      : OutputHook(PROB_SEQUENTIAL_HOOK), file_(file), model_type_(model_type), config_(config) {}
+
+    void Sink(const HeaderInfo &info, int vocab_file, util::stream::Chains &chains);
+
+    const char *Name() const { return "binary model"; }
+
+  private:
+    std::string file_;
+    ngram::ModelType model_type_;
+    ngram::Config config_;
+};
+
 }} // namespaces
 
 #endif // LM_BUILDER_OUTPUT_H
@@ -7,6 +7,7 @@
 #include "lm/builder/initial_probabilities.hh"
 #include "lm/builder/interpolate.hh"
 #include "lm/builder/output.hh"
+#include "lm/builder/shard.hh"
 #include "lm/common/compare.hh"
 #include "lm/common/renumber.hh"
 
@@ -227,7 +228,7 @@ util::stream::Sort<SuffixOrder, CombineCounts> *CountText(int text_file /* input
   type_count = config.vocab_estimate;
   util::FilePiece text(text_file, NULL, &std::cerr);
   text_file_name = text.FileName();
-  CorpusCount counter(text, vocab_file, token_count, type_count, prune_words, config.prune_vocab_file, chain.BlockSize() / chain.EntrySize(), config.disallowed_symbol_action);
+  CorpusCount counter(text, vocab_file, token_count, type_count, prune_words, config.prune_vocab_file, chain.BlockSize() / chain.EntrySize(), config.disallowed_symbol_action, config.shard);
   chain >> boost::ref(counter);
 
   util::scoped_ptr<util::stream::Sort<SuffixOrder, CombineCounts> > sorter(new util::stream::Sort<SuffixOrder, CombineCounts>(chain, config.sort, SuffixOrder(config.order), CombineCounts()));
@@ -235,13 +236,21 @@ util::stream::Sort<SuffixOrder, CombineCounts> *CountText(int text_file /* input
   return sorter.release();
 }
 
-void InitialProbabilities(const std::vector<uint64_t> &counts, const std::vector<uint64_t> &counts_pruned, const std::vector<Discount> &discounts, Master &master, Sorts<SuffixOrder> &primary, util::FixedArray<util::stream::FileBuffer> &gammas, const std::vector<uint64_t> &prune_thresholds, bool prune_vocab, const SpecialVocab &specials) {
+// With shards, counts, counts_pruned, and discounts are replaced with those of
+// the whole model, computed from every shard's stats.
+void InitialProbabilities(std::vector<uint64_t> &counts, std::vector<uint64_t> &counts_pruned, std::vector<Discount> &discounts, const std::vector<OrderStat> &shard_stats, Master &master, Sorts<SuffixOrder> &primary, util::FixedArray<util::stream::FileBuffer> &gammas, const std::vector<uint64_t> &prune_thresholds, bool prune_vocab, const SpecialVocab &specials) {
   const PipelineConfig &config = master.Config();
   util::stream::Chains second(config.order);
 
   {
     Sorts<ContextOrder> sorts;
     master.SetupSorts(sorts, !config.renumber_vocabulary);
+    if (config.shard.Enabled()) {
+      // Chains are sized by the whole model's counts, which are upper bounds.
+      std::vector<OrderStat> total;
+      ExchangeStats(config.shard, shard_stats, total);
+      CalculateDiscounts(total, config.discount, counts, counts_pruned, discounts);
+    }
     PrintStatistics(counts, counts_pruned, discounts);
     lm::ngram::ShowSizes(counts_pruned);
     std::cerr << "=== 3/" << master.Steps() << " Calculating and sorting initial probabilities ===" << std::endl;
@@ -249,7 +258,12 @@ void InitialProbabilities(const std::vector<uint64_t> &counts, const std::vector
   }
 
   util::stream::Chains gamma_chains(config.order);
-  InitialProbabilities(config.initial_probs, discounts, master.MutableChains(), second, gamma_chains, prune_thresholds, prune_vocab, specials);
+  util::stream::Chains shard_totals(config.order);
+  if (config.shard.Enabled()) {
+    ShardInitialProbabilities(config.initial_probs, config.shard, config.TempPrefix(), discounts, master.MutableChains(), second, shard_totals, gamma_chains, specials);
+  } else {
+    InitialProbabilities(config.initial_probs, discounts, master.MutableChains(), second, gamma_chains, prune_thresholds, prune_vocab, specials);
+  }
   // Don't care about gamma for 0.
   gamma_chains[0] >> util::stream::kRecycle;
   gammas.Init(config.order - 1);
@@ -280,6 +294,10 @@ void InterpolateProbabilities(const std::vector<uint64_t> &counts, Master &maste
   }
   master >> Interpolate(std::max(master.Config().vocab_size_for_unk, counts[0] - 1 /* <s> is not included */), util::stream::ChainPositions(gamma_chains), config.prune_thresholds, config.prune_vocab, config.output_q, specials);
   gamma_chains >> util::stream::kRecycle;
+  if (config.shard.Enabled()) {
+    ExchangeProbs(config.shard, master.MutableChains());
+    if (config.shard.index) return;
+  }
   output.SinkProbs(master.MutableChains());
 }
 
@@ -342,6 +360,8 @@ void Pipeline(PipelineConfig &config, int text_file, Output &output) {
   UTIL_THROW_IF(config.TotalMemory() < config.minimum_block * config.order * config.block_count, util::Exception,
       "Not enough memory to fit " << (config.order * config.block_count) << " blocks with minimum size " << config.minimum_block << ".  Increase memory to " << (config.minimum_block * config.order * config.block_count) << " bytes or decrease the minimum block size.");
 
+  if (config.shard.Enabled()) CheckShardDir(config.shard);
+
   Master master(config, output.Steps());
   // master's destructor will wait for chains.  But they might be deadlocked if
   // this thread dies because e.g. it ran out of memory.
@@ -365,13 +385,14 @@ void Pipeline(PipelineConfig &config, int text_file, Output &output) {
     std::vector<uint64_t> counts;
     std::vector<uint64_t> counts_pruned;
     std::vector<Discount> discounts;
-    master >> AdjustCounts(config.prune_thresholds, counts, counts_pruned, prune_words, config.discount, discounts);
+    std::vector<OrderStat> shard_stats;
+    master >> AdjustCounts(config.prune_thresholds, counts, counts_pruned, prune_words, config.discount, discounts, config.shard.Enabled() ? &shard_stats : NULL);
     numbering.ApplyRenumber(master.MutableChains());
 
     {
       util::FixedArray<util::stream::FileBuffer> gammas;
       Sorts<SuffixOrder> primary;
-      InitialProbabilities(counts, counts_pruned, discounts, master, primary, gammas, config.prune_thresholds, config.prune_vocab, numbering.Specials());
+      InitialProbabilities(counts, counts_pruned, discounts, shard_stats, master, primary, gammas, config.prune_thresholds, config.prune_vocab, numbering.Specials());
       output.SetHeader(HeaderInfo(text_file_name, token_count, counts_pruned));
       // Also does output.
       InterpolateProbabilities(counts_pruned, master, primary, gammas, output, numbering.Specials());
@@ -4,6 +4,7 @@
 #include "lm/builder/adjust_counts.hh"
 #include "lm/builder/initial_probabilities.hh"
 #include "lm/builder/header_info.hh"
+#include "lm/builder/shard.hh"
 #include "lm/lm_exception.hh"
 #include "lm/word_index.hh"
 #include "util/stream/config.hh"
@@ -65,6 +66,11 @@ struct PipelineConfig {
    */
   WarningAction disallowed_symbol_action;
 
+  /* Build with several processes, this being one of them.  See shard.hh.
+   * Only shard 0 writes output.
+   */
+  ShardConfig shard;
+
   const std::string &TempPrefix() const { return sort.temp_prefix; }
   std::size_t TotalMemory() const { return sort.total_memory; }
 };
@@ -0,0 +1,187 @@
+#include "lm/builder/shard.hh"
+
+#include "lm/builder/payload.hh"
+#include "lm/common/compare.hh"
+#include "lm/common/ngram.hh"
+#include "util/exception.hh"
+#include "util/file.hh"
+#include "util/fixed_array.hh"
+#include "util/stream/chain.hh"
+#include "util/stream/io.hh"
+#include "util/stream/multi_stream.hh"
+#include "util/stream/stream.hh"
+
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <queue>
+
+#include <fcntl.h>
+
+namespace lm { namespace builder {
+
+namespace {
+const unsigned int kPollMilliseconds = 100;
+// Say something if a shard has been waiting this long.
+const unsigned int kComplainPolls = 600;
+
+std::string Unpublished(const std::string &name) {
+  return name + ".partial";
+}
+
+// Orders shared records with the least on top of a priority queue.
+class GreaterRecord {
+  public:
+    explicit GreaterRecord(std::size_t order) : compare_(order) {}
+
+    bool operator()(const SharedRecords *first, const SharedRecords *second) const {
+      return compare_(second->Get(), first->Get());
+    }
+
+  private:
+    SuffixOrder compare_;
+};
+
+// Merges the n-grams of one order from every shard.
+class MergeProbs {
+  public:
+    MergeProbs(const ShardConfig &shard, std::size_t order) : shard_(shard), order_(order) {}
+
+    void Run(const util::stream::ChainPosition &position) {
+      const std::size_t size = NGram<BuildingPayload>::TotalSize(order_);
+      util::FixedArray<SharedRecords> from(shard_.count);
+      std::priority_queue<SharedRecords*, std::vector<SharedRecords*>, GreaterRecord> queue((GreaterRecord(order_)));
+      for (std::size_t i = 0; i < shard_.count; ++i) {
+        from.push_back(shard_.File("probs", order_, i), size);
+        // Every shard has <unk> and <s>, but only shard 0 knows their probabilities.
+        if (i && order_ == 1) {
+          while (from.back() && *static_cast<const WordIndex*>(from.back().Get()) <= kBOS) ++from.back();
+        }
+        if (from.back()) queue.push(&from.back());
+      }
+      // Everybody read the stats before writing probabilities, so clean up.
+      if (order_ == 1) {
+        for (std::size_t i = 0; i < shard_.count; ++i) {
+          UTIL_THROW_IF(std::remove(shard_.File("stats", i).c_str()), util::ErrnoException, "Failed to delete " << shard_.File("stats", i));
+        }
+      }
+      util::stream::Stream out(position);
+      while (!queue.empty()) {
+        SharedRecords *top = queue.top();
+        queue.pop();
+        memcpy(out.Get(), top->Get(), size);
+        ++out;
+        if (++*top) queue.push(top);
+      }
+      out.Poison();
+    }
+
+  private:
+    const ShardConfig &shard_;
+    std::size_t order_;
+};
+} // namespace
+
+std::string ShardConfig::File(const char *kind, std::size_t a) const {
+  return dir + '/' + kind + '.' + boost::lexical_cast<std::string>(a);
+}
+
+std::string ShardConfig::File(const char *kind, std::size_t a, std::size_t b) const {
+  return File(kind, a) + '.' + boost::lexical_cast<std::string>(b);
+}
+
+std::string ShardConfig::File(const char *kind, std::size_t a, std::size_t b, std::size_t c) const {
+  return File(kind, a, b) + '.' + boost::lexical_cast<std::string>(c);
+}
+
+int CreateShared(const std::string &name) {
+  return util::CreateOrThrow(Unpublished(name).c_str());
+}
+
+void PublishShared(const std::string &name) {
+  UTIL_THROW_IF(std::rename(Unpublished(name).c_str(), name.c_str()), util::ErrnoException, "Failed to rename " << Unpublished(name) << " to " << name);
+}
+
+int OpenShared(const std::string &name) {
+  int fd;
+  for (unsigned int polls = 1; -1 == (fd = open(name.c_str(), O_RDONLY)); ++polls) {
+    UTIL_THROW_IF(errno != ENOENT, util::ErrnoException, "while opening " << name);
+    if (polls % kComplainPolls == 0) {
+      std::cerr << "Still waiting for another shard to write " << name << std::endl;
+    }
+    boost::this_thread::sleep(boost::posix_time::milliseconds(kPollMilliseconds));
+  }
+  return fd;
+}
+
+SharedRecords::SharedRecords(const std::string &name, std::size_t record_size) : record_size_(record_size) {
+  util::scoped_fd file(OpenShared(name));
+  const uint64_t size = util::SizeOrThrow(file.get());
+  UTIL_THROW_IF(size % record_size, util::Exception, "Size " << size << " of " << name << " is not a multiple of " << record_size);
+  // mmap refuses empty files.
+  if (size) util::MapRead(util::LAZY, file.get(), 0, size, mem_);
+  current_ = static_cast<const uint8_t*>(mem_.get());
+  end_ = current_ + size;
+  UTIL_THROW_IF(std::remove(name.c_str()), util::ErrnoException, "Failed to delete " << name);
+}
+
+void CheckShardDir(const ShardConfig &shard) {
+  const std::string name(shard.File("stats", shard.index));
+  util::scoped_fd existing(open(name.c_str(), O_RDONLY));
+  UTIL_THROW_IF(existing.get() != -1, util::Exception, name << " already exists.  Start from an empty --shard_dir.");
+}
+
+void ExchangeStats(const ShardConfig &shard, const std::vector<OrderStat> &mine, std::vector<OrderStat> &total) {
+  std::vector<OrderStat> send(mine);
+  // AdjustCounts always adds <unk> and <s>.  They only count in shard 0.
+  if (shard.index) {
+    send[0].count -= 2;
+    send[0].count_pruned -= 2;
+    send[0].n[0] -= 2;
+  }
+  const std::size_t bytes = sizeof(OrderStat) * send.size();
+  const std::string name(shard.File("stats", shard.index));
+  {
+    util::scoped_fd out(CreateShared(name));
+    util::WriteOrThrow(out.get(), &send[0], bytes);
+  }
+  PublishShared(name);
+
+  total.resize(send.size());
+  memset(&total[0], 0, bytes);
+  for (std::size_t i = 0; i < shard.count; ++i) {
+    util::scoped_fd in(OpenShared(shard.File("stats", i)));
+    util::ReadOrThrow(in.get(), &send[0], bytes);
+    for (std::size_t order = 0; order < total.size(); ++order) {
+      for (unsigned j = 0; j < 5; ++j) {
+        total[order].n[j] += send[order].n[j];
+      }
+      total[order].count += send[order].count;
+      total[order].count_pruned += send[order].count_pruned;
+    }
+  }
+}
+
+void ExchangeProbs(const ShardConfig &shard, util::stream::Chains &chains) {
+  util::FixedArray<util::scoped_fd> files(chains.size());
+  for (std::size_t i = 0; i < chains.size(); ++i) {
+    files.push_back(CreateShared(shard.File("probs", i + 1, shard.index)));
+    chains[i] >> util::stream::Write(files.back().get());
+  }
+  chains >> util::stream::kRecycle;
+  chains.Wait(false);
+  for (std::size_t i = 0; i < chains.size(); ++i) {
+    PublishShared(shard.File("probs", i + 1, shard.index));
+  }
+  if (shard.index) return;
+
+  for (std::size_t i = 0; i < chains.size(); ++i) {
+    chains[i] >> MergeProbs(shard, i + 1);
+  }
+}
+
+}} // namespaces
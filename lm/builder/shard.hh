@@ -0,0 +1,96 @@
+#ifndef LM_BUILDER_SHARD_H
+#define LM_BUILDER_SHARD_H
+
+#include "lm/builder/adjust_counts.hh"
+#include "lm/builder/payload.hh"
+#include "lm/word_index.hh"
+#include "util/mmap.hh"
+#include "util/murmur_hash.hh"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace util { namespace stream { class Chains; } }
+
+/* Building one model with several lmplz processes (shards) that share a
+ * directory.  Every shard reads the whole corpus, so they agree on the
+ * vocabulary ids, but only counts the n-grams whose last word it owns.
+ * Adjusted counts, probabilities, and interpolation of an n-gram only look at
+ * n-grams with the same last word.  The exceptions are exchanged through the
+ * directory:
+ *   - count of counts for the discounts, summed over shards (ExchangeStats);
+ *   - sums over the extensions of each context, which go to the shard that
+ *     owns the context's last word (ShardInitialProbabilities).
+ * Finally shard 0 merges everybody's probabilities and writes the model.
+ *
+ * A file appears in the directory under its name once it is complete, so
+ * shards wait for each other by waiting for files.  Files are deleted once
+ * read.  The directory should be empty when the shards start.
+ */
+namespace lm { namespace builder {
+
+struct ShardConfig {
+  ShardConfig() : index(0), count(1) {}
+
+  bool Enabled() const { return count > 1; }
+
+  // The shard with the n-grams ending in word.  <unk> and <s> are shard 0's.
+  std::size_t Owner(WordIndex word) const {
+    return word <= kBOS ? 0 : util::MurmurHashNative(&word, sizeof(WordIndex)) % count;
+  }
+
+  bool Owns(WordIndex word) const { return Owner(word) == index; }
+
+  // dir/kind.a, dir/kind.a.b, and dir/kind.a.b.c
+  std::string File(const char *kind, std::size_t a) const;
+  std::string File(const char *kind, std::size_t a, std::size_t b) const;
+  std::string File(const char *kind, std::size_t a, std::size_t b, std::size_t c) const;
+
+  std::string dir;
+  std::size_t index;
+  std::size_t count;
+};
+
+// Create a shared file for writing.  It has a temporary name until Publish.
+int CreateShared(const std::string &name);
+void PublishShared(const std::string &name);
+
+// Wait for a shared file to be published, then open it for reading.
+int OpenShared(const std::string &name);
+
+// Fixed-size records from a published shared file, which is deleted.
+class SharedRecords {
+  public:
+    SharedRecords(const std::string &name, std::size_t record_size);
+
+    const void *Get() const { return current_; }
+
+    SharedRecords &operator++() {
+      current_ += record_size_;
+      return *this;
+    }
+
+    operator bool() const { return current_ != end_; }
+
+  private:
+    util::scoped_memory mem_;
+    const uint8_t *current_, *end_;
+    const std::size_t record_size_;
+};
+
+// Refuse to run in a directory left over from another build.
+void CheckShardDir(const ShardConfig &shard);
+
+// Sum the adjusted count statistics of all shards.
+void ExchangeStats(const ShardConfig &shard, const std::vector<OrderStat> &mine, std::vector<OrderStat> &total);
+
+// Called by every shard with its interpolated probabilities.  Shard 0
+// continues: the chains are then fed everybody's n-grams in suffix order.
+void ExchangeProbs(const ShardConfig &shard, util::stream::Chains &chains);
+
+}} // namespaces
+
+#endif // LM_BUILDER_SHARD_H
@@ -0,0 +1,175 @@
+#include "lm/builder/output.hh"
+#include "lm/builder/pipeline.hh"
+
+#include "util/file.hh"
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#define BOOST_TEST_MODULE ShardTest
+#include <boost/test/unit_test.hpp>
+
+namespace lm { namespace builder { namespace {
+
+class Random {
+  public:
+    Random() : state_(1) {}
+
+    // Product of two uniform draws below bound, so low numbers are frequent.
+    uint32_t Skewed(uint32_t bound) {
+      uint32_t a = Next() % bound;
+      return a * (Next() % bound) / bound;
+    }
+
+    uint32_t Next() {
+      state_ = state_ * 1103515245 + 12345;
+      return state_ >> 16;
+    }
+
+  private:
+    uint32_t state_;
+};
+
+// Enough text that every order has n-grams seen 1, 2, 3, and 4+ times, as
+// discounting requires.  Random lines over a skewed vocabulary with a long
+// tail of rare words, and repeated sentences so long n-grams recur too.
+std::string Corpus() {
+  Random random;
+  std::vector<std::string> sentences(60);
+  for (std::size_t i = 0; i < sentences.size(); ++i) {
+    std::stringstream sentence;
+    for (std::size_t j = 0; j < 4 + i % 6; ++j) {
+      sentence << (j ? " " : "") << 'w' << random.Skewed(60);
+    }
+    sentences[i] = sentence.str();
+  }
+
+  std::stringstream out;
+  for (unsigned line = 0; line < 3000; ++line) {
+    if (line % 3 == 0) {
+      out << sentences[random.Skewed(sentences.size())] << '\n';
+      continue;
+    }
+    std::size_t length = 1 + line % 13;
+    for (std::size_t i = 0; i < length; ++i) {
+      if (random.Next() % 10 == 0) {
+        out << 'r' << random.Next() % 2000;
+      } else {
+        out << 'w' << random.Skewed(60);
+      }
+      out << (i + 1 == length ? '\n' : ' ');
+    }
+  }
+  return out.str();
+}
+
+PipelineConfig Config(std::size_t order) {
+  PipelineConfig config;
+  config.order = order;
+  config.sort.temp_prefix = "shard_test_";
+  config.sort.buffer_size = 1 << 16;
+  config.sort.total_memory = 1 << 24;
+  config.initial_probs.adder_in.total_memory = 32768;
+  config.initial_probs.adder_in.block_count = 2;
+  config.initial_probs.adder_out.total_memory = 32768;
+  config.initial_probs.adder_out.block_count = 2;
+  config.initial_probs.interpolate_unigrams = true;
+  config.read_backoffs = config.initial_probs.adder_out;
+  config.vocab_estimate = 1000;
+  config.minimum_block = 8192;
+  config.block_count = 2;
+  config.prune_thresholds.resize(order, 0);
+  config.prune_vocab = false;
+  config.renumber_vocabulary = false;
+  config.discount.bad_action = THROW_UP;
+  config.output_q = false;
+  config.vocab_size_for_unk = 0;
+  config.disallowed_symbol_action = THROW_UP;
+  return config;
+}
+
+// Estimate from text and return the ARPA file.
+void Build(PipelineConfig config, const std::string &text, std::string &arpa) {
+  util::scoped_fd in(util::MakeTemp(config.TempPrefix() + "in"));
+  util::WriteOrThrow(in.get(), text.data(), text.size());
+  util::SeekOrThrow(in.get(), 0);
+  util::scoped_fd out(util::MakeTemp(config.TempPrefix() + "arpa"));
+  {
+    Output output(config.TempPrefix(), false, false);
+    output.Add(new PrintHook(util::DupOrThrow(out.get()), false));
+    Pipeline(config, in.release(), output);
+  }
+  arpa.resize(util::SizeOrThrow(out.get()));
+  util::SeekOrThrow(out.get(), 0);
+  if (!arpa.empty()) util::ReadOrThrow(out.get(), &arpa[0], arpa.size());
+}
+
+// The shards of one model, each on its own thread as it would be in its own
+// process.
+void BuildSharded(const PipelineConfig &base, std::size_t shards, const std::string &text, std::string &arpa) {
+  char dir[] = "shard_test_dirXXXXXX";
+  BOOST_REQUIRE(mkdtemp(dir));
+  std::vector<std::string> arpas(shards);
+  boost::thread_group threads;
+  for (std::size_t i = 0; i < shards; ++i) {
+    PipelineConfig config(base);
+    config.shard.count = shards;
+    config.shard.index = i;
+    config.shard.dir = dir;
+    threads.create_thread(boost::bind(&Build, config, boost::cref(text), boost::ref(arpas[i])));
+  }
+  threads.join_all();
+  // Shards delete what they read, so this is empty again.
+  BOOST_CHECK_EQUAL(0, rmdir(dir));
+  // Only shard 0 writes the model.
+  for (std::size_t i = 1; i < shards; ++i) {
+    BOOST_CHECK(arpas[i].empty());
+  }
+  arpa.swap(arpas[0]);
+}
+
+// Shards must give the same ARPA file as a single process.
+void Compare(std::size_t order, std::size_t shards, bool discount_fallback = false) {
+  std::string text(Corpus());
+  PipelineConfig config(Config(order));
+  if (discount_fallback) {
+    // As lmplz --discount_fallback.
+    config.discount.bad_action = COMPLAIN;
+    config.discount.fallback.amount[0] = 0.0;
+    config.discount.fallback.amount[1] = 0.5;
+    config.discount.fallback.amount[2] = 1.0;
+    config.discount.fallback.amount[3] = 1.5;
+  }
+  std::string single, sharded;
+  Build(config, text, single);
+  BuildSharded(config, shards, text, sharded);
+  BOOST_REQUIRE(!single.empty());
+  BOOST_CHECK(single == sharded);
+}
+
+BOOST_AUTO_TEST_CASE(TwoShardsOrder2) {
+  Compare(2, 2);
+}
+
+BOOST_AUTO_TEST_CASE(TwoShardsOrder3) {
+  Compare(3, 2);
+}
+
+// The corpus is too small for order 4 and 5 discounts.  These also check that
+// the fallback is applied the same way to the summed statistics.
+BOOST_AUTO_TEST_CASE(ThreeShardsOrder4) {
+  Compare(4, 3, true);
+}
+
+BOOST_AUTO_TEST_CASE(FourShardsOrder5) {
+  Compare(5, 4, true);
+}
+
+}}} // namespaces
@@ -15,6 +15,7 @@ Config::Config() :
   unknown_missing_logprob(-100.0),
   probing_multiplier(1.5),
   building_memory(1073741824ULL), // 1 GB
+  building_threads(1),
   temporary_directory_prefix(""),
   arpa_complain(ALL),
   write_mmap(NULL),
@@ -23,6 +24,7 @@ Config::Config() :
   rest_function(REST_MAX),
   prob_bits(8),
   backoff_bits(8),
+  fingerprint_bits(32),
   pointer_bhiksha_bits(22),
   load_method(util::POPULATE_OR_READ) {}
 
@@ -65,6 +65,11 @@ struct Config {
   // models.
   std::size_t building_memory;
 
+  // Number of threads to build with.  Above 1, parsing of n-grams above
+  // unigrams is spread over threads and the trie sorts with all of them.  The
+  // model comes out the same either way.
+  std::size_t building_threads;
+
   // Template for temporary directory appropriate for passing to mkdtemp.
   // The characters XXXXXX are appended before passing to mkdtemp.  Only
   // applies to trie.  If empty, defaults to write_mmap.  If that's NULL,
@@ -99,11 +104,17 @@ struct Config {
   std::vector<std::string> rest_lower_files;
 
 
-  // Quantization options.  Only effective for QuantTrieModel.  One value is
-  // reserved for each of prob and backoff, so 2^bits - 1 buckets will be used
-  // to quantize (and one of the remaining backoffs will be 0).
+  // Quantization options.  Only effective for QuantTrieModel and
+  // PerfectHashModel.  One value is reserved for each of prob and backoff, so
+  // 2^bits - 1 buckets will be used to quantize (and one of the remaining
+  // backoffs will be 0).
   uint8_t prob_bits, backoff_bits;
 
+  // Bits of each n-gram's hash kept by PerfectHashModel to tell the n-grams
+  // it has from those it doesn't.  An absent n-gram is mistaken for a present
+  // one with probability 2^-fingerprint_bits.  At most 57.
+  uint8_t fingerprint_bits;
+
   // Bhiksha compression (simple form).  Only works with trie.
   uint8_t pointer_bhiksha_bits;
 
@@ -5,6 +5,7 @@
 #include "util/usage.hh"
 
 #include <stdint.h>
+#include <vector>
 
 namespace {
 
@@ -67,53 +68,154 @@ template <class Model, class Width> void QueryFromBytes(const Model &model, int
   std::cout << "RSSMax: " << util::RSSMax() << std::endl;
 }
 
-template <class Model, class Width> void DispatchFunction(const Model &model, bool query) {
-  if (query) {
-    QueryFromBytes<Model, Width>(model, 0);
-  } else {
-    ConvertToBytes<Model, Width>(model, 0);
+// Compare FullScore against FullScoreBatch.  Sentences are independent, so
+// the batch path scores kLanes sentences side by side, one word from each per
+// call.
+template <class Model, class Width> void BatchFromBytes(const Model &model, int fd_in) {
+  const std::size_t kLanes = 256;
+  const Width kEOS = model.GetVocabulary().EndSentence();
+  double loaded = util::CPUTime();
+  std::cout << "CPU_to_load: " << loaded << std::endl;
+
+  std::vector<Width> words;
+  Width buf[4096];
+  while (std::size_t got = util::ReadOrEOF(fd_in, buf, sizeof(buf))) {
+    UTIL_THROW_IF2(got % sizeof(Width), "File size not a multiple of vocab id size " << sizeof(Width));
+    words.insert(words.end(), buf, buf + got / sizeof(Width));
+  }
+  // Sentence boundaries: sentence i is [starts[i], starts[i+1]).
+  std::vector<std::size_t> starts(1, 0);
+  for (std::size_t i = 0; i < words.size(); ++i) {
+    if (words[i] == kEOS) starts.push_back(i + 1);
+  }
+  if (starts.back() != words.size()) starts.push_back(words.size());
+  const std::size_t sentences = starts.size() - 1;
+  double read = util::CPUTime();
+
+  // Scalar path.
+  double scalar_total = 0.0;
+  lm::ngram::State state[2];
+  for (std::size_t s = 0; s < sentences; ++s) {
+    const lm::ngram::State *in = &model.BeginSentenceState();
+    float sum = 0.0;
+    for (std::size_t i = starts[s]; i < starts[s + 1]; ++i) {
+      lm::ngram::State *out = (in == &state[0]) ? &state[1] : &state[0];
+      sum += model.FullScore(*in, words[i], *out).prob;
+      in = out;
+    }
+    scalar_total += sum;
+  }
+  double scalar = util::CPUTime();
+
+  // Batch path.  Each lane holds a sentence; a lane that finishes picks up
+  // the next unscored sentence.
+  double batch_total = 0.0;
+  std::vector<lm::ngram::State> in_states(kLanes), out_states(kLanes);
+  std::vector<lm::WordIndex> query(kLanes);
+  std::vector<lm::FullScoreReturn> ret(kLanes);
+  std::vector<std::size_t> position(kLanes), end(kLanes);
+  std::size_t next_sentence = 0, active = 0;
+  for (; active < kLanes && next_sentence < sentences; ++active, ++next_sentence) {
+    position[active] = starts[next_sentence];
+    end[active] = starts[next_sentence + 1];
+    in_states[active] = model.BeginSentenceState();
+  }
+  while (active) {
+    for (std::size_t l = 0; l < active; ++l) {
+      query[l] = words[position[l]];
+    }
+    model.FullScoreBatch(&in_states[0], &query[0], active, &out_states[0], &ret[0]);
+    float sum = 0.0;
+    for (std::size_t l = 0; l < active;) {
+      sum += ret[l].prob;
+      in_states[l] = out_states[l];
+      if (++position[l] != end[l]) {
+        ++l;
+      } else if (next_sentence < sentences) {
+        position[l] = starts[next_sentence];
+        end[l] = starts[next_sentence + 1];
+        in_states[l] = model.BeginSentenceState();
+        ++next_sentence;
+        ++l;
+      } else {
+        // Retire the lane by moving the last one, still unprocessed, into it.
+        --active;
+        position[l] = position[active];
+        end[l] = end[active];
+        out_states[l] = out_states[active];
+        ret[l] = ret[active];
+      }
+    }
+    batch_total += sum;
+  }
+  double batch = util::CPUTime();
+
+  std::cerr << "Probability sum is " << scalar_total << " scalar " << batch_total << " batch" << std::endl;
+  std::cout << "Queries: " << words.size() << std::endl;
+  std::cout << "CPU_to_read: " << (read - loaded) << std::endl;
+  std::cout << "Scalar_CPU: " << (scalar - read) << "\nScalar_queries_per_second: " << (static_cast<double>(words.size()) / (scalar - read)) << std::endl;
+  std::cout << "Batch_CPU: " << (batch - scalar) << "\nBatch_queries_per_second: " << (static_cast<double>(words.size()) / (batch - scalar)) << std::endl;
+  std::cout << "RSSMax: " << util::RSSMax() << std::endl;
+}
+
+enum Mode { VOCAB, QUERY, BATCH };
+
+template <class Model, class Width> void DispatchFunction(const Model &model, Mode mode) {
+  switch (mode) {
+    case QUERY:
+      QueryFromBytes<Model, Width>(model, 0);
+      break;
+    case BATCH:
+      BatchFromBytes<Model, Width>(model, 0);
+      break;
+    case VOCAB:
+      ConvertToBytes<Model, Width>(model, 0);
+      break;
   }
 }
 
-template <class Model> void DispatchWidth(const char *file, bool query) {
+template <class Model> void DispatchWidth(const char *file, Mode mode) {
   lm::ngram::Config config;
   config.load_method = util::READ;
   std::cerr << "Using load_method = READ." << std::endl;
   Model model(file, config);
   lm::WordIndex bound = model.GetVocabulary().Bound();
   if (bound <= 256) {
-    DispatchFunction<Model, uint8_t>(model, query);
+    DispatchFunction<Model, uint8_t>(model, mode);
   } else if (bound <= 65536) {
-    DispatchFunction<Model, uint16_t>(model, query);
+    DispatchFunction<Model, uint16_t>(model, mode);
   } else if (bound <= (1ULL << 32)) {
-    DispatchFunction<Model, uint32_t>(model, query);
+    DispatchFunction<Model, uint32_t>(model, mode);
   } else {
-    DispatchFunction<Model, uint64_t>(model, query);
+    DispatchFunction<Model, uint64_t>(model, mode);
   }
 }
 
-void Dispatch(const char *file, bool query) {
+void Dispatch(const char *file, Mode mode) {
   using namespace lm::ngram;
   lm::ngram::ModelType model_type;
   if (lm::ngram::RecognizeBinary(file, model_type)) {
     switch(model_type) {
       case PROBING:
-        DispatchWidth<lm::ngram::ProbingModel>(file, query);
+        DispatchWidth<lm::ngram::ProbingModel>(file, mode);
         break;
       case REST_PROBING:
-        DispatchWidth<lm::ngram::RestProbingModel>(file, query);
+        DispatchWidth<lm::ngram::RestProbingModel>(file, mode);
         break;
       case TRIE:
-        DispatchWidth<lm::ngram::TrieModel>(file, query);
+        DispatchWidth<lm::ngram::TrieModel>(file, mode);
         break;
       case QUANT_TRIE:
-        DispatchWidth<lm::ngram::QuantTrieModel>(file, query);
+        DispatchWidth<lm::ngram::QuantTrieModel>(file, mode);
         break;
       case ARRAY_TRIE:
-        DispatchWidth<lm::ngram::ArrayTrieModel>(file, query);
+        DispatchWidth<lm::ngram::ArrayTrieModel>(file, mode);
         break;
       case QUANT_ARRAY_TRIE:
-        DispatchWidth<lm::ngram::QuantArrayTrieModel>(file, query);
+        DispatchWidth<lm::ngram::QuantArrayTrieModel>(file, mode);
+        break;
+      case PERFECT_HASH:
+        DispatchWidth<lm::ngram::PerfectHashModel>(file, mode);
         break;
       default:
         UTIL_THROW(util::Exception, "Unrecognized kenlm model type " << model_type);
@@ -126,7 +228,7 @@ void Dispatch(const char *file, bool query) {
 } // namespace
 
 int main(int argc, char *argv[]) {
-  if (argc != 3 || (strcmp(argv[1], "vocab") && strcmp(argv[1], "query"))) {
+  if (argc != 3 || (strcmp(argv[1], "vocab") && strcmp(argv[1], "query") && strcmp(argv[1], "batch"))) {
     std::cerr
       << "Benchmark program for KenLM.  Intended usage:\n"
       << "#Convert text to vocabulary ids offline.  These ids are tied to a model.\n"
@@ -134,9 +236,14 @@ int main(int argc, char *argv[]) {
       << "#Ensure files are in RAM.\n"
       << "cat $text.vocab $model >/dev/null\n"
       << "#Timed query against the model.\n"
-      << argv[0] << " query $model <$text.vocab\n";
+      << argv[0] << " query $model <$text.vocab\n"
+      << "#Timed query with FullScore next to FullScoreBatch.  Loads all of $text.vocab into RAM.\n"
+      << argv[0] << " batch $model <$text.vocab\n";
     return 1;
   }
-  Dispatch(argv[2], !strcmp(argv[1], "query"));
+  Mode mode = VOCAB;
+  if (!strcmp(argv[1], "query")) mode = QUERY;
+  if (!strcmp(argv[1], "batch")) mode = BATCH;
+  Dispatch(argv[2], mode);
   return 0;
 }
@@ -2,6 +2,7 @@
 
 #include "lm/blank.hh"
 #include "lm/lm_exception.hh"
+#include "lm/parallel_arpa.hh"
 #include "lm/search_hashed.hh"
 #include "lm/search_trie.hh"
 #include "lm/read_arpa.hh"
@@ -40,7 +41,7 @@ void ComplainAboutARPA(const Config &config, ModelType model_type) {
   if (config.arpa_complain == Config::ALL) {
     *config.messages << "Loading the LM will be faster if you build a binary file." << std::endl;
   } else if (config.arpa_complain == Config::EXPENSIVE &&
-             (model_type == TRIE || model_type == QUANT_TRIE || model_type == ARRAY_TRIE || model_type == QUANT_ARRAY_TRIE)) {
+             (model_type == TRIE || model_type == QUANT_TRIE || model_type == ARRAY_TRIE || model_type == QUANT_ARRAY_TRIE || model_type == PERFECT_HASH)) {
     *config.messages << "Building " << kModelNames[model_type] << " from ARPA is expensive.  Save time by building a binary format." << std::endl;
   }
 }
@@ -75,7 +76,15 @@ template <class Search, class VocabularyT> GenericModel<Search, VocabularyT>::Ge
     ComplainAboutARPA(init_config, kModelType);
     InitializeFromARPA(fd.release(), file, init_config);
   }
+  SetupStates();
+}
+
+template <class Search, class VocabularyT> GenericModel<Search, VocabularyT>::GenericModel(const char *file, NGramSource &source, const Config &config) : backing_(config) {
+  InitializeFromNGrams(file, source, config);
+  SetupStates();
+}
 
+template <class Search, class VocabularyT> void GenericModel<Search, VocabularyT>::SetupStates() {
   // g++ prints warnings unless these are fully initialized.
   State begin_sentence = State();
   begin_sentence.length = 1;
@@ -93,44 +102,53 @@ template <class Search, class VocabularyT> void GenericModel<Search, VocabularyT
   // Backing file is the ARPA.
   util::FilePiece f(fd, file, config.ProgressMessages());
   try {
-    std::vector<uint64_t> counts;
-    // File counts do not include pruned trigrams that extend to quadgrams etc.   These will be fixed by search_.
-    ReadARPACounts(f, counts);
-    CheckCounts(counts);
-    if (counts.size() < 2) UTIL_THROW(FormatLoadException, "This ngram implementation assumes at least a bigram model.");
-    if (config.probing_multiplier <= 1.0) UTIL_THROW(ConfigException, "probing multiplier must be > 1.0");
-
-    std::size_t vocab_size = util::CheckOverflow(VocabularyT::Size(counts[0], config));
-    // Setup the binary file for writing the vocab lookup table.  The search_ is responsible for growing the binary file to its needs.
-    vocab_.SetupMemory(backing_.SetupJustVocab(vocab_size, counts.size()), vocab_size, counts[0], config);
-
-    if (config.write_mmap && config.include_vocab) {
-      WriteWordsWrapper wrap(config.enumerate_vocab);
-      vocab_.ConfigureEnumerate(&wrap, counts[0]);
-      search_.InitializeFromARPA(file, f, counts, config, vocab_, backing_);
-      void *vocab_rebase, *search_rebase;
-      backing_.WriteVocabWords(wrap.Buffer(), vocab_rebase, search_rebase);
-      // Due to writing at the end of file, mmap may have relocated data.  So remap.
-      vocab_.Relocate(vocab_rebase);
-      search_.SetupMemory(reinterpret_cast<uint8_t*>(search_rebase), counts, config);
+    if (config.building_threads > 1) {
+      ParallelARPA parallel(f, config.building_threads);
+      InitializeFromNGrams(file, parallel, config);
     } else {
-      vocab_.ConfigureEnumerate(config.enumerate_vocab, counts[0]);
-      search_.InitializeFromARPA(file, f, counts, config, vocab_, backing_);
+      InitializeFromNGrams(file, f, config);
     }
-
-    if (!vocab_.SawUnk()) {
-      assert(config.unknown_missing != THROW_UP);
-      // Default probabilities for unknown.
-      search_.UnknownUnigram().backoff = 0.0;
-      search_.UnknownUnigram().prob = config.unknown_missing_logprob;
-    }
-    backing_.FinishFile(config, kModelType, kVersion, counts);
   } catch (util::Exception &e) {
     e << " Byte: " << f.Offset();
     throw;
   }
 }
 
+template <class Search, class VocabularyT> template <class In> void GenericModel<Search, VocabularyT>::InitializeFromNGrams(const char *file, In &f, const Config &config) {
+  std::vector<uint64_t> counts;
+  // File counts do not include pruned trigrams that extend to quadgrams etc.   These will be fixed by search_.
+  ReadARPACounts(f, counts);
+  CheckCounts(counts);
+  if (counts.size() < 2) UTIL_THROW(FormatLoadException, "This ngram implementation assumes at least a bigram model.");
+  if (config.probing_multiplier <= 1.0) UTIL_THROW(ConfigException, "probing multiplier must be > 1.0");
+
+  std::size_t vocab_size = util::CheckOverflow(VocabularyT::Size(counts[0], config));
+  // Setup the binary file for writing the vocab lookup table.  The search_ is responsible for growing the binary file to its needs.
+  vocab_.SetupMemory(backing_.SetupJustVocab(vocab_size, counts.size()), vocab_size, counts[0], config);
+
+  if (config.write_mmap && config.include_vocab) {
+    WriteWordsWrapper wrap(config.enumerate_vocab);
+    vocab_.ConfigureEnumerate(&wrap, counts[0]);
+    search_.InitializeFromARPA(file, f, counts, config, vocab_, backing_);
+    void *vocab_rebase, *search_rebase;
+    backing_.WriteVocabWords(wrap.Buffer(), vocab_rebase, search_rebase);
+    // Due to writing at the end of file, mmap may have relocated data.  So remap.
+    vocab_.Relocate(vocab_rebase);
+    search_.SetupMemory(reinterpret_cast<uint8_t*>(search_rebase), counts, config);
+  } else {
+    vocab_.ConfigureEnumerate(config.enumerate_vocab, counts[0]);
+    search_.InitializeFromARPA(file, f, counts, config, vocab_, backing_);
+  }
+
+  if (!vocab_.SawUnk()) {
+    assert(config.unknown_missing != THROW_UP);
+    // Default probabilities for unknown.
+    search_.UnknownUnigram().backoff = 0.0;
+    search_.UnknownUnigram().prob = config.unknown_missing_logprob;
+  }
+  backing_.FinishFile(config, kModelType, kVersion, counts);
+}
+
 template <class Search, class VocabularyT> FullScoreReturn GenericModel<Search, VocabularyT>::FullScore(const State &in_state, const WordIndex new_word, State &out_state) const {
   FullScoreReturn ret = ScoreExceptBackoff(in_state.words, in_state.words + in_state.length, new_word, out_state);
   for (const float *i = in_state.backoff + ret.ngram_length - 1; i < in_state.backoff + in_state.length; ++i) {
@@ -295,6 +313,97 @@ template <class Search, class VocabularyT> void GenericModel<Search, VocabularyT
   }
 }
 
+template <class Search, class VocabularyT> void GenericModel<Search, VocabularyT>::FullScoreBatch(const State *in_states, const WordIndex *new_words, std::size_t count, State *out_states, FullScoreReturn *ret) const {
+  for (std::size_t offset = 0; offset < count; offset += kBatchBlock) {
+    ScoreBlock(in_states + offset, new_words + offset, std::min(kBatchBlock, count - offset), out_states + offset, ret + offset);
+  }
+}
+
+/* Same logic as ScoreExceptBackoff and ResumeScore, but turned inside out:
+ * the outer loop is over n-gram order and the inner loops are over queries.
+ * Each order makes one pass to prefetch and a second pass to look up.
+ */
+template <class Search, class VocabularyT> void GenericModel<Search, VocabularyT>::ScoreBlock(const State *in_states, const WordIndex *new_words, std::size_t count, State *out_states, FullScoreReturn *ret) const {
+  typename Search::Node nodes[kBatchBlock];
+  bool active[kBatchBlock];
+
+  for (std::size_t i = 0; i < count; ++i) {
+    assert(new_words[i] < vocab_.Bound());
+    search_.PrefetchUnigram(new_words[i]);
+  }
+  for (std::size_t i = 0; i < count; ++i) {
+    FullScoreReturn &r = ret[i];
+    State &out_state = out_states[i];
+    r.ngram_length = 1;
+    typename Search::UnigramPointer uni(search_.LookupUnigram(new_words[i], nodes[i], r.independent_left, r.extend_left));
+    out_state.backoff[0] = uni.Backoff();
+    r.prob = uni.Prob();
+    r.rest = uni.Rest();
+    out_state.length = HasExtension(out_state.backoff[0]) ? 1 : 0;
+    out_state.words[0] = new_words[i];
+    active[i] = true;
+  }
+
+  for (unsigned char order_minus_2 = 0; ; ++order_minus_2) {
+    const bool longest = (order_minus_2 == P::Order() - 2);
+    bool any = false;
+    for (std::size_t i = 0; i < count; ++i) {
+      if (!active[i]) continue;
+      if (order_minus_2 >= in_states[i].length || ret[i].independent_left) {
+        active[i] = false;
+        continue;
+      }
+      any = true;
+      const WordIndex word = in_states[i].words[order_minus_2];
+      if (longest) {
+        search_.PrefetchLongest(word, nodes[i]);
+      } else {
+        search_.PrefetchMiddle(order_minus_2, word, nodes[i]);
+      }
+    }
+    if (!any) break;
+
+    for (std::size_t i = 0; i < count; ++i) {
+      if (!active[i]) continue;
+      FullScoreReturn &r = ret[i];
+      const WordIndex word = in_states[i].words[order_minus_2];
+      if (longest) {
+        r.independent_left = true;
+        typename Search::LongestPointer found(search_.LookupLongest(word, nodes[i]));
+        if (found.Found()) {
+          r.prob = found.Prob();
+          r.rest = r.prob;
+          // There is no blank in longest_.
+          r.ngram_length = P::Order();
+        }
+        continue;
+      }
+      typename Search::MiddlePointer pointer(search_.LookupMiddle(order_minus_2, word, nodes[i], r.independent_left, r.extend_left));
+      if (!pointer.Found()) {
+        active[i] = false;
+        continue;
+      }
+      float &backoff_out = out_states[i].backoff[order_minus_2 + 1];
+      backoff_out = pointer.Backoff();
+      r.prob = pointer.Prob();
+      r.rest = pointer.Rest();
+      r.ngram_length = order_minus_2 + 2;
+      if (HasExtension(backoff_out)) {
+        out_states[i].length = r.ngram_length;
+      }
+    }
+    if (longest) break;
+  }
+
+  for (std::size_t i = 0; i < count; ++i) {
+    const State &in_state = in_states[i];
+    CopyRemainingHistory(in_state.words, out_states[i]);
+    for (const float *b = in_state.backoff + ret[i].ngram_length - 1; b < in_state.backoff + in_state.length; ++b) {
+      ret[i].prob += *b;
+    }
+  }
+}
+
 template <class Search, class VocabularyT> float GenericModel<Search, VocabularyT>::InternalUnRest(const uint64_t *pointers_begin, const uint64_t *pointers_end, unsigned char first_length) const {
   float ret;
   typename Search::Node node;
@@ -322,6 +431,7 @@ template class GenericModel<trie::TrieSearch<DontQuantize, trie::DontBhiksha>, S
 template class GenericModel<trie::TrieSearch<DontQuantize, trie::ArrayBhiksha>, SortedVocabulary>;
 template class GenericModel<trie::TrieSearch<SeparatelyQuantize, trie::DontBhiksha>, SortedVocabulary>;
 template class GenericModel<trie::TrieSearch<SeparatelyQuantize, trie::ArrayBhiksha>, SortedVocabulary>;
+template class GenericModel<PerfectHashSearch, ProbingVocabulary>;
 
 } // namespace detail
 
@@ -340,6 +450,8 @@ base::Model *LoadVirtual(const char *file_name, const Config &config, ModelType
       return new ArrayTrieModel(file_name, config);
     case QUANT_ARRAY_TRIE:
       return new QuantArrayTrieModel(file_name, config);
+    case PERFECT_HASH:
+      return new PerfectHashModel(file_name, config);
     default:
       UTIL_THROW(FormatLoadException, "Confused by model type " << model_type);
   }
@@ -7,6 +7,7 @@
 #include "lm/facade.hh"
 #include "lm/quantize.hh"
 #include "lm/search_hashed.hh"
+#include "lm/search_perfect_hash.hh"
 #include "lm/search_trie.hh"
 #include "lm/state.hh"
 #include "lm/value.hh"
@@ -50,12 +51,28 @@ template <class Search, class VocabularyT> class GenericModel : public base::Mod
      */
     explicit GenericModel(const char *file, const Config &config = Config());
 
+    /* Build from n-grams that were never written as ARPA, such as those lmplz
+     * just estimated.  Usually config.write_mmap is set to save a binary file.
+     * file is only used to name temporary files when the config doesn't.
+     */
+    GenericModel(const char *file, NGramSource &source, const Config &config = Config());
+
     /* Score p(new_word | in_state) and incorporate new_word into out_state.
      * Note that in_state and out_state must be different references:
      * &in_state != &out_state.
      */
     FullScoreReturn FullScore(const State &in_state, const WordIndex new_word, State &out_state) const;
 
+    /* Batch version of FullScore: for i in [0, count) score
+     * p(new_words[i] | in_states[i]), writing the state to out_states[i] and
+     * the return to ret[i].  Results are identical to calling FullScore on
+     * each query, but the queries are independent so their lookups walk the
+     * orders in lockstep, prefetching every query's next bucket before
+     * probing any of them.  This hides memory latency when the model does
+     * not fit in cache.  out_states must not overlap in_states.
+     */
+    void FullScoreBatch(const State *in_states, const WordIndex *new_words, std::size_t count, State *out_states, FullScoreReturn *ret) const;
+
     /* Slower call without in_state.  Try to remember state, but sometimes it
      * would cost too much memory or your decoder isn't setup properly.
      * To use this function, make an array of WordIndex containing the context
@@ -105,6 +122,13 @@ template <class Search, class VocabularyT> class GenericModel : public base::Mod
   private:
     FullScoreReturn ScoreExceptBackoff(const WordIndex *const context_rbegin, const WordIndex *const context_rend, const WordIndex new_word, State &out_state) const;
 
+    // Number of queries FullScoreBatch keeps in flight.  Enough to cover
+    // memory latency while the prefetched lines still fit in L1.
+    static const std::size_t kBatchBlock = 32;
+
+    // One block of FullScoreBatch, count <= kBatchBlock.
+    void ScoreBlock(const State *in_states, const WordIndex *new_words, std::size_t count, State *out_states, FullScoreReturn *ret) const;
+
     // Score bigrams and above.  Do not include backoff.
     void ResumeScore(const WordIndex *context_rbegin, const WordIndex *const context_rend, unsigned char starting_order_minus_2, typename Search::Node &node, float *backoff_out, unsigned char &next_use, FullScoreReturn &ret) const;
 
@@ -113,6 +137,12 @@ template <class Search, class VocabularyT> class GenericModel : public base::Mod
 
     void InitializeFromARPA(int fd, const char *file, const Config &config);
 
+    // In is util::FilePiece, ParallelARPA, or NGramSource.
+    template <class In> void InitializeFromNGrams(const char *file, In &f, const Config &config);
+
+    // Begin sentence and null context states, once the model is loaded.
+    void SetupStates();
+
     float InternalUnRest(const uint64_t *pointers_begin, const uint64_t *pointers_end, unsigned char first_length) const;
 
     BinaryFormat backing_;
@@ -131,6 +161,7 @@ template <class Search, class VocabularyT> class GenericModel : public base::Mod
 class name : public from {\
   public:\
     name(const char *file, const Config &config = Config()) : from(file, config) {}\
+    name(const char *file, NGramSource &source, const Config &config = Config()) : from(file, source, config) {}\
 };
 
 LM_NAME_MODEL(ProbingModel, detail::GenericModel<detail::HashedSearch<BackoffValue> LM_COMMA() ProbingVocabulary>);
@@ -139,6 +170,7 @@ LM_NAME_MODEL(TrieModel, detail::GenericModel<trie::TrieSearch<DontQuantize LM_C
 LM_NAME_MODEL(ArrayTrieModel, detail::GenericModel<trie::TrieSearch<DontQuantize LM_COMMA() trie::ArrayBhiksha> LM_COMMA() SortedVocabulary>);
 LM_NAME_MODEL(QuantTrieModel, detail::GenericModel<trie::TrieSearch<SeparatelyQuantize LM_COMMA() trie::DontBhiksha> LM_COMMA() SortedVocabulary>);
 LM_NAME_MODEL(QuantArrayTrieModel, detail::GenericModel<trie::TrieSearch<SeparatelyQuantize LM_COMMA() trie::ArrayBhiksha> LM_COMMA() SortedVocabulary>);
+LM_NAME_MODEL(PerfectHashModel, detail::GenericModel<detail::PerfectHashSearch LM_COMMA() ProbingVocabulary>);
 
 // Default implementation.  No real reason for it to be the default.
 typedef ::lm::ngram::ProbingVocabulary Vocabulary;
@@ -1,7 +1,9 @@
 #include "lm/model.hh"
+#include "util/file.hh"
 
 #include <cstdlib>
 #include <cstring>
+#include <string>
 
 #define BOOST_TEST_MODULE ModelTest
 #include <boost/test/unit_test.hpp>
@@ -286,6 +288,47 @@ template <class M> void NoUnkCheck(const M &model) {
   SLOPPY_CHECK_CLOSE(-100.0, ret.prob, 0.001);
 }
 
+// FullScoreBatch must agree with FullScore on every query.
+template <class M> void BatchMatchesScalar(const M &model) {
+  std::vector<State> contexts;
+  contexts.push_back(model.BeginSentenceState());
+  contexts.push_back(model.NullContextState());
+  const WordIndex bound = model.GetVocabulary().Bound();
+  State out;
+  for (WordIndex w = 0; w < bound; ++w) {
+    model.FullScore(model.BeginSentenceState(), w, out);
+    contexts.push_back(out);
+    State second;
+    model.FullScore(out, (w * 7) % bound, second);
+    contexts.push_back(second);
+  }
+
+  std::vector<State> in_states;
+  std::vector<WordIndex> words;
+  for (std::size_t c = 0; c < contexts.size(); ++c) {
+    for (WordIndex w = 0; w < bound; ++w) {
+      in_states.push_back(contexts[c]);
+      words.push_back(w);
+    }
+  }
+  std::vector<State> out_states(in_states.size());
+  std::vector<FullScoreReturn> rets(in_states.size());
+  model.FullScoreBatch(&in_states[0], &words[0], in_states.size(), &out_states[0], &rets[0]);
+
+  for (std::size_t i = 0; i < in_states.size(); ++i) {
+    FullScoreReturn expect = model.FullScore(in_states[i], words[i], out);
+    SLOPPY_CHECK_CLOSE(expect.prob, rets[i].prob, 0.001);
+    SLOPPY_CHECK_CLOSE(expect.rest, rets[i].rest, 0.001);
+    BOOST_CHECK_EQUAL(static_cast<unsigned int>(expect.ngram_length), static_cast<unsigned int>(rets[i].ngram_length));
+    BOOST_CHECK_EQUAL(expect.independent_left, rets[i].independent_left);
+    BOOST_CHECK_EQUAL(expect.extend_left, rets[i].extend_left);
+    BOOST_CHECK_EQUAL(out, out_states[i]);
+    for (unsigned char j = 0; j < out.length; ++j) {
+      SLOPPY_CHECK_CLOSE(out.backoff[j], out_states[i].backoff[j], 0.001);
+    }
+  }
+}
+
 template <class M> void Everything(const M &m) {
   Starters(m);
   Continuation(m);
@@ -294,6 +337,7 @@ template <class M> void Everything(const M &m) {
   MinimalState(m);
   ExtendLeftTest(m);
   Stateless(m);
+  BatchMatchesScalar(m);
 }
 
 class ExpectEnumerateVocab : public EnumerateVocab {
@@ -321,8 +365,9 @@ class ExpectEnumerateVocab : public EnumerateVocab {
     std::vector<std::string> seen;
 };
 
-template <class ModelT> void LoadingTest() {
+template <class ModelT> void LoadingTest(std::size_t building_threads = 1) {
   Config config;
+  config.building_threads = building_threads;
   config.arpa_complain = Config::NONE;
   config.messages = NULL;
   config.probing_multiplier = 2.0;
@@ -359,6 +404,48 @@ BOOST_AUTO_TEST_CASE(bhiksha_trie) {
 BOOST_AUTO_TEST_CASE(quant_bhiksha_trie) {
   LoadingTest<QuantArrayTrieModel>();
 }
+BOOST_AUTO_TEST_CASE(perfect_hash) {
+  LoadingTest<PerfectHashModel>();
+}
+
+std::string ReadFile(const char *name) {
+  util::scoped_fd file(util::OpenReadOrThrow(name));
+  std::string ret(util::SizeOrThrow(file.get()), '\0');
+  if (!ret.empty()) util::ReadOrThrow(file.get(), &ret[0], ret.size());
+  return ret;
+}
+
+// Building with several threads must write the same binary as with one.
+template <class ModelT> void ThreadsTest(const char *arpa) {
+  Config config;
+  config.arpa_complain = Config::NONE;
+  config.messages = NULL;
+  config.write_mmap = "test_threads1.binary";
+  { ModelT m(arpa, config); }
+  config.building_threads = 3;
+  config.write_mmap = "test_threads3.binary";
+  { ModelT m(arpa, config); }
+
+  std::string serial(ReadFile("test_threads1.binary")), parallel(ReadFile("test_threads3.binary"));
+  BOOST_REQUIRE(!serial.empty());
+  BOOST_CHECK_EQUAL(serial.size(), parallel.size());
+  BOOST_CHECK(serial == parallel);
+  unlink("test_threads1.binary");
+  unlink("test_threads3.binary");
+}
+
+template <class ModelT> void ThreadsTest() {
+  LoadingTest<ModelT>(3);
+  ThreadsTest<ModelT>(TestLocation());
+  ThreadsTest<ModelT>(TestNoUnkLocation());
+}
+
+BOOST_AUTO_TEST_CASE(probing_threads) {
+  ThreadsTest<Model>();
+}
+BOOST_AUTO_TEST_CASE(trie_threads) {
+  ThreadsTest<TrieModel>();
+}
 
 template <class ModelT> void BinaryTest(Config::WriteMethod write_method) {
   Config config;
@@ -430,6 +517,9 @@ BOOST_AUTO_TEST_CASE(write_and_read_array_trie) {
 BOOST_AUTO_TEST_CASE(write_and_read_quant_array_trie) {
   BinaryTest<QuantArrayTrieModel>();
 }
+BOOST_AUTO_TEST_CASE(write_and_read_perfect_hash) {
+  BinaryTest<PerfectHashModel>();
+}
 
 BOOST_AUTO_TEST_CASE(rest_max) {
   Config config;
@@ -7,8 +7,17 @@
 #include "util/file_piece.hh"
 #include "util/usage.hh"
 
+#ifdef WITH_THREADS
+#include "util/read_compressed.hh"
+#include "util/stream/chain.hh"
+#include "util/string_stream.hh"
+#endif
+
 #include <cstdlib>
+#include <cstring>
+#include <iostream>
 #include <string>
+#include <vector>
 #include <cmath>
 
 namespace lm {
@@ -21,13 +30,20 @@ class QueryPrinter {
 
     void Word(StringPiece surface, WordIndex vocab, const FullScoreReturn &ret) {
       if (!print_word_) return;
-      out_ << surface << '=' << vocab << ' ' << static_cast<unsigned int>(ret.ngram_length)  << ' ' << ret.prob << '\t';
+      WriteWord(out_, surface, vocab, ret);
       if (flush_) out_.flush();
     }
 
     void Line(uint64_t oov, float total) {
       if (!print_line_) return;
-      out_ << "Total: " << total << " OOV: " << oov << '\n';
+      WriteLine(out_, oov, total);
+      if (flush_) out_.flush();
+    }
+
+    // Output already formatted by WriteWord and WriteLine, as in threaded
+    // mode.
+    void Formatted(StringPiece text) {
+      out_ << text;
       if (flush_) out_.flush();
     }
 
@@ -41,6 +57,17 @@ class QueryPrinter {
       out_.flush();
     }
 
+    bool PrintWord() const { return print_word_; }
+    bool PrintLine() const { return print_line_; }
+
+    template <class Stream> static void WriteWord(Stream &out, StringPiece surface, WordIndex vocab, const FullScoreReturn &ret) {
+      out << surface << '=' << vocab << ' ' << static_cast<unsigned int>(ret.ngram_length)  << ' ' << ret.prob << '\t';
+    }
+
+    template <class Stream> static void WriteLine(Stream &out, uint64_t oov, float total) {
+      out << "Total: " << total << " OOV: " << oov << '\n';
+    }
+
   private:
     util::FileStream out_;
     bool print_word_;
@@ -49,17 +76,33 @@ class QueryPrinter {
     bool flush_;
 };
 
-template <class Model, class Printer> void Query(const Model &model, bool sentence_context, Printer &printer) {
+// Corpus-level statistics for the summary.
+struct QueryTotals {
+  QueryTotals() : total(0.0), total_oov_only(0.0), oov(0), tokens(0), lines(0) {}
+
+  template <class Printer> void Summary(Printer &printer) const {
+    printer.Summary(
+        pow(10.0, -(total / static_cast<double>(tokens))), // PPL including OOVs
+        pow(10.0, -((total - total_oov_only) / static_cast<double>(tokens - oov))), // PPL excluding OOVs
+        oov,
+        tokens);
+  }
+
+  double total;
+  double total_oov_only;
+  uint64_t oov;
+  uint64_t tokens;
+  uint64_t lines;
+};
+
+template <class Model, class Printer> void Query(const Model &model, bool sentence_context, Printer &printer, int in_fd = 0) {
   typename Model::State state, out;
   lm::FullScoreReturn ret;
   StringPiece word;
 
-  util::FilePiece in(0);
+  util::FilePiece in(in_fd);
 
-  double corpus_total = 0.0;
-  double corpus_total_oov_only = 0.0;
-  uint64_t corpus_oov = 0;
-  uint64_t corpus_tokens = 0;
+  QueryTotals corpus;
 
   while (true) {
     state = sentence_context ? model.BeginSentenceState() : model.NullContextState();
@@ -71,11 +114,11 @@ template <class Model, class Printer> void Query(const Model &model, bool senten
       ret = model.FullScore(state, vocab, out);
       if (vocab == model.GetVocabulary().NotFound()) {
         ++oov;
-        corpus_total_oov_only += ret.prob;
+        corpus.total_oov_only += ret.prob;
       }
       total += ret.prob;
       printer.Word(word, vocab, ret);
-      ++corpus_tokens;
+      ++corpus.tokens;
       state = out;
     }
     // If people don't have a newline after their last query, this won't add a </s>.
@@ -86,22 +129,266 @@ template <class Model, class Printer> void Query(const Model &model, bool senten
     if (sentence_context) {
       ret = model.FullScore(state, model.GetVocabulary().EndSentence(), out);
       total += ret.prob;
-      ++corpus_tokens;
+      ++corpus.tokens;
       printer.Word("</s>", model.GetVocabulary().EndSentence(), ret);
     }
     printer.Line(oov, total);
-    corpus_total += total;
-    corpus_oov += oov;
+    corpus.total += total;
+    corpus.oov += oov;
+    ++corpus.lines;
+  }
+  corpus.Summary(printer);
+}
+
+#ifdef WITH_THREADS
+/* Threaded mode.  QueryLineInput cuts the input into blocks of whole lines.  The chain has one QueryBlockScorer per thread and scorer i takes
+ * every block whose index is i modulo the number of threads, passing the
+ * others along untouched.  Since blocks go through the chain in order,
+ * QueryBlockWriter at the end sees them in input order.
+ *
+ * Scorers leave their results in a QueryBlockOutput slot indexed by block
+ * number modulo the number of blocks in the chain.  A block can't come around
+ * again until the writer is done with its slot.  The slot also holds any line
+ * too long for a block.
+ */
+struct QueryBlockOutput {
+  QueryBlockOutput() : oov(0), tokens(0) {}
+
+  void Clear() {
+    text.str(std::string());
+    line_totals.clear();
+    oov_probs.clear();
+    oov = 0;
+    tokens = 0;
+    std::string().swap(long_line);
+  }
+
+  // Formatted like QueryPrinter.
+  util::StringStream text;
+  // Kept separately so the writer adds them in the same order as Query does
+  // and the summary is identical.
+  std::vector<float> line_totals;
+  std::vector<float> oov_probs;
+  // OOVs in complete lines.
+  uint64_t oov;
+  uint64_t tokens;
+  // A line with no newline in a whole block is read here instead and its
+  // block is left empty.
+  std::string long_line;
+};
+
+/* Like util::stream::LineInput, but a line longer than the block goes to the
+ * block's QueryBlockOutput slot rather than failing.
+ */
+class QueryLineInput {
+  public:
+    QueryLineInput(int fd, std::vector<QueryBlockOutput> &slots) : fd_(fd), slots_(&slots) {}
+
+    void Run(const util::stream::ChainPosition &position) {
+      util::ReadCompressed reader(fd_);
+      const std::size_t block_size = position.GetChain().BlockSize();
+      // Beginning of a line to be placed in the next block.  Always shorter
+      // than a block.
+      std::vector<char> carry;
+      std::vector<char> buffer;
+      std::size_t index = 0;
+      for (util::stream::Link block(position); ; ++block, ++index) {
+        char *begin = static_cast<char*>(block->Get());
+        char *end = begin + block_size;
+        char *to = begin;
+        if (!carry.empty()) std::memcpy(to, &carry[0], carry.size());
+        to += carry.size();
+        carry.clear();
+        bool eof = false;
+        while (to != end) {
+          std::size_t got = reader.Read(to, end - to);
+          if (!got) {
+            eof = true;
+            break;
+          }
+          to += got;
+        }
+        if (eof) {
+          block->SetValidSize(to - begin);
+          ++block;
+          block.Poison();
+          return;
+        }
+
+        // Find the end of the last complete line.
+        char *line_end = to;
+        for (; line_end != begin && *(line_end - 1) != '\n'; --line_end) {}
+        if (line_end != begin) {
+          carry.assign(line_end, to);
+          block->SetValidSize(line_end - begin);
+          continue;
+        }
+
+        // The whole block is one line.  Read the rest of it into the slot.
+        std::string &line = (*slots_)[index % slots_->size()].long_line;
+        line.assign(begin, to);
+        block->SetValidSize(0);
+        buffer.resize(block_size);
+        while (true) {
+          std::size_t got = reader.Read(&buffer[0], buffer.size());
+          if (!got) {
+            ++block;
+            block.Poison();
+            return;
+          }
+          char *found = static_cast<char*>(std::memchr(&buffer[0], '\n', got));
+          if (found) {
+            line.append(&buffer[0], found + 1);
+            carry.assign(found + 1, &buffer[0] + got);
+            break;
+          }
+          line.append(&buffer[0], got);
+        }
+      }
+    }
+
+  private:
+    int fd_;
+    std::vector<QueryBlockOutput> *slots_;
+};
+
+template <class Model> class QueryBlockScorer {
+  public:
+    QueryBlockScorer(const Model &model, bool sentence_context, bool print_word, bool print_line, std::size_t thread, std::size_t threads, std::vector<QueryBlockOutput> &outputs)
+      : model_(&model), sentence_context_(sentence_context), print_word_(print_word), print_line_(print_line), thread_(thread), threads_(threads), outputs_(&outputs) {}
+
+    void Run(const util::stream::ChainPosition &position) {
+      std::size_t index = 0;
+      for (util::stream::Link block(position); block; ++block, ++index) {
+        if (index % threads_ != thread_) continue;
+        QueryBlockOutput &output = (*outputs_)[index % outputs_->size()];
+        if (!output.long_line.empty()) {
+          Score(output.long_line.data(), output.long_line.data() + output.long_line.size(), output);
+        } else {
+          const char *begin = static_cast<const char*>(block->Get());
+          Score(begin, begin + block->ValidSize(), output);
+        }
+      }
+    }
+
+  private:
+    // Same as Query, but reading from memory.
+    void Score(const char *i, const char *end, QueryBlockOutput &output) const {
+      typename Model::State state, out;
+      lm::FullScoreReturn ret;
+      while (true) {
+        state = sentence_context_ ? model_->BeginSentenceState() : model_->NullContextState();
+        float total = 0.0;
+        uint64_t oov = 0;
+        while (true) {
+          for (; i != end && *i != '\n' && util::kSpaces[static_cast<unsigned char>(*i)]; ++i) {}
+          if (i == end || *i == '\n') break;
+          const char *word_begin = i;
+          for (; i != end && !util::kSpaces[static_cast<unsigned char>(*i)]; ++i) {}
+          StringPiece word(word_begin, i - word_begin);
+          lm::WordIndex vocab = model_->GetVocabulary().Index(word);
+          ret = model_->FullScore(state, vocab, out);
+          if (vocab == model_->GetVocabulary().NotFound()) {
+            ++oov;
+            output.oov_probs.push_back(ret.prob);
+          }
+          total += ret.prob;
+          if (print_word_) QueryPrinter::WriteWord(output.text, word, vocab, ret);
+          ++output.tokens;
+          state = out;
+        }
+        // Only the last block can end without a newline.  Like Query, there's
+        // no </s> then.
+        if (i == end) return;
+        ++i;
+        if (sentence_context_) {
+          ret = model_->FullScore(state, model_->GetVocabulary().EndSentence(), out);
+          total += ret.prob;
+          ++output.tokens;
+          if (print_word_) QueryPrinter::WriteWord(output.text, "</s>", model_->GetVocabulary().EndSentence(), ret);
+        }
+        if (print_line_) QueryPrinter::WriteLine(output.text, oov, total);
+        output.line_totals.push_back(total);
+        output.oov += oov;
+      }
+    }
+
+    const Model *model_;
+    bool sentence_context_, print_word_, print_line_;
+    std::size_t thread_, threads_;
+    std::vector<QueryBlockOutput> *outputs_;
+};
+
+class QueryBlockWriter {
+  public:
+    QueryBlockWriter(QueryPrinter &printer, std::vector<QueryBlockOutput> &outputs, QueryTotals &corpus)
+      : printer_(&printer), outputs_(&outputs), corpus_(&corpus) {}
+
+    void Run(const util::stream::ChainPosition &position) {
+      std::size_t index = 0;
+      for (util::stream::Link block(position); block; ++block, ++index) {
+        QueryBlockOutput &output = (*outputs_)[index % outputs_->size()];
+        if (!output.text.str().empty()) printer_->Formatted(output.text.str());
+        for (std::vector<float>::const_iterator i = output.oov_probs.begin(); i != output.oov_probs.end(); ++i) {
+          corpus_->total_oov_only += *i;
+        }
+        for (std::vector<float>::const_iterator i = output.line_totals.begin(); i != output.line_totals.end(); ++i) {
+          corpus_->total += *i;
+        }
+        corpus_->oov += output.oov;
+        corpus_->tokens += output.tokens;
+        corpus_->lines += output.line_totals.size();
+        output.Clear();
+      }
+    }
+
+  private:
+    QueryPrinter *printer_;
+    std::vector<QueryBlockOutput> *outputs_;
+    QueryTotals *corpus_;
+};
+
+// Bytes of input in each block.  Longer lines are handled by QueryLineInput,
+// but each takes a block to itself.  Output for a block is several times
+// larger, so blocks are kept small.
+const std::size_t kQueryBlockSize = 1 << 20;
+
+/* Same output as Query, but scored by threads sharing the model.  Throughput
+ * is reported on stderr.
+ */
+template <class Model> void ThreadedQuery(const Model &model, bool sentence_context, QueryPrinter &printer, std::size_t threads, int in_fd = 0) {
+  // The threads share this, so it's the bulk of memory.
+  std::cerr << "Model memory: " << (util::RSSMax() >> 20) << " MB resident after loading" << std::endl;
+  // Blocks being scored, plus slack for uneven blocks, reading, and writing.
+  const std::size_t block_count = 2 * threads + 2;
+  std::vector<QueryBlockOutput> outputs(block_count);
+  QueryTotals corpus;
+  double start = util::WallTime();
+  {
+    util::stream::Chain chain(util::stream::ChainConfig(1, block_count, block_count * kQueryBlockSize));
+    chain >> QueryLineInput(in_fd, outputs);
+    for (std::size_t thread = 0; thread < threads; ++thread) {
+      chain >> QueryBlockScorer<Model>(model, sentence_context, printer.PrintWord(), printer.PrintLine(), thread, threads, outputs);
+    }
+    chain >> QueryBlockWriter(printer, outputs, corpus) >> util::stream::kRecycle;
   }
-  printer.Summary(
-      pow(10.0, -(corpus_total / static_cast<double>(corpus_tokens))), // PPL including OOVs
-      pow(10.0, -((corpus_total - corpus_total_oov_only) / static_cast<double>(corpus_tokens - corpus_oov))), // PPL excluding OOVs
-      corpus_oov,
-      corpus_tokens);
+  double elapsed = util::WallTime() - start;
+  corpus.Summary(printer);
+  std::cerr << "Scored " << corpus.lines << " lines and " << corpus.tokens << " tokens on " << threads << " threads in " << elapsed << " s: "
+    << static_cast<uint64_t>(elapsed > 0.0 ? corpus.lines / elapsed : 0.0) << " lines/s, "
+    << static_cast<uint64_t>(elapsed > 0.0 ? corpus.tokens / elapsed : 0.0) << " tokens/s" << std::endl;
 }
+#endif // WITH_THREADS
 
-template <class Model> void Query(const char *file, const Config &config, bool sentence_context, QueryPrinter &printer) {
+// threads is the number of scoring threads, with 0 for the usual serial mode.
+template <class Model> void Query(const char *file, const Config &config, bool sentence_context, QueryPrinter &printer, std::size_t threads = 0) {
   Model model(file, config);
+#ifdef WITH_THREADS
+  if (threads) {
+    ThreadedQuery(model, sentence_context, printer, threads);
+    return;
+  }
+#endif
   Query<Model, QueryPrinter>(model, sentence_context, printer);
 }
 
@@ -109,5 +396,3 @@ template <class Model> void Query(const char *file, const Config &config, bool s
 } // namespace lm
 
 #endif // LM_NGRAM_QUERY_H
-
-
@@ -0,0 +1,224 @@
+#include "lm/parallel_arpa.hh"
+
+#include "lm/blank.hh"
+#include "lm/lm_exception.hh"
+
+#include <algorithm>
+#include <string>
+
+#ifdef WITH_THREADS
+#include "util/pcqueue.hh"
+#include "util/thread_pool.hh"
+#endif
+
+namespace lm {
+
+namespace {
+
+// Enough lines that threads don't spend their time waiting on each other.
+const std::size_t kChunkLines = 8192;
+
+bool IsBlank(const StringPiece &line) {
+  for (const char *i = line.data(); i != line.data() + line.size(); ++i) {
+    if (!util::kSpaces[static_cast<unsigned char>(*i)]) return false;
+  }
+  return true;
+}
+
+const char *SkipSpaces(const char *i, const char *end, const bool *delim) {
+  for (; i != end && delim[static_cast<unsigned char>(*i)]; ++i) {}
+  return i;
+}
+
+/* Parse an n-gram line without its newline the same way ReadNGram parses one
+ * from util::FilePiece.  backoff is NULL for the highest order.
+ */
+template <class Lookup> void ParseLine(StringPiece line, unsigned int order, const Lookup &lookup, WordIndex *words, float &prob, float *backoff) {
+  const char *i = line.data(), *const end = line.data() + line.size();
+  i = util::ParseNumber(StringPiece(i, end - i), prob);
+  for (WordIndex *word_out = words; word_out != words + order; ++word_out) {
+    i = SkipSpaces(i, end, kARPASpaces);
+    UTIL_THROW_IF(i == end, FormatLoadException, "Expected " << order << " words");
+    const char *word_begin = i;
+    for (; i != end && !kARPASpaces[static_cast<unsigned char>(*i)]; ++i) {}
+    StringPiece word(word_begin, i - word_begin);
+    *word_out = lookup.Index(word);
+    // Check for words mapped to <unk> that are not the string <unk>.
+    UTIL_THROW_IF(*word_out == 0 /* mapped to <unk> */ && (word != StringPiece("<unk>", 5)) && (word != StringPiece("<UNK>", 5)),
+        FormatLoadException, "Word " << word << " was not seen in the unigrams (which are supposed to list the entire vocabulary) but appears");
+  }
+  if (i == end) {
+    if (backoff) *backoff = ngram::kNoExtensionBackoff;
+    return;
+  }
+  UTIL_THROW_IF(*i != '\t', FormatLoadException, "Expected tab or newline for backoff");
+  ++i;
+  float got;
+  i = util::ParseNumber(StringPiece(i, end - i), got);
+  if (backoff) {
+    // Zero is made negative as in ReadBackoff.
+    if (got == ngram::kExtensionBackoff) got = ngram::kNoExtensionBackoff;
+    CheckBackoff(got);
+    UTIL_THROW_IF(i != end, FormatLoadException, "Expected newline after backoff");
+    *backoff = got;
+  } else {
+    UTIL_THROW_IF(got != 0.0, FormatLoadException, "Non-zero backoff " << got << " provided for an n-gram that should have no backoff");
+  }
+}
+
+} // namespace
+
+struct ParallelARPA::Chunk {
+#ifdef WITH_THREADS
+  Chunk() : pending(false), done(0) {}
+#else
+  Chunk() : pending(false) {}
+#endif
+
+  void Parse() {
+    const std::size_t lines = ends.size();
+    words.resize(lines * order);
+    probs.resize(lines);
+    backoffs.resize(has_backoff ? lines : 0);
+    error.clear();
+    try {
+      std::size_t begin = 0;
+      for (parsed = 0; parsed < lines; begin = ends[parsed++]) {
+        ParseLine(StringPiece(text.data() + begin, ends[parsed] - begin), order, *lookup, &words[parsed * order], probs[parsed], has_backoff ? &backoffs[parsed] : NULL);
+      }
+    } catch (const util::Exception &e) {
+      error = e.what();
+    }
+  }
+
+  // Set by Fill.
+  unsigned int order;
+  bool has_backoff;
+  const Lookup *lookup;
+  std::string text;
+  // Where each line ends in text.
+  std::vector<std::size_t> ends;
+  std::vector<uint64_t> offsets;
+
+  // Set by Parse.  Lines before parsed are good.  The rest are not if error
+  // is set.
+  std::vector<WordIndex> words;
+  std::vector<float> probs, backoffs;
+  std::size_t parsed;
+  std::string error;
+
+  // Filled but not yet handed out.
+  bool pending;
+#ifdef WITH_THREADS
+  util::Semaphore done;
+#endif
+};
+
+#ifdef WITH_THREADS
+class ParallelARPA::Parser {
+  public:
+    typedef Chunk *Request;
+
+    void operator()(Chunk *chunk) {
+      chunk->Parse();
+      chunk->done.post();
+    }
+};
+#endif
+
+ParallelARPA::ParallelARPA(util::FilePiece &file, std::size_t threads)
+  : file_(file), order_(0), remaining_(0),
+    chunk_count_(2 * std::max<std::size_t>(threads, 1)), head_(0), started_(false),
+    current_(0), next_(0), available_(0), words_(NULL), probs_(NULL), backoffs_(NULL), offsets_(NULL) {
+  chunks_.reset(new Chunk[chunk_count_]);
+#ifdef WITH_THREADS
+  // The queue is as long as the ring, so handing out work never blocks.
+  pool_.reset(new util::ThreadPool<Parser>(chunk_count_, std::max<std::size_t>(threads, 1), Parser(), static_cast<Chunk*>(NULL)));
+#endif
+}
+
+ParallelARPA::~ParallelARPA() {}
+
+void ParallelARPA::ReadCounts(std::vector<uint64_t> &number) {
+  ReadARPACounts(file_, number);
+  counts_ = number;
+}
+
+void ParallelARPA::BeginOrder(unsigned int length) {
+  ReadNGramHeader(file_, length);
+  order_ = length;
+  remaining_ = (length <= counts_.size()) ? counts_[length - 1] : 0;
+  started_ = false;
+  current_ = next_ = available_ = 0;
+  offsets_ = NULL;
+}
+
+void ParallelARPA::End() {
+  ReadEnd(file_);
+}
+
+void ParallelARPA::Fill(Chunk &chunk) {
+  chunk.order = order_;
+  chunk.has_backoff = (order_ != counts_.size());
+  chunk.lookup = lookup_.get();
+  chunk.text.clear();
+  chunk.ends.clear();
+  chunk.offsets.clear();
+  while (remaining_ && chunk.ends.size() < kChunkLines) {
+    uint64_t offset = file_.Offset();
+    // Keep \r so it's an error as with util::FilePiece.
+    StringPiece line(file_.ReadLine('\n', false));
+    // ReadFloat skips blank lines between n-grams.
+    if (IsBlank(line)) continue;
+    chunk.offsets.push_back(offset);
+    // Leading spaces before the probability are skipped as in ReadFloat.
+    const char *begin = SkipSpaces(line.data(), line.data() + line.size(), util::kSpaces);
+    chunk.text.append(begin, line.data() + line.size() - begin);
+    chunk.ends.push_back(chunk.text.size());
+    --remaining_;
+  }
+  chunk.pending = true;
+#ifdef WITH_THREADS
+  pool_->Produce(&chunk);
+#else
+  chunk.Parse();
+#endif
+}
+
+void ParallelARPA::NextChunk() {
+  if (started_) {
+    Chunk &finished = chunks_[head_];
+    if (!finished.error.empty()) {
+      // Report the line that failed, not the previous one.
+      current_ = next_;
+      FormatLoadException e;
+      e << finished.error;
+      throw e;
+    }
+    offsets_ = NULL;
+    if (remaining_) Fill(finished);
+    head_ = (head_ + 1) % chunk_count_;
+  } else {
+    for (std::size_t i = 0; i < chunk_count_ && remaining_; ++i) {
+      Fill(chunks_[i]);
+    }
+    head_ = 0;
+    started_ = true;
+  }
+  Chunk &chunk = chunks_[head_];
+  UTIL_THROW_IF(!chunk.pending, FormatLoadException, "Read past the " << counts_[order_ - 1] << " " << order_ << "-grams in the header");
+#ifdef WITH_THREADS
+  util::WaitSemaphore(chunk.done);
+#endif
+  chunk.pending = false;
+  next_ = 0;
+  available_ = chunk.parsed;
+  words_ = chunk.words.empty() ? NULL : &chunk.words[0];
+  probs_ = &chunk.probs[0];
+  backoffs_ = chunk.backoffs.empty() ? NULL : &chunk.backoffs[0];
+  offsets_ = &chunk.offsets[0];
+  // The first line failed.
+  if (!available_) NextChunk();
+}
+
+} // namespace lm
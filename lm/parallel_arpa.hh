@@ -0,0 +1,163 @@
+#ifndef LM_PARALLEL_ARPA_H
+#define LM_PARALLEL_ARPA_H
+
+#include "lm/read_arpa.hh"
+#include "lm/word_index.hh"
+#include "util/file_piece.hh"
+#include "util/string_piece.hh"
+
+#include <boost/scoped_array.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <cstddef>
+#include <vector>
+
+#include <stdint.h>
+
+namespace util { template <class Handler> class ThreadPool; }
+
+namespace lm {
+
+/* Reads an ARPA file like util::FilePiece, but parses the n-grams above
+ * unigrams (numbers and vocabulary lookups) on worker threads.  This thread
+ * still reads lines, in chunks, and hands out parsed n-grams in file order, so
+ * anything built from them is the same as with util::FilePiece.  Unigrams are
+ * parsed by this thread because they build the vocabulary.
+ */
+class ParallelARPA {
+  public:
+    // file should be at the beginning.  It is not owned.
+    ParallelARPA(util::FilePiece &file, std::size_t threads);
+
+    ~ParallelARPA();
+
+    util::FilePiece &File() { return file_; }
+
+    void ReadCounts(std::vector<uint64_t> &number);
+
+    void BeginOrder(unsigned int length);
+
+    // Move to the next n-gram of the current order.  vocab must be the same
+    // every time and finished loading.
+    template <class Voc> void Next(const Voc &vocab) {
+      if (!lookup_.get()) lookup_.reset(new VocabLookup<Voc>(vocab));
+      if (next_ == available_) NextChunk();
+      current_ = next_++;
+    }
+
+    // The current n-gram, with words in file order.
+    const WordIndex *Words() const { return words_ + current_ * order_; }
+    float Prob() const { return probs_[current_]; }
+    // Not below the highest order.
+    float Backoff() const { return backoffs_[current_]; }
+
+    // Byte offset of the current n-gram's line, for error messages.
+    uint64_t Offset() const { return offsets_ ? offsets_[current_] : file_.Offset(); }
+
+    void End();
+
+  private:
+    class Lookup {
+      public:
+        virtual ~Lookup() {}
+        virtual WordIndex Index(const StringPiece &word) const = 0;
+    };
+
+    template <class Voc> class VocabLookup : public Lookup {
+      public:
+        explicit VocabLookup(const Voc &vocab) : vocab_(vocab) {}
+
+        WordIndex Index(const StringPiece &word) const {
+          return vocab_.Index(word);
+        }
+
+      private:
+        const Voc &vocab_;
+    };
+
+    struct Chunk;
+
+    // Read lines into chunk and start parsing them.
+    void Fill(Chunk &chunk);
+
+    // Wait for the next chunk, throwing its error if that's all that's left.
+    void NextChunk();
+
+    util::FilePiece &file_;
+
+    std::vector<uint64_t> counts_;
+
+    unsigned int order_;
+
+    // Lines of the current order not yet read.
+    uint64_t remaining_;
+
+    boost::scoped_ptr<Lookup> lookup_;
+
+    // Ring of chunks.  head_ is being consumed.  The rest are being parsed in
+    // turn.
+    boost::scoped_array<Chunk> chunks_;
+    std::size_t chunk_count_;
+    std::size_t head_;
+    bool started_;
+
+    // Parsed n-grams in the head chunk.
+    std::size_t current_, next_, available_;
+    const WordIndex *words_;
+    const float *probs_, *backoffs_;
+    const uint64_t *offsets_;
+
+#ifdef WITH_THREADS
+    class Parser;
+    // Last so it joins before chunks go away.
+    boost::scoped_ptr<util::ThreadPool<Parser> > pool_;
+#endif
+};
+
+inline void ReadARPACounts(ParallelARPA &in, std::vector<uint64_t> &number) {
+  in.ReadCounts(number);
+}
+inline void ReadNGramHeader(ParallelARPA &in, unsigned int length) {
+  in.BeginOrder(length);
+}
+
+inline void ReadBackoff(ParallelARPA &/*in*/, Prob &/*weights*/) {}
+inline void ReadBackoff(ParallelARPA &in, float &backoff) {
+  backoff = in.Backoff();
+}
+inline void ReadBackoff(ParallelARPA &in, ProbBackoff &weights) {
+  ReadBackoff(in, weights.backoff);
+}
+inline void ReadBackoff(ParallelARPA &in, RestWeights &weights) {
+  ReadBackoff(in, weights.backoff);
+}
+
+inline void ReadEnd(ParallelARPA &in) {
+  in.End();
+}
+
+template <class Voc, class Weights> void Read1Gram(ParallelARPA &f, Voc &vocab, Weights *unigrams, PositiveProbWarn &warn) {
+  Read1Gram(f.File(), vocab, unigrams, warn);
+}
+
+template <class Voc, class Weights, class Iterator> void ReadNGram(ParallelARPA &f, const unsigned char n, const Voc &vocab, Iterator indices_out, Weights &weights, PositiveProbWarn &warn) {
+  try {
+    f.Next(vocab);
+    weights.prob = f.Prob();
+    if (weights.prob > 0.0) {
+      warn.Warn(weights.prob);
+      weights.prob = 0.0;
+    }
+    for (const WordIndex *i = f.Words(); i != f.Words() + n; ++i, ++indices_out) {
+      *indices_out = *i;
+    }
+    ReadBackoff(f, weights);
+  } catch(util::Exception &e) {
+    e << " in the " << static_cast<unsigned int>(n) << "-gram at byte " << f.Offset();
+    throw;
+  }
+}
+
+} // namespace lm
+
+#endif // LM_PARALLEL_ARPA_H
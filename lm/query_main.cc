@@ -10,12 +10,15 @@
 void Usage(const char *name) {
   std::cerr <<
     "KenLM was compiled with maximum order " << KENLM_MAX_ORDER << ".\n"
-    "Usage: " << name << " [-b] [-n] [-w] [-s] lm_file\n"
+    "Usage: " << name << " [-b] [-n] [-w] [-s] [-t threads] lm_file\n"
     "-b: Do not buffer output.\n"
     "-n: Do not wrap the input in <s> and </s>.\n"
     "-v summary|sentence|word: Level of verbosity\n"
-    "-l lazy|populate|read|parallel: Load lazily, with populate, or malloc+read\n"
-    "The default loading method is populate on Linux and read on others.\n";
+    "-l lazy|populate|read|parallel|interleave: Load lazily, with populate, or malloc+read\n"
+    "   interleave is read with pages spread over all NUMA nodes\n"
+    "The default loading method is populate on Linux and read on others.\n"
+    "-t threads: Score blocks of input on this many threads sharing the model.\n"
+    "   Output is in input order.  Throughput is reported on stderr.\n";
   exit(1);
 }
 
@@ -27,9 +30,10 @@ int main(int argc, char *argv[]) {
   bool sentence_context = true;
   unsigned int verbosity = 2;
   bool flush = false;
+  std::size_t threads = 0;
 
   int opt;
-  while ((opt = getopt(argc, argv, "bnv:l:")) != -1) {
+  while ((opt = getopt(argc, argv, "bnv:l:t:")) != -1) {
     switch (opt) {
       case 'b':
         flush = true;
@@ -57,10 +61,21 @@ int main(int argc, char *argv[]) {
           config.load_method = util::READ;
         } else if (!strcmp(optarg, "parallel")) {
           config.load_method = util::PARALLEL_READ;
+        } else if (!strcmp(optarg, "interleave")) {
+          config.load_method = util::READ_INTERLEAVE;
         } else {
           Usage(argv[0]);
         }
         break;
+      case 't':
+#ifdef WITH_THREADS
+        threads = atoi(optarg);
+        if (!threads) Usage(argv[0]);
+#else
+        std::cerr << "-t requires query to be compiled with threading support." << std::endl;
+        return 1;
+#endif
+        break;
       case 'h':
       default:
         Usage(argv[0]);
@@ -76,22 +91,25 @@ int main(int argc, char *argv[]) {
     if (RecognizeBinary(file, model_type)) {
       switch(model_type) {
         case PROBING:
-          Query<lm::ngram::ProbingModel>(file, config, sentence_context, printer);
+          Query<lm::ngram::ProbingModel>(file, config, sentence_context, printer, threads);
           break;
         case REST_PROBING:
-          Query<lm::ngram::RestProbingModel>(file, config, sentence_context, printer);
+          Query<lm::ngram::RestProbingModel>(file, config, sentence_context, printer, threads);
           break;
         case TRIE:
-          Query<TrieModel>(file, config, sentence_context, printer);
+          Query<TrieModel>(file, config, sentence_context, printer, threads);
           break;
         case QUANT_TRIE:
-          Query<QuantTrieModel>(file, config, sentence_context, printer);
+          Query<QuantTrieModel>(file, config, sentence_context, printer, threads);
           break;
         case ARRAY_TRIE:
-          Query<ArrayTrieModel>(file, config, sentence_context, printer);
+          Query<ArrayTrieModel>(file, config, sentence_context, printer, threads);
           break;
         case QUANT_ARRAY_TRIE:
-          Query<QuantArrayTrieModel>(file, config, sentence_context, printer);
+          Query<QuantArrayTrieModel>(file, config, sentence_context, printer, threads);
+          break;
+        case PERFECT_HASH:
+          Query<PerfectHashModel>(file, config, sentence_context, printer, threads);
           break;
         default:
           std::cerr << "Unrecognized kenlm model type " << model_type << std::endl;
@@ -104,7 +122,7 @@ int main(int argc, char *argv[]) {
       Query<lm::np::Model, lm::ngram::QueryPrinter>(model, sentence_context, printer);
 #endif
     } else {
-      Query<ProbingModel>(file, config, sentence_context, printer);
+      Query<ProbingModel>(file, config, sentence_context, printer, threads);
     }
     util::PrintUsage(std::cerr);
   } catch (const std::exception &e) {
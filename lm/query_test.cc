@@ -0,0 +1,66 @@
+#include "lm/ngram_query.hh"
+
+#include "util/file.hh"
+
+#include <string>
+
+#define BOOST_TEST_MODULE QueryTest
+#include <boost/test/unit_test.hpp>
+
+namespace lm {
+namespace ngram {
+namespace {
+
+#ifdef WITH_THREADS
+std::string ReadAll(int fd) {
+  std::string ret(util::SizeOrThrow(fd), 0);
+  util::SeekOrThrow(fd, 0);
+  if (!ret.empty()) util::ReadOrThrow(fd, &ret[0], ret.size());
+  return ret;
+}
+
+// Serial and threaded query must print the same thing for the input.
+void Compare(const std::string &input, std::size_t threads) {
+  Model model(boost::unit_test::framework::master_test_suite().argv[1]);
+  util::scoped_fd in(util::MakeTemp("query_test_in"));
+  util::WriteOrThrow(in.get(), input.data(), input.size());
+
+  util::scoped_fd serial(util::MakeTemp("query_test_serial"));
+  {
+    QueryPrinter printer(serial.get(), true, true, true, false);
+    util::SeekOrThrow(in.get(), 0);
+    // Both readers take ownership of the fd they're given.
+    Query<Model, QueryPrinter>(model, true, printer, util::DupOrThrow(in.get()));
+  }
+  util::scoped_fd threaded(util::MakeTemp("query_test_threaded"));
+  {
+    QueryPrinter printer(threaded.get(), true, true, true, false);
+    util::SeekOrThrow(in.get(), 0);
+    ThreadedQuery(model, true, printer, threads, util::DupOrThrow(in.get()));
+  }
+  std::string serial_out(ReadAll(serial.get()));
+  BOOST_CHECK(!serial_out.empty());
+  BOOST_CHECK(serial_out == ReadAll(threaded.get()));
+}
+
+BOOST_AUTO_TEST_CASE(Short) {
+  Compare("looking on a little more loin\non a little more\nloin\n", 2);
+}
+
+// Lines longer than a block are carried separately instead of failing.
+BOOST_AUTO_TEST_CASE(LongerThanBlock) {
+  std::string input("on a little more\n");
+  std::string long_line;
+  while (long_line.size() <= 2 * kQueryBlockSize) {
+    long_line += "looking on a little more loin ";
+  }
+  input += long_line + "\nloin\n" + long_line + "\n" + long_line;
+  Compare(input, 3);
+}
+#else
+BOOST_AUTO_TEST_CASE(NoThreads) {}
+#endif
+
+} // namespace
+} // namespace ngram
+} // namespace lm
@@ -44,6 +44,16 @@ uint64_t ReadCount(const std::string &from) {
 
 } // namespace
 
+void CheckBackoff(float backoff) {
+#if defined(WIN32) && !defined(__MINGW32__)
+  int float_class = _fpclass(backoff);
+  UTIL_THROW_IF(float_class == _FPCLASS_SNAN || float_class == _FPCLASS_QNAN || float_class == _FPCLASS_NINF || float_class == _FPCLASS_PINF, FormatLoadException, "Bad backoff " << backoff);
+#else
+  int float_class = std::fpclassify(backoff);
+  UTIL_THROW_IF(float_class == FP_NAN || float_class == FP_INFINITE, FormatLoadException, "Bad backoff " << backoff);
+#endif
+}
+
 void ReadARPACounts(util::FilePiece &in, std::vector<uint64_t> &number) {
   number.clear();
   StringPiece line = in.ReadLine();
@@ -111,15 +121,7 @@ void ReadBackoff(util::FilePiece &in, float &backoff) {
     case '\t':
       backoff = in.ReadFloat();
       if (backoff == ngram::kExtensionBackoff) backoff = ngram::kNoExtensionBackoff;
-      {
-#if defined(WIN32) && !defined(__MINGW32__)
-		int float_class = _fpclass(backoff);
-        UTIL_THROW_IF(float_class == _FPCLASS_SNAN || float_class == _FPCLASS_QNAN || float_class == _FPCLASS_NINF || float_class == _FPCLASS_PINF, FormatLoadException, "Bad backoff " << backoff);
-#else
-        int float_class = std::fpclassify(backoff);
-        UTIL_THROW_IF(float_class == FP_NAN || float_class == FP_INFINITE, FormatLoadException, "Bad backoff " << backoff);
-#endif
-      }
+      CheckBackoff(backoff);
       UTIL_THROW_IF(in.get() != '\n', FormatLoadException, "Expected newline after backoff");
       break;
     case '\n':
@@ -145,6 +147,15 @@ void ReadEnd(util::FilePiece &in) {
   } catch (const util::EndOfFileException &e) {}
 }
 
+NGramSource::~NGramSource() {}
+
+void ReadBackoff(NGramSource &in, float &backoff) {
+  // Zero is made negative as in the ARPA reader.
+  backoff = in.Backoff();
+  if (backoff == ngram::kExtensionBackoff) backoff = ngram::kNoExtensionBackoff;
+  CheckBackoff(backoff);
+}
+
 void PositiveProbWarn::Warn(float prob) {
   switch (action_) {
     case THROW_UP:
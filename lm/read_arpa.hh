@@ -26,6 +26,60 @@ inline void ReadBackoff(util::FilePiece &in, RestWeights &weights) {
 
 void ReadEnd(util::FilePiece &in);
 
+// Throws FormatLoadException if the backoff is NaN or infinite.
+void CheckBackoff(float backoff);
+
+/* N-grams that have already been parsed, such as lmplz's intermediate
+ * streams, so that a model can be built without the text round trip through
+ * an ARPA file.  Orders are read in increasing order, each from the
+ * beginning, just as they appear in an ARPA file.
+ */
+class NGramSource {
+  public:
+    virtual ~NGramSource();
+
+    // Like the ARPA header.
+    virtual void ReadCounts(std::vector<uint64_t> &number) = 0;
+
+    // Throws if the previous order has n-grams that were not read.
+    virtual void BeginOrder(unsigned int length) = 0;
+
+    // Move to the next n-gram of the current order.  Throws if there isn't one.
+    virtual void Next() = 0;
+
+    // The current n-gram.  Word(0) is the first word, as in an ARPA file.
+    virtual StringPiece Word(unsigned int index) const = 0;
+    virtual float Prob() const = 0;
+    // Only called below the highest order.
+    virtual float Backoff() const = 0;
+
+    // Index of the current n-gram within its order, for error messages.
+    virtual uint64_t Offset() const = 0;
+
+    // Throws if the highest order has n-grams that were not read.
+    virtual void End() = 0;
+};
+
+inline void ReadARPACounts(NGramSource &in, std::vector<uint64_t> &number) {
+  in.ReadCounts(number);
+}
+inline void ReadNGramHeader(NGramSource &in, unsigned int length) {
+  in.BeginOrder(length);
+}
+
+inline void ReadBackoff(NGramSource &/*in*/, Prob &/*weights*/) {}
+void ReadBackoff(NGramSource &in, float &backoff);
+inline void ReadBackoff(NGramSource &in, ProbBackoff &weights) {
+  ReadBackoff(in, weights.backoff);
+}
+inline void ReadBackoff(NGramSource &in, RestWeights &weights) {
+  ReadBackoff(in, weights.backoff);
+}
+
+inline void ReadEnd(NGramSource &in) {
+  in.End();
+}
+
 extern const bool kARPASpaces[256];
 
 // Positive log probability warning.
@@ -59,7 +113,25 @@ template <class Voc, class Weights> void Read1Gram(util::FilePiece &f, Voc &voca
   }
 }
 
-template <class Voc, class Weights> void Read1Grams(util::FilePiece &f, std::size_t count, Voc &vocab, Weights *unigrams, PositiveProbWarn &warn) {
+template <class Voc, class Weights> void Read1Gram(NGramSource &f, Voc &vocab, Weights *unigrams, PositiveProbWarn &warn) {
+  try {
+    f.Next();
+    float prob = f.Prob();
+    if (prob > 0.0) {
+      warn.Warn(prob);
+      prob = 0.0;
+    }
+    WordIndex word = vocab.Insert(f.Word(0));
+    Weights &w = unigrams[word];
+    w.prob = prob;
+    ReadBackoff(f, w);
+  } catch(util::Exception &e) {
+    e << " in 1-gram number " << f.Offset();
+    throw;
+  }
+}
+
+template <class In, class Voc, class Weights> void Read1Grams(In &f, std::size_t count, Voc &vocab, Weights *unigrams, PositiveProbWarn &warn) {
   ReadNGramHeader(f, 1);
   for (std::size_t i = 0; i < count; ++i) {
     Read1Gram(f, vocab, unigrams, warn);
@@ -90,6 +162,28 @@ template <class Voc, class Weights, class Iterator> void ReadNGram(util::FilePie
   }
 }
 
+template <class Voc, class Weights, class Iterator> void ReadNGram(NGramSource &f, const unsigned char n, const Voc &vocab, Iterator indices_out, Weights &weights, PositiveProbWarn &warn) {
+  try {
+    f.Next();
+    weights.prob = f.Prob();
+    if (weights.prob > 0.0) {
+      warn.Warn(weights.prob);
+      weights.prob = 0.0;
+    }
+    for (unsigned char i = 0; i < n; ++i, ++indices_out) {
+      StringPiece word(f.Word(i));
+      WordIndex index = vocab.Index(word);
+      *indices_out = index;
+      UTIL_THROW_IF(index == 0 /* mapped to <unk> */ && (word != StringPiece("<unk>", 5)) && (word != StringPiece("<UNK>", 5)),
+          FormatLoadException, "Word " << word << " was not seen in the unigrams but appears");
+    }
+    ReadBackoff(f, weights);
+  } catch(util::Exception &e) {
+    e << " in " << static_cast<unsigned int>(n) << "-gram number " << f.Offset();
+    throw;
+  }
+}
+
 } // namespace lm
 
 #endif // LM_READ_ARPA_H
@@ -4,6 +4,7 @@
 #include "lm/blank.hh"
 #include "lm/lm_exception.hh"
 #include "lm/model.hh"
+#include "lm/parallel_arpa.hh"
 #include "lm/read_arpa.hh"
 #include "lm/value.hh"
 #include "lm/vocab.hh"
@@ -156,8 +157,8 @@ template <class Build> void MarkLower(
   }
 }
 
-template <class Build, class Activate, class Store> void ReadNGrams(
-    util::FilePiece &f,
+template <class Build, class Activate, class Store, class In> void ReadNGrams(
+    In &f,
     const unsigned int n,
     const size_t count,
     const ProbingVocabulary &vocab,
@@ -229,24 +230,27 @@ template <class Value> uint8_t *HashedSearch<Value>::SetupMemory(uint8_t *start,
   longest_.Relocate(start);
 }*/
 
-template <class Value> void HashedSearch<Value>::InitializeFromARPA(const char * /*file*/, util::FilePiece &f, const std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab, BinaryFormat &backing) {
+template <class Value> template <class In> void HashedSearch<Value>::InitializeFromARPA(const char * /*file*/, In &f, const std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab, BinaryFormat &backing) {
   void *vocab_rebase;
   void *search_base = backing.GrowForSearch(Size(counts, config), vocab.UnkCountChangePadding(), vocab_rebase);
   vocab.Relocate(vocab_rebase);
   SetupMemory(reinterpret_cast<uint8_t*>(search_base), counts, config);
+  LoadARPA(f, counts, config, vocab);
+}
 
+template <class Value> template <class In> void HashedSearch<Value>::LoadARPA(In &f, const std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab) {
   PositiveProbWarn warn(config.positive_log_probability);
   Read1Grams(f, counts[0], vocab, unigram_.Raw(), warn);
   CheckSpecials(config, vocab);
   DispatchBuild(f, counts, config, vocab, warn);
 }
 
-template <> void HashedSearch<BackoffValue>::DispatchBuild(util::FilePiece &f, const std::vector<uint64_t> &counts, const Config &config, const ProbingVocabulary &vocab, PositiveProbWarn &warn) {
+template <> template <class In> void HashedSearch<BackoffValue>::DispatchBuild(In &f, const std::vector<uint64_t> &counts, const Config &config, const ProbingVocabulary &vocab, PositiveProbWarn &warn) {
   NoRestBuild build;
   ApplyBuild(f, counts, vocab, warn, build);
 }
 
-template <> void HashedSearch<RestValue>::DispatchBuild(util::FilePiece &f, const std::vector<uint64_t> &counts, const Config &config, const ProbingVocabulary &vocab, PositiveProbWarn &warn) {
+template <> template <class In> void HashedSearch<RestValue>::DispatchBuild(In &f, const std::vector<uint64_t> &counts, const Config &config, const ProbingVocabulary &vocab, PositiveProbWarn &warn) {
   switch (config.rest_function) {
     case Config::REST_MAX:
       {
@@ -263,7 +267,7 @@ template <> void HashedSearch<RestValue>::DispatchBuild(util::FilePiece &f, cons
   }
 }
 
-template <class Value> template <class Build> void HashedSearch<Value>::ApplyBuild(util::FilePiece &f, const std::vector<uint64_t> &counts, const ProbingVocabulary &vocab, PositiveProbWarn &warn, const Build &build) {
+template <class Value> template <class In, class Build> void HashedSearch<Value>::ApplyBuild(In &f, const std::vector<uint64_t> &counts, const ProbingVocabulary &vocab, PositiveProbWarn &warn, const Build &build) {
   for (WordIndex i = 0; i < counts[0]; ++i) {
     build.SetRest(&i, (unsigned int)1, unigram_.Raw()[i]);
   }
@@ -293,6 +297,16 @@ template <class Value> template <class Build> void HashedSearch<Value>::ApplyBui
 template class HashedSearch<BackoffValue>;
 template class HashedSearch<RestValue>;
 
+template void HashedSearch<BackoffValue>::InitializeFromARPA(const char *file, util::FilePiece &f, const std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab, BinaryFormat &backing);
+template void HashedSearch<BackoffValue>::InitializeFromARPA(const char *file, NGramSource &f, const std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab, BinaryFormat &backing);
+template void HashedSearch<BackoffValue>::InitializeFromARPA(const char *file, ParallelARPA &f, const std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab, BinaryFormat &backing);
+template void HashedSearch<RestValue>::InitializeFromARPA(const char *file, util::FilePiece &f, const std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab, BinaryFormat &backing);
+template void HashedSearch<RestValue>::InitializeFromARPA(const char *file, NGramSource &f, const std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab, BinaryFormat &backing);
+template void HashedSearch<RestValue>::InitializeFromARPA(const char *file, ParallelARPA &f, const std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab, BinaryFormat &backing);
+template void HashedSearch<BackoffValue>::LoadARPA(util::FilePiece &f, const std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab);
+template void HashedSearch<BackoffValue>::LoadARPA(NGramSource &f, const std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab);
+template void HashedSearch<BackoffValue>::LoadARPA(ParallelARPA &f, const std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab);
+
 } // namespace detail
 } // namespace ngram
 } // namespace lm
@@ -8,6 +8,7 @@
 #include "lm/weights.hh"
 
 #include "util/bit_packing.hh"
+#include "util/prefetch.hh"
 #include "util/probing_hash_table.hh"
 
 #include <algorithm>
@@ -84,7 +85,12 @@ template <class Value> class HashedSearch {
 
     uint8_t *SetupMemory(uint8_t *start, const std::vector<uint64_t> &counts, const Config &config);
 
-    void InitializeFromARPA(const char *file, util::FilePiece &f, const std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab, BinaryFormat &backing);
+    // In is util::FilePiece, ParallelARPA, or NGramSource.
+    template <class In> void InitializeFromARPA(const char *file, In &f, const std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab, BinaryFormat &backing);
+
+    // The part of InitializeFromARPA after memory is set up, which is also how
+    // PerfectHashSearch builds from temporary probing tables.
+    template <class In> void LoadARPA(In &f, const std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab);
 
     unsigned char Order() const {
       return middle_.size() + 2;
@@ -100,6 +106,20 @@ template <class Value> class HashedSearch {
       return ret;
     }
 
+    // Prefetch hints.  Call with the same arguments as the Lookup functions
+    // below some time before calling them.
+    void PrefetchUnigram(WordIndex word) const {
+      util::PrefetchRead(&unigram_.Lookup(word));
+    }
+
+    void PrefetchMiddle(unsigned char order_minus_2, WordIndex word, const Node &node) const {
+      middle_[order_minus_2].Prefetch(CombineWordHash(node, word));
+    }
+
+    void PrefetchLongest(WordIndex word, const Node &node) const {
+      longest_.Prefetch(CombineWordHash(node, word));
+    }
+
     MiddlePointer Unpack(uint64_t extend_pointer, unsigned char extend_length, Node &node) const {
       node = extend_pointer;
       return MiddlePointer(middle_[extend_length - 2].MustFind(extend_pointer)->value);
@@ -136,11 +156,19 @@ template <class Value> class HashedSearch {
       return true;
     }
 
+    typedef util::ProbingHashTable<typename Value::ProbingEntry, util::IdentityHash> Middle;
+    typedef util::ProbingHashTable<ProbEntry, util::IdentityHash> Longest;
+
+    // For converting to other searches.
+    const typename Value::Weights *Unigrams() const { return &unigram_.Lookup(0); }
+    const Middle &MiddleTable(unsigned char order_minus_2) const { return middle_[order_minus_2]; }
+    const Longest &LongestTable() const { return longest_; }
+
   private:
     // Interpret config's rest cost build policy and pass the right template argument to ApplyBuild.
-    void DispatchBuild(util::FilePiece &f, const std::vector<uint64_t> &counts, const Config &config, const ProbingVocabulary &vocab, PositiveProbWarn &warn);
+    template <class In> void DispatchBuild(In &f, const std::vector<uint64_t> &counts, const Config &config, const ProbingVocabulary &vocab, PositiveProbWarn &warn);
 
-    template <class Build> void ApplyBuild(util::FilePiece &f, const std::vector<uint64_t> &counts, const ProbingVocabulary &vocab, PositiveProbWarn &warn, const Build &build);
+    template <class In, class Build> void ApplyBuild(In &f, const std::vector<uint64_t> &counts, const ProbingVocabulary &vocab, PositiveProbWarn &warn, const Build &build);
 
     class Unigram {
       public:
@@ -178,10 +206,8 @@ template <class Value> class HashedSearch {
 
     Unigram unigram_;
 
-    typedef util::ProbingHashTable<typename Value::ProbingEntry, util::IdentityHash> Middle;
     std::vector<Middle> middle_;
 
-    typedef util::ProbingHashTable<ProbEntry, util::IdentityHash> Longest;
     Longest longest_;
 };
 
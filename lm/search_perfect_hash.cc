@@ -0,0 +1,163 @@
+#include "lm/search_perfect_hash.hh"
+
+#include "lm/binary_format.hh"
+#include "lm/lm_exception.hh"
+#include "lm/parallel_arpa.hh"
+#include "lm/read_arpa.hh"
+#include "lm/vocab.hh"
+
+#include "util/ersatz_progress.hh"
+#include "util/file_piece.hh"
+#include "util/mmap.hh"
+
+#include <cstring>
+
+namespace lm {
+namespace ngram {
+namespace detail {
+
+namespace {
+
+// Fingerprint bits, padded for alignment.
+const uint64_t kHeaderSize = 8;
+
+typedef HashedSearch<BackoffValue> Probing;
+
+uint64_t UnigramSize(uint64_t count) {
+  // +1 for hallucinate <unk> as in HashedSearch.
+  return (count + 1) * sizeof(ProbBackoff);
+}
+
+// Keys in a probing hash table, which marks empty buckets with key 0.
+template <class Table> void CollectKeys(const Table &table, std::vector<uint64_t> &keys) {
+  keys.clear();
+  for (typename Table::ConstIterator i = table.RawBegin(); i != table.RawEnd(); ++i) {
+    if (i->key) keys.push_back(i->key);
+  }
+}
+
+template <class Table> uint64_t CountEntries(const Table &table) {
+  uint64_t ret = 0;
+  for (typename Table::ConstIterator i = table.RawBegin(); i != table.RawEnd(); ++i) {
+    if (i->key) ++ret;
+  }
+  return ret;
+}
+
+void BuildHash(const std::vector<uint64_t> &keys, unsigned int n, PerfectHashTable &table) {
+  try {
+    table.Build(keys.empty() ? NULL : &keys[0], keys.empty() ? NULL : &keys[0] + keys.size());
+  } catch (const util::PerfectHashDuplicateException &e) {
+    UTIL_THROW(FormatLoadException, "There is a duplicate " << n << "-gram (or two " << n << "-grams with the same 64-bit hash).");
+  }
+}
+
+} // namespace
+
+void PerfectHashSearch::UpdateConfigFromBinary(const BinaryFormat &file, const std::vector<uint64_t> &counts, uint64_t offset, Config &config) {
+  SeparatelyQuantize::UpdateConfigFromBinary(file, offset, config);
+  file.ReadForConfig(&config.fingerprint_bits, 1, offset + SeparatelyQuantize::Size(counts.size(), config));
+}
+
+uint64_t PerfectHashSearch::Size(const std::vector<uint64_t> &counts, const Config &config) {
+  uint64_t ret = SeparatelyQuantize::Size(counts.size(), config) + kHeaderSize + UnigramSize(counts[0]);
+  for (unsigned char n = 1; n < counts.size() - 1; ++n) {
+    ret += PerfectHashTable::Size(counts[n], config.fingerprint_bits, SeparatelyQuantize::MiddleBits(config) + 1);
+  }
+  return ret + PerfectHashTable::Size(counts.back(), config.fingerprint_bits, SeparatelyQuantize::LongestBits(config));
+}
+
+uint8_t *PerfectHashSearch::SetupMemory(uint8_t *start, const std::vector<uint64_t> &counts, const Config &config) {
+  UTIL_THROW_IF(!config.fingerprint_bits || config.fingerprint_bits > 57, ConfigException, "Fingerprints can have 1 to 57 bits, not " << static_cast<unsigned>(config.fingerprint_bits) << ".");
+  quant_.SetupMemory(start, counts.size(), config);
+  start += SeparatelyQuantize::Size(counts.size(), config);
+  header_ = start;
+  start += kHeaderSize;
+  unigram_ = reinterpret_cast<ProbBackoff*>(start);
+  start += UnigramSize(counts[0]);
+
+  middle_bits_ = SeparatelyQuantize::MiddleBits(config);
+  middle_.resize(counts.size() - 2);
+  for (unsigned char n = 2; n < counts.size(); ++n) {
+    // The extra bit is independent_left.
+    middle_[n - 2].Init(start, counts[n - 1], config.fingerprint_bits, middle_bits_ + 1);
+    start += PerfectHashTable::Size(counts[n - 1], config.fingerprint_bits, middle_bits_ + 1);
+  }
+  longest_.Init(start, counts.back(), config.fingerprint_bits, SeparatelyQuantize::LongestBits(config));
+  return start + PerfectHashTable::Size(counts.back(), config.fingerprint_bits, SeparatelyQuantize::LongestBits(config));
+}
+
+template <class In> void PerfectHashSearch::InitializeFromARPA(const char * /*file*/, In &f, std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab, BinaryFormat &backing) {
+  util::scoped_memory probing_memory;
+  util::HugeMalloc(Probing::Size(counts, config), true, probing_memory);
+  Probing probing;
+  probing.SetupMemory(static_cast<uint8_t*>(probing_memory.get()), counts, config);
+  probing.LoadARPA(f, counts, config, vocab);
+
+  // Count the n-grams, including those filled in.
+  for (unsigned char n = 2; n < counts.size(); ++n) {
+    counts[n - 1] = CountEntries(probing.MiddleTable(n - 2));
+  }
+  uint64_t longest = CountEntries(probing.LongestTable());
+  UTIL_THROW_IF(longest != counts.back(), FormatLoadException, "The ARPA file says there are " << counts.back() << " " << counts.size() << "-grams but " << longest << " were loaded.");
+
+  void *vocab_rebase;
+  void *search_base = backing.GrowForSearch(Size(counts, config), vocab.UnkCountChangePadding(), vocab_rebase);
+  vocab.Relocate(vocab_rebase);
+  SetupMemory(reinterpret_cast<uint8_t*>(search_base), counts, config);
+  *header_ = config.fingerprint_bits;
+  memcpy(unigram_, probing.Unigrams(), UnigramSize(counts[0]));
+
+  std::vector<float> probs, backoffs;
+  for (unsigned char n = 2; n < counts.size(); ++n) {
+    const Probing::Middle &table = probing.MiddleTable(n - 2);
+    probs.clear();
+    backoffs.clear();
+    for (Probing::Middle::ConstIterator i = table.RawBegin(); i != table.RawEnd(); ++i) {
+      if (!i->key) continue;
+      BackoffValue::ProbingProxy weights(i->value);
+      probs.push_back(weights.Prob());
+      if (weights.Backoff() != 0.0) backoffs.push_back(weights.Backoff());
+    }
+    quant_.Train(n, probs, backoffs);
+  }
+  probs.clear();
+  for (Probing::Longest::ConstIterator i = probing.LongestTable().RawBegin(); i != probing.LongestTable().RawEnd(); ++i) {
+    if (i->key) probs.push_back(i->value.prob);
+  }
+  quant_.TrainProb(counts.size(), probs);
+  quant_.FinishedLoading(config);
+
+  uint64_t total = 0;
+  for (unsigned char n = 1; n < counts.size(); ++n) total += counts[n];
+  util::ErsatzProgress progress(total, config.ProgressMessages(), "Building minimal perfect hash tables");
+  std::vector<uint64_t> keys;
+  for (unsigned char n = 2; n < counts.size(); ++n) {
+    const Probing::Middle &from = probing.MiddleTable(n - 2);
+    PerfectHashTable &to = middle_[n - 2];
+    CollectKeys(from, keys);
+    BuildHash(keys, n, to);
+    for (Probing::Middle::ConstIterator i = from.RawBegin(); i != from.RawEnd(); ++i) {
+      if (!i->key) continue;
+      BackoffValue::ProbingProxy weights(i->value);
+      util::BitAddress address(to.Insert(i->key));
+      MiddlePointer(quant_, n - 2, address).Write(weights.Prob(), weights.Backoff());
+      if (weights.IndependentLeft()) util::WriteInt25(address.base, address.offset + middle_bits_, 1, 1);
+    }
+    progress += counts[n - 1];
+  }
+  CollectKeys(probing.LongestTable(), keys);
+  BuildHash(keys, counts.size(), longest_);
+  for (Probing::Longest::ConstIterator i = probing.LongestTable().RawBegin(); i != probing.LongestTable().RawEnd(); ++i) {
+    if (i->key) LongestPointer(quant_, longest_.Insert(i->key)).Write(i->value.prob);
+  }
+  progress.Finished();
+}
+
+template void PerfectHashSearch::InitializeFromARPA(const char *file, util::FilePiece &f, std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab, BinaryFormat &backing);
+template void PerfectHashSearch::InitializeFromARPA(const char *file, NGramSource &f, std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab, BinaryFormat &backing);
+template void PerfectHashSearch::InitializeFromARPA(const char *file, ParallelARPA &f, std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab, BinaryFormat &backing);
+
+} // namespace detail
+} // namespace ngram
+} // namespace lm
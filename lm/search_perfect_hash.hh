@@ -0,0 +1,194 @@
+#ifndef LM_SEARCH_PERFECT_HASH_H
+#define LM_SEARCH_PERFECT_HASH_H
+
+#include "lm/config.hh"
+#include "lm/model_type.hh"
+#include "lm/quantize.hh"
+#include "lm/search_hashed.hh"
+#include "lm/value.hh"
+#include "lm/weights.hh"
+
+#include "util/bit_packing.hh"
+#include "util/perfect_hash.hh"
+#include "util/prefetch.hh"
+
+#include <vector>
+
+#include <stdint.h>
+
+namespace lm {
+namespace ngram {
+class BinaryFormat;
+class ProbingVocabulary;
+namespace detail {
+
+/* One order's n-grams, keyed by the same hash as the probing model.  A
+ * minimal perfect hash sends each n-gram to an index in an array of entries
+ * bit-packed as [fingerprint][value].  The fingerprint is the top bits of the
+ * key and rejects almost all n-grams that are not in the model.
+ */
+class PerfectHashTable {
+  public:
+    static uint64_t Size(uint64_t entries, uint8_t fingerprint_bits, uint8_t value_bits) {
+      // Padding because ReadInt57 reads 8 bytes.
+      uint64_t packed = (entries * (fingerprint_bits + value_bits) + 7) / 8 + sizeof(uint64_t);
+      return util::PerfectHash::Size(entries) + ((packed + 7) & ~static_cast<uint64_t>(7));
+    }
+
+    PerfectHashTable() {}
+
+    void Init(void *start, uint64_t entries, uint8_t fingerprint_bits, uint8_t value_bits) {
+      hash_ = util::PerfectHash(start, entries);
+      base_ = static_cast<uint8_t*>(start) + util::PerfectHash::Size(entries);
+      fingerprint_ = util::BitsMask::ByBits(fingerprint_bits);
+      entry_bits_ = fingerprint_bits + value_bits;
+    }
+
+    void Prefetch(uint64_t key) const {
+      hash_.Prefetch(key);
+    }
+
+    // Where key's value is, with NULL base if key is not present.
+    util::BitAddress Find(uint64_t key) const {
+      if (!hash_.Entries()) return util::BitAddress(NULL, 0);
+      uint64_t offset = hash_(key) * entry_bits_;
+      if (util::ReadInt57(base_, offset, fingerprint_.bits, fingerprint_.mask) != Fingerprint(key))
+        return util::BitAddress(NULL, 0);
+      return util::BitAddress(base_, offset + fingerprint_.bits);
+    }
+
+    // For building, in memory that was zeros.  Build the hash function for
+    // the keys [begin, end), then Insert each of them.
+    void Build(const uint64_t *begin, const uint64_t *end) {
+      void *start = base_ - util::PerfectHash::Size(hash_.Entries());
+      util::PerfectHash::Build(begin, end, start);
+      hash_ = util::PerfectHash(start, hash_.Entries());
+    }
+
+    util::BitAddress Insert(uint64_t key) {
+      uint64_t offset = hash_(key) * entry_bits_;
+      util::WriteInt57(base_, offset, fingerprint_.bits, Fingerprint(key));
+      return util::BitAddress(base_, offset + fingerprint_.bits);
+    }
+
+  private:
+    uint64_t Fingerprint(uint64_t key) const {
+      return key >> (64 - fingerprint_.bits);
+    }
+
+    util::PerfectHash hash_;
+    uint8_t *base_;
+    util::BitsMask fingerprint_;
+    uint8_t entry_bits_;
+};
+
+/* Like the probing model, but n-grams above unigrams are in PerfectHashTables
+ * with quantized values.  That's a fraction of the probing model's size (a bit
+ * more than a quantized trie with 32-bit fingerprints) and a few memory
+ * accesses per lookup.  The price is that an n-gram not in the model is taken
+ * for one in it with probability 2^-fingerprint_bits.  Building goes
+ * through the probing model's tables (sized by probing_multiplier), which
+ * also fill in n-grams that SRI pruned.
+ */
+class PerfectHashSearch {
+  public:
+    typedef uint64_t Node;
+
+    typedef BackoffValue::ProbingProxy UnigramPointer;
+    typedef SeparatelyQuantize::MiddlePointer MiddlePointer;
+    typedef SeparatelyQuantize::LongestPointer LongestPointer;
+
+    static const ModelType kModelType = PERFECT_HASH;
+    static const bool kDifferentRest = false;
+    static const unsigned int kVersion = 0;
+
+    static void UpdateConfigFromBinary(const BinaryFormat &file, const std::vector<uint64_t> &counts, uint64_t offset, Config &config);
+
+    static uint64_t Size(const std::vector<uint64_t> &counts, const Config &config);
+
+    uint8_t *SetupMemory(uint8_t *start, const std::vector<uint64_t> &counts, const Config &config);
+
+    // In is util::FilePiece, ParallelARPA, or NGramSource.  counts are
+    // corrected for n-grams that SRI pruned.
+    template <class In> void InitializeFromARPA(const char *file, In &f, std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab, BinaryFormat &backing);
+
+    unsigned char Order() const {
+      return middle_.size() + 2;
+    }
+
+    ProbBackoff &UnknownUnigram() { return unigram_[0]; }
+
+    UnigramPointer LookupUnigram(WordIndex word, Node &next, bool &independent_left, uint64_t &extend_left) const {
+      extend_left = static_cast<uint64_t>(word);
+      next = extend_left;
+      UnigramPointer ret(unigram_[word]);
+      independent_left = ret.IndependentLeft();
+      return ret;
+    }
+
+    // Prefetch hints.  Only the pilot can be fetched before the hash is
+    // computed.
+    void PrefetchUnigram(WordIndex word) const {
+      util::PrefetchRead(unigram_ + word);
+    }
+
+    void PrefetchMiddle(unsigned char order_minus_2, WordIndex word, const Node &node) const {
+      middle_[order_minus_2].Prefetch(CombineWordHash(node, word));
+    }
+
+    void PrefetchLongest(WordIndex word, const Node &node) const {
+      longest_.Prefetch(CombineWordHash(node, word));
+    }
+
+    MiddlePointer Unpack(uint64_t extend_pointer, unsigned char extend_length, Node &node) const {
+      node = extend_pointer;
+      return MiddlePointer(quant_, extend_length - 2, middle_[extend_length - 2].Find(extend_pointer));
+    }
+
+    MiddlePointer LookupMiddle(unsigned char order_minus_2, WordIndex word, Node &node, bool &independent_left, uint64_t &extend_pointer) const {
+      node = CombineWordHash(node, word);
+      util::BitAddress address(middle_[order_minus_2].Find(node));
+      if (!address.base) {
+        independent_left = true;
+        return MiddlePointer();
+      }
+      extend_pointer = node;
+      // The bit after the quantized value.
+      independent_left = util::ReadInt25(address.base, address.offset + middle_bits_, 1, 1);
+      return MiddlePointer(quant_, order_minus_2, address);
+    }
+
+    LongestPointer LookupLongest(WordIndex word, const Node &node) const {
+      util::BitAddress address(longest_.Find(CombineWordHash(node, word)));
+      if (!address.base) return LongestPointer();
+      return LongestPointer(quant_, address);
+    }
+
+    bool FastMakeNode(const WordIndex *begin, const WordIndex *end, Node &node) const {
+      assert(begin != end);
+      node = static_cast<Node>(*begin);
+      for (const WordIndex *i = begin + 1; i < end; ++i) {
+        node = CombineWordHash(node, *i);
+      }
+      return true;
+    }
+
+  private:
+    SeparatelyQuantize quant_;
+
+    // Search header after the quantization tables: fingerprint bits.
+    uint8_t *header_;
+
+    ProbBackoff *unigram_;
+
+    std::vector<PerfectHashTable> middle_;
+    PerfectHashTable longest_;
+
+    uint8_t middle_bits_;
+};
+
+} // namespace detail
+} // namespace ngram
+} // namespace lm
+
+#endif // LM_SEARCH_PERFECT_HASH_H
@@ -6,7 +6,9 @@
 #include "lm/blank.hh"
 #include "lm/lm_exception.hh"
 #include "lm/max_order.hh"
+#include "lm/parallel_arpa.hh"
 #include "lm/quantize.hh"
+#include "lm/read_arpa.hh"
 #include "lm/trie.hh"
 #include "lm/trie_sort.hh"
 #include "lm/vocab.hh"
@@ -575,7 +577,7 @@ template <class Quant, class Bhiksha> uint8_t *TrieSearch<Quant, Bhiksha>::Setup
   return start + Longest::Size(Quant::LongestBits(config), counts.back(), counts[0]);
 }
 
-template <class Quant, class Bhiksha> void TrieSearch<Quant, Bhiksha>::InitializeFromARPA(const char *file, util::FilePiece &f, std::vector<uint64_t> &counts, const Config &config, SortedVocabulary &vocab, BinaryFormat &backing) {
+template <class Quant, class Bhiksha> template <class In> void TrieSearch<Quant, Bhiksha>::InitializeFromARPA(const char *file, In &f, std::vector<uint64_t> &counts, const Config &config, SortedVocabulary &vocab, BinaryFormat &backing) {
   std::string temporary_prefix;
   if (!config.temporary_directory_prefix.empty()) {
     temporary_prefix = config.temporary_directory_prefix;
@@ -595,6 +597,16 @@ template class TrieSearch<DontQuantize, ArrayBhiksha>;
 template class TrieSearch<SeparatelyQuantize, DontBhiksha>;
 template class TrieSearch<SeparatelyQuantize, ArrayBhiksha>;
 
+#define LM_TRIE_INITIALIZE(Quant, Bhiksha) \
+template void TrieSearch<Quant, Bhiksha>::InitializeFromARPA(const char *file, util::FilePiece &f, std::vector<uint64_t> &counts, const Config &config, SortedVocabulary &vocab, BinaryFormat &backing); \
+template void TrieSearch<Quant, Bhiksha>::InitializeFromARPA(const char *file, NGramSource &f, std::vector<uint64_t> &counts, const Config &config, SortedVocabulary &vocab, BinaryFormat &backing); \
+template void TrieSearch<Quant, Bhiksha>::InitializeFromARPA(const char *file, ParallelARPA &f, std::vector<uint64_t> &counts, const Config &config, SortedVocabulary &vocab, BinaryFormat &backing);
+
+LM_TRIE_INITIALIZE(DontQuantize, DontBhiksha)
+LM_TRIE_INITIALIZE(DontQuantize, ArrayBhiksha)
+LM_TRIE_INITIALIZE(SeparatelyQuantize, DontBhiksha)
+LM_TRIE_INITIALIZE(SeparatelyQuantize, ArrayBhiksha)
+
 } // namespace trie
 } // namespace ngram
 } // namespace lm
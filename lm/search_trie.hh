@@ -59,7 +59,8 @@ template <class Quant, class Bhiksha> class TrieSearch {
 
     uint8_t *SetupMemory(uint8_t *start, const std::vector<uint64_t> &counts, const Config &config);
 
-    void InitializeFromARPA(const char *file, util::FilePiece &f, std::vector<uint64_t> &counts, const Config &config, SortedVocabulary &vocab, BinaryFormat &backing);
+    // In is util::FilePiece, ParallelARPA, or NGramSource.
+    template <class In> void InitializeFromARPA(const char *file, In &f, std::vector<uint64_t> &counts, const Config &config, SortedVocabulary &vocab, BinaryFormat &backing);
 
     unsigned char Order() const {
       return middle_end_ - middle_begin_ + 2;
@@ -74,6 +75,20 @@ template <class Quant, class Bhiksha> class TrieSearch {
       return ret;
     }
 
+    // Prefetch hints.  The trie can only guess where the search will land, so
+    // these fetch the start of the range to be searched.
+    void PrefetchUnigram(WordIndex word) const {
+      unigram_.Prefetch(word);
+    }
+
+    void PrefetchMiddle(unsigned char order_minus_2, WordIndex /*word*/, const Node &node) const {
+      middle_begin_[order_minus_2].Prefetch(node);
+    }
+
+    void PrefetchLongest(WordIndex /*word*/, const Node &node) const {
+      longest_.Prefetch(node);
+    }
+
     MiddlePointer Unpack(uint64_t extend_pointer, unsigned char extend_length, Node &node) const {
       return MiddlePointer(quant_, extend_length - 2, middle_begin_[extend_length - 2].ReadEntry(extend_pointer, node));
     }
@@ -4,6 +4,7 @@
 #include "lm/weights.hh"
 #include "lm/word_index.hh"
 #include "util/bit_packing.hh"
+#include "util/prefetch.hh"
 
 #include <cstddef>
 
@@ -62,6 +63,10 @@ class Unigram {
       return unigram_;
     }
 
+    void Prefetch(WordIndex word) const {
+      util::PrefetchRead(unigram_ + word);
+    }
+
     UnigramPointer Find(WordIndex word, NodeRange &next) const {
       UnigramValue *val = unigram_ + word;
       next.begin = val->next;
@@ -81,6 +86,11 @@ class BitPacked {
       return insert_index_;
     }
 
+    // Start loading the first entry of a range that is about to be searched.
+    void Prefetch(const NodeRange &range) const {
+      util::PrefetchRead(base_ + ((range.begin * total_bits_) >> 3));
+    }
+
   protected:
     static uint64_t BaseSize(uint64_t entries, uint64_t max_vocab, uint8_t remaining_bits);
 
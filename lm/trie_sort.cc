@@ -2,11 +2,13 @@
 
 #include "lm/config.hh"
 #include "lm/lm_exception.hh"
+#include "lm/parallel_arpa.hh"
 #include "lm/read_arpa.hh"
 #include "lm/vocab.hh"
 #include "lm/weights.hh"
 #include "lm/word_index.hh"
 #include "util/file_piece.hh"
+#include "util/fixed_array.hh"
 #include "util/mmap.hh"
 #include "util/proxy_iterator.hh"
 #include "util/sized_iterator.hh"
@@ -20,6 +22,11 @@
 #include <limits>
 #include <vector>
 
+#ifdef WITH_THREADS
+#include <boost/ref.hpp>
+#include <boost/thread/thread.hpp>
+#endif
+
 namespace lm {
 namespace ngram {
 namespace trie {
@@ -76,18 +83,54 @@ FILE *DiskFlush(const void *mem_begin, const void *mem_end, const std::string &t
   return util::FDOpenOrThrow(file);
 }
 
-FILE *WriteContextFile(uint8_t *begin, uint8_t *end, const std::string &temp_prefix, std::size_t entry_size, unsigned char order) {
-  const size_t context_size = sizeof(WordIndex) * (order - 1);
-  // Sort just the contexts using the same memory.
-  PartialIter context_begin(PartialViewProxy(begin + sizeof(WordIndex), entry_size, context_size));
-  PartialIter context_end(PartialViewProxy(end + sizeof(WordIndex), entry_size, context_size));
+// Sort full records by full n-gram.
+class SortEntries {
+  public:
+    SortEntries(std::size_t entry_size, unsigned char order) : entry_size_(entry_size), order_(order) {}
+
+    void operator()(uint8_t *begin, uint8_t *end) const {
+      util::SizedProxy proxy_begin(begin, entry_size_), proxy_end(end, entry_size_);
+      // parallel_sort uses too much RAM.  TODO: figure out why windows sort doesn't like my proxies.
+#if defined(_WIN32) || defined(_WIN64)
+      std::stable_sort
+#else
+      std::sort
+#endif
+          (NGramIter(proxy_begin), NGramIter(proxy_end), util::SizedCompare<EntryCompare>(EntryCompare(order_)));
+    }
+
+  private:
+    std::size_t entry_size_;
+    unsigned char order_;
+};
+
+// Sort just the contexts using the same memory.
+class SortContexts {
+  public:
+    SortContexts(std::size_t entry_size, unsigned char order) : entry_size_(entry_size), order_(order) {}
 
+    void operator()(uint8_t *begin, uint8_t *end) const {
+      const size_t context_size = sizeof(WordIndex) * (order_ - 1);
+      PartialIter context_begin(PartialViewProxy(begin + sizeof(WordIndex), entry_size_, context_size));
+      PartialIter context_end(PartialViewProxy(end + sizeof(WordIndex), entry_size_, context_size));
 #if defined(_WIN32) || defined(_WIN64)
-  std::stable_sort
+      std::stable_sort
 #else
-  std::sort
+      std::sort
 #endif
-    (context_begin, context_end, util::SizedCompare<EntryCompare, PartialViewProxy>(EntryCompare(order - 1)));
+        (context_begin, context_end, util::SizedCompare<EntryCompare, PartialViewProxy>(EntryCompare(order_ - 1)));
+    }
+
+  private:
+    std::size_t entry_size_;
+    unsigned char order_;
+};
+
+FILE *WriteContextFile(uint8_t *begin, uint8_t *end, const std::string &temp_prefix, std::size_t entry_size, unsigned char order) {
+  const size_t context_size = sizeof(WordIndex) * (order - 1);
+  SortContexts(entry_size, order)(begin, end);
+  PartialIter context_begin(PartialViewProxy(begin + sizeof(WordIndex), entry_size, context_size));
+  PartialIter context_end(PartialViewProxy(end + sizeof(WordIndex), entry_size, context_size));
 
   util::scoped_FILE out(util::FMakeTemp(temp_prefix));
 
@@ -106,6 +149,69 @@ FILE *WriteContextFile(uint8_t *begin, uint8_t *end, const std::string &temp_pre
   return out.release();
 }
 
+// Split a batch into pieces of about the same number of entries.
+void SplitBatch(uint8_t *begin, uint8_t *end, std::size_t entry_size, std::size_t pieces, std::vector<uint8_t*> &bounds) {
+  const std::size_t entries = (end - begin) / entry_size;
+  bounds.clear();
+  for (std::size_t i = 0; i < pieces; ++i) {
+    bounds.push_back(begin + (entries * i / pieces) * entry_size);
+  }
+  bounds.push_back(end);
+}
+
+template <class Sort> class SortPiece {
+  public:
+    SortPiece(const Sort &sort, uint8_t *begin, uint8_t *end) : sort_(sort), begin_(begin), end_(end) {}
+
+    void operator()() { sort_(begin_, end_); }
+
+  private:
+    Sort sort_;
+    uint8_t *begin_, *end_;
+};
+
+// Sort each piece between bounds, on its own thread if there are threads.
+template <class Sort> void SortPieces(const std::vector<uint8_t*> &bounds, const Sort &sort) {
+#ifdef WITH_THREADS
+  boost::thread_group threads;
+  for (std::size_t i = 1; i + 1 < bounds.size(); ++i) {
+    threads.create_thread(SortPiece<Sort>(sort, bounds[i], bounds[i + 1]));
+  }
+  sort(bounds[0], bounds[1]);
+  threads.join_all();
+#else
+  for (std::size_t i = 0; i + 1 < bounds.size(); ++i) {
+    sort(bounds[i], bounds[i + 1]);
+  }
+#endif
+}
+
+/* Write sorted pieces of a batch to one sorted file.  Entries are compared and
+ * written starting offset bytes in: compare_order words are compared and
+ * write_size bytes are written.  If unique, repeats are written once.
+ */
+FILE *MergePieces(const std::vector<uint8_t*> &bounds, std::size_t entry_size, std::size_t offset, unsigned char compare_order, std::size_t write_size, bool unique, const std::string &temp_prefix) {
+  util::scoped_FILE out(util::FMakeTemp(temp_prefix));
+  EntryCompare less(compare_order);
+  // Piece i has remaining entries [heads[i], bounds[i + 1]).
+  std::vector<const uint8_t*> heads(bounds.begin(), bounds.end() - 1);
+  const uint8_t *previous = NULL;
+  while (true) {
+    std::size_t best = heads.size();
+    for (std::size_t i = 0; i < heads.size(); ++i) {
+      if (heads[i] != bounds[i + 1] && (best == heads.size() || less(heads[i] + offset, heads[best] + offset))) best = i;
+    }
+    if (best == heads.size()) break;
+    const uint8_t *data = heads[best] + offset;
+    if (!unique || !previous || memcmp(previous, data, write_size)) {
+      util::WriteOrThrow(out.get(), data, write_size);
+      previous = data;
+    }
+    heads[best] += entry_size;
+  }
+  return out.release();
+}
+
 struct ThrowCombine {
   void operator()(std::size_t entry_size, unsigned char order, const void *first, const void *second, FILE * /*out*/) const {
     const WordIndex *base = reinterpret_cast<const WordIndex*>(first);
@@ -150,6 +256,105 @@ template <class Combine> FILE *MergeSortedFiles(FILE *first_file, FILE *second_f
   return out_file.release();
 }
 
+/* Merges the sorted batches of one order down to one file of n-grams and one
+ * of contexts.  This can run in the background while later orders are read.
+ */
+class OrderMerge {
+  public:
+    OrderMerge(const std::string &temp_prefix, unsigned char order)
+      : temp_prefix_(temp_prefix), weights_size_(0), order_(order) {}
+
+    ~OrderMerge() {
+#ifdef WITH_THREADS
+      if (thread_.get()) thread_->join();
+#endif
+      for (std::deque<FILE*>::iterator i = files_.begin(); i != files_.end(); ++i) {
+        util::scoped_FILE deleter(*i);
+      }
+      for (std::deque<FILE*>::iterator i = contexts_.begin(); i != contexts_.end(); ++i) {
+        util::scoped_FILE deleter(*i);
+      }
+    }
+
+    // Sorted batches to merge, which are closed by this.
+    std::deque<FILE*> &Files() { return files_; }
+    std::deque<FILE*> &Contexts() { return contexts_; }
+
+    // Files have weights_size bytes of weights after the words.
+    void Start(std::size_t weights_size, bool background) {
+      weights_size_ = weights_size;
+#ifdef WITH_THREADS
+      if (background) {
+        thread_.reset(new boost::thread(boost::ref(*this)));
+        return;
+      }
+#endif
+      Run();
+    }
+
+    // Background thread.
+    void operator()() {
+      try {
+        Run();
+      } catch (const FormatLoadException &e) {
+        format_error_ = e.what();
+      } catch (const std::exception &e) {
+        other_error_ = e.what();
+      }
+    }
+
+    // Wait for the merge and take the merged files, if any.
+    void Finish(util::scoped_FILE &full, util::scoped_FILE &context) {
+#ifdef WITH_THREADS
+      if (thread_.get()) {
+        thread_->join();
+        thread_.reset();
+      }
+#endif
+      if (!format_error_.empty()) {
+        FormatLoadException e;
+        e << format_error_;
+        throw e;
+      }
+      UTIL_THROW_IF(!other_error_.empty(), util::Exception, other_error_);
+      if (!files_.empty()) {
+        full.reset(files_.front());
+        files_.pop_front();
+        context.reset(contexts_.front());
+        contexts_.pop_front();
+      }
+    }
+
+  private:
+    static void PopFront(std::deque<FILE*> &files) {
+      util::scoped_FILE deleter(files.front());
+      files.pop_front();
+    }
+
+    void Run() {
+      while (files_.size() > 1) {
+        files_.push_back(MergeSortedFiles(files_[0], files_[1], temp_prefix_, weights_size_, order_, ThrowCombine()));
+        PopFront(files_);
+        PopFront(files_);
+        contexts_.push_back(MergeSortedFiles(contexts_[0], contexts_[1], temp_prefix_, 0, order_ - 1, FirstCombine()));
+        PopFront(contexts_);
+        PopFront(contexts_);
+      }
+    }
+
+    const std::string &temp_prefix_;
+    std::size_t weights_size_;
+    const unsigned char order_;
+
+    std::deque<FILE*> files_, contexts_;
+
+    std::string format_error_, other_error_;
+
+#ifdef WITH_THREADS
+    boost::scoped_ptr<boost::thread> thread_;
+#endif
+};
+
 } // namespace
 
 void RecordReader::Init(FILE *file, std::size_t entry_size) {
@@ -187,7 +392,7 @@ void RecordReader::Rewind() {
   }
 }
 
-SortedFiles::SortedFiles(const Config &config, util::FilePiece &f, std::vector<uint64_t> &counts, size_t buffer, const std::string &file_prefix, SortedVocabulary &vocab) {
+template <class In> SortedFiles::SortedFiles(const Config &config, In &f, std::vector<uint64_t> &counts, size_t buffer, const std::string &file_prefix, SortedVocabulary &vocab) {
   PositiveProbWarn warn(config.positive_log_probability);
   unigram_.reset(util::MakeTemp(file_prefix));
   {
@@ -211,33 +416,20 @@ SortedFiles::SortedFiles(const Config &config, util::FilePiece &f, std::vector<u
   mem.reset(malloc(buffer));
   if (!mem.get()) UTIL_THROW(util::ErrnoException, "malloc failed for sort buffer size " << buffer);
 
+  // With threads, each order is merged while the next is read.
+  util::FixedArray<OrderMerge> merges(counts.size() - 1);
   for (unsigned char order = 2; order <= counts.size(); ++order) {
-    ConvertToSorted(f, vocab, counts, file_prefix, order, warn, mem.get(), buffer);
+    merges.push_back(file_prefix, order);
+    ConvertToSorted(f, vocab, counts, file_prefix, order, warn, mem.get(), buffer, config.building_threads, merges.back().Files(), merges.back().Contexts());
+    merges.back().Start(sizeof(float) + ((order == counts.size()) ? 0 : sizeof(float)), config.building_threads > 1);
   }
   ReadEnd(f);
+  for (std::size_t i = 0; i < merges.size(); ++i) {
+    merges[i].Finish(full_[i], context_[i]);
+  }
 }
 
-namespace {
-class Closer {
-  public:
-    explicit Closer(std::deque<FILE*> &files) : files_(files) {}
-
-    ~Closer() {
-      for (std::deque<FILE*>::iterator i = files_.begin(); i != files_.end(); ++i) {
-        util::scoped_FILE deleter(*i);
-      }
-    }
-
-    void PopFront() {
-      util::scoped_FILE deleter(files_.front());
-      files_.pop_front();
-    }
-  private:
-    std::deque<FILE*> &files_;
-};
-} // namespace
-
-void SortedFiles::ConvertToSorted(util::FilePiece &f, const SortedVocabulary &vocab, const std::vector<uint64_t> &counts, const std::string &file_prefix, unsigned char order, PositiveProbWarn &warn, void *mem, std::size_t mem_size) {
+template <class In> void SortedFiles::ConvertToSorted(In &f, const SortedVocabulary &vocab, const std::vector<uint64_t> &counts, const std::string &file_prefix, unsigned char order, PositiveProbWarn &warn, void *mem, std::size_t mem_size, std::size_t threads, std::deque<FILE*> &files, std::deque<FILE*> &contexts) {
   ReadNGramHeader(f, order);
   const size_t count = counts[order - 1];
   // Size of weights.  Does it include backoff?
@@ -246,9 +438,7 @@ void SortedFiles::ConvertToSorted(util::FilePiece &f, const SortedVocabulary &vo
   const size_t entry_size = words_size + weights_size;
   const size_t batch_size = std::min(count, mem_size / entry_size);
   uint8_t *const begin = reinterpret_cast<uint8_t*>(mem);
-
-  std::deque<FILE*> files, contexts;
-  Closer files_closer(files), contexts_closer(contexts);
+  std::vector<uint8_t*> bounds;
 
   for (std::size_t batch = 0, done = 0; done < count; ++batch) {
     uint8_t *out = begin;
@@ -264,41 +454,27 @@ void SortedFiles::ConvertToSorted(util::FilePiece &f, const SortedVocabulary &vo
         ReadNGram(f, order, vocab, it, *reinterpret_cast<ProbBackoff*>(out + words_size), warn);
       }
     }
-    // Sort full records by full n-gram.
-    util::SizedProxy proxy_begin(begin, entry_size), proxy_end(out_end, entry_size);
-    // parallel_sort uses too much RAM.  TODO: figure out why windows sort doesn't like my proxies.
-#if defined(_WIN32) || defined(_WIN64)
-    std::stable_sort
-#else
-    std::sort
-#endif
-        (NGramIter(proxy_begin), NGramIter(proxy_end), util::SizedCompare<EntryCompare>(EntryCompare(order)));
-    files.push_back(DiskFlush(begin, out_end, file_prefix));
-    contexts.push_back(WriteContextFile(begin, out_end, file_prefix, entry_size, order));
+    if (threads > 1) {
+      // Sort pieces on threads then merge them on the way to disk.
+      SplitBatch(begin, out_end, entry_size, threads, bounds);
+      SortPieces(bounds, SortEntries(entry_size, order));
+      files.push_back(MergePieces(bounds, entry_size, 0, order, entry_size, false, file_prefix));
+      SortPieces(bounds, SortContexts(entry_size, order));
+      contexts.push_back(MergePieces(bounds, entry_size, sizeof(WordIndex), order - 1, sizeof(WordIndex) * (order - 1), true, file_prefix));
+    } else {
+      SortEntries(entry_size, order)(begin, out_end);
+      files.push_back(DiskFlush(begin, out_end, file_prefix));
+      contexts.push_back(WriteContextFile(begin, out_end, file_prefix, entry_size, order));
+    }
 
     done += (out_end - begin) / entry_size;
   }
-
-  // All individual files created.  Merge them.
-
-  while (files.size() > 1) {
-    files.push_back(MergeSortedFiles(files[0], files[1], file_prefix, weights_size, order, ThrowCombine()));
-    files_closer.PopFront();
-    files_closer.PopFront();
-    contexts.push_back(MergeSortedFiles(contexts[0], contexts[1], file_prefix, 0, order - 1, FirstCombine()));
-    contexts_closer.PopFront();
-    contexts_closer.PopFront();
-  }
-
-  if (!files.empty()) {
-    // Steal from closers.
-    full_[order - 2].reset(files.front());
-    files.pop_front();
-    context_[order - 2].reset(contexts.front());
-    contexts.pop_front();
-  }
 }
 
+template SortedFiles::SortedFiles(const Config &config, util::FilePiece &f, std::vector<uint64_t> &counts, size_t buffer, const std::string &file_prefix, SortedVocabulary &vocab);
+template SortedFiles::SortedFiles(const Config &config, NGramSource &f, std::vector<uint64_t> &counts, size_t buffer, const std::string &file_prefix, SortedVocabulary &vocab);
+template SortedFiles::SortedFiles(const Config &config, ParallelARPA &f, std::vector<uint64_t> &counts, size_t buffer, const std::string &file_prefix, SortedVocabulary &vocab);
+
 } // namespace trie
 } // namespace ngram
 } // namespace lm
@@ -10,6 +10,8 @@
 #include "util/scoped.hh"
 
 #include <cstddef>
+#include <cstdio>
+#include <deque>
 #include <functional>
 #include <string>
 #include <vector>
@@ -84,8 +86,8 @@ class RecordReader {
 
 class SortedFiles {
   public:
-    // Build from ARPA
-    SortedFiles(const Config &config, util::FilePiece &f, std::vector<uint64_t> &counts, std::size_t buffer, const std::string &file_prefix, SortedVocabulary &vocab);
+    // Build from ARPA.  In is util::FilePiece, ParallelARPA, or NGramSource.
+    template <class In> SortedFiles(const Config &config, In &f, std::vector<uint64_t> &counts, std::size_t buffer, const std::string &file_prefix, SortedVocabulary &vocab);
 
     int StealUnigram() {
       return unigram_.release();
@@ -100,7 +102,8 @@ class SortedFiles {
     }
 
   private:
-    void ConvertToSorted(util::FilePiece &f, const SortedVocabulary &vocab, const std::vector<uint64_t> &counts, const std::string &prefix, unsigned char order, PositiveProbWarn &warn, void *mem, std::size_t mem_size);
+    // Read one order into sorted batches, sorting with threads.
+    template <class In> void ConvertToSorted(In &f, const SortedVocabulary &vocab, const std::vector<uint64_t> &counts, const std::string &prefix, unsigned char order, PositiveProbWarn &warn, void *mem, std::size_t mem_size, std::size_t threads, std::deque<FILE*> &files, std::deque<FILE*> &contexts);
 
     util::scoped_fd unigram_;
 
@@ -22,6 +22,7 @@ void printHelp(char **argv)
             "\t-no-alignment-info   -- do not include alignment info in the binary phrase table\n"
 #ifdef WITH_THREADS
             "\t-threads int|all  -- number of threads used for conversion\n"
+            "\t-queue-memory int -- MB held for lines the threads finish out of order (default 256)\n"
 #endif
             "\n  advanced:\n"
             "\t-encoding string  -- encoding type: PREnc REnc None (default PREnc)\n"
@@ -72,6 +73,7 @@ int main(int argc, char **argv)
     boost::thread::hardware_concurrency() ? boost::thread::hardware_concurrency() :
 #endif
     1;
+  size_t queueMemoryMB = 256;
 
   if(1 >= argc) {
     printHelp(argv);
@@ -139,6 +141,9 @@ int main(int argc, char **argv)
       std::cerr << "Thread support not compiled in" << std::endl;
       exit(1);
 #endif
+    } else if("-queue-memory" == arg && i+1 < argc) {
+      ++i;
+      queueMemoryMB = atoi(argv[i]);
     } else {
       //something's wrong... print help
       printHelp(argv);
@@ -168,7 +173,7 @@ int main(int argc, char **argv)
                      useAlignmentInfo, multipleScoreTrees,
                      quantize, maxRank, warnMe
 #ifdef WITH_THREADS
-                     , threads
+                     , threads, queueMemoryMB
 #endif
                     );
 }
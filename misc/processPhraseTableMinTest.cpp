@@ -0,0 +1,104 @@
+/***********************************************************************
+  Moses - factored phrase-based language decoder
+  Copyright (C) 2026 University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+// Runs the processPhraseTableMin program given as the first argument on a
+// small phrase table with several threads, once with no memory for lines
+// finished out of order and once with plenty, and checks that the compact
+// tables are byte-identical.
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#define  BOOST_TEST_MODULE MosesProcessPhraseTableMin
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+namespace fs = boost::filesystem;
+
+namespace
+{
+
+const char *ProgramLocation()
+{
+  if (boost::unit_test::framework::master_test_suite().argc < 2) {
+    return "processPhraseTableMin";
+  }
+  return boost::unit_test::framework::master_test_suite().argv[1];
+}
+
+string ReadFile(const fs::path &path)
+{
+  ifstream in(path.string().c_str(), ios::binary);
+  BOOST_REQUIRE(in);
+  stringstream ret;
+  ret << in.rdbuf();
+  return ret.str();
+}
+
+/* Source phrases in sorted order with a few targets each, enough lines that
+ * the threads' blocks finish out of order.
+ */
+void MakeTable(const fs::path &path)
+{
+  ofstream out(path.string().c_str());
+  for (size_t i = 0; i < 3000; ++i) {
+    ostringstream source;
+    source << "s" << 1000 + i << " s" << i % 17;
+    for (size_t j = 0; j < 1 + i % 4; ++j) {
+      out << source.str() << " ||| t" << (i * 7 + j) % 911 << " t" << j
+          << " ||| 0." << 1 + (i + j) % 9 << " 0." << 1 + i % 7
+          << " 0." << 1 + j << " 0." << 1 + (i * j) % 5
+          << " ||| 0-0 " << (j % 2 ? "1-1" : "0-1") << " ||| \n";
+    }
+  }
+  BOOST_REQUIRE(out);
+}
+
+string Convert(const fs::path &dir, const string &name, size_t queueMemoryMB)
+{
+  ostringstream cmd;
+  cmd << ProgramLocation() << " -in " << dir / "phrase-table"
+      << " -out " << dir / name << " -T " << dir
+      << " -nscores 4 -threads 4 -queue-memory " << queueMemoryMB
+      << " 2> /dev/null";
+  BOOST_REQUIRE_EQUAL(0, system(cmd.str().c_str()));
+  return ReadFile(dir / (name + ".minphr"));
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(queue_memory_limit)
+{
+  fs::path dir = fs::temp_directory_path() / fs::unique_path("process_pt_min_test_%%%%-%%%%-%%%%");
+  fs::create_directories(dir);
+  MakeTable(dir / "phrase-table");
+
+  string unlimited = Convert(dir, "unlimited", 256);
+  // 0 MB: every thread but the one holding up the queue waits for it
+  string limited = Convert(dir, "limited", 0);
+  BOOST_CHECK(!unlimited.empty());
+  BOOST_CHECK(limited == unlimited);
+
+  boost::system::error_code ec;
+  fs::remove_all(dir, ec);
+}
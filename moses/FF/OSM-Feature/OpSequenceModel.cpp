@@ -260,6 +260,8 @@ void OpSequenceModel::SetParameter(const std::string& key, const std::string& va
       load_method = util::READ;
     } else if (value == "parallel_read") {
       load_method = util::PARALLEL_READ;
+    } else if (value == "interleave") {
+      load_method = util::READ_INTERLEAVE;
     } else {
       UTIL_THROW2("Unknown KenLM load method " << value);
     }
@@ -19,10 +19,11 @@ License along with this library; if not, write to the Free Software
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
-#include <boost/version.hpp>
 #ifdef WITH_THREADS
 #include <boost/thread/locks.hpp>
 #endif
+#include <cstring>
+#include <new>
 #include <ostream>
 #include <string>
 #include "FactorCollection.h"
@@ -35,52 +36,138 @@ namespace Moses
 {
 FactorCollection FactorCollection::s_instance;
 
-const Factor *FactorCollection::AddFactor(const StringPiece &factorString, bool isNonTerminal)
+namespace
 {
-  FactorFriend to_ins;
-  to_ins.in.m_string = factorString;
-  to_ins.in.m_id = (isNonTerminal) ? m_factorIdNonTerminal : m_factorId;
-  Set & set = (isNonTerminal) ? m_set : m_setNonTerminal;
-  // If we're threaded, hope a read-only lock is sufficient.
-#ifdef WITH_THREADS
-  {
-    // read=lock scope
-    boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
-    Set::const_iterator i = set.find(to_ins);
-    if (i != set.end()) return &i->in;
+inline bool IsNonTerminal(const Factor &factor)
+{
+  return factor.GetId() < moses_MaxNumNonterminals;
+}
+
+inline std::size_t AlignedSize(std::size_t size)
+{
+  return (size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+}
+}
+
+FactorCollection::Table::Table(std::size_t buckets)
+  : mask(buckets - 1), slots(new std::atomic<const Factor*>[buckets])
+{
+  for (std::size_t i = 0; i < buckets; ++i) {
+    slots[i].store(NULL, std::memory_order_relaxed);
   }
-  boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
-#endif // WITH_THREADS
-  std::pair<Set::iterator, bool> ret(set.insert(to_ins));
-  if (ret.second) {
-    ret.first->in.m_string.set(
-      memcpy(m_string_backing.Allocate(factorString.size()), factorString.data(), factorString.size()),
-      factorString.size());
-    if (isNonTerminal) {
-      m_factorIdNonTerminal++;
-      UTIL_THROW_IF2(m_factorIdNonTerminal >= moses_MaxNumNonterminals, "Number of non-terminals exceeds maximum size reserved. Adjust parameter moses_MaxNumNonterminals, then recompile");
-    } else {
-      m_factorId++;
+}
+
+FactorCollection::Table::~Table()
+{
+  delete[] slots;
+}
+
+FactorCollection::Shard::Shard()
+  : table(new Table(kInitialBuckets)), size(0)
+{
+}
+
+FactorCollection::Shard::~Shard()
+{
+  delete table.load();
+  for (size_t i = 0; i < retired.size(); ++i) {
+    delete retired[i];
+  }
+}
+
+const Factor *FactorCollection::Find(const Table &table, const StringPiece &factorString, uint64_t hash, bool isNonTerminal)
+{
+  for (std::size_t i = hash & table.mask;; i = (i + 1) & table.mask) {
+    const Factor *factor = table.slots[i].load(std::memory_order_acquire);
+    if (factor == NULL) {
+      return NULL;
+    }
+    if (factor->GetString() == factorString && IsNonTerminal(*factor) == isNonTerminal) {
+      return factor;
     }
   }
-  return &ret.first->in;
 }
 
-const Factor *FactorCollection::GetFactor(const StringPiece &factorString, bool isNonTerminal)
+void FactorCollection::Insert(Table &table, const Factor *factor, uint64_t hash)
 {
-  FactorFriend to_find;
-  to_find.in.m_string = factorString;
-  to_find.in.m_id = (isNonTerminal) ? m_factorIdNonTerminal : m_factorId;
-  Set & set = (isNonTerminal) ? m_set : m_setNonTerminal;
-  {
-    // read=lock scope
+  std::size_t i = hash & table.mask;
+  while (table.slots[i].load(std::memory_order_relaxed)) {
+    i = (i + 1) & table.mask;
+  }
+  // the Factor is fully built; publish it to lock-free readers
+  table.slots[i].store(factor, std::memory_order_release);
+}
+
+// Tables are never freed while the collection is alive, so a reader holding
+// the old table still sees a consistent (if stale) snapshot
+void FactorCollection::Grow(Shard &shard)
+{
+  Table *old = shard.table.load(std::memory_order_relaxed);
+  Table *table = new Table((old->mask + 1) * 2);
+  for (std::size_t i = 0; i <= old->mask; ++i) {
+    const Factor *factor = old->slots[i].load(std::memory_order_relaxed);
+    if (factor) {
+      Insert(*table, factor, Hash(factor->GetString(), IsNonTerminal(*factor)));
+    }
+  }
+  shard.table.store(table, std::memory_order_release);
+  shard.retired.push_back(old);
+}
+
+size_t FactorCollection::NextNonTerminalId()
+{
+  size_t id = m_factorIdNonTerminal.load(std::memory_order_relaxed);
+  do {
+    UTIL_THROW_IF2(id + 1 >= moses_MaxNumNonterminals,
+                   "Number of non-terminals exceeds maximum size reserved. Adjust parameter moses_MaxNumNonterminals, then recompile");
+  } while (!m_factorIdNonTerminal.compare_exchange_weak(id, id + 1));
+  return id;
+}
+
+const Factor *FactorCollection::AddFactor(const StringPiece &factorString, bool isNonTerminal)
+{
+  uint64_t hash = Hash(factorString, isNonTerminal);
+  Shard &shard = GetShard(hash);
+
+  // common case: the factor already exists. No lock
+  const Factor *factor = Find(*shard.table.load(std::memory_order_acquire), factorString, hash, isNonTerminal);
+  if (factor) return factor;
+
 #ifdef WITH_THREADS
-    boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
+  boost::unique_lock<boost::mutex> lock(shard.lock);
 #endif // WITH_THREADS
-    Set::const_iterator i = set.find(to_find);
-    if (i != set.end()) return &i->in;
+  // another thread may have added it since, possibly into a new table
+  Table *table = shard.table.load(std::memory_order_relaxed);
+  factor = Find(*table, factorString, hash, isNonTerminal);
+  if (factor) return factor;
+
+  // take the id first: if the non-terminal range is full, nothing has been
+  // allocated or consumed yet
+  size_t id = isNonTerminal ? NextNonTerminalId() : m_factorId.fetch_add(1);
+
+  // keep the load factor under 1/2 so probes stay short and always end
+  if ((shard.size + 1) * 2 > table->mask + 1) {
+    Grow(shard);
+    table = shard.table.load(std::memory_order_relaxed);
   }
-  return NULL;
+
+  char *mem = static_cast<char*>(shard.backing.Allocate(AlignedSize(sizeof(Factor)) + AlignedSize(factorString.size())));
+  Factor *ret = new (mem) Factor();
+  char *str = mem + AlignedSize(sizeof(Factor));
+  memcpy(str, factorString.data(), factorString.size());
+  ret->m_string.set(str, factorString.size());
+  ret->m_id = id;
+
+  Insert(*table, ret, hash);
+  ++shard.size;
+  return ret;
+}
+
+const Factor *FactorCollection::GetFactor(const StringPiece &factorString, bool isNonTerminal)
+{
+  uint64_t hash = Hash(factorString, isNonTerminal);
+  const Shard &shard = GetShard(hash);
+  return Find(*shard.table.load(std::memory_order_acquire), factorString, hash, isNonTerminal);
 }
 
 
@@ -91,15 +178,16 @@ TO_STRING_BODY(FactorCollection);
 // friend
 ostream& operator<<(ostream& out, const FactorCollection& factorCollection)
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(factorCollection.m_accessLock);
-#endif
-  for (FactorCollection::Set::const_iterator i = factorCollection.m_set.begin(); i != factorCollection.m_set.end(); ++i) {
-    out << i->in;
+  for (size_t i = 0; i < FactorCollection::kNumShards; ++i) {
+    const FactorCollection::Table &table = *factorCollection.m_shards[i].table.load(std::memory_order_acquire);
+    for (size_t j = 0; j <= table.mask; ++j) {
+      const Factor *factor = table.slots[j].load(std::memory_order_acquire);
+      if (factor) {
+        out << *factor;
+      }
+    }
   }
   return out;
 }
 
 }
-
-
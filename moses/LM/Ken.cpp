@@ -471,6 +471,8 @@ LanguageModel *ConstructKenLM(const std::string &lineOrig)
         load_method = util::READ;
       } else if (value == "parallel_read") {
         load_method = util::PARALLEL_READ;
+      } else if (value == "interleave") {
+        load_method = util::READ_INTERLEAVE;
       } else {
         UTIL_THROW2("Unknown KenLM load method " << value);
       }
@@ -27,6 +27,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "util/file.hh"
 #include "util/exception.hh"
 
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#endif
+
 namespace Moses
 {
 
@@ -55,6 +59,7 @@ PhraseTableCreator::PhraseTableCreator(std::string inPath,
                                        bool warnMe
 #ifdef WITH_THREADS
                                        , size_t threads
+                                       , size_t queueMemoryMB
 #endif
                                       )
   : m_inPath(inPath), m_outPath(outPath), m_tempfilePath(tempfilePath),
@@ -68,9 +73,11 @@ PhraseTableCreator::PhraseTableCreator(std::string inPath,
     m_threads(threads),
     m_srcHash(m_orderBits, m_fingerPrintBits, 1),
     m_rnkHash(10, 24, m_threads),
+    m_queueBytes(0), m_maxQueueBytes(queueMemoryMB << 20),
 #else
     m_srcHash(m_orderBits, m_fingerPrintBits),
     m_rnkHash(m_orderBits, m_fingerPrintBits),
+    m_queueBytes(0), m_maxQueueBytes(0),
 #endif
     m_maxPhraseLength(0),
     m_lastFlushedLine(-1), m_lastFlushedSourceNum(0),
@@ -182,6 +189,7 @@ void PhraseTableCreator::PrintInfo()
 
 #ifdef WITH_THREADS
   std::cerr << "\tRunning with " << m_threads << " threads" << std::endl;
+  std::cerr << "\tMemory for lines finished out of order: " << (m_maxQueueBytes >> 20) << " MB" << std::endl;
 #endif
   std::cerr << std::endl;
 }
@@ -381,36 +389,71 @@ void PhraseTableCreator::CalcHuffmanCodes()
 {
   std::cerr << "\tCreating Huffman codes for " << m_symbolCounter.Size()
             << " target phrase symbols" << std::endl;
+  if(!m_quantize)
+    for(size_t i = 0; i < m_scoreCounters.size(); i++)
+      std::cerr << "\tCreating Huffman codes for " << m_scoreCounters[i]->Size()
+                << " scores" << std::endl;
+  if(m_useAlignmentInfo)
+    std::cerr << "\tCreating Huffman codes for " << m_alignCounter.Size()
+              << " alignment points" << std::endl;
 
+  // the code sets are independent of each other
+#ifdef WITH_THREADS
+  boost::thread_group threads;
+  threads.create_thread(boost::bind(&PhraseTableCreator::CalcSymbolHuffmanCodes, this));
+  for(size_t i = 0; i < m_scoreCounters.size(); i++)
+    threads.create_thread(boost::bind(&PhraseTableCreator::CalcScoreHuffmanCodes, this, i));
+  if(m_useAlignmentInfo)
+    threads.create_thread(boost::bind(&PhraseTableCreator::CalcAlignHuffmanCodes, this));
+  threads.join_all();
+#else
+  CalcSymbolHuffmanCodes();
+  for(size_t i = 0; i < m_scoreCounters.size(); i++)
+    CalcScoreHuffmanCodes(i);
+  if(m_useAlignmentInfo)
+    CalcAlignHuffmanCodes();
+#endif
+
+  if(m_quantize)
+    for(size_t i = 0; i < m_scoreCounters.size(); i++)
+      std::cerr << "\tCreated Huffman codes for " << m_scoreCounters[i]->Size()
+                << " quantized scores" << std::endl;
+  std::cerr << std::endl;
+}
+
+void PhraseTableCreator::CalcSymbolHuffmanCodes()
+{
   m_symbolTree = new SymbolTree(m_symbolCounter.Begin(),
                                 m_symbolCounter.End());
+}
 
-  std::vector<ScoreTree*>::iterator treeIt = m_scoreTrees.begin();
-  for(std::vector<ScoreCounter*>::iterator it = m_scoreCounters.begin();
-      it != m_scoreCounters.end(); it++) {
-    if(m_quantize)
-      (*it)->Quantize(m_quantize);
-
-    std::cerr << "\tCreating Huffman codes for " << (*it)->Size()
-              << " scores" << std::endl;
+void PhraseTableCreator::CalcScoreHuffmanCodes(size_t i)
+{
+  if(m_quantize)
+    m_scoreCounters[i]->Quantize(m_quantize);
+  m_scoreTrees[i] = new ScoreTree(m_scoreCounters[i]->Begin(),
+                                  m_scoreCounters[i]->End());
+}
 
-    *treeIt = new ScoreTree((*it)->Begin(), (*it)->End());
-    treeIt++;
-  }
+void PhraseTableCreator::CalcAlignHuffmanCodes()
+{
+  m_alignTree = new AlignTree(m_alignCounter.Begin(), m_alignCounter.End());
+}
 
-  if(m_useAlignmentInfo) {
-    std::cerr << "\tCreating Huffman codes for " << m_alignCounter.Size()
-              << " alignment points" << std::endl;
-    m_alignTree = new AlignTree(m_alignCounter.Begin(), m_alignCounter.End());
-  }
-  std::cerr << std::endl;
+void PhraseTableCreator::AddCounts(EncodingCounts& counts)
+{
+  m_symbolCounter.IncreaseBy(counts.symbols);
+  for(size_t i = 0; i < counts.scores.size(); i++)
+    m_scoreCounters[i]->IncreaseBy(counts.scores[i]);
+  if(m_useAlignmentInfo)
+    m_alignCounter.IncreaseBy(counts.alignment);
 }
 
 
 void PhraseTableCreator::AddSourceSymbolId(std::string& symbol)
 {
 #ifdef WITH_THREADS
-  boost::mutex::scoped_lock lock(m_mutex);
+  boost::unique_lock<boost::shared_mutex> lock(m_mutex);
 #endif
 
   if(m_sourceSymbolsMap.count(symbol) == 0) {
@@ -422,7 +465,7 @@ void PhraseTableCreator::AddSourceSymbolId(std::string& symbol)
 void PhraseTableCreator::AddTargetSymbolId(std::string& symbol)
 {
 #ifdef WITH_THREADS
-  boost::mutex::scoped_lock lock(m_mutex);
+  boost::unique_lock<boost::shared_mutex> lock(m_mutex);
 #endif
   if(m_targetSymbolsMap.count(symbol) == 0) {
     unsigned value = m_targetSymbolsMap.size();
@@ -433,7 +476,7 @@ void PhraseTableCreator::AddTargetSymbolId(std::string& symbol)
 unsigned PhraseTableCreator::GetSourceSymbolId(std::string& symbol)
 {
 #ifdef WITH_THREADS
-  boost::mutex::scoped_lock lock(m_mutex);
+  boost::shared_lock<boost::shared_mutex> lock(m_mutex);
 #endif
   boost::unordered_map<std::string, unsigned>::iterator it
   = m_sourceSymbolsMap.find(symbol);
@@ -447,7 +490,7 @@ unsigned PhraseTableCreator::GetSourceSymbolId(std::string& symbol)
 unsigned PhraseTableCreator::GetTargetSymbolId(std::string& symbol)
 {
 #ifdef WITH_THREADS
-  boost::mutex::scoped_lock lock(m_mutex);
+  boost::shared_lock<boost::shared_mutex> lock(m_mutex);
 #endif
   boost::unordered_map<std::string, unsigned>::iterator it
   = m_targetSymbolsMap.find(symbol);
@@ -459,7 +502,14 @@ unsigned PhraseTableCreator::GetTargetSymbolId(std::string& symbol)
 unsigned PhraseTableCreator::GetOrAddTargetSymbolId(std::string& symbol)
 {
 #ifdef WITH_THREADS
-  boost::mutex::scoped_lock lock(m_mutex);
+  {
+    boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+    boost::unordered_map<std::string, unsigned>::iterator it
+    = m_targetSymbolsMap.find(symbol);
+    if(it != m_targetSymbolsMap.end())
+      return it->second;
+  }
+  boost::unique_lock<boost::shared_mutex> lock(m_mutex);
 #endif
   boost::unordered_map<std::string, unsigned>::iterator it
   = m_targetSymbolsMap.find(symbol);
@@ -535,27 +585,27 @@ unsigned PhraseTableCreator::EncodePREncSymbol2(int left, int right, unsigned ra
 }
 
 void PhraseTableCreator::EncodeTargetPhraseNone(std::vector<std::string>& t,
-    std::ostream& os)
+    std::ostream& os, EncodingCounts& counts)
 {
   std::stringstream encodedTargetPhrase;
   size_t j = 0;
   while(j < t.size()) {
     unsigned targetSymbolId = GetOrAddTargetSymbolId(t[j]);
 
-    m_symbolCounter.Increase(targetSymbolId);
+    counts.symbols[targetSymbolId]++;
     os.write((char*)&targetSymbolId, sizeof(targetSymbolId));
     j++;
   }
 
   unsigned stopSymbolId = GetTargetSymbolId(m_phraseStopSymbol);
   os.write((char*)&stopSymbolId, sizeof(stopSymbolId));
-  m_symbolCounter.Increase(stopSymbolId);
+  counts.symbols[stopSymbolId]++;
 }
 
 void PhraseTableCreator::EncodeTargetPhraseREnc(std::vector<std::string>& s,
     std::vector<std::string>& t,
     std::set<AlignPoint>& a,
-    std::ostream& os)
+    std::ostream& os, EncodingCounts& counts)
 {
   std::stringstream encodedTargetPhrase;
 
@@ -598,20 +648,20 @@ void PhraseTableCreator::EncodeTargetPhraseREnc(std::vector<std::string>& s,
     }
 
     os.write((char*)&encodedSymbol, sizeof(encodedSymbol));
-    m_symbolCounter.Increase(encodedSymbol);
+    counts.symbols[encodedSymbol]++;
   }
 
   unsigned stopSymbolId = GetTargetSymbolId(m_phraseStopSymbol);
   unsigned encodedSymbol = EncodeREncSymbol1(stopSymbolId);
   os.write((char*)&encodedSymbol, sizeof(encodedSymbol));
-  m_symbolCounter.Increase(encodedSymbol);
+  counts.symbols[encodedSymbol]++;
 }
 
 void PhraseTableCreator::EncodeTargetPhrasePREnc(std::vector<std::string>& s,
     std::vector<std::string>& t,
     std::set<AlignPoint>& a,
     size_t ownRank,
-    std::ostream& os)
+    std::ostream& os, EncodingCounts& counts)
 {
   std::vector<unsigned> encodedSymbols(t.size());
   std::vector<unsigned> encodedSymbolsLengths(t.size(), 0);
@@ -660,13 +710,13 @@ void PhraseTableCreator::EncodeTargetPhrasePREnc(std::vector<std::string>& s,
   while(j < t.size()) {
     if(encodedSymbolsLengths[j] > 0) {
       unsigned encodedSymbol = encodedSymbols[j];
-      m_symbolCounter.Increase(encodedSymbol);
+      counts.symbols[encodedSymbol]++;
       os.write((char*)&encodedSymbol, sizeof(encodedSymbol));
       j += encodedSymbolsLengths[j];
     } else {
       unsigned targetSymbolId = GetOrAddTargetSymbolId(t[j]);
       unsigned encodedSymbol = EncodePREncSymbol1(targetSymbolId);
-      m_symbolCounter.Increase(encodedSymbol);
+      counts.symbols[encodedSymbol]++;
       os.write((char*)&encodedSymbol, sizeof(encodedSymbol));
       j++;
     }
@@ -675,10 +725,11 @@ void PhraseTableCreator::EncodeTargetPhrasePREnc(std::vector<std::string>& s,
   unsigned stopSymbolId = GetTargetSymbolId(m_phraseStopSymbol);
   unsigned encodedSymbol = EncodePREncSymbol1(stopSymbolId);
   os.write((char*)&encodedSymbol, sizeof(encodedSymbol));
-  m_symbolCounter.Increase(encodedSymbol);
+  counts.symbols[encodedSymbol]++;
 }
 
-void PhraseTableCreator::EncodeScores(std::vector<float>& scores, std::ostream& os)
+void PhraseTableCreator::EncodeScores(std::vector<float>& scores, std::ostream& os,
+                                      EncodingCounts& counts)
 {
   size_t c = 0;
   float score;
@@ -687,25 +738,26 @@ void PhraseTableCreator::EncodeScores(std::vector<float>& scores, std::ostream&
     score = scores[c];
     score = FloorScore(TransformScore(score));
     os.write((char*)&score, sizeof(score));
-    m_scoreCounters[m_multipleScoreTrees ? c : 0]->Increase(score);
+    counts.scores[m_multipleScoreTrees ? c : 0][score]++;
     c++;
   }
 }
 
 void PhraseTableCreator::EncodeAlignment(std::set<AlignPoint>& alignment,
-    std::ostream& os)
+    std::ostream& os, EncodingCounts& counts)
 {
   for(std::set<AlignPoint>::iterator it = alignment.begin();
       it != alignment.end(); it++) {
     os.write((char*)&(*it), sizeof(AlignPoint));
-    m_alignCounter.Increase(*it);
+    counts.alignment[*it]++;
   }
   AlignPoint stop(-1, -1);
   os.write((char*) &stop, sizeof(AlignPoint));
-  m_alignCounter.Increase(stop);
+  counts.alignment[stop]++;
 }
 
-std::string PhraseTableCreator::EncodeLine(std::vector<std::string>& tokens, size_t ownRank)
+std::string PhraseTableCreator::EncodeLine(std::vector<std::string>& tokens, size_t ownRank,
+    EncodingCounts& counts)
 {
   std::string sourcePhraseStr = tokens[0];
   std::string targetPhraseStr = tokens[1];
@@ -743,17 +795,17 @@ std::string PhraseTableCreator::EncodeLine(std::vector<std::string>& tokens, siz
   std::stringstream encodedTargetPhrase;
 
   if(m_coding == PREnc) {
-    EncodeTargetPhrasePREnc(s, t, a, ownRank, encodedTargetPhrase);
+    EncodeTargetPhrasePREnc(s, t, a, ownRank, encodedTargetPhrase, counts);
   } else if(m_coding == REnc) {
-    EncodeTargetPhraseREnc(s, t, a, encodedTargetPhrase);
+    EncodeTargetPhraseREnc(s, t, a, encodedTargetPhrase, counts);
   } else {
-    EncodeTargetPhraseNone(t, encodedTargetPhrase);
+    EncodeTargetPhraseNone(t, encodedTargetPhrase, counts);
   }
 
-  EncodeScores(scores, encodedTargetPhrase);
+  EncodeScores(scores, encodedTargetPhrase, counts);
 
   if(m_useAlignmentInfo)
-    EncodeAlignment(a, encodedTargetPhrase);
+    EncodeAlignment(a, encodedTargetPhrase, counts);
 
   return encodedTargetPhrase.str();
 }
@@ -832,9 +884,32 @@ std::string PhraseTableCreator::CompressEncodedCollection(std::string encodedCol
   return compressedEncodedCollection;
 }
 
-void PhraseTableCreator::AddRankedLine(PackedItem& pi)
+void PhraseTableCreator::PushQueue(const PackedItem& pi)
 {
   m_queue.push(pi);
+  m_queueBytes += pi.GetSrc().size() + pi.GetTrg().size();
+}
+
+PackedItem PhraseTableCreator::PopQueue()
+{
+  PackedItem pi = m_queue.top();
+  m_queue.pop();
+  m_queueBytes -= pi.GetSrc().size() + pi.GetTrg().size();
+  return pi;
+}
+
+#ifdef WITH_THREADS
+void PhraseTableCreator::WaitForQueue(boost::mutex::scoped_lock& lock, long firstLine)
+{
+  // the task with the next line to flush never waits, so the queue drains
+  while(m_queueBytes > m_maxQueueBytes && firstLine != m_lastFlushedLine + 1)
+    m_queueNotFull.wait(lock);
+}
+#endif
+
+void PhraseTableCreator::AddRankedLine(PackedItem& pi)
+{
+  PushQueue(pi);
 }
 
 void PhraseTableCreator::FlushRankedQueue(bool force)
@@ -844,8 +919,7 @@ void PhraseTableCreator::FlushRankedQueue(bool force)
   while(!m_queue.empty() && m_lastFlushedLine + 1 == m_queue.top().GetLine()) {
     m_lastFlushedLine++;
 
-    PackedItem pi = m_queue.top();
-    m_queue.pop();
+    PackedItem pi = PopQueue();
 
     if(m_lastSourceRange.size() == step) {
       m_rnkHash.AddRange(m_lastSourceRange);
@@ -904,14 +978,13 @@ void PhraseTableCreator::FlushRankedQueue(bool force)
 
 void PhraseTableCreator::AddEncodedLine(PackedItem& pi)
 {
-  m_queue.push(pi);
+  PushQueue(pi);
 }
 
 void PhraseTableCreator::FlushEncodedQueue(bool force)
 {
   while(!m_queue.empty() && m_lastFlushedLine + 1 == m_queue.top().GetLine()) {
-    PackedItem pi = m_queue.top();
-    m_queue.pop();
+    PackedItem pi = PopQueue();
     m_lastFlushedLine++;
 
     if(m_lastFlushedSourcePhrase != pi.GetSrc()) {
@@ -987,15 +1060,14 @@ void PhraseTableCreator::FlushEncodedQueue(bool force)
 
 void PhraseTableCreator::AddCompressedCollection(PackedItem& pi)
 {
-  m_queue.push(pi);
+  PushQueue(pi);
 }
 
 void PhraseTableCreator::FlushCompressedQueue(bool force)
 {
-  if(force || m_queue.size() > 10000) {
+  if(force || m_queue.size() > 10000 || m_queueBytes > m_maxQueueBytes) {
     while(!m_queue.empty() && m_lastFlushedLine + 1 == m_queue.top().GetLine()) {
-      PackedItem pi = m_queue.top();
-      m_queue.pop();
+      PackedItem pi = PopQueue();
       m_lastFlushedLine++;
 
       m_compressedTargetPhrases->push_back(pi.GetTrg());
@@ -1017,7 +1089,6 @@ void PhraseTableCreator::FlushCompressedQueue(bool force)
 
 size_t RankingTask::m_lineNum = 0;
 #ifdef WITH_THREADS
-boost::mutex RankingTask::m_mutex;
 boost::mutex RankingTask::m_fileMutex;
 #endif
 
@@ -1093,11 +1164,15 @@ void RankingTask::operator()()
 
     {
 #ifdef WITH_THREADS
-      boost::mutex::scoped_lock lock(m_mutex);
+      boost::mutex::scoped_lock lock(m_creator.m_queueMutex);
+      m_creator.WaitForQueue(lock, lineNum);
 #endif
       for(size_t i = 0; i < result.size(); i++)
         m_creator.AddRankedLine(result[i]);
       m_creator.FlushRankedQueue();
+#ifdef WITH_THREADS
+      m_creator.m_queueNotFull.notify_all();
+#endif
     }
 
     result.clear();
@@ -1117,7 +1192,6 @@ void RankingTask::operator()()
 
 size_t EncodingTask::m_lineNum = 0;
 #ifdef WITH_THREADS
-boost::mutex EncodingTask::m_mutex;
 boost::mutex EncodingTask::m_fileMutex;
 #endif
 
@@ -1146,6 +1220,9 @@ void EncodingTask::operator()()
   std::vector<PackedItem> result;
   result.reserve(max_lines);
 
+  PhraseTableCreator::EncodingCounts counts;
+  counts.scores.resize(m_creator.m_scoreCounters.size());
+
   while(lines.size()) {
     for(size_t i = 0; i < lines.size(); i++) {
       std::vector<std::string> tokens;
@@ -1176,7 +1253,7 @@ void EncodingTask::operator()()
       if(m_creator.m_coding == PhraseTableCreator::PREnc)
         ownRank = m_creator.m_ranks[lineNum + i];
 
-      std::string encodedLine = m_creator.EncodeLine(tokens, ownRank);
+      std::string encodedLine = m_creator.EncodeLine(tokens, ownRank, counts);
 
       PackedItem packedItem(lineNum + i, tokens[0], encodedLine, ownRank);
       result.push_back(packedItem);
@@ -1185,11 +1262,15 @@ void EncodingTask::operator()()
 
     {
 #ifdef WITH_THREADS
-      boost::mutex::scoped_lock lock(m_mutex);
+      boost::mutex::scoped_lock lock(m_creator.m_queueMutex);
+      m_creator.WaitForQueue(lock, lineNum);
 #endif
       for(size_t i = 0; i < result.size(); i++)
         m_creator.AddEncodedLine(result[i]);
       m_creator.FlushEncodedQueue();
+#ifdef WITH_THREADS
+      m_creator.m_queueNotFull.notify_all();
+#endif
     }
 
     result.clear();
@@ -1205,6 +1286,8 @@ void EncodingTask::operator()()
     lineNum = m_lineNum;
     m_lineNum += lines.size();
   }
+
+  m_creator.AddCounts(counts);
 }
 
 //****************************************************************************//
@@ -1238,12 +1321,21 @@ void CompressionTask::operator()()
     std::string dummy;
     PackedItem packedItem(collectionNum, dummy, compressedCollection, 0);
 
+    {
 #ifdef WITH_THREADS
-    boost::mutex::scoped_lock lock(m_mutex);
+      boost::mutex::scoped_lock lock(m_creator.m_queueMutex);
+      m_creator.WaitForQueue(lock, collectionNum);
+#endif
+      m_creator.AddCompressedCollection(packedItem);
+      m_creator.FlushCompressedQueue();
+#ifdef WITH_THREADS
+      m_creator.m_queueNotFull.notify_all();
 #endif
-    m_creator.AddCompressedCollection(packedItem);
-    m_creator.FlushCompressedQueue();
+    }
 
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
     collectionNum = m_collectionNum;
     m_collectionNum++;
   }
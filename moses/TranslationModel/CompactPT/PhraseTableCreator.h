@@ -28,6 +28,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <vector>
 #include <set>
 #include <boost/unordered_map.hpp>
+#ifdef WITH_THREADS
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#endif
 
 #include "moses/InputFileStream.h"
 #include "moses/ThreadPool.h"
@@ -96,6 +100,14 @@ public:
     m_freqMap[data] += num;
   }
 
+  void IncreaseBy(const FreqMap& freqMap) {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    for(typename FreqMap::const_iterator it = freqMap.begin(); it != freqMap.end(); it++)
+      m_freqMap[it->first] += it->second;
+  }
+
   mapped_type& operator[](DataType data) {
     return m_freqMap[data];
   }
@@ -204,12 +216,21 @@ private:
 
 #ifdef WITH_THREADS
   size_t m_threads;
-  boost::mutex m_mutex;
+  // guards the symbol maps, which are mostly read
+  boost::shared_mutex m_mutex;
+
+  // Lines finished out of order by the tasks wait in m_queue.  A task that
+  // is not holding up the queue waits while it is over m_maxQueueBytes.
+  boost::mutex m_queueMutex;
+  boost::condition_variable m_queueNotFull;
 #endif
 
   BlockHashIndex m_srcHash;
   BlockHashIndex m_rnkHash;
 
+  size_t m_queueBytes;
+  size_t m_maxQueueBytes;
+
   size_t m_maxPhraseLength;
 
   std::vector<unsigned> m_ranks;
@@ -264,6 +285,15 @@ private:
   std::vector<ScoreCounter*> m_scoreCounters;
   std::vector<ScoreTree*> m_scoreTrees;
 
+  // Frequencies counted by one EncodingTask without locking, added to the
+  // counters above when the task is done
+  struct EncodingCounts {
+    SymbolCounter::FreqMap symbols;
+    std::vector<ScoreCounter::FreqMap> scores;
+    AlignCounter::FreqMap alignment;
+  };
+  void AddCounts(EncodingCounts& counts);
+
   std::priority_queue<PackedItem> m_queue;
   long m_lastFlushedLine;
   long m_lastFlushedSourceNum;
@@ -292,20 +322,22 @@ private:
   unsigned EncodePREncSymbol2(int lOff, int rOff, unsigned rank);
 
   void EncodeTargetPhraseNone(std::vector<std::string>& t,
-                              std::ostream& os);
+                              std::ostream& os, EncodingCounts& counts);
 
   void EncodeTargetPhraseREnc(std::vector<std::string>& s,
                               std::vector<std::string>& t,
                               std::set<AlignPoint>& a,
-                              std::ostream& os);
+                              std::ostream& os, EncodingCounts& counts);
 
   void EncodeTargetPhrasePREnc(std::vector<std::string>& s,
                                std::vector<std::string>& t,
                                std::set<AlignPoint>& a, size_t ownRank,
-                               std::ostream& os);
+                               std::ostream& os, EncodingCounts& counts);
 
-  void EncodeScores(std::vector<float>& scores, std::ostream& os);
-  void EncodeAlignment(std::set<AlignPoint>& alignment, std::ostream& os);
+  void EncodeScores(std::vector<float>& scores, std::ostream& os,
+                    EncodingCounts& counts);
+  void EncodeAlignment(std::set<AlignPoint>& alignment, std::ostream& os,
+                       EncodingCounts& counts);
 
   std::string MakeSourceKey(std::string&);
   std::string MakeSourceTargetKey(std::string&, std::string&);
@@ -315,12 +347,22 @@ private:
   void CreateRankHash();
   void EncodeTargetPhrases();
   void CalcHuffmanCodes();
+  void CalcSymbolHuffmanCodes();
+  void CalcScoreHuffmanCodes(size_t i);
+  void CalcAlignHuffmanCodes();
   void CompressTargetPhrases();
 
+  void PushQueue(const PackedItem& pi);
+  PackedItem PopQueue();
+#ifdef WITH_THREADS
+  void WaitForQueue(boost::mutex::scoped_lock& lock, long firstLine);
+#endif
+
   void AddRankedLine(PackedItem& pi);
   void FlushRankedQueue(bool force = false);
 
-  std::string EncodeLine(std::vector<std::string>& tokens, size_t ownRank);
+  std::string EncodeLine(std::vector<std::string>& tokens, size_t ownRank,
+                         EncodingCounts& counts);
   void AddEncodedLine(PackedItem& pi);
   void FlushEncodedQueue(bool force = false);
 
@@ -345,6 +387,7 @@ public:
                      bool warnMe = true
 #ifdef WITH_THREADS
                                    , size_t threads = 2
+                                   , size_t queueMemoryMB = 256
 #endif
                     );
 
@@ -359,7 +402,6 @@ class RankingTask
 {
 private:
 #ifdef WITH_THREADS
-  static boost::mutex m_mutex;
   static boost::mutex m_fileMutex;
 #endif
   static size_t m_lineNum;
@@ -375,7 +417,6 @@ class EncodingTask
 {
 private:
 #ifdef WITH_THREADS
-  static boost::mutex m_mutex;
   static boost::mutex m_fileMutex;
 #endif
   static size_t m_lineNum;
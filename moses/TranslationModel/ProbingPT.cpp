@@ -130,6 +130,8 @@ void ProbingPT::SetParameter(const std::string& key, const std::string& value)
       load_method = util::READ;
     } else if (value == "parallel_read") {
       load_method = util::PARALLEL_READ;
+    } else if (value == "interleave") {
+      load_method = util::READ_INTERLEAVE;
     } else {
       UTIL_THROW2("load method not supported" << value);
     }
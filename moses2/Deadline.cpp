@@ -0,0 +1,104 @@
+/*
+ * Deadline.cpp
+ *
+ *  Created on: 16 Oct 2026
+ */
+
+#include <algorithm>
+#include <sstream>
+#include "Deadline.h"
+
+using namespace std;
+
+namespace Moses2
+{
+
+namespace
+{
+// part of the time of a step that doesn't shrink with the beam
+const double kFixedCost = 0.1;
+}
+
+Deadline::Deadline()
+  :m_budget(0)
+  ,m_factor(1)
+  ,m_minFactor(1)
+  ,m_sumFactors(0)
+  ,m_cost(0)
+  ,m_numSteps(0)
+  ,m_numDegraded(0)
+  ,m_lastWeight(0)
+  ,m_searchStart(0)
+{
+}
+
+void Deadline::Start()
+{
+  m_timer.start();
+}
+
+double Deadline::GetElapsed() const
+{
+  return m_timer.get_elapsed_time() * 1000;
+}
+
+void Deadline::Update(size_t step, size_t numSteps, size_t weight)
+{
+  if (m_budget == 0) {
+    return;
+  }
+
+  double elapsed = GetElapsed();
+  if (m_numSteps == 0) {
+    // lookup etc. count against the budget, but not as search steps
+    m_searchStart = elapsed;
+  } else {
+    m_cost += m_lastWeight * (kFixedCost + (1 - kFixedCost) * m_factor);
+  }
+  m_lastWeight = weight;
+
+  double left = m_budget - elapsed;
+  if (left <= 0) {
+    m_factor = 0;
+  } else if (m_cost > 0 && step < numSteps) {
+    double fullStep = (elapsed - m_searchStart) / m_cost;
+    double needed = fullStep * (numSteps - step);
+    double factor = (left / needed - kFixedCost) / (1 - kFixedCost);
+    m_factor = std::max(0.0, std::min(1.0, factor));
+  }
+
+  m_numSteps += weight;
+  m_sumFactors += m_factor * weight;
+  if (m_factor < 1) {
+    m_numDegraded += weight;
+  }
+  m_minFactor = std::min(m_minFactor, m_factor);
+}
+
+size_t Deadline::Scale(size_t limit) const
+{
+  if (m_factor >= 1 || limit == 0) {
+    // 0 = unlimited. Nothing to scale
+    return limit;
+  }
+  return std::max<size_t>(1, limit * m_factor);
+}
+
+float Deadline::GetAverageBeamFactor() const
+{
+  return m_numSteps ? m_sumFactors / m_numSteps : 1;
+}
+
+std::string Deadline::Debug() const
+{
+  stringstream out;
+  out << "budget=" << m_budget << "ms"
+      << " elapsed=" << (size_t) GetElapsed() << "ms"
+      << " degraded-steps=" << m_numDegraded << "/" << m_numSteps
+      << " min-beam=" << m_minFactor
+      << " avg-beam=" << GetAverageBeamFactor();
+  return out.str();
+}
+
+}
+
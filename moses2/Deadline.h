@@ -0,0 +1,87 @@
+/*
+ * Deadline.h
+ *
+ *  Created on: 16 Oct 2026
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include "legacy/Timer.h"
+
+namespace Moses2
+{
+
+/** Time budget of one sentence.
+ * The search calls Update() before each step (a stack in phrase-based
+ * search, a span in SCFG). When the steps so far say the rest of the
+ * sentence won't fit into the time left, the beam, i.e. the stack size and
+ * cube pruning pop limit, is scaled down. Once the budget is spent the beam
+ * is 1, so there is always a complete translation, just a worse one.
+ */
+class Deadline
+{
+public:
+  Deadline();
+  virtual ~Deadline() {
+  }
+
+  // milliseconds. 0 = no deadline
+  void SetBudget(size_t budget) {
+    m_budget = budget;
+  }
+  size_t GetBudget() const {
+    return m_budget;
+  }
+
+  void Start();
+
+  // before step 'step' of 'numSteps'. A call can cover several steps that
+  // run together, e.g. the spans of one width decoded in parallel
+  void Update(size_t step, size_t numSteps, size_t weight = 1);
+
+  size_t GetStackSize(size_t stackSize) const {
+    return Scale(stackSize);
+  }
+  size_t GetPopLimit(size_t popLimit) const {
+    return Scale(popLimit);
+  }
+
+  // milliseconds since Start(). Tests override it with a clock of their own
+  virtual double GetElapsed() const;
+
+  // how far the beam was degraded. 1 = full beam
+  float GetBeamFactor() const {
+    return m_factor;
+  }
+  float GetMinBeamFactor() const {
+    return m_minFactor;
+  }
+  float GetAverageBeamFactor() const;
+
+  size_t GetNumSteps() const {
+    return m_numSteps;
+  }
+  size_t GetNumDegradedSteps() const {
+    return m_numDegraded;
+  }
+
+  std::string Debug() const;
+
+protected:
+  size_t m_budget;
+  Timer m_timer;
+
+  float m_factor, m_minFactor;
+  double m_sumFactors; // of the steps so far
+  double m_cost; // same, but in full beam steps
+  size_t m_numSteps, m_numDegraded;
+  size_t m_lastWeight; // steps of the previous Update(), not yet in m_cost
+  double m_searchStart; // elapsed at the first step
+
+  size_t Scale(size_t limit) const;
+};
+
+}
+
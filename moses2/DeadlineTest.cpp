@@ -0,0 +1,81 @@
+#include <boost/test/unit_test.hpp>
+
+#include "Deadline.h"
+
+using namespace Moses2;
+
+namespace
+{
+// time only moves when the test says so, so a loaded machine can't push the
+// search past its budget
+class ManualDeadline: public Deadline
+{
+public:
+  ManualDeadline()
+    :m_now(0) {
+  }
+
+  double GetElapsed() const {
+    return m_now;
+  }
+
+  void Advance(double ms) {
+    m_now += ms;
+  }
+
+protected:
+  double m_now;
+};
+
+// the calls SCFG::Manager::Decode() makes with search-threads > 1: one
+// Update() per width, covering all spans of that width. Each width takes
+// widthTime ms
+void DecodeParallel(ManualDeadline &deadline, size_t inputSize, size_t widthTime)
+{
+  deadline.Start();
+  size_t numSpans = inputSize * (inputSize + 1) / 2;
+  size_t spanInd = 0;
+  for (size_t phraseSize = 1; phraseSize <= inputSize; ++phraseSize) {
+    size_t numStarts = inputSize - phraseSize + 1;
+    deadline.Update(spanInd, numSpans, numStarts);
+    deadline.Advance(widthTime);
+    spanInd += numStarts;
+  }
+}
+}
+
+BOOST_AUTO_TEST_SUITE(deadline)
+
+BOOST_AUTO_TEST_CASE(parallel_spans_generous_budget)
+{
+  // about 40ms of work in 400ms
+  ManualDeadline deadline;
+  deadline.SetBudget(400);
+  DecodeParallel(deadline, 40, 1);
+
+  BOOST_CHECK_EQUAL(deadline.GetNumSteps(), 40 * 41 / 2);
+  BOOST_CHECK_EQUAL(deadline.GetNumDegradedSteps(), 0);
+  BOOST_CHECK_EQUAL(deadline.GetMinBeamFactor(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_spans_tight_budget)
+{
+  // about 40ms of work in 10ms
+  ManualDeadline deadline;
+  deadline.SetBudget(10);
+  DecodeParallel(deadline, 40, 1);
+
+  BOOST_CHECK(deadline.GetNumDegradedSteps() > 0);
+  BOOST_CHECK(deadline.GetMinBeamFactor() < 1);
+}
+
+BOOST_AUTO_TEST_CASE(no_budget)
+{
+  ManualDeadline deadline;
+  DecodeParallel(deadline, 5, 0);
+
+  BOOST_CHECK_EQUAL(deadline.GetNumSteps(), 0);
+  BOOST_CHECK_EQUAL(deadline.GetStackSize(200), 200);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -17,7 +17,8 @@ namespace Moses2
 {
 
 FeatureFunction::FeatureFunction(size_t startInd, const std::string &line)
-  :m_startInd(startInd)
+  :m_index(0)
+  ,m_startInd(startInd)
   ,m_numScores(1)
   ,m_PhraseTableInd(NOT_FOUND)
   ,m_tuneable(true)
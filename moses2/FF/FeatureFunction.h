@@ -9,6 +9,7 @@
 
 #include <cstddef>
 #include <string>
+#include <stdint.h>
 #include <vector>
 #include "../TypeDef.h"
 #include "../Phrase.h"
@@ -43,6 +44,14 @@ public:
   virtual void Load(System &system) {
   }
 
+  // position in FeatureFunctions
+  size_t GetIndex() const {
+    return m_index;
+  }
+  void SetIndex(size_t ind) {
+    m_index = ind;
+  }
+
   size_t GetStartInd() const {
     return m_startInd;
   }
@@ -74,6 +83,11 @@ public:
 
   virtual void SetParameter(const std::string& key, const std::string& value);
 
+  // hits and misses of the feature's own cache, if it has one. For -profile-features
+  virtual bool GetCacheStats(uint64_t &hits, uint64_t &misses) const {
+    return false;
+  }
+
   // may have more factors than actually need, but not guaranteed.
   virtual void
   EvaluateInIsolation(MemPool &pool, const System &system, const Phrase<Moses2::Word> &source,
@@ -103,6 +117,7 @@ public:
   }
 
 protected:
+  size_t m_index;
   size_t m_startInd;
   size_t m_numScores;
   size_t m_PhraseTableInd;
@@ -5,6 +5,7 @@
  *      Author: hieu
  */
 
+#include <fstream>
 #include <boost/foreach.hpp>
 #include "FeatureRegistry.h"
 #include "FeatureFunctions.h"
@@ -25,12 +26,23 @@ using namespace std;
 namespace Moses2
 {
 FeatureFunctions::FeatureFunctions(System &system) :
-  m_system(system), m_ffStartInd(0)
+  m_unkWP(NULL), m_profiler(NULL), m_system(system), m_ffStartInd(0)
 {
 }
 
 FeatureFunctions::~FeatureFunctions()
 {
+  if (m_profiler) {
+    // before the ffs go, their caches are reported
+    if (m_profilerPath == "-") {
+      m_profiler->Report(cerr);
+    } else {
+      ofstream out(m_profilerPath.c_str());
+      m_profiler->Report(out);
+    }
+    delete m_profiler;
+  }
+
   RemoveAllInColl(m_featureFunctions);
 }
 
@@ -69,6 +81,7 @@ void FeatureFunctions::Create()
   BOOST_FOREACH(const std::string &line, *ffParams) {
     FeatureFunction *ff = Create(line);
 
+    ff->SetIndex(m_featureFunctions.size());
     m_featureFunctions.push_back(ff);
 
     StatefulFeatureFunction *sfff = dynamic_cast<StatefulFeatureFunction*>(ff);
@@ -104,6 +117,11 @@ void FeatureFunctions::Create()
   }
 
   OverrideFeatures();
+
+  params.SetParameter(m_profilerPath, "profile-features", std::string(""));
+  if (!m_profilerPath.empty()) {
+    m_profiler = new FeatureProfiler(m_featureFunctions);
+  }
 }
 
 FeatureFunction *FeatureFunctions::Create(const std::string &line)
@@ -180,8 +198,10 @@ void FeatureFunctions::EvaluateInIsolation(MemPool &pool, const System &system,
     const Phrase<Moses2::Word> &source, TargetPhraseImpl &targetPhrase) const
 {
   SCORE estimatedScore = 0;
+  FeatureProfiler::Counters *counters = GetProfilerCounters();
 
   BOOST_FOREACH(const FeatureFunction *ff, m_featureFunctions) {
+    FeatureProfiler::Scope scope(counters, ff->GetIndex(), FeatureProfiler::EvaluateInIsolation);
     Scores& scores = targetPhrase.GetScores();
     ff->EvaluateInIsolation(pool, system, source, targetPhrase, scores, estimatedScore);
   }
@@ -196,8 +216,10 @@ void FeatureFunctions::EvaluateInIsolation(
   SCFG::TargetPhraseImpl &targetPhrase) const
 {
   SCORE estimatedScore = 0;
+  FeatureProfiler::Counters *counters = GetProfilerCounters();
 
   BOOST_FOREACH(const FeatureFunction *ff, m_featureFunctions) {
+    FeatureProfiler::Scope scope(counters, ff->GetIndex(), FeatureProfiler::EvaluateInIsolation);
     Scores& scores = targetPhrase.GetScores();
     ff->EvaluateInIsolation(pool, system, source, targetPhrase, scores, estimatedScore);
   }
@@ -208,7 +230,10 @@ void FeatureFunctions::EvaluateInIsolation(
 void FeatureFunctions::EvaluateAfterTablePruning(MemPool &pool,
     const TargetPhrases &tps, const Phrase<Moses2::Word> &sourcePhrase) const
 {
+  FeatureProfiler::Counters *counters = GetProfilerCounters();
+
   BOOST_FOREACH(const FeatureFunction *ff, m_featureFunctions) {
+    FeatureProfiler::Scope scope(counters, ff->GetIndex(), FeatureProfiler::EvaluateAfterTablePruning);
     ff->EvaluateAfterTablePruning(pool, tps, sourcePhrase);
   }
 }
@@ -216,14 +241,20 @@ void FeatureFunctions::EvaluateAfterTablePruning(MemPool &pool,
 void FeatureFunctions::EvaluateAfterTablePruning(MemPool &pool, const SCFG::TargetPhrases &tps,
     const Phrase<SCFG::Word> &sourcePhrase) const
 {
+  FeatureProfiler::Counters *counters = GetProfilerCounters();
+
   BOOST_FOREACH(const FeatureFunction *ff, m_featureFunctions) {
+    FeatureProfiler::Scope scope(counters, ff->GetIndex(), FeatureProfiler::EvaluateAfterTablePruning);
     ff->EvaluateAfterTablePruning(pool, tps, sourcePhrase);
   }
 }
 
 void FeatureFunctions::EvaluateWhenAppliedBatch(const Batch &batch) const
 {
+  FeatureProfiler::Counters *counters = GetProfilerCounters();
+
   BOOST_FOREACH(const StatefulFeatureFunction *ff, m_statefulFeatureFunctions) {
+    FeatureProfiler::Scope scope(counters, ff->GetIndex(), FeatureProfiler::EvaluateWhenAppliedBatch);
     ff->EvaluateWhenAppliedBatch(m_system, batch);
   }
 }
@@ -12,6 +12,7 @@
 #include <string>
 #include "../legacy/Parameter.h"
 #include "../Phrase.h"
+#include "FeatureProfiler.h"
 
 namespace Moses2
 {
@@ -74,6 +75,14 @@ public:
     return m_unkWP;
   }
 
+  // NULL unless -profile-features
+  FeatureProfiler *GetProfiler() const {
+    return m_profiler;
+  }
+  FeatureProfiler::Counters *GetProfilerCounters() const {
+    return m_profiler ? &m_profiler->GetCounters() : NULL;
+  }
+
   // the pool here must be the system pool if the rule was loaded during load, or the mgr pool if it was loaded on demand
   void EvaluateInIsolation(MemPool &pool, const System &system,
                            const Phrase<Moses2::Word> &source, TargetPhraseImpl &targetPhrase) const;
@@ -97,6 +106,8 @@ protected:
   std::vector<const StatefulFeatureFunction*> m_statefulFeatureFunctions;
   std::vector<const FeatureFunction*> m_withPhraseTableInd;
   const UnknownWordPenalty *m_unkWP;
+  FeatureProfiler *m_profiler;
+  std::string m_profilerPath;
 
   boost::unordered_map<std::string, size_t> m_defaultNames;
   System &m_system;
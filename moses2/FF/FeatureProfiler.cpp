@@ -0,0 +1,144 @@
+/*
+ * FeatureProfiler.cpp
+ *
+ *  Created on: 16 Oct 2026
+ */
+
+#include <sstream>
+#include <boost/foreach.hpp>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+#include "FeatureProfiler.h"
+#include "FeatureFunction.h"
+#include "../legacy/Util2.h"
+
+using namespace std;
+
+namespace Moses2
+{
+
+namespace
+{
+void KeepCounters(FeatureProfiler::Counters *counters)
+{
+}
+}
+
+FeatureProfiler::Counters::Counters(size_t size)
+{
+  m_counters = new Counter[size * NumEvents];
+  for (size_t i = 0; i < size * NumEvents; ++i) {
+    m_counters[i].calls = 0;
+    m_counters[i].cycles = 0;
+  }
+}
+
+FeatureProfiler::Counters::~Counters()
+{
+  delete[] m_counters;
+}
+
+////////////////////////////////////////////////////////////////////////////
+FeatureProfiler::FeatureProfiler(const std::vector<FeatureFunction*> &ffs)
+  :m_ffs(ffs)
+  ,m_threadCounters(KeepCounters)
+{
+}
+
+FeatureProfiler::~FeatureProfiler()
+{
+  RemoveAllInColl(m_allCounters);
+}
+
+FeatureProfiler::Counters &FeatureProfiler::AddThread()
+{
+  Counters *counters = new Counters(m_ffs.size());
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_allCounters.push_back(counters);
+  }
+  m_threadCounters.reset(counters);
+  return *counters;
+}
+
+uint64_t FeatureProfiler::ReadCycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+const char *FeatureProfiler::GetEventName(Event event)
+{
+  switch (event) {
+  case EvaluateInIsolation:
+    return "EvaluateInIsolation";
+  case EvaluateAfterTablePruning:
+    return "EvaluateAfterTablePruning";
+  case EvaluateWhenApplied:
+    return "EvaluateWhenApplied";
+  case EvaluateWhenAppliedBatch:
+    return "EvaluateWhenAppliedBatch";
+  case Lookup:
+    return "Lookup";
+  default:
+    return "";
+  }
+}
+
+void FeatureProfiler::Report(std::ostream &out) const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+
+#if defined(__x86_64__) || defined(__i386__)
+  out << "{\"clock\": \"rdtsc\"";
+#else
+  out << "{\"clock\": \"ns\"";
+#endif
+  out << ", \"threads\": " << m_allCounters.size()
+      << ", \"features\": [";
+
+  for (size_t ffInd = 0; ffInd < m_ffs.size(); ++ffInd) {
+    const FeatureFunction &ff = *m_ffs[ffInd];
+    out << (ffInd ? "," : "") << "\n  {\"name\": \"" << EscapeJson(ff.GetName()) << "\"";
+
+    for (size_t event = 0; event < NumEvents; ++event) {
+      uint64_t calls = 0, cycles = 0;
+      BOOST_FOREACH(const Counters *counters, m_allCounters) {
+        const Counter &counter = counters->Get(ffInd, (Event) event);
+        calls += counter.calls.load(std::memory_order_relaxed);
+        cycles += counter.cycles.load(std::memory_order_relaxed);
+      }
+      if (calls) {
+        out << ", \"" << GetEventName((Event) event) << "\": {\"calls\": " << calls
+            << ", \"cycles\": " << cycles << "}";
+      }
+    }
+
+    uint64_t hits, misses;
+    if (ff.GetCacheStats(hits, misses)) {
+      out << ", \"cache\": {\"hits\": " << hits << ", \"misses\": " << misses
+          << ", \"hit-rate\": " << (hits + misses ? double(hits) / (hits + misses) : 0)
+          << "}";
+    }
+    out << "}";
+  }
+
+  out << "\n]}" << endl;
+}
+
+std::string FeatureProfiler::Report() const
+{
+  stringstream out;
+  Report(out);
+  return out.str();
+}
+
+}
+
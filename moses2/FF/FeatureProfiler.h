@@ -0,0 +1,122 @@
+/*
+ * FeatureProfiler.h
+ *
+ *  Created on: 16 Oct 2026
+ */
+
+#pragma once
+
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
+namespace Moses2
+{
+class FeatureFunction;
+
+/** Call counts and cycles spent in each feature function, and in each phrase
+ * table's Lookup(). Turned on with -profile-features.
+ *
+ * Every thread adds to its own counters, so timing a call doesn't make the
+ * threads fight over a cache line. Report() adds up the counters of all the
+ * threads and writes them as JSON.
+ */
+class FeatureProfiler
+{
+public:
+  enum Event {
+    EvaluateInIsolation,
+    EvaluateAfterTablePruning,
+    EvaluateWhenApplied,
+    EvaluateWhenAppliedBatch,
+    Lookup,
+    NumEvents
+  };
+
+  struct Counter {
+    std::atomic<uint64_t> calls, cycles;
+  };
+
+  // counters of 1 thread
+  class Counters
+  {
+  public:
+    Counters(size_t size);
+    ~Counters();
+
+    void Add(size_t ffInd, Event event, uint64_t cycles) {
+      // only the owning thread writes. Atomic so that Report() can read
+      Counter &counter = m_counters[ffInd * NumEvents + event];
+      counter.calls.store(counter.calls.load(std::memory_order_relaxed) + 1,
+                          std::memory_order_relaxed);
+      counter.cycles.store(counter.cycles.load(std::memory_order_relaxed) + cycles,
+                           std::memory_order_relaxed);
+    }
+
+    const Counter &Get(size_t ffInd, Event event) const {
+      return m_counters[ffInd * NumEvents + event];
+    }
+
+  protected:
+    Counter *m_counters;
+  };
+
+  // times the enclosing block, if counters isn't NULL
+  class Scope
+  {
+  public:
+    Scope(Counters *counters, size_t ffInd, Event event)
+      :m_counters(counters)
+      ,m_ffInd(ffInd)
+      ,m_event(event) {
+      if (counters) {
+        m_start = ReadCycles();
+      }
+    }
+    ~Scope() {
+      if (m_counters) {
+        m_counters->Add(m_ffInd, m_event, ReadCycles() - m_start);
+      }
+    }
+
+  protected:
+    Counters *m_counters;
+    size_t m_ffInd;
+    Event m_event;
+    uint64_t m_start;
+  };
+
+  FeatureProfiler(const std::vector<FeatureFunction*> &ffs);
+  ~FeatureProfiler();
+
+  // of the calling thread
+  Counters &GetCounters() {
+    Counters *counters = m_threadCounters.get();
+    return counters ? *counters : AddThread();
+  }
+
+  static uint64_t ReadCycles();
+
+  void Report(std::ostream &out) const;
+  std::string Report() const;
+
+  static const char *GetEventName(Event event);
+
+protected:
+  const std::vector<FeatureFunction*> &m_ffs;
+
+  mutable boost::mutex m_mutex;
+  std::vector<Counters*> m_allCounters;
+
+  // not deleted at thread exit, the counts are reported later
+  boost::thread_specific_ptr<Counters> m_threadCounters;
+
+  Counters &AddThread();
+};
+
+}
+
@@ -7,19 +7,31 @@
 #include <iostream>
 #include <sstream>
 #include <algorithm>
-#include <boost/foreach.hpp>
+#include <cstring>
 #include "HypothesisColl.h"
 #include "ManagerBase.h"
 #include "System.h"
-#include "MemPoolAllocator.h"
 
 using namespace std;
 
 namespace Moses2
 {
 
+namespace
+{
+struct SlotFutureScoreOrderer {
+  template<typename T>
+  bool operator()(const T &a, const T &b) const {
+    return a.futureScore > b.futureScore;
+  }
+};
+}
+
 HypothesisColl::HypothesisColl(const ManagerBase &mgr)
-  :m_coll(MemPoolAllocator<const HypothesisBase*>(mgr.GetPool()))
+  :m_pool(mgr.GetPool())
+  ,m_slots(NULL)
+  ,m_capacity(0)
+  ,m_size(0)
   ,m_sortedHypos(NULL)
 {
   m_bestScore = -std::numeric_limits<float>::infinity();
@@ -36,11 +48,12 @@ const HypothesisBase *HypothesisColl::GetBestHypo() const
   }
 
   SCORE bestScore = -std::numeric_limits<SCORE>::infinity();
-  const HypothesisBase *bestHypo;
-  BOOST_FOREACH(const HypothesisBase *hypo, m_coll) {
-    if (hypo->GetFutureScore() > bestScore) {
-      bestScore = hypo->GetFutureScore();
-      bestHypo = hypo;
+  const HypothesisBase *bestHypo = NULL;
+  for (size_t i = 0; i < m_capacity; ++i) {
+    const Slot &slot = m_slots[i];
+    if (slot.hypo && (bestHypo == NULL || slot.futureScore > bestScore)) {
+      bestScore = slot.futureScore;
+      bestHypo = slot.hypo;
     }
   }
   return bestHypo;
@@ -52,7 +65,7 @@ void HypothesisColl::Add(
   Recycler<HypothesisBase*> &hypoRecycle,
   ArcLists &arcLists)
 {
-  size_t maxStackSize = mgr.system.options.search.stack_size;
+  size_t maxStackSize = mgr.GetStackSize();
 
   if (GetSize() > maxStackSize * 2) {
     //cerr << "maxStackSize=" << maxStackSize << " " << GetSize() << endl;
@@ -107,59 +120,84 @@ void HypothesisColl::Add(
 
 StackAdd HypothesisColl::Add(const HypothesisBase *hypo)
 {
-  std::pair<_HCType::iterator, bool> addRet = m_coll.insert(hypo);
-  //cerr << endl << "new=" << hypo->Debug(hypo->GetManager().system) << endl;
+  if (2 * (m_size + 1) > m_capacity) {
+    Grow();
+  }
+
+  size_t hash = hypo->hash();
+  SCORE futureScore = hypo->GetFutureScore();
+  Slot *slot = FindSlot(hash);
 
   // CHECK RECOMBINATION
-  if (addRet.second) {
+  if (slot->hypo == NULL) {
     // equiv hypo doesn't exists
-    //cerr << "Added " << hypo << endl;
+    slot->hash = hash;
+    slot->futureScore = futureScore;
+    slot->hypo = hypo;
+    ++m_size;
     return StackAdd(true, NULL);
+  }
+
+  HypothesisBase *hypoExisting = const_cast<HypothesisBase*>(slot->hypo);
+  if (futureScore > slot->futureScore) {
+    // incoming hypo is better than the one we have
+    slot->futureScore = futureScore;
+    slot->hypo = hypo;
+    return StackAdd(true, hypoExisting);
   } else {
-    HypothesisBase *hypoExisting = const_cast<HypothesisBase*>(*addRet.first);
-    //cerr << "hypoExisting=" << hypoExisting->Debug(hypo->GetManager().system) << endl;
-
-    if (hypo->GetFutureScore() > hypoExisting->GetFutureScore()) {
-      // incoming hypo is better than the one we have
-  	  //cerr << "Add " << hypo << "(" << hypo->hash() << ")"
-	  //	  << " discard existing " << hypoExisting << "(" << hypoExisting->hash() << ")"
-	  //	  << endl;
-
-      const HypothesisBase * const &hypoExisting1 = *addRet.first;
-      const HypothesisBase *&hypoExisting2 =
-        const_cast<const HypothesisBase *&>(hypoExisting1);
-      hypoExisting2 = hypo;
-
-      /*
-      Delete(hypoExisting);
-      addRet = m_coll.insert(hypo);
-      UTIL_THROW_IF2(!addRet.second, "couldn't insert hypo "
-      		  	  	  << hypo << "(" << hypo->hash() << ")");
-      */
-      /*
-      if (!addRet.second) {
-    	  cerr << "couldn't insert hypo " << hypo << "(" << hypo->hash() << ")" << endl;
-    	  cerr << "m_coll=";
-    	  for (_HCType::const_iterator iter = m_coll.begin(); iter != m_coll.end(); ++iter) {
-    		  const HypothesisBase *h = *iter;
-    		  cerr << h << "(" << h->hash() << ") ";
-    	  }
-    	  cerr << endl;
-    	  abort();
-      }
-	  */
+    // already storing the best hypo. discard incoming hypo
+    return StackAdd(false, hypoExisting);
+  }
+}
 
-      return StackAdd(true, hypoExisting);
-    } else {
-      // already storing the best hypo. discard incoming hypo
-      //cerr << "Keep existing " << hypoExisting << "(" << hypoExisting->hash() << ")"
-      //		  << " discard new " << hypo << "(" << hypo->hash() << ")"
-	  //		  << endl;
-      return StackAdd(false, hypoExisting);
+HypothesisColl::Slot *HypothesisColl::FindSlot(size_t hash) const
+{
+  size_t mask = m_capacity - 1;
+  size_t ind = GetSlotInd(hash);
+  while (m_slots[ind].hypo && m_slots[ind].hash != hash) {
+    ind = (ind + 1) & mask;
+  }
+  return m_slots + ind;
+}
+
+void HypothesisColl::Insert(const Slot &slot)
+{
+  *FindSlot(slot.hash) = slot;
+  ++m_size;
+}
+
+void HypothesisColl::Grow()
+{
+  Slot *oldSlots = m_slots;
+  size_t oldCapacity = m_capacity;
+
+  m_capacity = oldCapacity ? oldCapacity * 2 : 64;
+  m_slots = m_pool.Allocate<Slot>(m_capacity);
+  memset(m_slots, 0, m_capacity * sizeof(Slot));
+
+  m_size = 0;
+  for (size_t i = 0; i < oldCapacity; ++i) {
+    if (oldSlots[i].hypo) {
+      Insert(oldSlots[i]);
+    }
+  }
+  m_pool.Free(oldSlots, oldCapacity * sizeof(Slot));
+}
+
+size_t HypothesisColl::SelectBest(Slot *slots, size_t num) const
+{
+  size_t size = 0;
+  for (size_t i = 0; i < m_capacity; ++i) {
+    if (m_slots[i].hypo) {
+      slots[size++] = m_slots[i];
     }
   }
 
-  //assert(false);
+  if (num && num < size) {
+    // slots[num - 1] is the num-th best, the ones before it are no worse
+    std::nth_element(slots, slots + num - 1, slots + size, SlotFutureScoreOrderer());
+  }
+  return size;
 }
 
 const Hypotheses &HypothesisColl::GetSortedAndPrunedHypos(
@@ -170,14 +208,14 @@ const Hypotheses &HypothesisColl::GetSortedAndPrunedHypos(
     // create sortedHypos first
     MemPool &pool = mgr.GetPool();
     m_sortedHypos = new (pool.Allocate<Hypotheses>()) Hypotheses(pool,
-        m_coll.size());
+        GetSize());
 
     SortHypos(mgr, m_sortedHypos->GetArray());
 
     // prune
     Recycler<HypothesisBase*> &recycler = mgr.GetHypoRecycle();
 
-    size_t maxStackSize = mgr.system.options.search.stack_size;
+    size_t maxStackSize = mgr.GetStackSize();
     if (maxStackSize && m_sortedHypos->size() > maxStackSize) {
       for (size_t i = maxStackSize; i < m_sortedHypos->size(); ++i) {
         HypothesisBase *hypo = const_cast<HypothesisBase*>((*m_sortedHypos)[i]);
@@ -198,28 +236,32 @@ const Hypotheses &HypothesisColl::GetSortedAndPrunedHypos(
 
 void HypothesisColl::PruneHypos(const ManagerBase &mgr, ArcLists &arcLists)
 {
-  size_t maxStackSize = mgr.system.options.search.stack_size;
+  size_t maxStackSize = mgr.GetStackSize();
 
   Recycler<HypothesisBase*> &recycler = mgr.GetHypoRecycle();
 
-  const HypothesisBase **sortedHypos = (const HypothesisBase **) alloca(GetSize() * sizeof(const HypothesisBase *));
-  SortHypos(mgr, sortedHypos);
+  Slot *slots = (Slot*) alloca(GetSize() * sizeof(Slot));
+  size_t size = SelectBest(slots, maxStackSize);
 
   // update worse score
-  m_worstScore = sortedHypos[maxStackSize - 1]->GetFutureScore();
+  m_worstScore = slots[maxStackSize - 1].futureScore;
+
+  // rebuild the table with the hypos that are kept
+  memset(m_slots, 0, m_capacity * sizeof(Slot));
+  m_size = 0;
+  for (size_t i = 0; i < maxStackSize; ++i) {
+    Insert(slots[i]);
+  }
 
   // prune
-  for (size_t i = maxStackSize; i < GetSize(); ++i) {
-    HypothesisBase *hypo = const_cast<HypothesisBase*>(sortedHypos[i]);
+  for (size_t i = maxStackSize; i < size; ++i) {
+    HypothesisBase *hypo = const_cast<HypothesisBase*>(slots[i].hypo);
 
     // delete from arclist
     if (mgr.system.options.nbest.nbest_size) {
       arcLists.Delete(hypo);
     }
 
-    // delete from collection
-    Delete(hypo);
-
     recycler.Recycle(hypo);
   }
 
@@ -227,23 +269,8 @@ void HypothesisColl::PruneHypos(const ManagerBase &mgr, ArcLists &arcLists)
 
 void HypothesisColl::SortHypos(const ManagerBase &mgr, const HypothesisBase **sortedHypos) const
 {
-  size_t maxStackSize = mgr.system.options.search.stack_size;
+  size_t maxStackSize = mgr.GetStackSize();
   //assert(maxStackSize); // can't do stack=0 - unlimited stack size. No-one ever uses that
-  //assert(GetSize() > maxStackSize);
-  //assert(sortedHypos.size() == GetSize());
-
-  /*
-   cerr << "UNSORTED hypos: ";
-   BOOST_FOREACH(const HypothesisBase *hypo, m_coll) {
-     cerr << hypo << "(" << hypo->GetFutureScore() << ")" << " ";
-   }
-   cerr << endl;
-   */
-  size_t ind = 0;
-  BOOST_FOREACH(const HypothesisBase *hypo, m_coll) {
-    sortedHypos[ind] = hypo;
-    ++ind;
-  }
 
   size_t indMiddle;
   if (maxStackSize == 0) {
@@ -255,37 +282,50 @@ void HypothesisColl::SortHypos(const ManagerBase &mgr, const HypothesisBase **so
     indMiddle = GetSize();
   }
 
-  const HypothesisBase **iterMiddle = sortedHypos + indMiddle;
-
-  std::partial_sort(
-    sortedHypos,
-    iterMiddle,
-    sortedHypos + GetSize(),
-    HypothesisFutureScoreOrderer());
+  // only the hypos that survive pruning need to be in order
+  Slot *slots = (Slot*) alloca(GetSize() * sizeof(Slot));
+  size_t size = SelectBest(slots, indMiddle);
+  std::sort(slots, slots + indMiddle, SlotFutureScoreOrderer());
 
-  /*
-   cerr << "sorted hypos: ";
-   for (size_t i = 0; i < sortedHypos.size(); ++i) {
-     const HypothesisBase *hypo = sortedHypos[i];
-     cerr << hypo << " ";
-   }
-   cerr << endl;
-   */
+  for (size_t i = 0; i < size; ++i) {
+    sortedHypos[i] = slots[i].hypo;
+  }
 }
 
 void HypothesisColl::Delete(const HypothesisBase *hypo)
 {
-  //cerr << " Delete hypo=" << hypo << "(" << hypo->hash() << ")"
-  //		<< " m_coll=" << m_coll.size() << endl;
+  Slot *slot = m_capacity ? FindSlot(hypo->hash()) : NULL;
+  UTIL_THROW_IF2(slot == NULL || slot->hypo != hypo, "couldn't erase hypo " << hypo);
+
+  // shift back the slots that probed past this one, so no probe sequence
+  // runs into the gap
+  size_t mask = m_capacity - 1;
+  size_t ind = slot - m_slots;
+  size_t next = ind;
+  while (true) {
+    next = (next + 1) & mask;
+    if (m_slots[next].hypo == NULL) {
+      break;
+    }
 
-  size_t erased = m_coll.erase(hypo);
-  UTIL_THROW_IF2(erased != 1, "couldn't erase hypo " << hypo);
+    size_t home = GetSlotInd(m_slots[next].hash);
+    bool reachable = ind <= next ? (ind < home && home <= next) : (ind < home || home <= next);
+    if (!reachable) {
+      m_slots[ind] = m_slots[next];
+      ind = next;
+    }
+  }
+  m_slots[ind].hypo = NULL;
+  --m_size;
 }
 
 void HypothesisColl::Clear()
 {
   m_sortedHypos = NULL;
-  m_coll.clear();
+  if (m_size) {
+    memset(m_slots, 0, m_capacity * sizeof(Slot));
+    m_size = 0;
+  }
 
   m_bestScore = -std::numeric_limits<float>::infinity();
   m_worstScore = std::numeric_limits<float>::infinity();
@@ -294,9 +334,11 @@ void HypothesisColl::Clear()
 std::string HypothesisColl::Debug(const System &system) const
 {
   stringstream out;
-  BOOST_FOREACH (const HypothesisBase *hypo, m_coll) {
-    out << hypo->Debug(system);
-    out << std::endl << std::endl;
+  for (size_t i = 0; i < m_capacity; ++i) {
+    if (m_slots[i].hypo) {
+      out << m_slots[i].hypo->Debug(system);
+      out << std::endl << std::endl;
+    }
   }
 
   return out.str();
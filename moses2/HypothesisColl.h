@@ -5,9 +5,7 @@
  *      Author: hieu
  */
 #pragma once
-#include <boost/unordered_set.hpp>
 #include "HypothesisBase.h"
-#include "MemPoolAllocator.h"
 #include "Recycler.h"
 #include "Array.h"
 #include "legacy/Util2.h"
@@ -32,7 +30,7 @@ public:
            ArcLists &arcLists);
 
   size_t GetSize() const {
-    return m_coll.size();
+    return m_size;
   }
 
   void Clear();
@@ -54,11 +52,20 @@ public:
   std::string Debug(const System &system) const;
 
 protected:
-  typedef boost::unordered_set<const HypothesisBase*,
-		  UnorderedComparer<HypothesisBase>, UnorderedComparer<HypothesisBase>,
-          MemPoolAllocator<const HypothesisBase*> > _HCType;
+  // Recombination table. Open addressing with linear probing over a flat
+  // array, so a probe doesn't touch the hypo or its FF states.
+  // As before, hypos with the same state hash are recombined.
+  struct Slot {
+    size_t hash;
+    SCORE futureScore;
+    const HypothesisBase *hypo; // NULL if empty
+  };
+
+  MemPool &m_pool;
+  Slot *m_slots;
+  size_t m_capacity; // power of 2, or 0 before the first hypo
+  size_t m_size;
 
-  _HCType m_coll;
   mutable Hypotheses *m_sortedHypos;
 
   SCORE m_bestScore;
@@ -66,6 +73,18 @@ protected:
 
   StackAdd Add(const HypothesisBase *hypo);
 
+  size_t GetSlotInd(size_t hash) const {
+    // state hashes are often poor in the low bits
+    return (hash * 0x9E3779B97F4A7C15ULL >> 32) & (m_capacity - 1);
+  }
+  Slot *FindSlot(size_t hash) const;
+  void Insert(const Slot &slot);
+  void Grow();
+
+  // copy the occupied slots to 'slots', best 'num' hypos first, the rest
+  // in any order. Return the number of slots copied
+  size_t SelectBest(Slot *slots, size_t num) const;
+
   void PruneHypos(const ManagerBase &mgr, ArcLists &arcLists);
   void SortHypos(const ManagerBase &mgr, const HypothesisBase **sortedHypos) const;
 
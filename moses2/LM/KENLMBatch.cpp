@@ -84,7 +84,10 @@ private:
 /////////////////////////////////////////////////////////////////
 KENLMBatch::KENLMBatch(size_t startInd, const std::string &line)
   :StatefulFeatureFunction(startInd, line)
+  ,m_batchSize(10000)
+  ,m_batchWait(1000)
   ,m_numHypos(0)
+  ,m_processing(false)
 {
   cerr << "KENLMBatch::KENLMBatch" << endl;
   ReadParameters();
@@ -303,6 +306,10 @@ void KENLMBatch::SetParameter(const std::string& key,
     m_load_method =
       boost::lexical_cast<bool>(value) ?
       util::LAZY : util::POPULATE_OR_READ;
+  } else if (key == "batch-size") {
+    m_batchSize = Scan<size_t>(value);
+  } else if (key == "batch-wait") {
+    m_batchWait = Scan<size_t>(value);
   } else if (key == "load") {
     if (value == "lazy") {
       m_load_method = util::LAZY;
@@ -314,6 +321,8 @@ void KENLMBatch::SetParameter(const std::string& key,
       m_load_method = util::READ;
     } else if (value == "parallel_read") {
       m_load_method = util::PARALLEL_READ;
+    } else if (value == "interleave") {
+      m_load_method = util::READ_INTERLEAVE;
     } else {
       UTIL_THROW2("Unknown KenLM load method " << value);
     }
@@ -325,38 +334,162 @@ void KENLMBatch::SetParameter(const std::string& key,
 }
 
 void KENLMBatch::EvaluateWhenAppliedBatch(
+  const System &system,
   const Batch &batch) const
 {
-  {
-    // write lock
-    boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
-    m_batches.push_back(&batch);
-    m_numHypos += batch.size();
-  }
-  //cerr << "m_numHypos=" << m_numHypos << endl;
+  PendingBatch pending;
+  pending.batch = &batch;
+  pending.done = false;
+
+  boost::unique_lock<boost::mutex> lock(m_mutex);
+  m_batches.push_back(&pending);
+  m_numHypos += batch.size();
+
+  // wake up threads already waiting. The batch may now be big enough
+  m_threadNeeded.notify_all();
 
-  if (m_numHypos > 0) {
-    // process batch
-    EvaluateWhenAppliedBatch();
+  boost::system_time deadline = boost::get_system_time()
+                                + boost::posix_time::microseconds(m_batchWait);
 
-    m_batches.clear();
+  while (!pending.done) {
+    if (m_processing) {
+      // another thread is scoring. Our batch is either in it or next in line
+      m_threadNeeded.wait(lock);
+      continue;
+    }
+
+    bool full = m_numHypos >= m_batchSize
+                || m_batches.size() >= system.options.server.numThreads;
+    if (!full && boost::get_system_time() < deadline) {
+      m_threadNeeded.timed_wait(lock, deadline);
+      continue;
+    }
+
+    // this thread flushes everything that is waiting, including batches of
+    // other threads
+    std::vector<PendingBatch*> batches;
+    batches.swap(m_batches);
     m_numHypos = 0;
+    m_processing = true;
+
+    lock.unlock();
+    EvaluateWhenAppliedBatch(system, batches);
+    lock.lock();
 
+    BOOST_FOREACH(PendingBatch *other, batches) {
+      other->done = true;
+    }
+    m_processing = false;
     m_threadNeeded.notify_all();
-  } else {
-    boost::mutex::scoped_lock lock(m_mutex);
-    m_threadNeeded.wait(lock);
   }
 }
 
-void KENLMBatch::EvaluateWhenAppliedBatch() const
+void KENLMBatch::EvaluateWhenAppliedBatch(const System &system,
+    const std::vector<PendingBatch*> &batches) const
 {
-  BOOST_FOREACH(const Batch *batch, m_batches) {
-    //cerr << "batch=" << batch->size() << endl;
-    BOOST_FOREACH(Hypothesis *hypo, *batch) {
-      hypo->EvaluateWhenApplied(*this);
+  size_t statefulInd = GetStatefulInd();
+
+  // set up a cursor for each hypo with something to score
+  m_cursors.clear();
+  BOOST_FOREACH(const PendingBatch *pending, batches) {
+    BOOST_FOREACH(Hypothesis *hypo, *pending->batch) {
+      const lm::ngram::State &in_state =
+        static_cast<const KenLMState*>(hypo->GetPrevHypo()->GetState(statefulInd))->state;
+
+      if (!hypo->GetTargetPhrase().GetSize()) {
+        static_cast<KenLMState*>(hypo->GetState(statefulInd))->state = in_state;
+        continue;
+      }
+
+      const std::size_t begin = hypo->GetCurrTargetWordsRange().GetStartPos();
+      const std::size_t end = hypo->GetCurrTargetWordsRange().GetEndPos() + 1;
+
+      Cursor cursor;
+      cursor.hypo = hypo;
+      cursor.state = in_state;
+      cursor.pos = begin;
+      cursor.end = std::min(end, begin + m_ngram->Order() - 1);
+      cursor.score = 0;
+      m_cursors.push_back(cursor);
+    }
+  }
+
+  // score word by word, in lockstep across all hypos. Hypos which extend the
+  // same prefix ask identical questions so sort by context and only look up
+  // each distinct (context, word) pair once. The distinct lookups are
+  // independent so the model can prefetch them
+  while (true) {
+    m_queries.clear();
+    for (size_t i = 0; i < m_cursors.size(); ++i) {
+      Cursor &cursor = m_cursors[i];
+      if (cursor.pos < cursor.end) {
+        Query query;
+        query.context = &cursor.state;
+        query.word = TranslateID(cursor.hypo->GetWord(cursor.pos));
+        query.cursor = i;
+        m_queries.push_back(query);
+      }
+    }
+    if (m_queries.empty()) {
+      break;
+    }
+
+    std::sort(m_queries.begin(), m_queries.end(), QueryOrderer());
+
+    // one lookup per distinct (context, word) pair. m_groups[i] is the index
+    // of the first query answered by lookup i
+    m_contexts.clear();
+    m_words.clear();
+    m_groups.clear();
+    for (size_t i = 0; i < m_queries.size(); ++i) {
+      const Query &query = m_queries[i];
+      if (i == 0 || query.word != m_words.back() || !(*query.context == m_contexts.back())) {
+        m_contexts.push_back(*query.context);
+        m_words.push_back(query.word);
+        m_groups.push_back(i);
+      }
+    }
+    m_groups.push_back(m_queries.size());
+
+    m_outStates.resize(m_contexts.size());
+    m_rets.resize(m_contexts.size());
+    m_ngram->FullScoreBatch(&m_contexts.front(), &m_words.front(), m_contexts.size(),
+                            &m_outStates.front(), &m_rets.front());
+
+    for (size_t group = 0; group < m_contexts.size(); ++group) {
+      for (size_t i = m_groups[group]; i < m_groups[group + 1]; ++i) {
+        Cursor &cursor = m_cursors[m_queries[i].cursor];
+        cursor.score += m_rets[group].prob;
+        cursor.state = m_outStates[group];
+        ++cursor.pos;
+      }
     }
   }
+
+  // finish off each hypo the same way as KENLM::EvaluateWhenApplied()
+  std::vector<lm::WordIndex> indices(m_ngram->Order() - 1);
+  BOOST_FOREACH(Cursor &cursor, m_cursors) {
+    Hypothesis &hypo = *cursor.hypo;
+    lm::ngram::State &state = static_cast<KenLMState*>(hypo.GetState(statefulInd))->state;
+    float score = cursor.score;
+
+    const std::size_t end = hypo.GetCurrTargetWordsRange().GetEndPos() + 1;
+    if (hypo.GetBitmap().IsComplete()) {
+      // Score end of sentence.
+      const lm::WordIndex *last = LastIDs(hypo, &indices.front());
+      score += m_ngram->FullScoreForgotState(&indices.front(), last,
+                                             m_ngram->GetVocabulary().EndSentence(), state).prob;
+    } else if (cursor.end < end) {
+      // Get state after adding a long phrase.
+      const lm::WordIndex *last = LastIDs(hypo, &indices.front());
+      m_ngram->GetState(&indices.front(), last, state);
+    } else {
+      state = cursor.state;
+    }
+
+    score = TransformLMScore(score);
+    hypo.GetScores().PlusEquals(system, *this, score);
+  }
 }
 
 void KENLMBatch::EvaluateWhenApplied(const SCFG::Manager &mgr,
@@ -61,7 +61,10 @@ public:
                                    const SCFG::Hypothesis &hypo, int featureID, Scores &scores,
                                    FFState &state) const;
 
+  // Called concurrently by every decoding thread. Batches from all threads are
+  // pooled and scored together by whichever thread is elected to flush them
   virtual void EvaluateWhenAppliedBatch(
+    const System &system,
     const Batch &batch) const;
 
 protected:
@@ -87,15 +90,54 @@ protected:
   std::vector<lm::WordIndex> m_lmIdLookup;
 
   // batch
-  mutable std::vector<const Batch*> m_batches;
+  struct PendingBatch {
+    const Batch *batch;
+    bool done;
+  };
+
+  // a hypothesis which is being scored one word at a time
+  struct Cursor {
+    Hypothesis *hypo;
+    lm::ngram::State state;
+    size_t pos, end;
+    float score;
+  };
+
+  // one n-gram lookup. context points into the Cursor which asked for it
+  struct Query {
+    const lm::ngram::State *context;
+    lm::WordIndex word;
+    size_t cursor;
+  };
+
+  struct QueryOrderer {
+    bool operator()(const Query &a, const Query &b) const {
+      int cmp = a.context->Compare(*b.context);
+      if (cmp) return cmp < 0;
+      return a.word < b.word;
+    }
+  };
+
+  size_t m_batchSize; // flush once this many hypos are waiting
+  size_t m_batchWait; // max microseconds a thread waits for others to join
+
+  mutable std::vector<PendingBatch*> m_batches;
   mutable size_t m_numHypos;
-
-  mutable boost::shared_mutex m_accessLock;
+  mutable bool m_processing;
 
   mutable boost::mutex m_mutex;
   mutable boost::condition_variable m_threadNeeded;
 
-  void EvaluateWhenAppliedBatch() const;
+  // scratch space, only used by the thread which is flushing
+  mutable std::vector<Cursor> m_cursors;
+  mutable std::vector<Query> m_queries;
+  mutable std::vector<lm::ngram::State> m_contexts, m_outStates;
+  mutable std::vector<lm::WordIndex> m_words;
+  mutable std::vector<lm::FullScoreReturn> m_rets;
+  mutable std::vector<size_t> m_groups;
+
+  void EvaluateWhenAppliedBatch(const System &system,
+                                const std::vector<PendingBatch*> &batches) const;
 
 };
 
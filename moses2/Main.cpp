@@ -1,5 +1,8 @@
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <memory>
+#include <vector>
 #include <boost/pool/pool_alloc.hpp>
 #include "Main.h"
 #include "System.h"
@@ -15,6 +18,10 @@
 #include "legacy/ThreadPool.h"
 #include "legacy/Timer.h"
 #include "legacy/Util2.h"
+#include "util/file.hh"
+#include "util/mmap.hh"
+#include "util/read_compressed.hh"
+#include "util/string_piece.hh"
 #include "util/usage.hh"
 
 using namespace std;
@@ -85,21 +92,208 @@ istream &GetInputStream(Moses2::Parameter &params)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////
 
+namespace
+{
+template<typename Str>
+struct PendingLine {
+  Str line;
+  long translationId;
+  size_t numTokens;
+};
+
+// longest first. Ties keep input order
+template<typename Line>
+bool LongerThan(const Line *a, const Line *b)
+{
+  if (a->numTokens != b->numTokens) {
+    return a->numTokens > b->numTokens;
+  }
+  return a->translationId < b->translationId;
+}
+
+size_t CountTokens(const StringPiece &line)
+{
+  size_t ret = 0;
+  bool inToken = false;
+  for (size_t i = 0; i < line.size(); ++i) {
+    bool space = (line[i] == ' ' || line[i] == '\t');
+    if (!space && !inToken) {
+      ++ret;
+    }
+    inToken = !space;
+  }
+  return ret;
+}
+
+void SubmitLongestFirst(Moses2::System& system, Moses2::ThreadPool& pool,
+                        std::vector<PendingLine<std::string> > &window)
+{
+  std::vector<PendingLine<std::string>*> order(window.size());
+  for (size_t i = 0; i < window.size(); ++i) {
+    order[i] = &window[i];
+  }
+  std::sort(order.begin(), order.end(), LongerThan<PendingLine<std::string> >);
+
+  for (size_t i = 0; i < order.size(); ++i) {
+    boost::shared_ptr<Moses2::TranslationTask> task(new Moses2::TranslationTask(system, order[i]->line, order[i]->translationId));
+    pool.Submit(task);
+  }
+  window.clear();
+}
+
+// As above, but the lines point into the mmap'd input and are packed into
+// tasks of about chunkTokens tokens. After sorting, short lines share a task
+// while a long line usually gets one to itself. Without longestFirst the
+// lines keep input order
+void SubmitChunks(Moses2::System& system, Moses2::ThreadPool& pool,
+                  std::vector<PendingLine<StringPiece> > &window, size_t chunkTokens,
+                  bool longestFirst)
+{
+  std::vector<PendingLine<StringPiece>*> order(window.size());
+  for (size_t i = 0; i < window.size(); ++i) {
+    order[i] = &window[i];
+  }
+  if (longestFirst) {
+    std::sort(order.begin(), order.end(), LongerThan<PendingLine<StringPiece> >);
+  }
+
+  boost::shared_ptr<Moses2::TranslationTaskChunk> chunk;
+  size_t numTokens = 0;
+  for (size_t i = 0; i < order.size(); ++i) {
+    if (!chunk) {
+      chunk.reset(new Moses2::TranslationTaskChunk(system));
+      numTokens = 0;
+    }
+    chunk->Add(order[i]->line, order[i]->translationId);
+    numTokens += order[i]->numTokens + 1;
+
+    if (numTokens >= chunkTokens) {
+      pool.Submit(chunk);
+      chunk.reset();
+    }
+  }
+  if (chunk) {
+    pool.Submit(chunk);
+  }
+  window.clear();
+}
+
+// The mmap reader sees raw bytes, so compressed input has to go through
+// InputFileStream. Check the extension and, like util::ReadCompressed, the
+// magic bytes
+bool IsCompressed(const std::string &path)
+{
+  static const char *const kExtensions[] = {".gz", ".bz2", ".xz"};
+  for (size_t i = 0; i < sizeof(kExtensions) / sizeof(kExtensions[0]); ++i) {
+    if (StringPiece(path).ends_with(kExtensions[i])) {
+      return true;
+    }
+  }
+
+  util::scoped_fd file(util::OpenReadOrThrow(path.c_str()));
+  char magic[util::ReadCompressed::kMagicSize];
+  std::size_t got = util::ReadOrEOF(file.get(), magic, sizeof(magic));
+  return got == sizeof(magic) && util::ReadCompressed::DetectCompressedMagic(magic);
+}
+
+// -input-mmap. Map the whole input file instead of reading it line by line.
+// The mapping lives until every task has finished
+void batch_run_mmap(Moses2::Parameter& params, Moses2::System& system, Moses2::ThreadPool& pool,
+                    const std::string &path, size_t reorderWindow)
+{
+  size_t chunkTokens;
+  params.SetParameter(chunkTokens, "input-chunk-tokens", size_t(200));
+
+  util::scoped_fd file(util::OpenReadOrThrow(path.c_str()));
+  uint64_t size = util::SizeOrThrow(file.get());
+  util::scoped_memory mem;
+  if (size) {
+    util::MapRead(util::POPULATE_OR_LAZY, file.get(), 0, size, mem);
+  }
+
+  // With reordering off there is no window, so collect about one chunk of
+  // lines at a time rather than submitting every line as its own task
+  const bool longestFirst = reorderWindow > 1;
+  std::vector<PendingLine<StringPiece> > window;
+  window.reserve(std::max<size_t>(reorderWindow, 1));
+  size_t windowTokens = 0;
+
+  long translationId = 0;
+  const char *begin = mem.begin();
+  const char *end = begin + size;
+  while (begin < end) {
+    const char *newline = static_cast<const char*>(memchr(begin, '\n', end - begin));
+    if (newline == NULL) {
+      newline = end;
+    }
+
+    PendingLine<StringPiece> pending;
+    pending.line = StringPiece(begin, newline - begin);
+    pending.translationId = translationId++;
+    pending.numTokens = CountTokens(pending.line);
+    window.push_back(pending);
+    windowTokens += pending.numTokens + 1;
+
+    if (longestFirst ? window.size() >= reorderWindow : windowTokens >= chunkTokens) {
+      SubmitChunks(system, pool, window, chunkTokens, longestFirst);
+      windowTokens = 0;
+    }
+    begin = newline + 1;
+  }
+  SubmitChunks(system, pool, window, chunkTokens, longestFirst);
+
+  pool.Stop(true);
+}
+}
+
 void batch_run(Moses2::Parameter& params, Moses2::System& system, Moses2::ThreadPool& pool)
 {
+    // Long sentences that start last set the finishing time, so read a window
+    // of lines and submit the longest first. The window bounds how far ahead
+    // of the output position we can get, and so the OutputCollector backlog.
+    // 0 or 1 submits in input order
+    size_t reorderWindow;
+    params.SetParameter(reorderWindow, "input-reorder-window", size_t(pool.GetNumThreads() * 4));
+
+    const Moses2::PARAM_VEC *inputFile = params.GetParam("input-file");
+    if (params.GetParam("input-mmap") && inputFile && inputFile->size()) {
+      if (!IsCompressed(inputFile->at(0))) {
+        batch_run_mmap(params, system, pool, inputFile->at(0), reorderWindow);
+        return;
+      }
+      cerr << "input-mmap: " << inputFile->at(0)
+           << " is compressed, reading it line by line instead" << endl;
+    }
+
     istream& inStream = GetInputStream(params);
 
+    std::vector<PendingLine<std::string> > window;
+    window.reserve(reorderWindow);
+
     long translationId = 0;
     string line;
     while (getline(inStream, line)) {
         //cerr << "line=" << line << endl;
-        boost::shared_ptr<Moses2::TranslationTask> task(new Moses2::TranslationTask(system, line, translationId));
+        if (reorderWindow <= 1) {
+          boost::shared_ptr<Moses2::TranslationTask> task(new Moses2::TranslationTask(system, line, translationId));
+
+          //cerr << "START pool.Submit()" << endl;
+          pool.Submit(task);
+          //task->Run();
+        } else {
+          PendingLine<std::string> pending;
+          pending.line = line;
+          pending.translationId = translationId;
+          pending.numTokens = CountTokens(line);
+          window.push_back(pending);
 
-        //cerr << "START pool.Submit()" << endl;
-        pool.Submit(task);
-        //task->Run();
+          if (window.size() >= reorderWindow) {
+            SubmitLongestFirst(system, pool, window);
+          }
+        }
         ++translationId;
     }
+    SubmitLongestFirst(system, pool, window);
 
     pool.Stop(true);
 
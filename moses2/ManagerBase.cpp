@@ -5,6 +5,7 @@
  *      Author: hieu
  */
 #include <boost/foreach.hpp>
+#include <boost/thread.hpp>
 #include <vector>
 #include <sstream>
 #include "System.h"
@@ -20,6 +21,16 @@ using namespace std;
 
 namespace Moses2
 {
+namespace
+{
+void KeepWorkerPools(WorkerPools *)
+{
+}
+}
+
+boost::thread_specific_ptr<WorkerPools> ManagerBase::m_workerPools(&KeepWorkerPools);
+boost::thread_specific_ptr<size_t> ManagerBase::m_numPoolUsers;
+
 ManagerBase::ManagerBase(System &sys, const TranslationTask &task,
                          const std::string &inputStr, long translationId)
   :system(sys)
@@ -31,25 +42,60 @@ ManagerBase::ManagerBase(System &sys, const TranslationTask &task,
   ,m_hypoRecycle(NULL)
   ,m_input(NULL)
 {
+  m_deadline.SetBudget(system.options.search.deadline);
 }
 
 ManagerBase::~ManagerBase()
 {
-  system.featureFunctions.CleanUpAfterSentenceProcessing(*m_input);
+  if (m_input) {
+    // NULL if never decoded
+    system.featureFunctions.CleanUpAfterSentenceProcessing(*m_input);
+  }
 
-  if (m_pool) {
-    GetPool().Reset();
+  if (system.options.output.verbose >= 2 && m_deadline.GetNumDegradedSteps()) {
+    cerr << "Translation " << m_translationId << " deadline: "
+         << m_deadline.Debug() << endl;
   }
-  if (m_hypoRecycle) {
+
+  if (m_pool && --GetNumPoolUsers() == 0) {
+    MemPool &pool = GetPool();
+    pool.Reset();
+
+    if (system.memPoolStats && pool.GetStats().resets % system.memPoolStats == 0) {
+      cerr << "Thread " << boost::this_thread::get_id()
+           << " memory pool: " << pool.Debug() << endl;
+    }
+
     GetHypoRecycle().Clear();
   }
 }
 
+size_t ManagerBase::GetStackSize() const
+{
+  return m_deadline.GetStackSize(system.options.search.stack_size);
+}
+
+size_t ManagerBase::GetPopLimit() const
+{
+  return m_deadline.GetPopLimit(system.options.cube.pop_limit);
+}
+
 void ManagerBase::InitPools()
 {
   m_pool = &system.GetManagerPool();
   m_systemPool = &system.GetSystemPool();
   m_hypoRecycle = &system.GetHypoRecycler();
+  ++GetNumPoolUsers();
+}
+
+size_t &ManagerBase::GetNumPoolUsers()
+{
+  size_t *obj = m_numPoolUsers.get();
+  if (obj == NULL) {
+    obj = new size_t(0);
+    m_numPoolUsers.reset(obj);
+  }
+  return *obj;
 }
 
 }
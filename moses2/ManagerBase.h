@@ -11,11 +11,13 @@
 #include <cstddef>
 #include <string>
 #include <deque>
+#include <boost/thread/tss.hpp>
 #include "Phrase.h"
 #include "MemPool.h"
 #include "Recycler.h"
 #include "EstimatedScores.h"
 #include "ArcLists.h"
+#include "Deadline.h"
 #include "legacy/Bitmaps.h"
 
 namespace Moses2
@@ -30,6 +32,14 @@ class InputType;
 class OutputCollector;
 class HypothesisBase;
 
+// Pools of a thread that helps another thread decode its sentence. They
+// stand in for the helper's own pools while it works for that sentence.
+// See search-threads
+struct WorkerPools {
+  MemPool pool, systemPool;
+  Recycler<HypothesisBase*> hypoRecycle;
+};
+
 class ManagerBase
 {
 public:
@@ -46,16 +56,47 @@ public:
   virtual std::string OutputTransOpt() = 0;
 
   MemPool &GetPool() const {
-    return *m_pool;
+    WorkerPools *pools = m_workerPools.get();
+    return pools ? pools->pool : *m_pool;
   }
 
   MemPool &GetSystemPool() const {
-    return *m_systemPool;
+    WorkerPools *pools = m_workerPools.get();
+    return pools ? pools->systemPool : *m_systemPool;
   }
 
   Recycler<HypothesisBase*> &GetHypoRecycle() const {
-    return *m_hypoRecycle;
+    WorkerPools *pools = m_workerPools.get();
+    return pools ? pools->hypoRecycle : *m_hypoRecycle;
+  }
+
+  // while in scope, the calling thread allocates from 'pools'
+  class WorkerPoolsScope
+  {
+  public:
+    WorkerPoolsScope(WorkerPools &pools)
+      :m_prev(m_workerPools.get()) {
+      m_workerPools.reset(&pools);
+    }
+    ~WorkerPoolsScope() {
+      m_workerPools.reset(m_prev);
+    }
+  protected:
+    WorkerPools *m_prev;
+  };
+
+  // time budget of this sentence. Set from the deadline param, the server
+  // may change it before Decode()
+  Deadline &GetDeadline() {
+    return m_deadline;
   }
+  const Deadline &GetDeadline() const {
+    return m_deadline;
+  }
+
+  // stack size and cube pruning pop limit, after any cuts to meet the deadline
+  size_t GetStackSize() const;
+  size_t GetPopLimit() const;
 
   const InputType &GetInput() const {
     return *m_input;
@@ -69,10 +110,20 @@ protected:
   std::string m_inputStr;
   long m_translationId;
   InputType *m_input;
+  Deadline m_deadline;
 
   mutable MemPool *m_pool, *m_systemPool;
   mutable Recycler<HypothesisBase*> *m_hypoRecycle;
 
+  // not owned, the search that borrowed them gives them back to System
+  static boost::thread_specific_ptr<WorkerPools> m_workerPools;
+
+  // managers of this thread which use its pools. Several are alive at once
+  // when sentences are decoded together, see ManagerBatch. The pools are
+  // reset when the last of them goes
+  static boost::thread_specific_ptr<size_t> m_numPoolUsers;
+  static size_t &GetNumPoolUsers();
+
   void InitPools();
 
 };
@@ -6,6 +6,8 @@
  */
 
 #include <boost/foreach.hpp>
+#include <cstring>
+#include <sstream>
 #include "MemPool.h"
 #include "util/scoped.hh"
 #include "legacy/Util2.h"
@@ -28,12 +30,17 @@ MemPool::Page::~Page()
 }
 ////////////////////////////////////////////////////
 MemPool::MemPool(size_t initSize) :
-  m_currSize(initSize), m_currPage(0)
+  m_currSize(initSize), m_currPage(0), m_largeFreeMask(0),
+  m_intervalPeak(0), m_prevIntervalPeak(0)
 {
   Page *page = new Page(m_currSize);
   m_pages.push_back(page);
 
   current_ = page->mem;
+
+  memset(m_smallFree, 0, sizeof(m_smallFree));
+  memset(m_largeFree, 0, sizeof(m_largeFree));
+  memset(&m_stats, 0, sizeof(m_stats));
   //cerr << "new memory pool";
 }
 
@@ -71,10 +78,135 @@ uint8_t *MemPool::More(std::size_t size)
   }
 }
 
+uint8_t *MemPool::AllocateLarge(std::size_t size)
+{
+  // smallest class whose blocks are all big enough
+  size_t ind = 64 - __builtin_clzll(size - 1);
+  uint64_t mask = ind < kNumLargeClasses ? m_largeFreeMask >> ind << ind : 0;
+  if (mask == 0) {
+    return NULL;
+  }
+  ind = __builtin_ctzll(mask);
+
+  FreeBlock *block = m_largeFree[ind];
+  m_largeFree[ind] = block->next;
+  if (block->next == NULL) {
+    m_largeFreeMask &= ~(uint64_t(1) << ind);
+  }
+  ++m_stats.reused;
+
+  // put the rest back
+  uint8_t *ret = (uint8_t*) block;
+  if (block->size > size) {
+    Free(ret + size, block->size - size);
+  }
+  return ret;
+}
+
+void MemPool::Free(void *mem, std::size_t size)
+{
+  size = (size + 3) & 0xfffffffc;
+  if (size < sizeof(FreeBlock*)) {
+    return;
+  }
+  // sizes are only rounded to 4 bytes, so a block may not be aligned for
+  // the header's pointer. Leave those to the next Reset()
+  if ((uintptr_t) mem % sizeof(FreeBlock*)) {
+    return;
+  }
+
+  uint8_t *begin = (uint8_t*) mem;
+  bool found = false;
+  for (size_t i = 0; i <= m_currPage && !found; ++i) {
+    const Page &page = *m_pages[i];
+    found = page.mem <= begin && begin + size <= page.end;
+  }
+  if (!found) {
+    return;
+  }
+
+  FreeBlock *block = (FreeBlock*) mem;
+  if (size <= kMaxSmallSize) {
+    block->next = m_smallFree[size >> 2];
+    m_smallFree[size >> 2] = block;
+  } else {
+    size_t ind = 63 - __builtin_clzll(size);
+    block->next = m_largeFree[ind];
+    block->size = size;
+    m_largeFree[ind] = block;
+    m_largeFreeMask |= uint64_t(1) << ind;
+  }
+}
+
 void MemPool::Reset()
 {
+  size_t used = Used();
+  m_stats.peakBytes = std::max(m_stats.peakBytes, used);
+  m_intervalPeak = std::max(m_intervalPeak, used);
+  ++m_stats.resets;
+
   m_currPage = 0;
   current_ = m_pages[0]->mem;
+
+  memset(m_smallFree, 0, sizeof(m_smallFree));
+  memset(m_largeFree, 0, sizeof(m_largeFree));
+  m_largeFreeMask = 0;
+
+  if (m_stats.resets % kTrimInterval == 0) {
+    // keep enough for the biggest sentence of the last 2 intervals
+    Trim(std::max(m_intervalPeak, m_prevIntervalPeak));
+    m_prevIntervalPeak = m_intervalPeak;
+    m_intervalPeak = 0;
+  }
+}
+
+size_t MemPool::Used() const
+{
+  size_t ret = current_ - m_pages[m_currPage]->mem;
+  for (size_t i = 0; i < m_currPage; ++i) {
+    ret += m_pages[i]->size;
+  }
+  return ret;
+}
+
+void MemPool::Trim(size_t keepBytes)
+{
+  size_t numPages = 1;
+  size_t capacity = m_pages[0]->size;
+  while (numPages < m_pages.size() && capacity < keepBytes) {
+    capacity += m_pages[numPages]->size;
+    ++numPages;
+  }
+
+  while (m_pages.size() > numPages) {
+    delete m_pages.back();
+    m_pages.pop_back();
+    ++m_stats.trimmedPages;
+  }
+
+  // grow from the last page again, not from the size of the trimmed ones
+  m_currSize = std::min(m_currSize, m_pages.back()->size);
+}
+
+size_t MemPool::Capacity() const
+{
+  size_t ret = 0;
+  for (size_t i = 0; i < m_pages.size(); ++i) {
+    ret += m_pages[i]->size;
+  }
+  return ret;
+}
+
+std::string MemPool::Debug() const
+{
+  std::stringstream out;
+  out << "pages=" << GetNumPages()
+      << " capacity=" << Capacity()
+      << " peak=" << m_stats.peakBytes
+      << " resets=" << m_stats.resets
+      << " trimmed-pages=" << m_stats.trimmedPages
+      << " reused=" << m_stats.reused;
+  return out.str();
 }
 
 }
@@ -14,6 +14,7 @@
 #include <stdlib.h>
 #include <limits>
 #include <iostream>
+#include <string>
 
 namespace Moses2
 {
@@ -31,7 +32,20 @@ class MemPool
     ~Page();
   };
 
+  // header written into a freed block while it is on a free list
+  struct FreeBlock {
+    FreeBlock *next;
+    size_t size; // only set for large blocks
+  };
+
 public:
+  struct Stats {
+    size_t peakBytes; // most bytes handed out between two resets
+    size_t resets;
+    size_t trimmedPages;
+    size_t reused; // allocations served from free lists
+  };
+
   MemPool(std::size_t initSize = 10000);
 
   ~MemPool();
@@ -39,6 +53,20 @@ public:
   uint8_t *Allocate(std::size_t size) {
     size = (size + 3) & 0xfffffffc;
 
+    if (size <= kMaxSmallSize) {
+      FreeBlock *block = m_smallFree[size >> 2];
+      if (block) {
+        m_smallFree[size >> 2] = block->next;
+        ++m_stats.reused;
+        return (uint8_t*) block;
+      }
+    } else if (m_largeFreeMask) {
+      uint8_t *ret = AllocateLarge(size);
+      if (ret) {
+        return ret;
+      }
+    }
+
     uint8_t *ret = current_;
     current_ += size;
 
@@ -64,11 +92,40 @@ public:
     return (T*) ret;
   }
 
-  // re-use pool
+  // Give back memory that was allocated from this pool with this size, so
+  // later allocations can reuse it. Only valid until the next Reset().
+  // Blocks that aren't from this pool, or aren't aligned for a pointer, are
+  // ignored
+  void Free(void *mem, std::size_t size);
+
+  // re-use pool. Every kTrimInterval resets, pages beyond what the recent
+  // sentences needed are given back to the OS
   void Reset();
 
+  // bytes held by the pool's pages, whether handed out or not
+  size_t Capacity() const;
+
+  size_t GetNumPages() const {
+    return m_pages.size();
+  }
+
+  const Stats &GetStats() const {
+    return m_stats;
+  }
+
+  std::string Debug() const;
+
 private:
+  static const size_t kMaxSmallSize = 256;
+  static const size_t kNumLargeClasses = 64;
+  static const size_t kTrimInterval = 64;
+
   uint8_t *More(std::size_t size);
+  uint8_t *AllocateLarge(std::size_t size);
+
+  // bytes handed out since the last reset
+  size_t Used() const;
+  void Trim(size_t keepBytes);
 
   std::vector<Page*> m_pages;
 
@@ -76,6 +133,15 @@ private:
   size_t m_currPage;
   uint8_t *current_;
 
+  // free lists. Small blocks by exact size, 4 bytes apart. Large blocks by
+  // floor(log2(size)), with bit i of m_largeFreeMask set if list i isn't empty
+  FreeBlock *m_smallFree[kMaxSmallSize / 4 + 1];
+  FreeBlock *m_largeFree[kNumLargeClasses];
+  uint64_t m_largeFreeMask;
+
+  Stats m_stats;
+  size_t m_intervalPeak, m_prevIntervalPeak;
+
   // no copying
   MemPool(const MemPool &);
   MemPool &operator=(const MemPool &);
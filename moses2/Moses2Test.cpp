@@ -0,0 +1,3 @@
+//Supplies the main for the moses2 test module
+#define BOOST_TEST_MODULE moses2
+#include <boost/test/unit_test.hpp>
@@ -11,6 +11,7 @@
 #include <string>
 #include <sstream>
 #include <iostream>
+#include <boost/functional/hash.hpp>
 #include "Word.h"
 #include "MemPool.h"
 #include "TypeDef.h"
@@ -0,0 +1,104 @@
+/*
+ * Search.cpp
+ *
+ *  Created on: 16 Oct 2026
+ */
+
+#include "Search.h"
+#include <boost/foreach.hpp>
+#include "../Normal/Stack.h"
+#include "../Manager.h"
+#include "../../InputPathsBase.h"
+#include "../../System.h"
+
+using namespace std;
+
+namespace Moses2
+{
+namespace NSBatch
+{
+
+Search::Search(Manager &mgr)
+  :NSNormal::Search(mgr)
+  ,m_batch(mgr.GetPool())
+{
+}
+
+Search::~Search()
+{
+}
+
+void Search::InitWorkerPools()
+{
+}
+
+void Search::Decode()
+{
+  Start();
+
+  for (size_t stackInd = 0; stackInd < GetNumStacks(); ++stackInd) {
+    const Batch &batch = ExtendStack(stackInd);
+    if (!batch.empty()) {
+      mgr.system.featureFunctions.EvaluateWhenAppliedBatch(batch);
+    }
+    FinishStack(stackInd);
+  }
+}
+
+void Search::Start()
+{
+  InitStacks();
+}
+
+const Batch &Search::ExtendStack(size_t stackInd)
+{
+  m_batch.clear();
+
+  mgr.GetDeadline().Update(stackInd, m_stacks.GetSize());
+
+  NSNormal::Stack &stack = m_stacks[stackInd];
+  if (&stack == &m_stacks.Back()) {
+    // last stack. don't do anythin
+    return m_batch;
+  }
+
+  const Hypotheses &hypos = stack.GetSortedAndPrunedHypos(mgr, mgr.arcLists);
+
+  const InputPaths &paths = mgr.GetInputPaths();
+
+  // every extension lands in a later stack so they can all be created first,
+  // scored together, then added
+  BOOST_FOREACH(const InputPathBase *path, paths) {
+    BOOST_FOREACH(const HypothesisBase *hypo, hypos) {
+      Extend(*static_cast<const Hypothesis*>(hypo), *static_cast<const InputPath*>(path));
+    }
+  }
+
+  return m_batch;
+}
+
+void Search::FinishStack(size_t stackInd)
+{
+  BOOST_FOREACH(Hypothesis *hypo, m_batch) {
+    m_stacks.Add(hypo, mgr.GetHypoRecycle(), mgr.arcLists);
+  }
+  m_batch.clear();
+
+  // delete stack to save mem
+  if (stackInd < m_stacks.GetSize() - 1) {
+    m_stacks.Delete(stackInd);
+  }
+}
+
+void Search::Extend(const Hypothesis &hypo, const TargetPhraseImpl &tp,
+                    const InputPath &path, const Bitmap &newBitmap, SCORE estimatedScore)
+{
+  Hypothesis *newHypo = Hypothesis::Create(mgr.GetSystemPool(), mgr);
+  newHypo->Init(mgr, hypo, path, tp, newBitmap, estimatedScore);
+
+  // stateful FFs are applied to the whole batch in Decode()
+  m_batch.push_back(newHypo);
+}
+
+} // namespace
+}
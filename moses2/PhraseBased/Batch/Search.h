@@ -0,0 +1,57 @@
+/*
+ * Search.h
+ *
+ *  Created on: 16 Oct 2026
+ */
+#pragma once
+
+#include "../Normal/Search.h"
+
+namespace Moses2
+{
+class Hypothesis;
+class InputPath;
+class TargetPhraseImpl;
+
+namespace NSBatch
+{
+
+// Same stack decoding as NSNormal, but the stateful feature functions are
+// applied to all extensions of a stack in one go so that they can batch
+// their work (see KENLMBatch)
+class Search: public NSNormal::Search
+{
+public:
+  Search(Manager &mgr);
+  virtual ~Search();
+
+  virtual void Decode();
+
+  // Decode() a stack at a time, so that the new hypos of several sentences
+  // can be scored in 1 batch. See ManagerBatch
+  void Start();
+
+  size_t GetNumStacks() const {
+    return m_stacks.GetSize();
+  }
+
+  //! the extensions of stack stackInd, not yet scored by the stateful FFs
+  const Batch &ExtendStack(size_t stackInd);
+
+  //! once scored, add the extensions to the later stacks
+  void FinishStack(size_t stackInd);
+
+protected:
+  Batch m_batch;
+
+  // stateful FFs batch on the decoding thread. No helper threads
+  virtual void InitWorkerPools();
+
+  using NSNormal::Search::Extend;
+  virtual void Extend(const Hypothesis &hypo, const TargetPhraseImpl &tp,
+                      const InputPath &path, const Bitmap &newBitmap, SCORE estimatedScore);
+
+};
+
+}
+}
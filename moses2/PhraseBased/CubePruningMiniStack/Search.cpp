@@ -9,9 +9,8 @@
 #include "Stack.h"
 #include "../Manager.h"
 #include "../Hypothesis.h"
-#include "../TrellisPath.h"
+#include "../KBestExtractor.h"
 #include "../Sentence.h"
-#include "../../TrellisPaths.h"
 #include "../../InputPathsBase.h"
 #include "../../InputPathBase.h"
 #include "../../System.h"
@@ -72,6 +71,7 @@ void Search::Decode()
        ++stackInd) {
     //cerr << "stackInd=" << stackInd << endl;
     m_stack.Clear();
+    mgr.GetDeadline().Update(stackInd, sentence.GetSize() + 1);
     Decode(stackInd);
     PostDecode(stackInd);
 
@@ -119,8 +119,9 @@ void Search::Decode(size_t stackInd)
   cerr << endl;
    */
 
+  size_t popLimit = mgr.GetPopLimit();
   size_t pops = 0;
-  while (!m_queue.empty() && pops < mgr.system.options.cube.pop_limit) {
+  while (!m_queue.empty() && pops < popLimit) {
     // get best hypo from queue, add to stack
     //cerr << "queue=" << queue.size() << endl;
     QueueItem *item = m_queue.top();
@@ -227,7 +228,7 @@ const Hypothesis *Search::GetBestHypo() const
   return bestHypo;
 }
 
-void Search::AddInitialTrellisPaths(TrellisPaths<TrellisPath> &paths) const
+void Search::AddFinalHypos(KBestExtractor &extractor) const
 {
   const Stack::Coll &coll = m_stack.GetColl();
   BOOST_FOREACH(const Stack::Coll::value_type &val, coll) {
@@ -236,8 +237,7 @@ void Search::AddInitialTrellisPaths(TrellisPaths<TrellisPath> &paths) const
 
     BOOST_FOREACH(const HypothesisBase *hypoBase, sortedHypos) {
       const Hypothesis *hypo = static_cast<const Hypothesis*>(hypoBase);
-      TrellisPath *path = new TrellisPath(hypo, mgr.arcLists);
-      paths.Add(path);
+      extractor.AddFinalHypo(*hypo);
     }
   }
 }
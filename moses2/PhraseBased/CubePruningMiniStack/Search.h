@@ -34,7 +34,7 @@ public:
   virtual void Decode();
   const Hypothesis *GetBestHypo() const;
 
-  void AddInitialTrellisPaths(TrellisPaths<TrellisPath> &paths) const;
+  void AddFinalHypos(KBestExtractor &extractor) const;
 
 protected:
   Stack m_stack;
@@ -179,9 +179,13 @@ void Hypothesis::EmptyHypothesisState(const InputType &input)
 
 void Hypothesis::EvaluateWhenApplied()
 {
+  const FeatureFunctions &ffs = GetManager().system.featureFunctions;
+  FeatureProfiler::Counters *counters = ffs.GetProfilerCounters();
+
   const std::vector<const StatefulFeatureFunction*> &sfffs =
-    GetManager().system.featureFunctions.GetStatefulFeatureFunctions();
+    ffs.GetStatefulFeatureFunctions();
   BOOST_FOREACH(const StatefulFeatureFunction *sfff, sfffs) {
+    FeatureProfiler::Scope scope(counters, sfff->GetIndex(), FeatureProfiler::EvaluateWhenApplied);
     EvaluateWhenApplied(*sfff);
   }
 //cerr << *this << endl;
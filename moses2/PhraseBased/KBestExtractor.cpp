@@ -0,0 +1,188 @@
+/*
+ * KBestExtractor.cpp
+ *
+ *  Created on: 16 Oct 2026
+ */
+#include <sstream>
+#include <boost/foreach.hpp>
+#include "KBestExtractor.h"
+#include "Manager.h"
+#include "Hypothesis.h"
+#include "InputPath.h"
+#include "../System.h"
+#include "../Scores.h"
+#include "../SubPhrase.h"
+#include "../legacy/Util2.h"
+
+using namespace std;
+
+namespace Moses2
+{
+
+namespace
+{
+// arcs are last 1 first. The last arc is the initial hypo, which has no target phrase
+void OutputArcs(std::ostream &out, const System &system,
+                const std::vector<const Hypothesis*> &arcs)
+{
+  for (int i = arcs.size() - 2; i >= 0; --i) {
+    const Hypothesis *hypo = arcs[i];
+    const TargetPhrase<Moses2::Word> &tp = hypo->GetTargetPhrase();
+
+    const InputPath &path = static_cast<const InputPath&>(hypo->GetInputPath());
+    const SubPhrase<Moses2::Word> &subPhrase = path.subPhrase;
+
+    tp.OutputToStream(system, subPhrase, out);
+  }
+}
+}
+
+KBests::KBests(const Hypothesis &hypo, const ArcList &arcList)
+{
+  // the hypo that won recombination is the best. Each of the other arcs is a
+  // contender with its best derivation, ie. following its back-pointers
+  KBestDeriv best = { &hypo, NULL, 0, hypo.GetScores().GetTotalScore() };
+  m_derivs.push_back(best);
+
+  BOOST_FOREACH(const HypothesisBase *arcBase, arcList) {
+    const Hypothesis *arc = static_cast<const Hypothesis*>(arcBase);
+    if (arc != &hypo) {
+      KBestDeriv contender = { arc, NULL, 0, arc->GetScores().GetTotalScore() };
+      m_contenders.push(contender);
+    }
+  }
+}
+
+bool KBests::Extend(KBestExtractor &extractor, size_t ind)
+{
+  while (m_derivs.size() <= ind) {
+    // next best of the last derivation found is the arc with the next best
+    // derivation of its previous hypo
+    KBestDeriv next = m_derivs.back();
+    const Hypothesis *prevHypo = next.arc->GetPrevHypo();
+    if (prevHypo) {
+      KBests &prev = extractor.GetKBests(*prevHypo);
+      if (prev.Extend(extractor, next.prevInd + 1)) {
+        next.score -= prev.Get(next.prevInd).score;
+        ++next.prevInd;
+        next.score += prev.Get(next.prevInd).score;
+        next.prev = &prev;
+        m_contenders.push(next);
+      }
+    }
+
+    if (m_contenders.empty()) {
+      return false;
+    }
+
+    m_derivs.push_back(m_contenders.top());
+    m_contenders.pop();
+  }
+
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+KBestExtractor::KBestExtractor(const Manager &mgr)
+  :m_mgr(mgr)
+{
+  m_curr.kbests = NULL;
+}
+
+KBestExtractor::~KBestExtractor()
+{
+  BOOST_FOREACH(const Coll::value_type &collPair, m_coll) {
+    delete collPair.second;
+  }
+}
+
+KBests &KBestExtractor::GetKBests(const Hypothesis &hypo)
+{
+  KBests *&kbests = m_coll[&hypo];
+  if (kbests == NULL) {
+    const ArcLists &arcLists = m_mgr.arcLists;
+    kbests = new KBests(hypo, arcLists.GetArcList(&hypo));
+  }
+  return *kbests;
+}
+
+void KBestExtractor::AddFinalHypo(const Hypothesis &hypo)
+{
+  FinalDeriv contender = { &GetKBests(hypo), 0, hypo.GetScores().GetTotalScore() };
+  m_contenders.push(contender);
+}
+
+bool KBestExtractor::Next()
+{
+  if (m_curr.kbests && m_curr.kbests->Extend(*this, m_curr.ind + 1)) {
+    FinalDeriv next = m_curr;
+    ++next.ind;
+    next.score = next.kbests->Get(next.ind).score;
+    m_contenders.push(next);
+  }
+
+  if (m_contenders.empty()) {
+    return false;
+  }
+
+  m_curr = m_contenders.top();
+  m_contenders.pop();
+  return true;
+}
+
+void KBestExtractor::GetArcs(std::vector<const Hypothesis*> &arcs, Scores *scores) const
+{
+  const KBestDeriv *deriv = &m_curr.kbests->Get(m_curr.ind);
+  while (deriv) {
+    const Hypothesis *arc = deriv->arc;
+    arcs.push_back(arc);
+
+    if (deriv->prevInd) {
+      deriv = &deriv->prev->Get(deriv->prevInd);
+      if (scores) {
+        scores->MinusEquals(m_mgr.system, arc->GetPrevHypo()->GetScores());
+        scores->PlusEquals(m_mgr.system, deriv->arc->GetScores());
+      }
+    } else {
+      // rest is the best derivation, which the back-pointers already give
+      for (const Hypothesis *prevHypo = arc->GetPrevHypo(); prevHypo;
+           prevHypo = prevHypo->GetPrevHypo()) {
+        arcs.push_back(prevHypo);
+      }
+      deriv = NULL;
+    }
+  }
+}
+
+void KBestExtractor::OutputToStream(std::ostream &out) const
+{
+  const System &system = m_mgr.system;
+  MemPool &pool = m_mgr.GetPool();
+  const Hypothesis *hypo = m_curr.kbests->Get(m_curr.ind).arc;
+  Scores *scores = new (pool.Allocate<Scores>()) Scores(system, pool,
+      system.featureFunctions.GetNumScores(), hypo->GetScores());
+
+  std::vector<const Hypothesis*> arcs;
+  GetArcs(arcs, scores);
+
+  OutputArcs(out, system, arcs);
+  out << "||| ";
+
+  scores->OutputBreakdown(out, system);
+  out << "||| ";
+
+  out << scores->GetTotalScore();
+}
+
+std::string KBestExtractor::OutputTargetPhrase() const
+{
+  std::vector<const Hypothesis*> arcs;
+  GetArcs(arcs, NULL);
+
+  std::stringstream out;
+  OutputArcs(out, m_mgr.system, arcs);
+  return out.str();
+}
+
+}
+
@@ -0,0 +1,107 @@
+/*
+ * KBestExtractor.h
+ *
+ *  Created on: 16 Oct 2026
+ */
+#pragma once
+#include <vector>
+#include <queue>
+#include <string>
+#include <boost/unordered_map.hpp>
+#include "../TypeDef.h"
+#include "../ArcLists.h"
+
+namespace Moses2
+{
+
+class Manager;
+class Hypothesis;
+class Scores;
+class KBests;
+class KBestExtractor;
+
+/** A derivation of a recombined hypothesis: one of the arcs in its arc list,
+ * followed by the prevInd'th best derivation of the arc's previous hypothesis.
+ * Only the total score is kept, the score breakdown and target string are
+ * worked out when the derivation is output.
+ */
+struct KBestDeriv {
+  const Hypothesis *arc;
+  const KBests *prev; // NULL when prevInd == 0, ie. follow the arc's back-pointers
+  size_t prevInd;
+  SCORE score;
+};
+
+template<typename T>
+struct KBestScoreOrderer {
+  bool operator()(const T &a, const T &b) const {
+    return a.score < b.score;
+  }
+};
+
+/** The derivations of 1 hypothesis, best first, found as they're asked for.
+ * Huang & Chiang 2005, algorithm 3.
+ */
+class KBests
+{
+public:
+  KBests(const Hypothesis &hypo, const ArcList &arcList);
+
+  const KBestDeriv &Get(size_t ind) const {
+    return m_derivs[ind];
+  }
+
+  //! make sure the ind'th best derivation has been found. False if there isn't 1
+  bool Extend(KBestExtractor &extractor, size_t ind);
+
+protected:
+  std::vector<KBestDeriv> m_derivs;
+  std::priority_queue<KBestDeriv, std::vector<KBestDeriv>,
+      KBestScoreOrderer<KBestDeriv> > m_contenders;
+};
+
+/** N-best list for the phrase-based decoder. Unlike a list of trellis paths,
+ * nothing is expanded until it's needed, so the work and memory depend on the
+ * size of the n-best list, not the size of the arc lists.
+ */
+class KBestExtractor
+{
+public:
+  KBestExtractor(const Manager &mgr);
+  virtual ~KBestExtractor();
+
+  //! hypo in the last stack
+  void AddFinalHypo(const Hypothesis &hypo);
+
+  //! move to the next best translation. False if there are no more
+  bool Next();
+
+  //! current translation
+  void OutputToStream(std::ostream &out) const;
+  std::string OutputTargetPhrase() const;
+
+  KBests &GetKBests(const Hypothesis &hypo);
+
+protected:
+  struct FinalDeriv {
+    KBests *kbests;
+    size_t ind;
+    SCORE score;
+  };
+
+  const Manager &m_mgr;
+
+  typedef boost::unordered_map<const Hypothesis*, KBests*> Coll;
+  Coll m_coll;
+
+  std::priority_queue<FinalDeriv, std::vector<FinalDeriv>,
+      KBestScoreOrderer<FinalDeriv> > m_contenders;
+  FinalDeriv m_curr;
+
+  // hypos of the current translation, last 1 first. Scores, if given, start as
+  // the last hypo's and are changed to the translation's
+  void GetArcs(std::vector<const Hypothesis*> &arcs, Scores *scores) const;
+};
+
+}
+
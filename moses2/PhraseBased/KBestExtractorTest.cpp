@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/foreach.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "KBestExtractor.h"
+#include "Hypothesis.h"
+#include "Manager.h"
+#include "Search.h"
+#include "../TestModel.h"
+
+using namespace Moses2;
+using namespace std;
+
+namespace
+{
+// a translation: its hypos, last 1 first, and its score
+struct Deriv {
+  vector<const Hypothesis*> arcs;
+  SCORE score;
+};
+
+bool BetterDeriv(const Deriv &a, const Deriv &b)
+{
+  return a.score > b.score;
+}
+
+// scores are summed in different orders, so they may differ in the last bits
+const SCORE kEpsilon = 1e-4;
+
+/* Every path through the trellis: for each hypo in the last stack, each arc
+ * of its arc list followed by each path to the arc's previous hypo. The
+ * trellis-path n-best list produced these, best first, when asked for all of
+ * them.
+ */
+void GetDerivs(const ArcLists &arcLists, const Hypothesis &hypo, vector<Deriv> &derivs)
+{
+  BOOST_FOREACH(const HypothesisBase *arcBase, arcLists.GetArcList(&hypo)) {
+    const Hypothesis *arc = static_cast<const Hypothesis*>(arcBase);
+    const Hypothesis *prevHypo = arc->GetPrevHypo();
+    if (prevHypo == NULL) {
+      Deriv deriv;
+      deriv.arcs.push_back(arc);
+      deriv.score = arc->GetScores().GetTotalScore();
+      derivs.push_back(deriv);
+      continue;
+    }
+
+    vector<Deriv> prevDerivs;
+    GetDerivs(arcLists, *prevHypo, prevDerivs);
+    BOOST_FOREACH(Deriv &deriv, prevDerivs) {
+      deriv.arcs.insert(deriv.arcs.begin(), arc);
+      deriv.score += arc->GetScores().GetTotalScore() - prevHypo->GetScores().GetTotalScore();
+      derivs.push_back(deriv);
+    }
+  }
+}
+
+class TestManager: public Manager
+{
+public:
+  TestManager(System &system, const TranslationTask &task, const std::string &line)
+    :Manager(system, task, line, 0) {
+  }
+
+  void AddFinalHypos(KBestExtractor &extractor) const {
+    m_search->AddFinalHypos(extractor);
+  }
+};
+
+class TestKBestExtractor: public KBestExtractor
+{
+public:
+  TestKBestExtractor(const Manager &mgr)
+    :KBestExtractor(mgr) {
+  }
+
+  // before Next() is called, the extractor only has the hypos in the last stack
+  vector<const Hypothesis*> GetFinalHypos() const {
+    vector<const Hypothesis*> ret;
+    BOOST_FOREACH(const Coll::value_type &collPair, m_coll) {
+      ret.push_back(collPair.first);
+    }
+    return ret;
+  }
+
+  Deriv GetCurrent() const {
+    Deriv ret;
+    GetArcs(ret.arcs, NULL);
+    ret.score = m_curr.score;
+    return ret;
+  }
+};
+
+/* A monotone-ish model without an LM. Several phrases have the same scores,
+ * so many translations tie, and every hypo with the same coverage and last
+ * position recombines.
+ */
+class Model: public TestModel
+{
+public:
+  Model() {
+    Write("phrase-table",
+          "a ||| x ||| 0.5 0.5 0.5 0.5 ||| 0-0 ||| \n"
+          "a ||| y ||| 0.5 0.5 0.5 0.5 ||| 0-0 ||| \n"
+          "a b ||| x y ||| 0.4 0.4 0.4 0.4 ||| 0-0 1-1 ||| \n"
+          "b ||| y ||| 0.6 0.6 0.6 0.6 ||| 0-0 ||| \n"
+          "b ||| z ||| 0.2 0.3 0.4 0.5 ||| 0-0 ||| \n"
+          "b c ||| y z ||| 0.3 0.3 0.3 0.3 ||| 0-0 1-1 ||| \n"
+          "c ||| z ||| 0.7 0.7 0.7 0.7 ||| 0-0 ||| \n"
+          "c ||| w ||| 0.7 0.7 0.7 0.7 ||| 0-0 ||| \n"
+          "d ||| w ||| 0.9 0.9 0.9 0.9 ||| 0-0 ||| \n");
+    Load("[distortion-limit]\n2\n"
+         "[stack]\n1000\n"
+         "[n-best-list]\n" + GetPath("nbest") + "\n1000\n");
+  }
+};
+
+// Ask for k translations and check them against all paths through the trellis
+void Check(const std::string &input, size_t k)
+{
+  Model model;
+  TestManager mgr(model.GetSystem(), model.GetTask(), input);
+  mgr.Decode();
+
+  TestKBestExtractor extractor(mgr);
+  mgr.AddFinalHypos(extractor);
+
+  vector<Deriv> expected;
+  BOOST_FOREACH(const Hypothesis *hypo, extractor.GetFinalHypos()) {
+    GetDerivs(mgr.arcLists, *hypo, expected);
+  }
+  stable_sort(expected.begin(), expected.end(), BetterDeriv);
+  BOOST_REQUIRE(!expected.empty());
+
+  vector<Deriv> actual;
+  while (actual.size() < k && extractor.Next()) {
+    actual.push_back(extractor.GetCurrent());
+  }
+  BOOST_REQUIRE_EQUAL(actual.size(), min(k, expected.size()));
+  if (k >= expected.size()) {
+    BOOST_CHECK(!extractor.Next());
+  }
+
+  // best first, as many as there are of each score. Translations with the
+  // same score may come in any order, but each must be a path of the trellis
+  // with that score, and only come once
+  set<vector<const Hypothesis*> > seen;
+  for (size_t i = 0; i < actual.size(); ++i) {
+    BOOST_CHECK_SMALL(actual[i].score - expected[i].score, kEpsilon);
+    BOOST_CHECK(seen.insert(actual[i].arcs).second);
+
+    bool found = false;
+    BOOST_FOREACH(const Deriv &deriv, expected) {
+      if (deriv.arcs == actual[i].arcs) {
+        BOOST_CHECK_SMALL(actual[i].score - deriv.score, kEpsilon);
+        found = true;
+        break;
+      }
+    }
+    BOOST_CHECK(found);
+  }
+}
+
+size_t CountTies(const std::string &input)
+{
+  Model model;
+  TestManager mgr(model.GetSystem(), model.GetTask(), input);
+  mgr.Decode();
+
+  TestKBestExtractor extractor(mgr);
+  mgr.AddFinalHypos(extractor);
+  vector<Deriv> derivs;
+  BOOST_FOREACH(const Hypothesis *hypo, extractor.GetFinalHypos()) {
+    GetDerivs(mgr.arcLists, *hypo, derivs);
+  }
+  stable_sort(derivs.begin(), derivs.end(), BetterDeriv);
+
+  size_t ret = 0;
+  for (size_t i = 1; i < derivs.size(); ++i) {
+    if (derivs[i - 1].score - derivs[i].score < kEpsilon) {
+      ++ret;
+    }
+  }
+  return ret;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(kbest_extractor)
+
+BOOST_AUTO_TEST_CASE(lattice_has_ties)
+{
+  BOOST_CHECK(CountTies("a b c") > 0);
+}
+
+BOOST_AUTO_TEST_CASE(top_k)
+{
+  Check("a b c", 1);
+  Check("a b c", 5);
+  Check("a b c d", 20);
+}
+
+BOOST_AUTO_TEST_CASE(more_than_all)
+{
+  Check("a b", 1000);
+  Check("a b c", 1000);
+}
+
+BOOST_AUTO_TEST_CASE(single_word)
+{
+  Check("d", 1);
+  Check("d", 10);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
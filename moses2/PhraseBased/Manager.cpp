@@ -14,8 +14,10 @@
 #include "InputPath.h"
 #include "Sentence.h"
 #include "SentenceWithCandidates.h"
+#include "KBestExtractor.h"
 
 #include "Normal/Search.h"
+#include "Batch/Search.h"
 #include "CubePruningMiniStack/Search.h"
 
 /*
@@ -24,7 +26,6 @@
  #include "CubePruningCardinalStack/Search.h"
  #include "CubePruningBitmapStack/Search.h"
  */
-#include "../TrellisPaths.h"
 #include "../System.h"
 #include "../Phrase.h"
 #include "../InputPathsBase.h"
@@ -55,6 +56,24 @@ Manager::~Manager()
 }
 
 void Manager::Init()
+{
+  InitInput();
+
+  // lookup with every pt
+  FeatureProfiler::Counters *counters = system.featureFunctions.GetProfilerCounters();
+  const std::vector<const PhraseTable*> &pts = system.mappings;
+  for (size_t i = 0; i < pts.size(); ++i) {
+    const PhraseTable &pt = *pts[i];
+    //cerr << "Looking up from " << pt.GetName() << endl;
+    FeatureProfiler::Scope scope(counters, pt.GetIndex(), FeatureProfiler::Lookup);
+    pt.Lookup(*this, m_inputPaths);
+  }
+  //m_inputPaths.DeleteUnusedPaths();
+
+  InitSearch();
+}
+
+void Manager::InitInput()
 {
   // init pools etc
   InitPools();
@@ -83,17 +102,13 @@ void Manager::Init()
   const UnknownWordPenalty *unkWP = system.featureFunctions.GetUnknownWordPenalty();
   UTIL_THROW_IF2(unkWP == NULL, "There must be a UnknownWordPenalty FF");
   unkWP->ProcessXML(*this, GetPool(), sentence, m_inputPaths);
+}
 
-  // lookup with every pt
-  const std::vector<const PhraseTable*> &pts = system.mappings;
-  for (size_t i = 0; i < pts.size(); ++i) {
-    const PhraseTable &pt = *pts[i];
-    //cerr << "Looking up from " << pt.GetName() << endl;
-    pt.Lookup(*this, m_inputPaths);
-  }
-  //m_inputPaths.DeleteUnusedPaths();
+void Manager::InitSearch()
+{
   CalcFutureScore();
 
+  const Sentence &sentence = static_cast<const Sentence&>(GetInput());
   m_bitmaps->Init(sentence.GetSize(), vector<bool>(0));
   
   switch (system.options.search.algo) {
@@ -101,8 +116,7 @@ void Manager::Init()
     m_search = new NSNormal::Search(*this);
     break;
   case NormalBatch:
-    //m_search = new NSBatch::Search(*this);
-    UTIL_THROW2("Not implemented");
+    m_search = new NSBatch::Search(*this);
     break;
   case CubePruning:
   case CubePruningMiniStack:
@@ -131,6 +145,7 @@ void Manager::Decode()
 {
   //cerr << "Start Decode " << this << endl;
 
+  m_deadline.Start();
   Init();
   m_search->Decode();
 
@@ -223,12 +238,10 @@ std::string Manager::OutputBest() const
 
 std::string Manager::OutputNBest()
 {
-  arcLists.Sort();
-
   boost::unordered_set<size_t> distinctHypos;
 
-  TrellisPaths<TrellisPath> contenders;
-  m_search->AddInitialTrellisPaths(contenders);
+  KBestExtractor extractor(*this);
+  m_search->AddFinalHypos(extractor);
 
   long transId = GetTranslationId();
 
@@ -239,16 +252,13 @@ std::string Manager::OutputNBest()
   size_t maxIter = system.options.nbest.nbest_size * system.options.nbest.factor;
   size_t bestInd = 0;
   for (size_t i = 0; i < maxIter; ++i) {
-    if (bestInd > system.options.nbest.nbest_size || contenders.empty()) {
+    if (bestInd > system.options.nbest.nbest_size || !extractor.Next()) {
       break;
     }
 
-    //cerr << "bestInd=" << bestInd << endl;
-    TrellisPath *path = contenders.Get();
-
     bool ok = false;
     if (system.options.nbest.only_distinct) {
-      string tgtPhrase = path->OutputTargetPhrase(system);
+      string tgtPhrase = extractor.OutputTargetPhrase();
       //cerr << "tgtPhrase=" << tgtPhrase << endl;
       boost::hash<std::string> string_hash;
       size_t hash = string_hash(tgtPhrase);
@@ -263,14 +273,9 @@ std::string Manager::OutputNBest()
     if (ok) {
       ++bestInd;
       out << transId << " ||| ";
-      path->OutputToStream(out, system);
+      extractor.OutputToStream(out);
       out << "\n";
     }
-
-    // create next paths
-    path->CreateDeviantPaths(contenders, arcLists, GetPool(), system);
-
-    delete path;
   }
 
   return out.str();
@@ -52,6 +52,9 @@ public:
   const InputPaths &GetInputPaths() const {
     return m_inputPaths;
   }
+  InputPaths &GetInputPaths() {
+    return m_inputPaths;
+  }
 
   const TargetPhraseImpl &GetInitPhrase() const {
     return *m_initPhrase;
@@ -63,6 +66,7 @@ public:
   std::string OutputTransOpt();
 
 protected:
+  friend class ManagerBatch;
 
   InputPaths m_inputPaths;
   Bitmaps *m_bitmaps;
@@ -73,6 +77,8 @@ protected:
 
   // must be run in same thread as Decode()
   void Init();
+  void InitInput(); // up to the phrase-table lookup
+  void InitSearch(); // after it
   void CalcFutureScore();
 
 };
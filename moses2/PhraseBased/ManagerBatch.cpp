@@ -0,0 +1,89 @@
+/*
+ * ManagerBatch.cpp
+ *
+ *  Created on: 17 Oct 2026
+ */
+#include <algorithm>
+#include <boost/foreach.hpp>
+#include "ManagerBatch.h"
+#include "Manager.h"
+#include "Batch/Search.h"
+#include "../System.h"
+#include "../TranslationModel/PhraseTable.h"
+
+using namespace std;
+
+namespace Moses2
+{
+
+void ManagerBatch::Decode()
+{
+  if (m_mgrs.empty()) {
+    return;
+  }
+  const System &system = m_mgrs[0]->system;
+
+  BOOST_FOREACH(Manager *mgr, m_mgrs) {
+    mgr->GetDeadline().Start();
+    mgr->InitInput();
+  }
+
+  // lookup with every pt, for all sentences at once
+  FeatureProfiler::Counters *counters = system.featureFunctions.GetProfilerCounters();
+  const std::vector<const PhraseTable*> &pts = system.mappings;
+  for (size_t i = 0; i < pts.size(); ++i) {
+    const PhraseTable &pt = *pts[i];
+    FeatureProfiler::Scope scope(counters, pt.GetIndex(), FeatureProfiler::Lookup);
+    pt.LookupBatch(m_mgrs);
+  }
+
+  BOOST_FOREACH(Manager *mgr, m_mgrs) {
+    mgr->InitSearch();
+  }
+
+  if (system.options.search.algo == NormalBatch) {
+    DecodeLockstep();
+  } else {
+    BOOST_FOREACH(Manager *mgr, m_mgrs) {
+      mgr->m_search->Decode();
+    }
+  }
+}
+
+void ManagerBatch::DecodeLockstep()
+{
+  const System &system = m_mgrs[0]->system;
+
+  std::vector<NSBatch::Search*> searches;
+  size_t numStacks = 0;
+  BOOST_FOREACH(Manager *mgr, m_mgrs) {
+    NSBatch::Search *search = static_cast<NSBatch::Search*>(mgr->m_search);
+    search->Start();
+    searches.push_back(search);
+    numStacks = std::max(numStacks, search->GetNumStacks());
+  }
+
+  // the extensions of stack stackInd of every sentence, scored together
+  Batch batch(m_mgrs[0]->GetPool());
+  for (size_t stackInd = 0; stackInd < numStacks; ++stackInd) {
+    batch.clear();
+    BOOST_FOREACH(NSBatch::Search *search, searches) {
+      if (stackInd < search->GetNumStacks()) {
+        const Batch &extensions = search->ExtendStack(stackInd);
+        batch.insert(batch.end(), extensions.begin(), extensions.end());
+      }
+    }
+
+    if (!batch.empty()) {
+      system.featureFunctions.EvaluateWhenAppliedBatch(batch);
+    }
+
+    BOOST_FOREACH(NSBatch::Search *search, searches) {
+      if (stackInd < search->GetNumStacks()) {
+        search->FinishStack(stackInd);
+      }
+    }
+  }
+}
+
+}
@@ -0,0 +1,42 @@
+/*
+ * ManagerBatch.h
+ *
+ *  Created on: 17 Oct 2026
+ */
+
+#pragma once
+
+#include <vector>
+
+namespace Moses2
+{
+class Manager;
+
+/** Decodes several sentences together on the calling thread.
+ *
+ * Each phrase table looks up the input paths of all the sentences in 1
+ * pass, so a source phrase which is in more than 1 of them is only looked up
+ * once. With search-algorithm 4, the sentences' stacks are then extended in
+ * lockstep and the new hypos of all of them are scored by the stateful
+ * feature functions in 1 batch. Other searches decode the sentences one
+ * after the other.
+ *
+ * The managers share the thread's pools. Output all of them before deleting
+ * any, and delete them on this thread.
+ */
+class ManagerBatch
+{
+public:
+  void Add(Manager &mgr) {
+    m_mgrs.push_back(&mgr);
+  }
+
+  void Decode();
+
+protected:
+  std::vector<Manager*> m_mgrs;
+
+  void DecodeLockstep();
+};
+
+}
@@ -0,0 +1,116 @@
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "ManagerBatch.h"
+#include "Manager.h"
+#include "../TestModel.h"
+
+using namespace Moses2;
+using namespace std;
+
+namespace
+{
+// a phrase table in which the sentences below share phrases, and a
+// language model and distortion as the stateful feature functions
+class Model: public TestModel
+{
+public:
+  Model(int searchAlgo) {
+    Write("phrase-table",
+          "a ||| x ||| 0.5 0.5 0.5 0.5 ||| 0-0 ||| \n"
+          "a ||| y ||| 0.4 0.6 0.3 0.5 ||| 0-0 ||| \n"
+          "a b ||| y x ||| 0.4 0.4 0.4 0.4 ||| 0-1 1-0 ||| \n"
+          "b ||| y ||| 0.6 0.6 0.6 0.6 ||| 0-0 ||| \n"
+          "b c ||| z y ||| 0.3 0.2 0.3 0.1 ||| 0-1 1-0 ||| \n"
+          "c ||| z ||| 0.7 0.7 0.7 0.7 ||| 0-0 ||| \n"
+          "c a ||| w ||| 0.2 0.3 0.2 0.3 ||| 0-0 1-0 ||| \n");
+    string lm = Write("lm.arpa",
+                      "\\data\\\nngram 1=6\nngram 2=5\n\n"
+                      "\\1-grams:\n"
+                      "-1.0\t<s>\t-0.3\n-0.8\t</s>\n-0.6\tx\t-0.2\n"
+                      "-0.7\ty\t-0.2\n-0.9\tz\t-0.1\n-1.2\tw\t-0.1\n\n"
+                      "\\2-grams:\n"
+                      "-0.2\t<s> y\n-0.3\ty x\n-0.4\tx z\n-0.3\tz y\n-0.5\tw </s>\n\n"
+                      "\\end\\\n");
+
+    stringstream sections;
+    sections << "[distortion-limit]\n3\n"
+             << "[search-algorithm]\n" << searchAlgo << "\n"
+             << "[n-best-list]\n" << GetPath("nbest") << "\n10\n";
+    Load(sections.str(),
+         string(searchAlgo == 4 ? "KENLMBatch" : "KENLM")
+         + " name=LM0 factor=0 order=2 path=" + lm + "\n",
+         "LM0= 0.5\n");
+  }
+};
+
+const char *kSentences[] = {
+  "a b c", "c a", "a b c", "b", "c a b a", "d a", "a b c a b c"
+};
+const size_t kNumSentences = sizeof(kSentences) / sizeof(kSentences[0]);
+
+// best translation and n-best list of each sentence
+string Output(Manager &mgr)
+{
+  return mgr.OutputBest() + "\n" + mgr.OutputNBest();
+}
+
+// each sentence decoded on its own, then all of them together
+void Decode(Model &model, vector<string> &alone, vector<string> &together)
+{
+  for (size_t i = 0; i < kNumSentences; ++i) {
+    Manager mgr(model.GetSystem(), model.GetTask(), kSentences[i], i);
+    mgr.Decode();
+    alone.push_back(Output(mgr));
+  }
+
+  vector<Manager*> mgrs;
+  ManagerBatch batch;
+  for (size_t i = 0; i < kNumSentences; ++i) {
+    mgrs.push_back(new Manager(model.GetSystem(), model.GetTask(), kSentences[i], i));
+    batch.Add(*mgrs.back());
+  }
+  batch.Decode();
+
+  for (size_t i = 0; i < kNumSentences; ++i) {
+    together.push_back(Output(*mgrs[i]));
+  }
+  for (size_t i = 0; i < kNumSentences; ++i) {
+    delete mgrs[i];
+  }
+}
+
+void Check(int searchAlgo)
+{
+  Model model(searchAlgo);
+
+  // hypos are recycled within a thread, and are the size the 1st system on
+  // it needed. Decode on a new thread, as the decoder's workers do, so the
+  // models of other tests don't matter
+  vector<string> alone, together;
+  boost::thread(Decode, boost::ref(model), boost::ref(alone), boost::ref(together)).join();
+
+  BOOST_REQUIRE_EQUAL(kNumSentences, together.size());
+  for (size_t i = 0; i < kNumSentences; ++i) {
+    BOOST_CHECK_EQUAL(alone[i], together[i]);
+  }
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(manager_batch)
+
+BOOST_AUTO_TEST_CASE(normal_search)
+{
+  Check(0);
+}
+
+BOOST_AUTO_TEST_CASE(batch_search)
+{
+  Check(4);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -7,16 +7,19 @@
 
 #include "Search.h"
 #include <algorithm>
+#include <atomic>
 #include <boost/foreach.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
 #include "Stack.h"
 #include "../Manager.h"
-#include "../TrellisPath.h"
+#include "../KBestExtractor.h"
 #include "../Sentence.h"
-#include "../../TrellisPaths.h"
 #include "../../InputPathsBase.h"
 #include "../../Phrase.h"
 #include "../../System.h"
 #include "../../PhraseBased/TargetPhrases.h"
+#include "../../legacy/ThreadPool.h"
 
 using namespace std;
 
@@ -25,6 +28,73 @@ namespace Moses2
 namespace NSNormal
 {
 
+namespace
+{
+// expansions claimed by a thread at a time
+const size_t kExpansionChunk = 4;
+
+// new hypos made before they're added to the stacks. Bounds the memory
+// that isn't recycled while the threads are working
+const size_t kMaxBatchHypos = 8192;
+}
+
+// the expansions in m_expansions not yet claimed by a thread
+struct Search::ExpansionBatch {
+  ExpansionBatch(size_t vSize)
+    :size(vSize)
+    ,next(0)
+    ,active(0) {
+  }
+
+  size_t size;
+  std::atomic<size_t> next;
+  std::atomic<size_t> active; // helpers that may still be extending
+
+  boost::mutex mutex;
+  boost::condition_variable finished;
+
+  // extend the expansions the calling thread can claim
+  void Run(Search &search, size_t worker) {
+    if (worker) {
+      // announce before claiming, so the decoding thread waits for this one
+      ++active;
+    }
+
+    size_t begin;
+    while ((begin = next.fetch_add(kExpansionChunk)) < size) {
+      search.Expand(begin, std::min(begin + kExpansionChunk, size), worker);
+    }
+
+    if (worker && --active == 0) {
+      boost::mutex::scoped_lock lock(mutex);
+      finished.notify_all();
+    }
+  }
+};
+
+// A helper thread's share of a batch. The batch is held by shared_ptr, so a
+// helper that only starts after the decoding thread has done all the work
+// finds nothing to claim and never touches the search
+class ExpansionTask: public Task
+{
+public:
+  ExpansionTask(Search &search, const boost::shared_ptr<Search::ExpansionBatch> &batch,
+                size_t worker)
+    :m_search(search)
+    ,m_batch(batch)
+    ,m_worker(worker) {
+  }
+
+  virtual void Run() {
+    m_batch->Run(m_search, m_worker);
+  }
+
+protected:
+  Search &m_search;
+  boost::shared_ptr<Search::ExpansionBatch> m_batch;
+  size_t m_worker;
+};
+
 Search::Search(Manager &mgr)
   :Moses2::Search(mgr)
   , m_stacks(mgr)
@@ -35,12 +105,30 @@ Search::Search(Manager &mgr)
 
 Search::~Search()
 {
-  // TODO Auto-generated destructor stub
+  BOOST_FOREACH(WorkerPools *pools, m_workerPools) {
+    mgr.system.ReleaseWorkerPools(pools);
+  }
 }
 
 void Search::Decode()
 {
-  // init stacks
+  InitStacks();
+
+  for (size_t stackInd = 0; stackInd < m_stacks.GetSize(); ++stackInd) {
+    mgr.GetDeadline().Update(stackInd, m_stacks.GetSize());
+    Decode(stackInd);
+    //cerr << m_stacks << endl;
+
+    // delete stack to save mem
+    if (stackInd < m_stacks.GetSize() - 1) {
+      m_stacks.Delete(stackInd);
+    }
+    //cerr << m_stacks.Debug(mgr.system) << endl;
+  }
+}
+
+void Search::InitStacks()
+{
   const Sentence &sentence = static_cast<const Sentence&>(mgr.GetInput());
   m_stacks.Init(mgr, sentence.GetSize() + 1);
 
@@ -52,15 +140,17 @@ void Search::Decode()
 
   m_stacks.Add(initHypo, mgr.GetHypoRecycle(), mgr.arcLists);
 
-  for (size_t stackInd = 0; stackInd < m_stacks.GetSize(); ++stackInd) {
-    Decode(stackInd);
-    //cerr << m_stacks << endl;
+  InitWorkerPools();
+}
 
-    // delete stack to save mem
-    if (stackInd < m_stacks.GetSize() - 1) {
-      m_stacks.Delete(stackInd);
+void Search::InitWorkerPools()
+{
+  const System &system = mgr.system;
+  const Sentence &sentence = static_cast<const Sentence&>(mgr.GetInput());
+  if (system.GetSearchThreadPool() && sentence.GetSize() >= system.searchThreadsMinWords) {
+    for (size_t i = 1; i < system.searchThreads; ++i) {
+      m_workerPools.push_back(system.AcquireWorkerPools());
     }
-    //cerr << m_stacks.Debug(mgr.system) << endl;
   }
 }
 
@@ -76,6 +166,11 @@ void Search::Decode(size_t stackInd)
   const Hypotheses &hypos = stack.GetSortedAndPrunedHypos(mgr, mgr.arcLists);
   //cerr << "hypos=" << hypos.size() << endl;
 
+  if (!m_workerPools.empty()) {
+    DecodeParallel(hypos);
+    return;
+  }
+
   const InputPaths &paths = mgr.GetInputPaths();
 
   BOOST_FOREACH(const InputPathBase *path, paths) {
@@ -85,6 +180,151 @@ void Search::Decode(size_t stackInd)
   }
 }
 
+void Search::DecodeParallel(const Hypotheses &hypos)
+{
+  // Same loops and checks as the serial Extend(), but the new hypos are
+  // made by all threads and then added to the stacks by this thread, in
+  // the order the serial search would have added them
+  const InputPaths &paths = mgr.GetInputPaths();
+  const ReorderingConstraint &reorderingConstraint = mgr.GetInput().GetReorderingConstraint();
+  size_t numPt = mgr.system.mappings.size();
+  size_t numHypos = 0;
+
+  BOOST_FOREACH(const InputPathBase *pathBase, paths) {
+    const InputPath &path = *static_cast<const InputPath*>(pathBase);
+    const Range &pathRange = path.range;
+
+    BOOST_FOREACH(const HypothesisBase *hypoBase, hypos) {
+      const Hypothesis &hypo = *static_cast<const Hypothesis*>(hypoBase);
+      const Bitmap &hypoBitmap = hypo.GetBitmap();
+      const Range &hypoRange = hypo.GetInputPath().range;
+
+      if (!CanExtend(hypoBitmap, hypoRange.GetEndPos(), pathRange)) {
+        continue;
+      }
+      if (!reorderingConstraint.Check(hypoBitmap, pathRange.GetStartPos(), pathRange.GetEndPos())) {
+        continue;
+      }
+
+      // bitmaps are made in the same order as in the serial search
+      const Bitmap &newBitmap = mgr.GetBitmaps().GetBitmap(hypoBitmap, pathRange);
+
+      size_t numTps = 0;
+      for (size_t i = 0; i < numPt; ++i) {
+        const TargetPhrases *tps = path.targetPhrases[i];
+        if (tps) {
+          numTps += tps->GetSize();
+        }
+      }
+      if (numTps == 0) {
+        continue;
+      }
+
+      Expansion expansion;
+      expansion.hypo = &hypo;
+      expansion.path = &path;
+      expansion.newBitmap = &newBitmap;
+      expansion.estimatedScore = mgr.GetEstimatedScores().CalcEstimatedScore(newBitmap);
+      expansion.begin = numHypos;
+      expansion.worker = 0;
+      m_expansions.push_back(expansion);
+
+      numHypos += numTps;
+      if (numHypos >= kMaxBatchHypos) {
+        ExpandBatch();
+        numHypos = 0;
+      }
+    }
+  }
+
+  ExpandBatch();
+}
+
+void Search::ExpandBatch()
+{
+  if (m_expansions.empty()) {
+    return;
+  }
+
+  const Expansion &last = m_expansions.back();
+  size_t numHypos = last.begin;
+  for (size_t i = 0; i < mgr.system.mappings.size(); ++i) {
+    const TargetPhrases *tps = last.path->targetPhrases[i];
+    if (tps) {
+      numHypos += tps->GetSize();
+    }
+  }
+  m_newHypos.resize(numHypos);
+
+  boost::shared_ptr<ExpansionBatch> batch(new ExpansionBatch(m_expansions.size()));
+  size_t numChunks = (m_expansions.size() + kExpansionChunk - 1) / kExpansionChunk;
+  size_t numHelpers = std::min(m_workerPools.size(), numChunks - 1);
+
+  ThreadPool &threadPool = *mgr.system.GetSearchThreadPool();
+  for (size_t i = 1; i <= numHelpers; ++i) {
+    threadPool.Submit(boost::shared_ptr<Task>(new ExpansionTask(*this, batch, i)));
+  }
+
+  batch->Run(*this, 0);
+  {
+    boost::mutex::scoped_lock lock(batch->mutex);
+    while (batch->active) {
+      batch->finished.wait(lock);
+    }
+  }
+
+  // merge, in serial order. Discarded hypos go back to the thread that made them
+  for (size_t i = 0; i < m_expansions.size(); ++i) {
+    const Expansion &expansion = m_expansions[i];
+    size_t end = i + 1 < m_expansions.size() ? m_expansions[i + 1].begin : numHypos;
+    Recycler<HypothesisBase*> &hypoRecycle = expansion.worker
+        ? m_workerPools[expansion.worker - 1]->hypoRecycle
+        : mgr.GetHypoRecycle();
+
+    for (size_t j = expansion.begin; j < end; ++j) {
+      m_stacks.Add(m_newHypos[j], hypoRecycle, mgr.arcLists);
+    }
+  }
+
+  m_expansions.clear();
+  m_newHypos.clear();
+}
+
+void Search::Expand(size_t begin, size_t end, size_t worker)
+{
+  if (worker) {
+    ManagerBase::WorkerPoolsScope scope(*m_workerPools[worker - 1]);
+    for (size_t i = begin; i < end; ++i) {
+      Expand(m_expansions[i], worker);
+    }
+  } else {
+    for (size_t i = begin; i < end; ++i) {
+      Expand(m_expansions[i], worker);
+    }
+  }
+}
+
+void Search::Expand(Expansion &expansion, size_t worker)
+{
+  size_t ind = expansion.begin;
+  size_t numPt = mgr.system.mappings.size();
+  for (size_t i = 0; i < numPt; ++i) {
+    const TargetPhrases *tps = expansion.path->targetPhrases[i];
+    if (tps == NULL) {
+      continue;
+    }
+
+    BOOST_FOREACH(const TargetPhraseImpl *tp, *tps) {
+      Hypothesis *newHypo = Hypothesis::Create(mgr.GetSystemPool(), mgr);
+      newHypo->Init(mgr, *expansion.hypo, *expansion.path, *tp,
+                    *expansion.newBitmap, expansion.estimatedScore);
+      newHypo->EvaluateWhenApplied();
+      m_newHypos[ind++] = newHypo;
+    }
+  }
+  expansion.worker = worker;
+}
+
 void Search::Extend(const Hypothesis &hypo, const InputPath &path)
 {
   const Bitmap &hypoBitmap = hypo.GetBitmap();
@@ -144,15 +384,14 @@ const Hypothesis *Search::GetBestHypo() const
   return best;
 }
 
-void Search::AddInitialTrellisPaths(TrellisPaths<TrellisPath> &paths) const
+void Search::AddFinalHypos(KBestExtractor &extractor) const
 {
   const Stack &lastStack = m_stacks.Back();
   const Hypotheses &hypos = lastStack.GetSortedAndPrunedHypos(mgr, mgr.arcLists);
 
   BOOST_FOREACH(const HypothesisBase *hypoBase, hypos) {
     const Hypothesis *hypo = static_cast<const Hypothesis*>(hypoBase);
-    TrellisPath *path = new TrellisPath(hypo, mgr.arcLists);
-    paths.Add(path);
+    extractor.AddFinalHypo(*hypo);
   }
 }
 
@@ -19,6 +19,7 @@ class Hypothesis;
 class InputPath;
 class TargetPhrases;
 class TargetPhraseImpl;
+struct WorkerPools;
 
 namespace NSNormal
 {
@@ -33,17 +34,46 @@ public:
   virtual void Decode();
   const Hypothesis *GetBestHypo() const;
 
-  void AddInitialTrellisPaths(TrellisPaths<TrellisPath> &paths) const;
+  void AddFinalHypos(KBestExtractor &extractor) const;
+
+  // parallel extension of a stack, see search-threads.
+  // One hypo extended with the target phrases of one input path
+  struct Expansion {
+    const Hypothesis *hypo;
+    const InputPath *path;
+    const Bitmap *newBitmap;
+    SCORE estimatedScore;
+    size_t begin; // ind of its first new hypo in m_newHypos
+    size_t worker; // 0 = decoding thread, else m_workerPools[worker - 1]
+  };
+  struct ExpansionBatch;
+
+  // extend m_expansions[begin, end) in the calling thread
+  void Expand(size_t begin, size_t end, size_t worker);
 
 protected:
   Stacks m_stacks;
 
-  void Decode(size_t stackInd);
+  std::vector<WorkerPools*> m_workerPools;
+  std::vector<Expansion> m_expansions;
+  std::vector<Hypothesis*> m_newHypos;
+
+  // the initial hypo in the 1st stack, and the worker pools
+  void InitStacks();
+
+  // helper threads' pools, for sentences long enough to extend in parallel
+  virtual void InitWorkerPools();
+
+  virtual void Decode(size_t stackInd);
+  void DecodeParallel(const Hypotheses &hypos);
+  void ExpandBatch();
+  void Expand(Expansion &expansion, size_t worker);
+
   void Extend(const Hypothesis &hypo, const InputPath &path);
   void Extend(const Hypothesis &hypo, const TargetPhrases &tps,
               const InputPath &path, const Bitmap &newBitmap, SCORE estimatedScore);
-  void Extend(const Hypothesis &hypo, const TargetPhraseImpl &tp,
-              const InputPath &path, const Bitmap &newBitmap, SCORE estimatedScore);
+  virtual void Extend(const Hypothesis &hypo, const TargetPhraseImpl &tp,
+                      const InputPath &path, const Bitmap &newBitmap, SCORE estimatedScore);
 
 };
 
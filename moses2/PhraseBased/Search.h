@@ -18,10 +18,7 @@ class Stack;
 class Hypothesis;
 class Bitmap;
 class Range;
-class TrellisPath;
-
-template<typename T>
-class TrellisPaths;
+class KBestExtractor;
 
 class Search
 {
@@ -32,7 +29,7 @@ public:
   virtual void Decode() = 0;
   virtual const Hypothesis *GetBestHypo() const = 0;
 
-  virtual void AddInitialTrellisPaths(TrellisPaths<TrellisPath> &paths) const = 0;
+  virtual void AddFinalHypos(KBestExtractor &extractor) const = 0;
 
 protected:
   Manager &mgr;
@@ -0,0 +1,100 @@
+#include <sstream>
+#include <string>
+#include <boost/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "Manager.h"
+#include "../TestModel.h"
+
+using namespace Moses2;
+using namespace std;
+
+namespace
+{
+// a phrase table with several translations of each word and of pairs of
+// words, so each stack has many hypos to extend, and a language model and
+// distortion as the stateful feature functions
+class Model: public TestModel
+{
+public:
+  Model(size_t searchThreads) {
+    const char *words[] = { "a", "b", "c", "d" };
+    stringstream pt;
+    for (size_t i = 0; i < 4; ++i) {
+      for (size_t j = 0; j < 3; ++j) {
+        pt << words[i] << " ||| " << words[(i + j) % 4] << j
+           << " ||| 0." << 3 + j << " 0." << 5 - j << " 0." << 2 + i << " 0.4 ||| 0-0 ||| \n";
+      }
+      for (size_t k = 0; k < 4; ++k) {
+        pt << words[i] << " " << words[k] << " ||| " << words[k] << (i + k) % 3
+           << " " << words[i] << k % 3 << " ||| 0." << 1 + (i * k) % 8
+           << " 0.3 0.5 0." << 2 + k << " ||| 0-1 1-0 ||| \n";
+      }
+    }
+    Write("phrase-table", pt.str());
+
+    string lm = Write("lm.arpa",
+                      "\\data\\\nngram 1=6\nngram 2=4\n\n"
+                      "\\1-grams:\n"
+                      "-1.0\t<s>\t-0.3\n-0.8\t</s>\n-0.6\ta0\t-0.2\n"
+                      "-0.7\tb1\t-0.2\n-0.9\tc2\t-0.1\n-1.2\td0\t-0.1\n\n"
+                      "\\2-grams:\n"
+                      "-0.2\t<s> a0\n-0.3\ta0 b1\n-0.4\tb1 c2\n-0.3\tc2 d0\n\n"
+                      "\\end\\\n");
+
+    stringstream sections;
+    sections << "[distortion-limit]\n4\n"
+             << "[stack]\n100\n"
+             << "[search-threads]\n" << searchThreads << "\n"
+             << "[search-threads-min-words]\n10\n"
+             << "[n-best-list]\n" << GetPath("nbest") << "\n50\n";
+    Load(sections.str(),
+         "KENLM name=LM0 factor=0 order=2 path=" + lm + "\n",
+         "LM0= 0.5\n");
+  }
+};
+
+// long enough for the stacks to be extended by several threads
+string Sentence()
+{
+  const char *words[] = { "a", "b", "c", "d" };
+  stringstream ret;
+  for (size_t i = 0; i < 30; ++i) {
+    ret << (i ? " " : "") << words[(i * 7 + i / 4) % 4];
+  }
+  return ret.str();
+}
+
+void Decode(Model &model, string &output)
+{
+  Manager mgr(model.GetSystem(), model.GetTask(), Sentence(), 0);
+  mgr.Decode();
+  output = mgr.OutputBest() + "\n" + mgr.OutputNBest();
+}
+
+// best translation and n-best list with searchThreads threads
+string Output(size_t searchThreads)
+{
+  Model model(searchThreads);
+
+  // hypos are recycled within a thread, and are the size the 1st system on
+  // it needed. Decode on a new thread, as the decoder's workers do, so the
+  // models of other tests don't matter
+  string output;
+  boost::thread(Decode, boost::ref(model), boost::ref(output)).join();
+  return output;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(search_threads)
+
+BOOST_AUTO_TEST_CASE(same_output)
+{
+  string serial = Output(1);
+  BOOST_REQUIRE(!serial.empty());
+  BOOST_CHECK_EQUAL(serial, Output(2));
+  BOOST_CHECK_EQUAL(serial, Output(4));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
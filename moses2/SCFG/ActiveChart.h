@@ -57,10 +57,14 @@ public:
 
   SymbolBind(MemPool &pool);
 
+  // in 'pool', not the pool of 'copy', which may belong to another thread.
+  // Room for the element that is usually added next
   SymbolBind(MemPool &pool, const SymbolBind &copy)
-    :coll(copy.coll)
-    ,numNT(copy.numNT)
-  {}
+    :coll(pool)
+    ,numNT(copy.numNT) {
+    coll.reserve(copy.coll.size() + 1);
+    coll.insert(coll.end(), copy.coll.begin(), copy.coll.end());
+  }
 
   size_t GetSize() const {
     return coll.size();
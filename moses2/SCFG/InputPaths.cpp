@@ -42,29 +42,39 @@ void InputPaths::Init(const InputType &input, const ManagerBase &mgr)
     //cerr << "path=" << *path << endl;
     m_inputPaths.push_back(path);
     m_matrix->SetValue(startPos, 0, path);
+  }
 
-    // create normal paths of subphrases through the sentence
-    const SCFG::InputPath *prefixPath = path;
-    for (size_t phaseSize = 1; phaseSize <= size; ++phaseSize) {
-      size_t endPos = startPos + phaseSize - 1; // pb-like indexing. eg. [1-1] covers 1 word, NOT 0
+}
 
-      if (endPos >= size) {
-        break;
-      }
+SCFG::InputPath &InputPaths::CreatePath(const ManagerBase &mgr, size_t startPos, size_t phaseSize)
+{
+  const Sentence &sentence = static_cast<const Sentence&>(mgr.GetInput());
+  MemPool &pool = mgr.GetPool();
+  size_t numPt = mgr.system.mappings.size();
+  size_t endPos = startPos + phaseSize - 1; // pb-like indexing. eg. [1-1] covers 1 word, NOT 0
 
-      SubPhrase<SCFG::Word> subPhrase = sentence.GetSubPhrase(startPos, phaseSize);
-      Range range(startPos, endPos);
+  SubPhrase<SCFG::Word> subPhrase = sentence.GetSubPhrase(startPos, phaseSize);
+  Range range(startPos, endPos);
 
-      SCFG::InputPath *path = new (pool.Allocate<SCFG::InputPath>())
-      SCFG::InputPath(pool, subPhrase, range, numPt, prefixPath);
-      //cerr << "path=" << *path << endl;
-      m_inputPaths.push_back(path);
+  const SCFG::InputPath *prefixPath = m_matrix->GetValue(startPos, phaseSize - 1);
+  assert(prefixPath);
 
-      prefixPath = path;
-      m_matrix->SetValue(startPos, phaseSize, path);
-    }
-  }
+  SCFG::InputPath *path = new (pool.Allocate<SCFG::InputPath>())
+  SCFG::InputPath(pool, subPhrase, range, numPt, prefixPath);
+  //cerr << "path=" << *path << endl;
+
+  m_matrix->SetValue(startPos, phaseSize, path);
+  return *path;
+}
 
+void InputPaths::Add(size_t phaseSize)
+{
+  size_t size = m_matrix->GetRows();
+  for (size_t startPos = 0; startPos + phaseSize <= size; ++startPos) {
+    SCFG::InputPath *path = m_matrix->GetValue(startPos, phaseSize);
+    assert(path);
+    m_inputPaths.push_back(path);
+  }
 }
 
 std::string InputPaths::Debug(const System &system) const
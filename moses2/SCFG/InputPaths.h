@@ -24,8 +24,17 @@ class InputPath;
 class InputPaths: public InputPathsBase
 {
 public:
+  // only the 0 length paths. The others are made as they are needed, by
+  // CreatePath(), so they're in the pool of the thread that uses them
   void Init(const InputType &input, const ManagerBase &mgr);
 
+  // path of the span, from the calling thread's pool. Its prefix path must exist
+  SCFG::InputPath &CreatePath(const ManagerBase &mgr, size_t startPos, size_t phaseSize);
+
+  // add the paths of all spans of this size, once they're made, to the paths
+  // iterated over
+  void Add(size_t phaseSize);
+
   const Matrix<InputPath*> &GetMatrix() const {
     return *m_matrix;
   }
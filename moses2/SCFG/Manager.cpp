@@ -5,10 +5,15 @@
  *      Author: hieu
  */
 #include <boost/foreach.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <vector>
 #include <sstream>
 #include "../System.h"
+#include "../legacy/ThreadPool.h"
 #include "../TranslationModel/PhraseTable.h"
 #include "Manager.h"
 #include "InputPath.h"
@@ -27,20 +32,86 @@ namespace Moses2
 namespace SCFG
 {
 
+// the spans of a size not yet claimed by a thread
+struct Manager::SpanBatch {
+  SpanBatch(size_t vPhraseSize, size_t vNumSpans)
+    :phraseSize(vPhraseSize)
+    ,numSpans(vNumSpans)
+    ,next(0)
+    ,active(0) {
+  }
+
+  size_t phraseSize;
+  size_t numSpans;
+  std::atomic<size_t> next; // start pos of the next span
+  std::atomic<size_t> active; // helpers that may still be decoding
+
+  boost::mutex mutex;
+  boost::condition_variable finished;
+
+  // decode the spans the calling thread can claim
+  void Run(Manager &mgr, size_t worker) {
+    if (worker) {
+      // announce before claiming, so the decoding thread waits for this one
+      ++active;
+    }
+
+    size_t startPos;
+    while ((startPos = next++) < numSpans) {
+      mgr.DecodeSpan(startPos, phraseSize, worker);
+    }
+
+    if (worker && --active == 0) {
+      boost::mutex::scoped_lock lock(mutex);
+      finished.notify_all();
+    }
+  }
+};
+
+namespace
+{
+// A helper thread's share of a batch. A helper that only starts after the
+// batch is done finds nothing to claim and never touches the manager
+class SpanTask: public Task
+{
+public:
+  SpanTask(Manager &mgr, const boost::shared_ptr<Manager::SpanBatch> &batch,
+           size_t worker)
+    :m_mgr(mgr)
+    ,m_batch(batch)
+    ,m_worker(worker) {
+  }
+
+  virtual void Run() {
+    m_batch->Run(m_mgr, m_worker);
+  }
+
+protected:
+  Manager &m_mgr;
+  boost::shared_ptr<Manager::SpanBatch> m_batch;
+  size_t m_worker;
+};
+}
+
 Manager::Manager(System &sys, const TranslationTask &task,
                  const std::string &inputStr, long translationId)
   :ManagerBase(sys, task, inputStr, translationId)
+  ,m_workers(1)
 {
 
 }
 
 Manager::~Manager()
 {
-
+  for (size_t i = 1; i < m_workers.size(); ++i) {
+    system.ReleaseWorkerPools(m_workers[i].pools);
+  }
 }
 
 void Manager::Decode()
 {
+  m_deadline.Start();
+
   // init pools etc
   //cerr << "START InitPools()" << endl;
   InitPools();
@@ -61,33 +132,46 @@ void Manager::Decode()
   m_stacks.Init(*this, inputSize);
   //cerr << "CREATED m_stacks" << endl;
 
-  for (int startPos = inputSize - 1; startPos >= 0; --startPos) {
-    //cerr << endl << "startPos=" << startPos << endl;
+  // arc lists are shared by all spans, so n-best decoding stays serial
+  if (system.GetSearchThreadPool() && inputSize >= system.searchThreadsMinWords
+      && system.options.nbest.nbest_size == 0) {
+    m_workers.resize(system.searchThreads);
+    for (size_t i = 1; i < m_workers.size(); ++i) {
+      m_workers[i].pools = system.AcquireWorkerPools();
+    }
+  }
+
+  for (size_t startPos = 0; startPos < inputSize; ++startPos) {
     SCFG::InputPath &initPath = *m_inputPaths.GetMatrix().GetValue(startPos, 0);
 
     //cerr << "BEFORE InitActiveChart=" << initPath.Debug(system) << endl;
     InitActiveChart(initPath);
     //cerr << "AFTER InitActiveChart=" << initPath.Debug(system) << endl;
+  }
 
-    int maxPhraseSize = inputSize - startPos + 1;
-    for (int phraseSize = 1; phraseSize < maxPhraseSize; ++phraseSize) {
-      //cerr << endl << "phraseSize=" << phraseSize << endl;
-
-      SCFG::InputPath &path = *m_inputPaths.GetMatrix().GetValue(startPos, phraseSize);
-
-      Stack &stack = m_stacks.GetStack(startPos, phraseSize);
-
-      //cerr << "BEFORE LOOKUP path=" << path.Debug(system) << endl;
-      Lookup(path);
-      //cerr << "AFTER LOOKUP path="  << path.Debug(system) << endl;
-      Decode(path, stack);
-      //cerr << "AFTER DECODE path=" << path.Debug(system) << endl;
-
-      LookupUnary(path);
-      //cerr << "AFTER LookupUnary path=" << path.Debug(system) << endl;
-
-      //cerr << "#rules=" << path.GetNumRules() << endl;
+  // Spans are decoded shortest first. A span only needs the stacks and
+  // chart entries of shorter spans, so the spans of a size can be decoded
+  // in any order, or in parallel.
+  // Every span is a step of the deadline
+  size_t numSpans = inputSize * (inputSize + 1) / 2;
+  size_t spanInd = 0;
+
+  for (size_t phraseSize = 1; phraseSize <= inputSize; ++phraseSize) {
+    //cerr << endl << "phraseSize=" << phraseSize << endl;
+    size_t numStarts = inputSize - phraseSize + 1;
+
+    if (m_workers.size() > 1 && numStarts > 1) {
+      m_deadline.Update(spanInd, numSpans, numStarts);
+      DecodeSpans(phraseSize, numStarts);
+      spanInd += numStarts;
+    } else {
+      for (size_t startPos = 0; startPos < numStarts; ++startPos) {
+        m_deadline.Update(spanInd++, numSpans);
+        DecodeSpan(startPos, phraseSize, m_workers[0]);
+      }
     }
+
+    m_inputPaths.Add(phraseSize);
   }
 
   /*
@@ -98,6 +182,57 @@ void Manager::Decode()
   //m_stacks.OutputStacks();
 }
 
+void Manager::DecodeSpans(size_t phraseSize, size_t numSpans)
+{
+  boost::shared_ptr<SpanBatch> batch(new SpanBatch(phraseSize, numSpans));
+  size_t numHelpers = std::min(m_workers.size() - 1, numSpans - 1);
+
+  ThreadPool &threadPool = *system.GetSearchThreadPool();
+  for (size_t i = 1; i <= numHelpers; ++i) {
+    threadPool.Submit(boost::shared_ptr<Task>(new SpanTask(*this, batch, i)));
+  }
+
+  batch->Run(*this, 0);
+
+  boost::mutex::scoped_lock lock(batch->mutex);
+  while (batch->active) {
+    batch->finished.wait(lock);
+  }
+}
+
+void Manager::DecodeSpan(size_t startPos, size_t phraseSize, size_t worker)
+{
+  SpanWorker &spanWorker = m_workers[worker];
+  if (spanWorker.pools) {
+    ManagerBase::WorkerPoolsScope scope(*spanWorker.pools);
+    DecodeSpan(startPos, phraseSize, spanWorker);
+  } else {
+    DecodeSpan(startPos, phraseSize, spanWorker);
+  }
+}
+
+void Manager::DecodeSpan(size_t startPos, size_t phraseSize, SpanWorker &worker)
+{
+  // the path, its chart entries and rules are made by the thread that
+  // decodes the span. Each thread's pool holds the spans it decoded one size
+  // after the other, so the chart entries that a lookup of the next size
+  // walks are close together
+  SCFG::InputPath &path = m_inputPaths.CreatePath(*this, startPos, phraseSize);
+  Stack &stack = m_stacks.GetStack(startPos, phraseSize);
+
+  //cerr << "BEFORE LOOKUP path=" << path.Debug(system) << endl;
+  Lookup(path);
+  //cerr << "AFTER LOOKUP path="  << path.Debug(system) << endl;
+  Decode(path, stack, worker);
+  //cerr << "AFTER DECODE path=" << path.Debug(system) << endl;
+
+  // also sorts and prunes the span's stack, before other spans read it
+  LookupUnary(path);
+  //cerr << "AFTER LookupUnary path=" << path.Debug(system) << endl;
+
+  //cerr << "#rules=" << path.GetNumRules() << endl;
+}
+
 void Manager::InitActiveChart(SCFG::InputPath &path)
 {
   size_t numPt = system.mappings.size();
@@ -113,11 +248,13 @@ void Manager::InitActiveChart(SCFG::InputPath &path)
 
 void Manager::Lookup(SCFG::InputPath &path)
 {
+  FeatureProfiler::Counters *counters = system.featureFunctions.GetProfilerCounters();
   size_t numPt = system.mappings.size();
   //cerr << "numPt=" << numPt << endl;
 
   for (size_t i = 0; i < numPt; ++i) {
     const PhraseTable &pt = *system.mappings[i];
+    FeatureProfiler::Scope scope(counters, pt.GetIndex(), FeatureProfiler::Lookup);
     size_t maxChartSpan = system.maxChartSpans[i];
     pt.Lookup(GetPool(), *this, maxChartSpan, m_stacks, path);
   }
@@ -132,11 +269,13 @@ void Manager::Lookup(SCFG::InputPath &path)
 
 void Manager::LookupUnary(SCFG::InputPath &path)
 {
+  FeatureProfiler::Counters *counters = system.featureFunctions.GetProfilerCounters();
   size_t numPt = system.mappings.size();
   //cerr << "numPt=" << numPt << endl;
 
   for (size_t i = 0; i < numPt; ++i) {
     const PhraseTable &pt = *system.mappings[i];
+    FeatureProfiler::Scope scope(counters, pt.GetIndex(), FeatureProfiler::Lookup);
     pt.LookupUnary(GetPool(), *this, m_stacks, path);
   }
 
@@ -151,39 +290,42 @@ void Manager::LookupUnary(SCFG::InputPath &path)
 ///////////////////////////////////////////////////////////////
 // CUBE-PRUNING
 ///////////////////////////////////////////////////////////////
-void Manager::Decode(SCFG::InputPath &path, Stack &stack)
+void Manager::Decode(SCFG::InputPath &path, Stack &stack, SpanWorker &worker)
 {
+  Queue &queue = worker.queue;
+
   // clear cube pruning data
-  //std::vector<QueueItem*> &container = Container(m_queue);
+  //std::vector<QueueItem*> &container = Container(queue);
   //container.clear();
   Recycler<HypothesisBase*> &hypoRecycler = GetHypoRecycle();
-  while (!m_queue.empty()) {
-    QueueItem *item = m_queue.top();
-    m_queue.pop();
+  while (!queue.empty()) {
+    QueueItem *item = queue.top();
+    queue.pop();
     // recycle unused hypos from queue
     Hypothesis *hypo = item->hypo;
     hypoRecycler.Recycle(hypo);
 
     // recycle queue item
-    m_queueItemRecycler.push_back(item);
+    worker.queueItemRecycler.push_back(item);
   }
 
-  m_seenPositions.clear();
+  worker.seenPositions.clear();
 
   // init queue
   BOOST_FOREACH(const InputPath::Coll::value_type &valPair, path.targetPhrases) {
     const SymbolBind &symbolBind = valPair.first;
     const SCFG::TargetPhrases &tps = *valPair.second;
 
-    CreateQueue(path, symbolBind, tps);
+    CreateQueue(path, symbolBind, tps, worker);
   }
 
   // MAIN LOOP
+  size_t popLimit = GetPopLimit();
   size_t pops = 0;
-  while (!m_queue.empty() && pops < system.options.cube.pop_limit) {
+  while (!queue.empty() && pops < popLimit) {
     //cerr << "pops=" << pops << endl;
-    QueueItem *item = m_queue.top();
-    m_queue.pop();
+    QueueItem *item = queue.top();
+    queue.pop();
 
     // add hypo to stack
     Hypothesis *hypo = item->hypo;
@@ -192,9 +334,10 @@ void Manager::Decode(SCFG::InputPath &path, Stack &stack)
     stack.Add(hypo, GetHypoRecycle(), arcLists);
     //cerr << "Added " << *hypo << " " << endl;
 
-    item->CreateNext(GetSystemPool(), GetPool(), *this, m_queue, m_seenPositions, path);
+    item->CreateNext(GetSystemPool(), GetPool(), *this, queue, worker.seenPositions,
+                     worker.queueItemRecycler, path);
     //cerr << "Created next " << endl;
-    m_queueItemRecycler.push_back(item);
+    worker.queueItemRecycler.push_back(item);
 
     ++pops;
   }
@@ -204,15 +347,16 @@ void Manager::Decode(SCFG::InputPath &path, Stack &stack)
 void Manager::CreateQueue(
   const SCFG::InputPath &path,
   const SymbolBind &symbolBind,
-  const SCFG::TargetPhrases &tps)
+  const SCFG::TargetPhrases &tps,
+  SpanWorker &worker)
 {
   MemPool &pool = GetPool();
 
   SeenPosition *seenItem = new (pool.Allocate<SeenPosition>()) SeenPosition(pool, symbolBind, tps, symbolBind.numNT);
-  bool unseen = m_seenPositions.Add(seenItem);
+  bool unseen = worker.seenPositions.Add(seenItem);
   assert(unseen);
 
-  QueueItem *item = QueueItem::Create(GetPool(), *this);
+  QueueItem *item = QueueItem::Create(GetPool(), worker.queueItemRecycler);
   item->Init(GetPool(), symbolBind, tps, seenItem->hypoIndColl);
   for (size_t i = 0; i < symbolBind.coll.size(); ++i) {
     const SymbolBindElement &ele = symbolBind.coll[i];
@@ -226,7 +370,7 @@ void Manager::CreateQueue(
 
   //cerr << "hypo=" << item->hypo->Debug(system) << endl;
 
-  m_queue.push(item);
+  worker.queue.push(item);
 }
 
 ///////////////////////////////////////////////////////////////
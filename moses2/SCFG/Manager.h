@@ -11,6 +11,7 @@
 #include <cstddef>
 #include <string>
 #include <deque>
+#include <vector>
 #include "../ManagerBase.h"
 #include "Stacks.h"
 #include "InputPaths.h"
@@ -18,6 +19,7 @@
 
 namespace Moses2
 {
+struct WorkerPools;
 
 namespace SCFG
 {
@@ -41,14 +43,29 @@ public:
     return m_inputPaths;
   }
 
-  QueueItemRecycler &GetQueueItemRecycler() {
-    return m_queueItemRecycler;
-  }
-
   const Stacks &GetStacks() const {
     return m_stacks;
   }
 
+  // A thread that decodes spans. m_workers[0] is the decoding thread, the
+  // others help it decode the spans of a size in parallel. See search-threads
+  struct SpanWorker {
+    SpanWorker()
+      :pools(NULL) {
+    }
+
+    WorkerPools *pools; // NULL for the decoding thread
+
+    // cube pruning
+    Queue queue;
+    SeenPositions seenPositions;
+    QueueItemRecycler queueItemRecycler;
+  };
+  struct SpanBatch;
+
+  // lookup and decode the span in the calling thread
+  void DecodeSpan(size_t startPos, size_t phraseSize, size_t worker);
+
 protected:
   Stacks m_stacks;
   SCFG::InputPaths m_inputPaths;
@@ -56,7 +73,9 @@ protected:
   void InitActiveChart(SCFG::InputPath &path);
   void Lookup(SCFG::InputPath &path);
   void LookupUnary(SCFG::InputPath &path);
-  void Decode(SCFG::InputPath &path, Stack &stack);
+  void DecodeSpans(size_t phraseSize, size_t numSpans);
+  void DecodeSpan(size_t startPos, size_t phraseSize, SpanWorker &worker);
+  void Decode(SCFG::InputPath &path, Stack &stack, SpanWorker &worker);
 
   void ExpandHypo(
     const SCFG::InputPath &path,
@@ -69,16 +88,14 @@ protected:
     size_t ind,
     const std::vector<const SymbolBindElement*> ntEles);
 
-  // cube pruning
-  Queue m_queue;
-  SeenPositions m_seenPositions;
-
-  QueueItemRecycler m_queueItemRecycler;
+  std::vector<SpanWorker> m_workers;
 
+  // cube pruning
   void CreateQueue(
     const SCFG::InputPath &path,
     const SymbolBind &symbolBind,
-    const SCFG::TargetPhrases &tps);
+    const SCFG::TargetPhrases &tps,
+    SpanWorker &worker);
 };
 
 }
@@ -95,12 +95,11 @@ bool SeenPositions::Add(const SeenPosition *item)
 }
 
 ////////////////////////////////////////////////////////
-QueueItem *QueueItem::Create(MemPool &pool, SCFG::Manager &mgr)
+QueueItem *QueueItem::Create(MemPool &pool, QueueItemRecycler &queueItemRecycler)
 {
   //QueueItem *item = new (pool.Allocate<QueueItem>()) QueueItem(pool);
   //return item;
 
-  QueueItemRecycler &queueItemRecycler = mgr.GetQueueItemRecycler();
   QueueItem *ret;
   if (!queueItemRecycler.empty()) {
     // use item from recycle bin
@@ -172,6 +171,7 @@ void QueueItem::CreateNext(
   SCFG::Manager &mgr,
   SCFG::Queue &queue,
   SeenPositions &seenPositions,
+  QueueItemRecycler &queueItemRecycler,
   const SCFG::InputPath &path)
 {
   //cerr << "tpInd=" << tpInd << " " << tps->GetSize() << endl;
@@ -182,7 +182,7 @@ void QueueItem::CreateNext(
     bool unseen = seenPositions.Add(seenItem);
 
     if (unseen) {
-      QueueItem *item = QueueItem::Create(mgrPool, mgr);
+      QueueItem *item = QueueItem::Create(mgrPool, queueItemRecycler);
       item->Init(mgrPool, *symbolBind, *tps, tpInd + 1, *m_hypoIndColl);
       item->m_hyposColl = m_hyposColl;
       item->CreateHypo(systemPool, mgr, path, *symbolBind);
@@ -203,7 +203,7 @@ void QueueItem::CreateNext(
       bool unseen = seenPositions.Add(seenItem);
 
       if (unseen) {
-        QueueItem *item = QueueItem::Create(mgrPool, mgr);
+        QueueItem *item = QueueItem::Create(mgrPool, queueItemRecycler);
         item->Init(mgrPool, *symbolBind, *tps, tpInd, seenItem->hypoIndColl);
 
         item->m_hyposColl = m_hyposColl;
@@ -7,6 +7,7 @@
 #pragma once
 #include <vector>
 #include <queue>
+#include <deque>
 #include <boost/unordered_set.hpp>
 #include "../HypothesisColl.h"
 #include "../Vector.h"
@@ -20,6 +21,9 @@ namespace SCFG
 class SymbolBind;
 class TargetPhrases;
 class Queue;
+class QueueItem;
+
+typedef std::deque<QueueItem*> QueueItemRecycler;
 
 ///////////////////////////////////////////
 class SeenPosition
@@ -71,7 +75,7 @@ class QueueItem
 public:
   SCFG::Hypothesis *hypo;
 
-  static QueueItem *Create(MemPool &pool, SCFG::Manager &mgr);
+  static QueueItem *Create(MemPool &pool, QueueItemRecycler &queueItemRecycler);
 
   void Init(
     MemPool &pool,
@@ -97,6 +101,7 @@ public:
     SCFG::Manager &mgr,
     SCFG::Queue &queue,
     SeenPositions &seenPositions,
+    QueueItemRecycler &queueItemRecycler,
     const SCFG::InputPath &path);
 
   std::string Debug(const System &system) const;
@@ -116,10 +121,6 @@ protected:
 
 };
 
-///////////////////////////////////////////
-
-typedef std::deque<QueueItem*> QueueItemRecycler;
-
 ///////////////////////////////////////////
 class QueueItemOrderer
 {
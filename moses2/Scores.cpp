@@ -8,6 +8,7 @@
 #include <boost/foreach.hpp>
 #include <vector>
 #include <cstddef>
+#include <cstring>
 #include <stdio.h>
 #include "Scores.h"
 #include "Weights.h"
@@ -21,6 +22,85 @@ using namespace std;
 namespace Moses2
 {
 
+namespace
+{
+// Dense score kernels. N is the feature's number of scores, a compile time
+// constant for the common widths so the loops are unrolled and vectorized.
+// The weighted sum is done in 4 lanes, not 1 running total, so it doesn't
+// serialize on the float additions
+template<size_t N>
+inline SCORE WeightedSum(const SCORE *scores, const SCORE *weights)
+{
+  SCORE lanes[4] = { 0, 0, 0, 0 };
+  for (size_t i = 0; i < N; ++i) {
+    lanes[i % 4] += scores[i] * weights[i];
+  }
+  return (lanes[0] + lanes[2]) + (lanes[1] + lanes[3]);
+}
+
+inline SCORE WeightedSum(const SCORE *scores, const SCORE *weights, size_t num)
+{
+  switch (num) {
+  case 1:
+    return scores[0] * weights[0];
+  case 4:
+    return WeightedSum<4>(scores, weights);
+  case 5:
+    return WeightedSum<5>(scores, weights);
+  case 6:
+    return WeightedSum<6>(scores, weights);
+  case 8:
+    return WeightedSum<8>(scores, weights);
+  }
+
+  SCORE lanes[4] = { 0, 0, 0, 0 };
+  size_t i = 0;
+  for (; i + 4 <= num; i += 4) {
+    lanes[0] += scores[i] * weights[i];
+    lanes[1] += scores[i + 1] * weights[i + 1];
+    lanes[2] += scores[i + 2] * weights[i + 2];
+    lanes[3] += scores[i + 3] * weights[i + 3];
+  }
+  for (; i < num; ++i) {
+    lanes[i % 4] += scores[i] * weights[i];
+  }
+  return (lanes[0] + lanes[2]) + (lanes[1] + lanes[3]);
+}
+
+template<size_t N>
+inline void Add(SCORE *dest, const SCORE *scores)
+{
+  for (size_t i = 0; i < N; ++i) {
+    dest[i] += scores[i];
+  }
+}
+
+inline void Add(SCORE *dest, const SCORE *scores, size_t num)
+{
+  switch (num) {
+  case 1:
+    dest[0] += scores[0];
+    return;
+  case 4:
+    Add<4>(dest, scores);
+    return;
+  case 5:
+    Add<5>(dest, scores);
+    return;
+  case 6:
+    Add<6>(dest, scores);
+    return;
+  case 8:
+    Add<8>(dest, scores);
+    return;
+  }
+
+  for (size_t i = 0; i < num; ++i) {
+    dest[i] += scores[i];
+  }
+}
+}
+
 Scores::Scores(const System &system, MemPool &pool, size_t numScores) :
   m_total(0)
 {
@@ -100,47 +180,27 @@ void Scores::PlusEquals(const System &system,
                         const FeatureFunction &featureFunction, const std::vector<SCORE> &scores)
 {
   assert(scores.size() == featureFunction.GetNumScores());
-
-  const Weights &weights = system.weights;
-
-  size_t ffStartInd = featureFunction.GetStartInd();
-  for (size_t i = 0; i < scores.size(); ++i) {
-    SCORE incrScore = scores[i];
-    if (system.options.nbest.nbest_size) {
-      m_scores[ffStartInd + i] += incrScore;
-    }
-    //cerr << "ffStartInd=" << ffStartInd << " " << i << endl;
-    SCORE weight = weights[ffStartInd + i];
-    m_total += incrScore * weight;
-  }
+  PlusEquals(system, featureFunction, scores.data());
 }
 
 void Scores::PlusEquals(const System &system,
-                        const FeatureFunction &featureFunction, SCORE scores[])
+                        const FeatureFunction &featureFunction, const SCORE scores[])
 {
-  //assert(scores.size() == featureFunction.GetNumScores());
-
-  const Weights &weights = system.weights;
-
   size_t ffStartInd = featureFunction.GetStartInd();
-  for (size_t i = 0; i < featureFunction.GetNumScores(); ++i) {
-    SCORE incrScore = scores[i];
-    if (system.options.nbest.nbest_size) {
-      m_scores[ffStartInd + i] += incrScore;
-    }
-    //cerr << "ffStartInd=" << ffStartInd << " " << i << endl;
-    SCORE weight = weights[ffStartInd + i];
-    m_total += incrScore * weight;
+  size_t numScores = featureFunction.GetNumScores();
+
+  if (system.options.nbest.nbest_size) {
+    Add(m_scores + ffStartInd, scores, numScores);
   }
+  //cerr << "ffStartInd=" << ffStartInd << endl;
+  m_total += WeightedSum(scores, system.weights.GetWeightsPtr(ffStartInd), numScores);
 }
 
 void Scores::PlusEquals(const System &system, const Scores &other)
 {
   size_t numScores = system.featureFunctions.GetNumScores();
   if (system.options.nbest.nbest_size) {
-    for (size_t i = 0; i < numScores; ++i) {
-      m_scores[i] += other.m_scores[i];
-    }
+    Add(m_scores, other.m_scores, numScores);
   }
   m_total += other.m_total;
 }
@@ -178,21 +238,19 @@ void Scores::Assign(const System &system,
                     const FeatureFunction &featureFunction, const std::vector<SCORE> &scores)
 {
   assert(scores.size() == featureFunction.GetNumScores());
-
-  const Weights &weights = system.weights;
+  if (scores.empty()) {
+    return;
+  }
 
   size_t ffStartInd = featureFunction.GetStartInd();
-  for (size_t i = 0; i < scores.size(); ++i) {
-    SCORE incrScore = scores[i];
-
-    if (system.options.nbest.nbest_size) {
+  if (system.options.nbest.nbest_size) {
+    for (size_t i = 0; i < scores.size(); ++i) {
       assert(m_scores[ffStartInd + i] == 0);
-      m_scores[ffStartInd + i] = incrScore;
     }
-    //cerr << "ffStartInd=" << ffStartInd << " " << i << endl;
-    SCORE weight = weights[ffStartInd + i];
-    m_total += incrScore * weight;
+    memcpy(m_scores + ffStartInd, &scores[0], sizeof(SCORE) * scores.size());
   }
+  //cerr << "ffStartInd=" << ffStartInd << endl;
+  m_total += WeightedSum(&scores[0], system.weights.GetWeightsPtr(ffStartInd), scores.size());
 }
 
 void Scores::CreateFromString(const std::string &str,
@@ -248,22 +306,11 @@ void Scores::OutputBreakdown(std::ostream &out, const System &system) const
 
 // static functions to work out estimated scores
 SCORE Scores::CalcWeightedScore(const System &system,
-                                const FeatureFunction &featureFunction, SCORE scores[])
+                                const FeatureFunction &featureFunction, const SCORE scores[])
 {
-  SCORE ret = 0;
-
-  const Weights &weights = system.weights;
-
   size_t ffStartInd = featureFunction.GetStartInd();
-  for (size_t i = 0; i < featureFunction.GetNumScores(); ++i) {
-    SCORE incrScore = scores[i];
-
-    //cerr << "ffStartInd=" << ffStartInd << " " << i << endl;
-    SCORE weight = weights[ffStartInd + i];
-    ret += incrScore * weight;
-  }
-
-  return ret;
+  return WeightedSum(scores, system.weights.GetWeightsPtr(ffStartInd),
+                     featureFunction.GetNumScores());
 }
 
 SCORE Scores::CalcWeightedScore(const System &system,
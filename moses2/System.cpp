@@ -10,8 +10,10 @@
 #include <boost/thread.hpp>
 #include <boost/thread/mutex.hpp>
 #include "System.h"
+#include "ManagerBase.h"
 #include "FF/FeatureFunction.h"
 #include "TranslationModel/UnknownWordPenalty.h"
+#include "legacy/ThreadPool.h"
 #include "legacy/Util2.h"
 #include "util/exception.hh"
 
@@ -34,6 +36,13 @@ System::System(const Parameter &paramsArg) :
 
   params.SetParameter(cpuAffinityOffset, "cpu-affinity-offset", -1);
   params.SetParameter(cpuAffinityOffsetIncr, "cpu-affinity-increment", 1);
+  params.SetParameter<size_t>(memPoolStats, "mem-pool-stats", 0);
+  params.SetParameter<size_t>(searchThreads, "search-threads", 1);
+  params.SetParameter<size_t>(searchThreadsMinWords, "search-threads-min-words", 50);
+  if (searchThreads > 1) {
+    // the decoding thread is one of them
+    m_searchThreadPool.reset(new ThreadPool(searchThreads - 1));
+  }
 
   const PARAM_VEC *section;
 
@@ -86,6 +95,8 @@ System::System(const Parameter &paramsArg) :
 
 System::~System()
 {
+  m_searchThreadPool.reset();
+  RemoveAllInColl(m_freeWorkerPools);
 }
 
 void System::LoadWeights()
@@ -197,6 +208,26 @@ Batch &System::GetBatch(MemPool &pool) const
   return *obj;
 }
 
+WorkerPools *System::AcquireWorkerPools() const
+{
+  boost::mutex::scoped_lock lock(m_workerPoolsMutex);
+  if (m_freeWorkerPools.empty()) {
+    return new WorkerPools();
+  }
+  WorkerPools *ret = m_freeWorkerPools.back();
+  m_freeWorkerPools.pop_back();
+  return ret;
+}
+
+void System::ReleaseWorkerPools(WorkerPools *pools) const
+{
+  pools->pool.Reset();
+  pools->hypoRecycle.Clear();
+
+  boost::mutex::scoped_lock lock(m_workerPoolsMutex);
+  m_freeWorkerPools.push_back(pools);
+}
+
 void System::IsPb()
 {
   switch (options.search.algo) {
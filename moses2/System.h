@@ -11,6 +11,8 @@
 #include <boost/thread/tss.hpp>
 #include <boost/pool/object_pool.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 #include "FF/FeatureFunctions.h"
 #include "Weights.h"
 #include "MemPool.h"
@@ -33,6 +35,8 @@ class FeatureFunction;
 class StatefulFeatureFunction;
 class PhraseTable;
 class HypothesisBase;
+class ThreadPool;
+struct WorkerPools;
 
 class System
 {
@@ -51,6 +55,13 @@ public:
   // moses.ini params
   int cpuAffinityOffset;
   int cpuAffinityOffsetIncr;
+  size_t memPoolStats;
+
+  // extend the hypos of a stack (normal search) or decode the spans of a
+  // size (SCFG) in this many threads, for sentences of at least
+  // searchThreadsMinWords words
+  size_t searchThreads;
+  size_t searchThreadsMinWords;
 
   System(const Parameter &paramsArg);
   virtual ~System();
@@ -63,6 +74,14 @@ public:
 
   Batch &GetBatch(MemPool &pool) const;
 
+  // NULL if search-threads isn't set
+  ThreadPool *GetSearchThreadPool() const {
+    return m_searchThreadPool.get();
+  }
+
+  WorkerPools *AcquireWorkerPools() const;
+  void ReleaseWorkerPools(WorkerPools *pools) const;
+
 protected:
   mutable FactorCollection m_vocab;
   //mutable boost::thread_specific_ptr<MemPool> m_managerPool;
@@ -75,6 +94,10 @@ protected:
 
   mutable boost::thread_specific_ptr<Batch> m_batch;
 
+  boost::scoped_ptr<ThreadPool> m_searchThreadPool;
+  mutable boost::mutex m_workerPoolsMutex;
+  mutable std::vector<WorkerPools*> m_freeWorkerPools;
+
   void LoadWeights();
   void LoadMappings();
   void LoadDecodeGraphBackoff();
@@ -0,0 +1,89 @@
+/*
+ * TestModel.cpp
+ *
+ *  Created on: 17 Oct 2026
+ */
+#include <fstream>
+#include <sstream>
+#include <boost/test/unit_test.hpp>
+#include "TestModel.h"
+#include "System.h"
+#include "ManagerBase.h"
+
+using namespace std;
+
+namespace Moses2
+{
+
+namespace
+{
+class ModelTask: public TranslationTask
+{
+public:
+  ModelTask(System &system)
+    :TranslationTask(system, "", 0) {
+  }
+  virtual ~ModelTask() {
+    delete m_mgr;
+  }
+  virtual void Run() {
+  }
+};
+}
+
+TestModel::TestModel()
+  :m_dir(boost::filesystem::temp_directory_path()
+         / boost::filesystem::unique_path("moses2-test-%%%%%%%%"))
+{
+  boost::filesystem::create_directories(m_dir);
+}
+
+TestModel::~TestModel()
+{
+  m_task.reset();
+  m_system.reset();
+  boost::system::error_code ec;
+  boost::filesystem::remove_all(m_dir, ec);
+}
+
+std::string TestModel::GetPath(const std::string &file) const
+{
+  return (m_dir / file).string();
+}
+
+std::string TestModel::Write(const std::string &file, const std::string &content) const
+{
+  string path = GetPath(file);
+  ofstream out(path.c_str());
+  out << content;
+  BOOST_REQUIRE(out);
+  return path;
+}
+
+void TestModel::Load(const std::string &sections,
+                     const std::string &features,
+                     const std::string &weights)
+{
+  stringstream ini;
+  ini << "[input-factors]\n0\n"
+      << "[mapping]\n0 T 0\n"
+      << sections
+      << "[feature]\n"
+      << "UnknownWordPenalty\nWordPenalty\nPhrasePenalty\nDistortion\n"
+      << "PhraseDictionaryMemory name=TranslationModel0 num-features=4 "
+      << "input-factor=0 output-factor=0 path=" << GetPath("phrase-table") << "\n"
+      << features
+      << "[weight]\n"
+      << "UnknownWordPenalty0= 1\nWordPenalty0= -1\nPhrasePenalty0= 0.2\n"
+      << "TranslationModel0= 0.2 0.2 0.2 0.2\nDistortion0= 0.3\n"
+      << weights;
+  string path = Write("moses.ini", ini.str());
+
+  const char *argv[] = { "moses2_test", "-f", path.c_str(), "-threads", "1" };
+  BOOST_REQUIRE(m_params.LoadParam(5, const_cast<char**>(argv)));
+  m_system.reset(new System(m_params));
+  m_task.reset(new ModelTask(*m_system));
+}
+
+}
+
@@ -0,0 +1,60 @@
+/*
+ * TestModel.h
+ *
+ *  Created on: 17 Oct 2026
+ */
+
+#pragma once
+
+#include <string>
+#include <boost/filesystem.hpp>
+#include <boost/scoped_ptr.hpp>
+#include "TranslationTask.h"
+#include "legacy/Parameter.h"
+
+namespace Moses2
+{
+class System;
+
+/** A phrase-based system for the unit tests, loaded from files in a
+ * directory of its own, which is deleted with it.
+ *
+ * Write() the phrase table and any other files the model needs, then Load().
+ * The moses.ini has a memory phrase table at GetPath("phrase-table"), the
+ * usual penalties and distortion, and whatever else is passed to Load().
+ */
+class TestModel
+{
+public:
+  TestModel();
+  ~TestModel();
+
+  std::string GetPath(const std::string &file) const;
+
+  // returns the file's path
+  std::string Write(const std::string &file, const std::string &content) const;
+
+  // sections: moses.ini sections such as "[stack]\n100\n". features and
+  // weights: lines of the [feature] and [weight] sections
+  void Load(const std::string &sections,
+            const std::string &features = "",
+            const std::string &weights = "");
+
+  System &GetSystem() {
+    return *m_system;
+  }
+
+  // a task is needed to make a manager. This one is never run
+  const TranslationTask &GetTask() const {
+    return *m_task;
+  }
+
+protected:
+  boost::filesystem::path m_dir;
+  Parameter m_params;
+  boost::scoped_ptr<System> m_system;
+  boost::scoped_ptr<TranslationTask> m_task;
+};
+
+}
+
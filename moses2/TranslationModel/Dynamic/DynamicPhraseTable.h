@@ -41,7 +41,7 @@ class DynamicPhraseTable: public PhraseTable
       MemPool &pool,
       const DynamicPhraseTable::SCFGNODE &vnode,
       const ActiveChartEntry &prevEntry)
-      :Parent(prevEntry)
+      :Parent(pool, prevEntry)
       ,node(vnode)
     {}
   };
@@ -41,7 +41,7 @@ class MSPT: public PhraseTable
       MemPool &pool,
       const MSPT::SCFGNODE &vnode,
       const ActiveChartEntry &prevEntry)
-      :Parent(prevEntry)
+      :Parent(pool, prevEntry)
       ,node(vnode)
     {}
   };
@@ -41,7 +41,7 @@ class PhraseTableMemory: public PhraseTable
       MemPool &pool,
       const PhraseTableMemory::SCFGNODE &vnode,
       const ActiveChartEntry &prevEntry)
-      :Parent(prevEntry)
+      :Parent(pool, prevEntry)
       ,node(vnode)
     {}
   };
@@ -5,6 +5,7 @@
  *      Author: hieu
  */
 #include <boost/foreach.hpp>
+#include <boost/unordered_map.hpp>
 #include <queue>
 #include "PhraseTable.h"
 #include "../legacy/Util2.h"
@@ -20,6 +21,19 @@ using namespace std;
 namespace Moses2
 {
 
+namespace
+{
+// source phrases of input paths, by content
+struct SourcePhraseHasher {
+  size_t operator()(const Phrase<Moses2::Word> *phrase) const {
+    return phrase->hash();
+  }
+  bool operator()(const Phrase<Moses2::Word> *a, const Phrase<Moses2::Word> *b) const {
+    return *a == *b;
+  }
+};
+}
+
 ////////////////////////////////////////////////////////////////////////////
 PhraseTable::PhraseTable(size_t startInd, const std::string &line) :
   StatelessFeatureFunction(startInd, line), m_tableLimit(20) // default
@@ -94,6 +108,30 @@ TargetPhrases *PhraseTable::Lookup(const Manager &mgr, MemPool &pool,
   UTIL_THROW2("Not implemented");
 }
 
+void PhraseTable::LookupBatch(const std::vector<Manager*> &mgrs) const
+{
+  // the sentences share the pools of the thread, so the target phrases
+  // found for 1 of them live as long as all of them
+  typedef boost::unordered_map<const Phrase<Moses2::Word>*, TargetPhrases*,
+          SourcePhraseHasher, SourcePhraseHasher> Found;
+  Found found;
+
+  BOOST_FOREACH(Manager *mgr, mgrs) {
+    BOOST_FOREACH(InputPathBase *pathBase, mgr->GetInputPaths()) {
+      InputPath *path = static_cast<InputPath*>(pathBase);
+      if (!SatisfyBackoff(*mgr, *path)) {
+        continue;
+      }
+
+      std::pair<Found::iterator, bool> ret = found.insert(Found::value_type(&path->subPhrase, NULL));
+      if (ret.second) {
+        ret.first->second = Lookup(*mgr, mgr->GetPool(), *path);
+      }
+      path->AddTargetPhrases(*this, ret.first->second);
+    }
+  }
+}
+
 void PhraseTable::EvaluateInIsolation(MemPool &pool, const System &system,
                                       const Phrase<Moses2::Word> &source, const TargetPhraseImpl &targetPhrase, Scores &scores,
                                       SCORE &estimatedScore) const
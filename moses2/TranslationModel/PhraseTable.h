@@ -6,6 +6,7 @@
  */
 #pragma once
 #include <string>
+#include <vector>
 #include <boost/unordered_map.hpp>
 #include "../Word.h"
 #include "../HypothesisColl.h"
@@ -44,6 +45,10 @@ public:
   virtual TargetPhrases *Lookup(const Manager &mgr, MemPool &pool,
                                 InputPath &inputPath) const;
 
+  // lookup for several sentences decoded together, see ManagerBatch. A
+  // source phrase which is in more than 1 of them is looked up once
+  virtual void LookupBatch(const std::vector<Manager*> &mgrs) const;
+
   void SetPtInd(size_t ind) {
     m_ptInd = ind;
   }
@@ -32,7 +32,7 @@ namespace Moses2
 ProbingPT::ActiveChartEntryProbing::ActiveChartEntryProbing(
   MemPool &pool,
   const ActiveChartEntryProbing &prevEntry)
-  :Parent(prevEntry)
+  :Parent(pool, prevEntry)
   ,m_key(prevEntry.m_key)
 {}
 
@@ -70,15 +70,34 @@ std::pair<bool, uint64_t> ProbingPT::ActiveChartEntryProbing::GetKey(const SCFG:
 ProbingPT::ProbingPT(size_t startInd, const std::string &line)
   :PhraseTable(startInd, line)
   ,load_method(util::POPULATE_OR_READ)
+  ,m_sharedCacheMB(0)
+  ,m_sharedCache(NULL)
 {
   ReadParameters();
 }
 
 ProbingPT::~ProbingPT()
 {
+  if (m_sharedCache) {
+    std::cerr << GetName() << " shared cache: hits=" << m_sharedCache->GetHits()
+              << " misses=" << m_sharedCache->GetMisses()
+              << " evictions=" << m_sharedCache->GetEvictions()
+              << " bytes=" << m_sharedCache->GetSize() << std::endl;
+    delete m_sharedCache;
+  }
   delete m_engine;
 }
 
+bool ProbingPT::GetCacheStats(uint64_t &hits, uint64_t &misses) const
+{
+  if (m_sharedCache == NULL) {
+    return false;
+  }
+  hits = m_sharedCache->GetHits();
+  misses = m_sharedCache->GetMisses();
+  return true;
+}
+
 void ProbingPT::Load(System &system)
 {
   m_engine = new probingpt::QueryEngine(m_path.c_str(), load_method);
@@ -138,6 +157,10 @@ void ProbingPT::Load(System &system)
 
   // cache
   CreateCache(system);
+
+  if (m_sharedCacheMB) {
+    m_sharedCache = new TargetPhrasesCache(m_sharedCacheMB << 20);
+  }
 }
 
 void ProbingPT::SetParameter(const std::string& key, const std::string& value)
@@ -153,9 +176,13 @@ void ProbingPT::SetParameter(const std::string& key, const std::string& value)
       load_method = util::READ;
     } else if (value == "parallel_read") {
       load_method = util::PARALLEL_READ;
+    } else if (value == "interleave") {
+      load_method = util::READ_INTERLEAVE;
     } else {
       UTIL_THROW2("load method not supported" << value);
     }
+  } else if (key == "shared-cache-mb") {
+    m_sharedCacheMB = Scan<size_t>(value);
   } else {
     PhraseTable::SetParameter(key, value);
   }
@@ -226,12 +253,43 @@ TargetPhrases* ProbingPT::Lookup(const Manager &mgr, MemPool &pool,
     return tps;
   }
 
+  if (m_sharedCache) {
+    return LookupShared(mgr.system, sourcePhrase, keyStruct.second);
+  }
+
   // query pt
   TargetPhrases *tps = CreateTargetPhrases(pool, mgr.system, sourcePhrase,
                        keyStruct.second);
   return tps;
 }
 
+TargetPhrases *ProbingPT::LookupShared(const System &system,
+                                       const Phrase<Moses2::Word> &sourcePhrase, uint64_t key) const
+{
+  TargetPhrasesCache::EntryPtr entry = m_sharedCache->Find(key);
+  if (!entry) {
+    entry.reset(new TargetPhrasesCache::Entry());
+    entry->pool.reset(new MemPool(4096));
+    entry->tps = CreateTargetPhrases(*entry->pool, system, sourcePhrase, key);
+    if (entry->tps == NULL) {
+      // remember that there's no translation, without holding on to the pool
+      entry->pool.reset();
+    }
+    entry = m_sharedCache->Insert(key, entry);
+  }
+
+  // the target phrases must outlive this sentence even if they're evicted
+  m_sharedCache->Pin(entry);
+  return entry->tps;
+}
+
+void ProbingPT::CleanUpAfterSentenceProcessing(const System &system, const InputType &input) const
+{
+  if (m_sharedCache) {
+    m_sharedCache->ReleasePins();
+  }
+}
+
 std::pair<bool, uint64_t> ProbingPT::GetKey(const Phrase<Moses2::Word> &sourcePhrase) const
 {
   std::pair<bool, uint64_t> ret;
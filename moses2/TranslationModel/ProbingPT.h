@@ -12,6 +12,7 @@
 #include <boost/bimap.hpp>
 #include <deque>
 #include "PhraseTable.h"
+#include "TargetPhrasesCache.h"
 #include "../Vector.h"
 #include "../Phrase.h"
 #include "../SCFG/ActiveChart.h"
@@ -78,6 +79,10 @@ public:
   virtual void SetParameter(const std::string& key, const std::string& value);
   void Lookup(const Manager &mgr, InputPathsBase &inputPaths) const;
 
+  virtual void CleanUpAfterSentenceProcessing(const System &system, const InputType &input) const;
+
+  virtual bool GetCacheStats(uint64_t &hits, uint64_t &misses) const;
+
   uint64_t GetUnk() const {
     return m_unkId;
   }
@@ -136,6 +141,13 @@ protected:
 
   void CreateCache(System &system);
 
+  // filled as sentences are decoded. NULL = off
+  size_t m_sharedCacheMB;
+  TargetPhrasesCache *m_sharedCache;
+
+  TargetPhrases *LookupShared(const System &system,
+                              const Phrase<Moses2::Word> &sourcePhrase, uint64_t key) const;
+
   void ReformatWord(System &system, std::string &wordStr, bool &isNT);
 
   // SCFG
@@ -0,0 +1,141 @@
+/*
+ * TargetPhrasesCache.cpp
+ *
+ *  Created on: 16 Oct 2026
+ */
+
+#include "TargetPhrasesCache.h"
+
+using namespace std;
+
+namespace Moses2
+{
+
+TargetPhrasesCache::Entry::Entry()
+  :tps(NULL)
+{
+}
+
+size_t TargetPhrasesCache::Entry::GetSize() const
+{
+  size_t ret = sizeof(Entry);
+  if (pool) {
+    ret += pool->Capacity();
+  }
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////
+TargetPhrasesCache::TargetPhrasesCache(size_t maxBytes)
+  :m_maxShardBytes(maxBytes / kNumShards)
+  ,m_hits(0)
+  ,m_misses(0)
+  ,m_evictions(0)
+{
+}
+
+TargetPhrasesCache::EntryPtr TargetPhrasesCache::Find(uint64_t key)
+{
+  Shard &shard = GetShard(key);
+  boost::mutex::scoped_lock lock(shard.lock);
+
+  boost::unordered_map<uint64_t, size_t>::const_iterator iter = shard.index.find(key);
+  if (iter == shard.index.end()) {
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    return EntryPtr();
+  }
+
+  m_hits.fetch_add(1, std::memory_order_relaxed);
+  Slot &slot = shard.slots[iter->second];
+  slot.referenced = true;
+  return slot.entry;
+}
+
+TargetPhrasesCache::EntryPtr TargetPhrasesCache::Insert(uint64_t key, const EntryPtr &entry)
+{
+  size_t size = entry->GetSize();
+  if (size > m_maxShardBytes) {
+    // would flush the whole shard. Use it for this sentence only
+    return entry;
+  }
+
+  Shard &shard = GetShard(key);
+  boost::mutex::scoped_lock lock(shard.lock);
+
+  boost::unordered_map<uint64_t, size_t>::const_iterator iter = shard.index.find(key);
+  if (iter != shard.index.end()) {
+    return shard.slots[iter->second].entry;
+  }
+
+  Evict(shard, size);
+
+  Slot slot;
+  slot.key = key;
+  slot.entry = entry;
+  slot.size = size;
+  slot.referenced = false;
+
+  shard.index[key] = shard.slots.size();
+  shard.slots.push_back(slot);
+  shard.size += size;
+
+  return entry;
+}
+
+void TargetPhrasesCache::Evict(Shard &shard, size_t required)
+{
+  while (shard.size + required > m_maxShardBytes && !shard.slots.empty()) {
+    if (shard.hand >= shard.slots.size()) {
+      shard.hand = 0;
+    }
+
+    Slot &slot = shard.slots[shard.hand];
+    if (slot.referenced) {
+      // used since the hand last passed. Give it another round
+      slot.referenced = false;
+      ++shard.hand;
+      continue;
+    }
+
+    shard.size -= slot.size;
+    shard.index.erase(slot.key);
+    if (shard.hand + 1 < shard.slots.size()) {
+      slot = shard.slots.back();
+      shard.index[slot.key] = shard.hand;
+    }
+    shard.slots.pop_back();
+
+    m_evictions.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void TargetPhrasesCache::Pin(const EntryPtr &entry)
+{
+  Pins *pins = m_pins.get();
+  if (pins == NULL) {
+    pins = new Pins();
+    m_pins.reset(pins);
+  }
+  pins->push_back(entry);
+}
+
+void TargetPhrasesCache::ReleasePins()
+{
+  Pins *pins = m_pins.get();
+  if (pins) {
+    pins->clear();
+  }
+}
+
+size_t TargetPhrasesCache::GetSize() const
+{
+  size_t ret = 0;
+  for (size_t i = 0; i < kNumShards; ++i) {
+    const Shard &shard = m_shards[i];
+    boost::mutex::scoped_lock lock(shard.lock);
+    ret += shard.size;
+  }
+  return ret;
+}
+
+}
@@ -0,0 +1,106 @@
+/*
+ * TargetPhrasesCache.h
+ *
+ *  Created on: 16 Oct 2026
+ */
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <stdint.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/unordered_map.hpp>
+#include "../MemPool.h"
+
+namespace Moses2
+{
+class TargetPhrases;
+
+/** Bounded cache of decoded TargetPhrases, shared by all decoding threads.
+ * Keyed by source phrase hash. Split into shards, each with its own mutex
+ * and CLOCK eviction, so threads rarely wait for each other.
+ *
+ * An evicted entry stays alive as long as a sentence still uses it. Lookups
+ * pin the entry in the calling thread until ReleasePins(), which the phrase
+ * table calls in CleanUpAfterSentenceProcessing().
+ */
+class TargetPhrasesCache
+{
+public:
+  // owns the memory of the target phrases. tps == NULL caches a miss in the pt
+  struct Entry {
+    Entry();
+
+    boost::scoped_ptr<MemPool> pool;
+    TargetPhrases *tps;
+
+    size_t GetSize() const;
+  };
+  typedef boost::shared_ptr<Entry> EntryPtr;
+
+  TargetPhrasesCache(size_t maxBytes);
+
+  // return NULL if not cached
+  EntryPtr Find(uint64_t key);
+
+  // return the entry that is in the cache, which is not 'entry' if another
+  // thread got there first
+  EntryPtr Insert(uint64_t key, const EntryPtr &entry);
+
+  // keep entry alive until ReleasePins() is called by this thread
+  void Pin(const EntryPtr &entry);
+  void ReleasePins();
+
+  uint64_t GetHits() const {
+    return m_hits.load(std::memory_order_relaxed);
+  }
+  uint64_t GetMisses() const {
+    return m_misses.load(std::memory_order_relaxed);
+  }
+  uint64_t GetEvictions() const {
+    return m_evictions.load(std::memory_order_relaxed);
+  }
+  size_t GetSize() const;
+
+protected:
+  static const size_t kNumShards = 16;
+
+  struct Slot {
+    uint64_t key;
+    EntryPtr entry;
+    size_t size;
+    bool referenced;
+  };
+
+  struct Shard {
+    Shard() : hand(0), size(0) {}
+
+    mutable boost::mutex lock;
+    boost::unordered_map<uint64_t, size_t> index; // key -> slots ind
+    std::vector<Slot> slots;
+    size_t hand;
+    size_t size;
+  };
+
+  Shard m_shards[kNumShards];
+  size_t m_maxShardBytes;
+
+  std::atomic<uint64_t> m_hits, m_misses, m_evictions;
+
+  typedef std::vector<EntryPtr> Pins;
+  boost::thread_specific_ptr<Pins> m_pins;
+
+  Shard &GetShard(uint64_t key) {
+    // low bits of the key are often also used by the pt's own hash table
+    return m_shards[(key >> 32) % kNumShards];
+  }
+
+  // with shard.lock held
+  void Evict(Shard &shard, size_t required);
+};
+
+}
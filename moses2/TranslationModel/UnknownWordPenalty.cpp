@@ -96,6 +96,13 @@ void UnknownWordPenalty::Lookup(const Manager &mgr,
 
 }
 
+void UnknownWordPenalty::LookupBatch(const std::vector<Manager*> &mgrs) const
+{
+  BOOST_FOREACH(Manager *mgr, mgrs) {
+    Lookup(*mgr, mgr->GetInputPaths());
+  }
+}
+
 TargetPhrases *UnknownWordPenalty::Lookup(const Manager &mgr, MemPool &pool,
     InputPath &inputPath) const
 {
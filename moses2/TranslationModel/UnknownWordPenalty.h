@@ -27,6 +27,10 @@ public:
   virtual TargetPhrases *Lookup(const Manager &mgr, MemPool &pool,
                                 InputPath &inputPath) const;
 
+  // what's unknown depends on what the other pts found for each path, and
+  // on the xml of each sentence. Not shared between sentences
+  virtual void LookupBatch(const std::vector<Manager*> &mgrs) const;
+
   void ProcessXML(
     const Manager &mgr,
     MemPool &pool,
@@ -54,5 +54,27 @@ void TranslationTask::Run()
   delete m_mgr;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////
+TranslationTaskChunk::TranslationTaskChunk(System &system)
+  :m_system(system)
+{
+}
+
+TranslationTaskChunk::~TranslationTaskChunk()
+{
+}
+
+void TranslationTaskChunk::Add(const StringPiece &line, long translationId)
+{
+  m_lines.push_back(std::pair<StringPiece, long>(line, translationId));
+}
+
+void TranslationTaskChunk::Run()
+{
+  for (size_t i = 0; i < m_lines.size(); ++i) {
+    TranslationTask task(m_system, m_lines[i].first.as_string(), m_lines[i].second);
+    task.Run();
+  }
 }
 
+}
@@ -1,6 +1,8 @@
 #pragma once
 #include <string>
+#include <vector>
 #include "legacy/ThreadPool.h"
+#include "util/string_piece.hh"
 
 namespace Moses2
 {
@@ -22,5 +24,27 @@ protected:
   ManagerBase *m_mgr;
 };
 
+// Decodes several short inputs, one after the other, in a single task. Saves
+// the task and queue overhead per line when sentences are short. Lines are
+// only copied when they are decoded so they must outlive the task
+class TranslationTaskChunk: public Task
+{
+public:
+  TranslationTaskChunk(System &system);
+  virtual ~TranslationTaskChunk();
+
+  void Add(const StringPiece &line, long translationId);
+
+  size_t GetSize() const {
+    return m_lines.size();
+  }
+
+  virtual void Run();
+
+protected:
+  System &m_system;
+  std::vector<std::pair<StringPiece, long> > m_lines;
+};
+
 }
 
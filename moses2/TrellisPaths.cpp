@@ -1,14 +0,0 @@
-/*
- * TrellisPaths.cpp
- *
- *  Created on: 16 Mar 2016
- *      Author: hieu
- */
-#include "TrellisPaths.h"
-#include "legacy/Util2.h"
-
-namespace Moses2
-{
-
-
-} /* namespace Moses2 */
@@ -26,6 +26,11 @@ public:
     return m_weights[ind];
   }
 
+  // the weights of all feature functions, in score index order
+  const SCORE *GetWeightsPtr(size_t startInd) const {
+    return m_weights.data() + startInd;
+  }
+
   std::vector<SCORE> GetWeights(const FeatureFunction &ff) const;
 
   void SetWeights(const FeatureFunctions &ffs, const std::string &ffName, const std::vector<float> &weights);
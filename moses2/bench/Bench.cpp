@@ -0,0 +1,515 @@
+/*
+ * Bench.cpp
+ *
+ *  Created on: 16 Oct 2026
+ */
+
+// Micro-benchmarks of the decoder's hot components, on the tiny model in
+// bench/model. Prints a JSON array with ns/op and heap allocations/op for
+// each fixture, so runs can be compared across builds.
+//
+//   moses2-bench [-model DIR] [-min-time SECONDS] [-filter NAME]
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
+#include "CountAllocs.h"
+#include "../System.h"
+#include "../MemPool.h"
+#include "../HypothesisColl.h"
+#include "../TranslationTask.h"
+#include "../FF/StatefulFeatureFunction.h"
+#include "../PhraseBased/Hypothesis.h"
+#include "../PhraseBased/InputPath.h"
+#include "../PhraseBased/Manager.h"
+#include "../PhraseBased/TargetPhraseImpl.h"
+#include "../PhraseBased/TargetPhrases.h"
+#include "../TranslationModel/PhraseTable.h"
+#include "../legacy/Bitmaps.h"
+#include "../legacy/FactorCollection.h"
+#include "../legacy/InputFileStream.h"
+#include "../legacy/Parameter.h"
+#include "../legacy/Util2.h"
+#include "../../probingpt/storing.h"
+#include "util/exception.hh"
+
+using namespace std;
+using namespace Moses2;
+
+namespace
+{
+
+////////////////////////////////////////////////////////////////////////////
+// Manager with its set-up exposed, so the parts of Decode() can be timed
+class BenchManager: public Manager
+{
+public:
+  BenchManager(System &system, const TranslationTask &task, const std::string &line)
+    :Manager(system, task, line, 0) {
+  }
+
+  void Init() {
+    Manager::Init();
+  }
+
+  InputPaths &GetInputPaths() {
+    return m_inputPaths;
+  }
+};
+
+// a task is needed to make a manager. This one is never run
+class BenchTask: public TranslationTask
+{
+public:
+  BenchTask(System &system)
+    :TranslationTask(system, "", 0) {
+  }
+  virtual ~BenchTask() {
+    delete m_mgr;
+  }
+  virtual void Run() {
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////
+class Fixture
+{
+public:
+  Fixture(const std::string &name)
+    :m_name(name) {
+  }
+  virtual ~Fixture() {
+  }
+
+  const std::string &GetName() const {
+    return m_name;
+  }
+
+  // not timed. Called before and after each Run()
+  virtual void SetUp() {
+  }
+  virtual void TearDown() {
+  }
+
+  // do some operations, return how many
+  virtual size_t Run() = 0;
+
+protected:
+  std::string m_name;
+};
+
+// the ops of 1 fixture, written as a JSON object
+void Measure(Fixture &fixture, double minTime, bool first)
+{
+  typedef std::chrono::steady_clock Clock;
+
+  // always at least 1 measured run after the warm up, even with -min-time 0
+  uint64_t ops = 0, allocs = 0, runs = 0;
+  double elapsed = 0;
+  for (bool warmUp = true; warmUp || runs == 0 || elapsed < minTime; warmUp = false) {
+    fixture.SetUp();
+
+    uint64_t startAllocs = NumAllocs();
+    Clock::time_point start = Clock::now();
+    size_t runOps = fixture.Run();
+    double runTime = std::chrono::duration<double>(Clock::now() - start).count();
+    uint64_t runAllocs = NumAllocs() - startAllocs;
+
+    fixture.TearDown();
+
+    // the 1st run warms up caches and pools
+    if (!warmUp) {
+      ops += runOps;
+      allocs += runAllocs;
+      elapsed += runTime;
+      ++runs;
+    }
+  }
+
+  cout << (first ? "" : ",\n")
+       << "  {\"name\": \"" << EscapeJson(fixture.GetName()) << "\""
+       << ", \"ops\": " << ops;
+  // JSON has no nan or inf
+  if (ops) {
+    cout << ", \"ns_per_op\": " << elapsed * 1e9 / ops
+         << ", \"allocs_per_op\": " << double(allocs) / ops;
+  } else {
+    cout << ", \"ns_per_op\": null, \"allocs_per_op\": null";
+  }
+  cout << "}" << flush;
+}
+
+////////////////////////////////////////////////////////////////////////////
+class MemPoolFixture: public Fixture
+{
+public:
+  MemPoolFixture()
+    :Fixture("MemPool::Allocate") {
+    // typical sizes of hypos, states and arrays of pointers
+    for (size_t i = 0; i < 1024; ++i) {
+      m_sizes.push_back(8 + (i * 37) % 248);
+    }
+  }
+
+  size_t Run() {
+    // like a sentence: lots of allocations, then a reset
+    for (size_t i = 0; i < m_sizes.size(); ++i) {
+      m_pool.Allocate(m_sizes[i]);
+    }
+    m_pool.Reset();
+    return m_sizes.size();
+  }
+
+protected:
+  MemPool m_pool;
+  std::vector<size_t> m_sizes;
+};
+
+class FactorCollectionFixture: public Fixture
+{
+public:
+  FactorCollectionFixture(const System &system, const std::vector<std::string> &words)
+    :Fixture("FactorCollection::AddFactor")
+    ,m_system(system)
+    ,m_words(words) {
+  }
+
+  size_t Run() {
+    // words already in the vocab, as when an input sentence is read
+    FactorCollection &vocab = m_system.GetVocab();
+    for (size_t i = 0; i < m_words.size(); ++i) {
+      vocab.AddFactor(m_words[i], m_system, false);
+    }
+    return m_words.size();
+  }
+
+protected:
+  const System &m_system;
+  const std::vector<std::string> &m_words;
+};
+
+// Sets up a manager for the sentence before each run. The manager pools are
+// per thread, so only 1 manager can be alive at a time
+class ManagerFixture: public Fixture
+{
+public:
+  ManagerFixture(const std::string &name, System &system, const TranslationTask &task,
+                 const std::string &line)
+    :Fixture(name)
+    ,m_system(system)
+    ,m_task(task)
+    ,m_line(line) {
+  }
+
+  void SetUp() {
+    m_mgr.reset(new BenchManager(m_system, m_task, m_line));
+    m_mgr->Init();
+  }
+
+  void TearDown() {
+    m_mgr.reset();
+  }
+
+protected:
+  System &m_system;
+  const TranslationTask &m_task;
+  std::string m_line;
+  boost::scoped_ptr<BenchManager> m_mgr;
+};
+
+class LookupFixture: public ManagerFixture
+{
+public:
+  LookupFixture(const std::string &name, System &system, const TranslationTask &task,
+                const std::string &line, const PhraseTable &pt)
+    :ManagerFixture(name + "::Lookup", system, task, line)
+    ,m_pt(pt) {
+  }
+
+  size_t Run() {
+    // all the spans of the sentence. The target phrases stay in the pool
+    // until TearDown(), so not too many runs
+    for (size_t i = 0; i < 16; ++i) {
+      m_pt.Lookup(*m_mgr, m_mgr->GetInputPaths());
+    }
+    return 16;
+  }
+
+protected:
+  const PhraseTable &m_pt;
+};
+
+// hypos extending the empty hypo, and extending those again to the right
+void CreateHypos(BenchManager &mgr, std::vector<Hypothesis*> &hypos)
+{
+  const InputPaths &paths = mgr.GetInputPaths();
+  const Bitmap &initBitmap = mgr.GetBitmaps().GetInitialBitmap();
+
+  Hypothesis *initHypo = Hypothesis::Create(mgr.GetSystemPool(), mgr);
+  initHypo->Init(mgr, paths.GetBlank(), mgr.GetInitPhrase(), initBitmap);
+  initHypo->EmptyHypothesisState(mgr.GetInput());
+
+  std::vector<Hypothesis*> prevHypos(1, initHypo);
+  for (size_t level = 0; level < 2; ++level) {
+    std::vector<Hypothesis*> newHypos;
+    BOOST_FOREACH(const Hypothesis *prevHypo, prevHypos) {
+      const Bitmap &prevBitmap = prevHypo->GetBitmap();
+      size_t prevEnd = level ? prevHypo->GetInputPath().range.GetEndPos() : 0;
+
+      BOOST_FOREACH(const InputPathBase *pathBase, paths) {
+        const InputPath &path = *static_cast<const InputPath*>(pathBase);
+        if (path.range.GetStartPos() < prevEnd || prevBitmap.Overlap(path.range)) {
+          continue;
+        }
+
+        const Bitmap &bitmap = mgr.GetBitmaps().GetBitmap(prevBitmap, path.range);
+        for (size_t i = 0; i < mgr.system.mappings.size(); ++i) {
+          const TargetPhrases *tps = path.targetPhrases[i];
+          if (tps == NULL) {
+            continue;
+          }
+          BOOST_FOREACH(const TargetPhraseImpl *tp, *tps) {
+            Hypothesis *hypo = Hypothesis::Create(mgr.GetSystemPool(), mgr);
+            hypo->Init(mgr, *prevHypo, path, *tp, bitmap, 0);
+            hypo->EvaluateWhenApplied();
+            newHypos.push_back(hypo);
+          }
+        }
+      }
+    }
+
+    hypos.insert(hypos.end(), newHypos.begin(), newHypos.end());
+    // keep the 2nd level a sensible size
+    newHypos.resize(std::min<size_t>(newHypos.size(), 64));
+    prevHypos.swap(newHypos);
+  }
+}
+
+class HyposFixture: public ManagerFixture
+{
+public:
+  HyposFixture(const std::string &name, System &system, const TranslationTask &task,
+               const std::string &line)
+    :ManagerFixture(name, system, task, line) {
+  }
+
+  void SetUp() {
+    ManagerFixture::SetUp();
+    // from the hypo recycler, so the same memory each time
+    m_hypos.clear();
+    CreateHypos(*m_mgr, m_hypos);
+  }
+
+protected:
+  std::vector<Hypothesis*> m_hypos;
+};
+
+class EvaluateWhenAppliedFixture: public HyposFixture
+{
+public:
+  EvaluateWhenAppliedFixture(System &system, const TranslationTask &task,
+                             const std::string &line, const StatefulFeatureFunction &sfff)
+    :HyposFixture(sfff.GetName() + "::EvaluateWhenApplied", system, task, line)
+    ,m_sfff(sfff) {
+  }
+
+  size_t Run() {
+    for (size_t i = 0; i < 16; ++i) {
+      BOOST_FOREACH(Hypothesis *hypo, m_hypos) {
+        hypo->EvaluateWhenApplied(m_sfff);
+      }
+    }
+    return 16 * m_hypos.size();
+  }
+
+protected:
+  const StatefulFeatureFunction &m_sfff;
+};
+
+class HypothesisCollFixture: public HyposFixture
+{
+public:
+  HypothesisCollFixture(System &system, const TranslationTask &task,
+                        const std::string &line)
+    :HyposFixture("HypothesisColl::Add+Prune", system, task, line) {
+  }
+
+  size_t Run() {
+    // losers go to the recycler but aren't reused before TearDown(), so
+    // the same hypos can be added again
+    Recycler<HypothesisBase*> &recycler = m_mgr->GetHypoRecycle();
+    for (size_t i = 0; i < 16; ++i) {
+      HypothesisColl coll(*m_mgr);
+      BOOST_FOREACH(Hypothesis *hypo, m_hypos) {
+        coll.Add(*m_mgr, hypo, recycler, m_mgr->arcLists);
+      }
+      coll.GetSortedAndPrunedHypos(*m_mgr, m_mgr->arcLists);
+    }
+    return 16 * m_hypos.size();
+  }
+};
+
+class DecodeFixture: public Fixture
+{
+public:
+  DecodeFixture(System &system, const TranslationTask &task,
+                const std::vector<std::string> &lines)
+    :Fixture("Manager::Decode")
+    ,m_system(system)
+    ,m_task(task)
+    ,m_lines(lines) {
+  }
+
+  size_t Run() {
+    for (size_t i = 0; i < m_lines.size(); ++i) {
+      BenchManager mgr(m_system, m_task, m_lines[i]);
+      mgr.Decode();
+      mgr.OutputBest();
+    }
+    return m_lines.size();
+  }
+
+protected:
+  System &m_system;
+  const TranslationTask &m_task;
+  const std::vector<std::string> &m_lines;
+};
+
+////////////////////////////////////////////////////////////////////////////
+void WriteIni(const std::string &path, const std::string &modelDir, const std::string &ptLine)
+{
+  ofstream ini(path.c_str());
+  ini << "[input-factors]\n0\n"
+      << "[mapping]\n0 T 0\n"
+      << "[distortion-limit]\n6\n"
+      << "[stack]\n100\n"
+      << "[feature]\n"
+      << "UnknownWordPenalty\nWordPenalty\nPhrasePenalty\nDistortion\n"
+      << ptLine << "\n"
+      << "KENLM name=LM0 factor=0 order=2 path=" << modelDir << "/lm.arpa\n"
+      << "[weight]\n"
+      << "UnknownWordPenalty0= 1\nWordPenalty0= -1\nPhrasePenalty0= 0.2\n"
+      << "TranslationModel0= 0.2 0.2 0.2 0.2\nDistortion0= 0.3\nLM0= 0.5\n";
+}
+
+System *LoadSystem(Parameter &params, const std::string &iniPath)
+{
+  const char *argv[] = { "moses2-bench", "-f", iniPath.c_str(), "-threads", "1" };
+  UTIL_THROW_IF2(!params.LoadParam(5, const_cast<char**>(argv)),
+                 "Couldn't load " << iniPath);
+  return new System(params);
+}
+
+void Usage()
+{
+  cerr << "Usage: moses2-bench [-model DIR] [-min-time SECONDS] [-filter NAME]" << endl
+       << "  -model     directory of the bench model (default: bench/model)" << endl
+       << "  -min-time  time each fixture for at least this long (default: 1)" << endl
+       << "  -filter    only run fixtures whose name contains this" << endl;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+  std::string modelDir = "bench/model";
+  double minTime = 1;
+  std::string filter;
+
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "-model") && i + 1 < argc) {
+      modelDir = argv[++i];
+    } else if (!strcmp(argv[i], "-min-time") && i + 1 < argc) {
+      minTime = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "-filter") && i + 1 < argc) {
+      filter = argv[++i];
+    } else {
+      Usage();
+      return EXIT_FAILURE;
+    }
+  }
+  modelDir = boost::filesystem::absolute(modelDir).string();
+
+  std::vector<std::string> lines, words;
+  {
+    InputFileStream input(modelDir + "/input.txt");
+    std::string line;
+    while (getline(input, line)) {
+      lines.push_back(line);
+      std::vector<std::string> toks = Tokenize(line);
+      words.insert(words.end(), toks.begin(), toks.end());
+    }
+  }
+  UTIL_THROW_IF2(lines.empty(), "No input sentences in " << modelDir);
+
+  boost::filesystem::path tempDir = boost::filesystem::temp_directory_path()
+                                    / boost::filesystem::unique_path("moses2-bench-%%%%%%%%");
+  boost::filesystem::create_directories(tempDir);
+  std::string phraseTable = modelDir + "/phrase-table";
+  std::string probingDir = (tempDir / "probing").string();
+  probingpt::createProbingPT(phraseTable, probingDir, 4, 0, true, 0, false);
+
+  // the same model with the phrase table in memory and as ProbingPT
+  std::string memoryIni = (tempDir / "memory.ini").string();
+  std::string probingIni = (tempDir / "probing.ini").string();
+  WriteIni(memoryIni, modelDir, "PhraseDictionaryMemory name=TranslationModel0 num-features=4 "
+           "input-factor=0 output-factor=0 path=" + phraseTable);
+  WriteIni(probingIni, modelDir, "ProbingPT name=TranslationModel0 num-features=4 "
+           "input-factor=0 output-factor=0 path=" + probingDir);
+
+  Parameter memoryParams, probingParams;
+  boost::scoped_ptr<System> memorySystem(LoadSystem(memoryParams, memoryIni));
+  boost::scoped_ptr<System> probingSystem(LoadSystem(probingParams, probingIni));
+
+  BenchTask memoryTask(*memorySystem), probingTask(*probingSystem);
+
+  // the longest sentence, for the lookups and the hypos
+  std::string longest;
+  BOOST_FOREACH(const std::string &line, lines) {
+    if (line.size() > longest.size()) {
+      longest = line;
+    }
+  }
+
+  const FeatureFunctions &memoryFFs = memorySystem->featureFunctions;
+  const FeatureFunctions &probingFFs = probingSystem->featureFunctions;
+  const PhraseTable *memoryPt = dynamic_cast<const PhraseTable*>(
+                                  memoryFFs.FindFeatureFunction("TranslationModel0"));
+  const PhraseTable *probingPt = dynamic_cast<const PhraseTable*>(
+                                   probingFFs.FindFeatureFunction("TranslationModel0"));
+  const StatefulFeatureFunction *lm = dynamic_cast<const StatefulFeatureFunction*>(
+                                        memoryFFs.FindFeatureFunction("LM0"));
+  UTIL_THROW_IF2(memoryPt == NULL || probingPt == NULL || lm == NULL,
+                 "Bench model is missing TranslationModel0 or LM0");
+
+  std::vector<Fixture*> fixtures;
+  fixtures.push_back(new MemPoolFixture());
+  fixtures.push_back(new FactorCollectionFixture(*memorySystem, words));
+  fixtures.push_back(new LookupFixture("PhraseTableMemory", *memorySystem, memoryTask,
+                                       longest, *memoryPt));
+  fixtures.push_back(new LookupFixture("ProbingPT", *probingSystem, probingTask,
+                                       longest, *probingPt));
+  fixtures.push_back(new EvaluateWhenAppliedFixture(*memorySystem, memoryTask, longest, *lm));
+  fixtures.push_back(new HypothesisCollFixture(*memorySystem, memoryTask, longest));
+  fixtures.push_back(new DecodeFixture(*memorySystem, memoryTask, lines));
+
+  cout << "[\n";
+  bool first = true;
+  BOOST_FOREACH(Fixture *fixture, fixtures) {
+    if (fixture->GetName().find(filter) != std::string::npos) {
+      Measure(*fixture, minTime, first);
+      first = false;
+    }
+  }
+  cout << "\n]" << endl;
+
+  RemoveAllInColl(fixtures);
+  boost::filesystem::remove_all(tempDir);
+  return EXIT_SUCCESS;
+}
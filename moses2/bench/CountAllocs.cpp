@@ -0,0 +1,159 @@
+/*
+ * CountAllocs.cpp
+ *
+ *  Created on: 17 Oct 2026
+ */
+
+// Replaces every form of operator new and delete, so that all of the
+// program's heap allocations are counted and each is freed by the allocator
+// it came from. In a file of its own so the compiler doesn't see the
+// replacements next to their callers.
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "CountAllocs.h"
+
+namespace
+{
+std::atomic<uint64_t> g_numAllocs(0);
+
+void *Allocate(size_t size)
+{
+  g_numAllocs.fetch_add(1, std::memory_order_relaxed);
+  return malloc(size ? size : 1);
+}
+
+#if __cpp_aligned_new
+void *AllocateAligned(size_t size, std::align_val_t align)
+{
+  g_numAllocs.fetch_add(1, std::memory_order_relaxed);
+  size_t alignment = static_cast<size_t>(align);
+  if (alignment < sizeof(void*)) {
+    alignment = sizeof(void*);
+  }
+  void *ret;
+  return posix_memalign(&ret, alignment, size ? size : 1) ? NULL : ret;
+}
+#endif
+}
+
+namespace Moses2
+{
+uint64_t NumAllocs()
+{
+  return g_numAllocs.load(std::memory_order_relaxed);
+}
+}
+
+void *operator new(size_t size)
+{
+  void *ret = Allocate(size);
+  if (ret == NULL) {
+    throw std::bad_alloc();
+  }
+  return ret;
+}
+
+void *operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t&) noexcept
+{
+  return Allocate(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+  return Allocate(size);
+}
+
+void operator delete(void *p) noexcept
+{
+  free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+  free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t&) noexcept
+{
+  free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t&) noexcept
+{
+  free(p);
+}
+
+#if __cpp_sized_deallocation
+void operator delete(void *p, size_t) noexcept
+{
+  free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+  free(p);
+}
+#endif
+
+#if __cpp_aligned_new
+void *operator new(size_t size, std::align_val_t align)
+{
+  void *ret = AllocateAligned(size, align);
+  if (ret == NULL) {
+    throw std::bad_alloc();
+  }
+  return ret;
+}
+
+void *operator new[](size_t size, std::align_val_t align)
+{
+  return operator new(size, align);
+}
+
+void *operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept
+{
+  return AllocateAligned(size, align);
+}
+
+void *operator new[](size_t size, std::align_val_t align, const std::nothrow_t&) noexcept
+{
+  return AllocateAligned(size, align);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept
+{
+  free(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept
+{
+  free(p);
+}
+
+void operator delete(void *p, size_t, std::align_val_t) noexcept
+{
+  free(p);
+}
+
+void operator delete[](void *p, size_t, std::align_val_t) noexcept
+{
+  free(p);
+}
+
+void operator delete(void *p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+  free(p);
+}
+
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+  free(p);
+}
+#endif
@@ -0,0 +1,19 @@
+/*
+ * CountAllocs.h
+ *
+ *  Created on: 17 Oct 2026
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace Moses2
+{
+
+// heap allocations of the whole program so far. Every form of operator new
+// is replaced to count them, see CountAllocs.cpp
+uint64_t NumAllocs();
+
+}
+
@@ -29,7 +29,6 @@
 namespace Moses2
 {
 
-struct FactorFriend;
 class FactorCollection;
 
 /** Represents a factor (word, POS, etc).
@@ -41,21 +40,18 @@ class Factor
 
   // only these classes are allowed to instantiate this class
   friend class FactorCollection;
-  friend struct FactorFriend;
 
   // FactorCollection writes here.
-  // This is mutable so the pointer can be changed to pool-backed memory.
-  mutable StringPiece m_string;
+  // Points just past the Factor, in the same block of its shard's pool.
+  StringPiece m_string;
   size_t m_id;
 
   //! protected constructor. only friend class, FactorCollection, is allowed to create Factor objects
   Factor() {
   }
 
-  // Needed for STL containers.  They'll delegate through FactorFriend, which is never exposed publicly.
-  Factor(const Factor &factor) :
-    m_string(factor.m_string), m_id(factor.m_id) {
-  }
+  // Not implemented.  Factors are built in place by FactorCollection and never copied.
+  Factor(const Factor &factor);
 
   // Not implemented.  Shouldn't be called.
   Factor &operator=(const Factor &factor);
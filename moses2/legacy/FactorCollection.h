@@ -19,6 +19,7 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  ***********************************************************************/
 
+
 #pragma once
 
 // reserve space for non-terminal symbols (ensuring consecutive numbering, and allowing quick lookup by ID)
@@ -27,14 +28,15 @@
 #endif
 
 #ifdef WITH_THREADS
-#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/mutex.hpp>
 #endif
 
 #include "util/murmur_hash.hh"
-#include <boost/unordered_set.hpp>
 
+#include <atomic>
 #include <functional>
 #include <string>
+#include <vector>
 
 #include "util/string_piece.hh"
 #include "util/pool.hh"
@@ -45,17 +47,6 @@ namespace Moses2
 
 class System;
 
-/** We don't want Factor to be copyable by anybody.  But we also want to store
- * it in an STL container.  The solution is that Factor's copy constructor is
- * private and friended to FactorFriend.  The STL containers can delegate
- * copying, so friending the container isn't sufficient.  STL containers see
- * FactorFriend's public copy constructor and everybody else sees Factor's
- * private copy constructor.
- */
-struct FactorFriend {
-  Factor in;
-};
-
 /** collection of factors
  *
  * All Factors in moses are accessed and created by a FactorCollection.
@@ -63,44 +54,74 @@ struct FactorFriend {
  * from being created on the stack, etc), their memory addresses can
  * be used as keys to uniquely identify them.
  * Only 1 FactorCollection object should be created.
+ *
+ * Factors are interned in kNumShards open-addressed tables, picked by the top
+ * bits of the string's hash. Lookups take no lock: a slot is published with a
+ * release store once its Factor is complete, so readers only need acquire
+ * loads. Inserting takes the mutex of a single shard, so threads adding new
+ * words only contend when they land in the same shard. Factors and their
+ * strings live in per-shard pools and never move.
  */
 class FactorCollection
 {
   friend std::ostream& operator<<(std::ostream&, const FactorCollection&);
   friend class System;
 
-  struct HashFactor: public std::unary_function<const FactorFriend &,
-      std::size_t> {
-    std::size_t operator()(const FactorFriend &factor) const {
-      return util::MurmurHashNative(factor.in.m_string.data(),
-                                    factor.in.m_string.size());
-    }
-  };
-  struct EqualsFactor: public std::binary_function<const FactorFriend &,
-      const FactorFriend &, bool> {
-    bool operator()(const FactorFriend &left, const FactorFriend &right) const {
-      return left.in.GetString() == right.in.GetString();
-    }
+  static const std::size_t kNumShardsLog2 = 6;
+  static const std::size_t kNumShards = 1 << kNumShardsLog2;
+  static const std::size_t kInitialBuckets = 256;
+
+  struct Table {
+    explicit Table(std::size_t buckets);
+    ~Table();
+
+    std::size_t mask;
+    std::atomic<const Factor*> *slots;
   };
-  typedef boost::unordered_set<FactorFriend, HashFactor, EqualsFactor> Set;
-  Set m_set;
-  Set m_setNonTerminal;
 
-  util::Pool m_string_backing;
+  struct Shard {
+    Shard();
+    ~Shard();
 
+    std::atomic<Table*> table;
+    std::size_t size;
+    // tables replaced by Grow(). Readers may still be probing them
+    std::vector<Table*> retired;
+    util::Pool backing;
 #ifdef WITH_THREADS
-  //reader-writer lock
-  mutable boost::shared_mutex m_accessLock;
+    boost::mutex lock;
 #endif
+  };
+  Shard m_shards[kNumShards];
 
-  size_t m_factorIdNonTerminal; /**< unique, contiguous ids, starting from 0, for each non-terminal factor */
-  size_t m_factorId; /**< unique, contiguous ids, starting from moses_MaxNumNonterminals, for each terminal factor */
+  std::atomic<size_t> m_factorIdNonTerminal; /**< unique, contiguous ids, starting from 0, for each non-terminal factor */
+  std::atomic<size_t> m_factorId; /**< unique, contiguous ids, starting from moses_MaxNumNonterminals, for each terminal factor */
 
   //! constructor. only the 1 static variable can be created
   FactorCollection() :
     m_factorIdNonTerminal(0), m_factorId(moses_MaxNumNonterminals) {
   }
 
+  // non-terminals and terminals with the same string are different factors
+  static uint64_t Hash(const StringPiece &factorString, bool isNonTerminal) {
+    return util::MurmurHashNative(factorString.data(), factorString.size(),
+                                  isNonTerminal);
+  }
+
+  Shard &GetShard(uint64_t hash) {
+    return m_shards[hash >> (64 - kNumShardsLog2)];
+  }
+
+  static const Factor *Find(const Table &table, const StringPiece &factorString,
+                            uint64_t hash, bool isNonTerminal);
+
+  // caller holds the shard's lock
+  static void Insert(Table &table, const Factor *factor, uint64_t hash);
+  static void Grow(Shard &shard);
+
+  // reserves the next non-terminal id, or throws without reserving one
+  size_t NextNonTerminalId();
+
 public:
   ~FactorCollection();
 
@@ -111,7 +132,7 @@ public:
                           bool isNonTerminal);
 
   size_t GetNumNonTerminals() {
-    return m_factorIdNonTerminal;
+    return m_factorIdNonTerminal.load(std::memory_order_acquire);
   }
 
   const Factor *GetFactor(const StringPiece &factorString, bool isNonTerminal =
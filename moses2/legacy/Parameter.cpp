@@ -51,6 +51,10 @@ Parameter::Parameter()
   AddParam(main_opts, "config", "f", "location of the configuration file");
   AddParam(main_opts, "input-file", "i",
            "location of the input file to be translated");
+  AddParam(main_opts, "input-mmap",
+           "batch mode: mmap the uncompressed input-file rather than reading it line by line");
+  AddParam(main_opts, "input-chunk-tokens",
+           "with input-mmap, pack lines into tasks of about this many tokens. Default = 200");
 
   AddParam(main_opts, "verbose", "v", "verbosity level of the logging");
   AddParam(main_opts, "show-weights", "print feature weights and exit");
@@ -87,6 +91,8 @@ Parameter::Parameter()
   //    "threshold for constructing hypotheses based on estimate cost");
   AddParam(search_opts, "stack", "s",
            "maximum stack size for histogram pruning. 0 = unlimited stack size");
+  AddParam(search_opts, "deadline",
+           "time budget per sentence in milliseconds. The stack size and cube pruning pop limit are cut as it runs out. 0 = no deadline (default)");
   //AddParam(search_opts, "stack-diversity", "sd",
   //    "minimum number of hypothesis of each coverage in stack (default 0)");
 
@@ -124,6 +130,8 @@ Parameter::Parameter()
   //    "if present, allow dropping of source words"); //da = drop any (word); see -du for comparison
   AddParam(search_opts, "threads", "th",
            "number of threads to use in decoding (defaults to single-threaded)");
+  AddParam(search_opts, "input-reorder-window",
+           "batch mode: decode each window of this many input lines longest first. 0 = input order (default 4 x threads)");
 
   // distortion options
   po::options_description disto_opts("Distortion options");
@@ -308,6 +316,10 @@ Parameter::Parameter()
            "Max. number of seconds the server will keep a persistent connection alive.");
   AddParam(server_opts,"server-timeout",
            "Max. number of seconds the server will wait for a client to submit a request once a connection has been established.");
+  AddParam(server_opts,"server-batch-size",
+           "Max. No. of requests decoded together as one batch. Default 1 (no batching).");
+  AddParam(server_opts,"server-batch-wait",
+           "Max. number of milliseconds a request waits for others to batch with. Default 5.");
 
   po::options_description irstlm_opts("IRSTLM Options");
   //AddParam(irstlm_opts, "clean-lm-cache",
@@ -358,6 +370,14 @@ Parameter::Parameter()
   AddParam(misc_opts, "cpu-affinity-offset", "CPU Affinity. Default = -1 (no affinity)");
   AddParam(misc_opts, "cpu-affinity-increment",
            "Set to 1 (default) to put each thread on different cores. 0 to run all threads on one core");
+  AddParam(misc_opts, "mem-pool-stats",
+           "Print the memory pool statistics of a decoding thread every n sentences it translates. Default = 0 (never)");
+  AddParam(misc_opts, "profile-features",
+           "Count calls and cycles spent in each feature function and phrase table lookup. Written as JSON to this file on exit, - for stderr");
+  AddParam(misc_opts, "search-threads",
+           "Number of threads that extend the hypotheses of a stack (normal search) or decode the spans of one width (SCFG), for long sentences. Default = 1");
+  AddParam(misc_opts, "search-threads-min-words",
+           "Only use search-threads for sentences of at least this many words. Default = 50");
 
   // Compact phrase table and reordering table.
   po::options_description cpt_opts(
@@ -40,6 +40,7 @@ namespace Moses2
 
 ThreadPool::ThreadPool(size_t numThreads, int cpuAffinityOffset,
                        int cpuAffinityIncr) :
+  m_numQueued(0), m_numSleeping(0), m_numWaiting(0), m_nextWorker(0),
   m_stopped(false), m_stopping(false), m_queueLimit(numThreads*2)
 {
 #if defined(_WIN32) || defined(_WIN64)
@@ -51,9 +52,14 @@ ThreadPool::ThreadPool(size_t numThreads, int cpuAffinityOffset,
 
   int cpuInd = cpuAffinityOffset % numCPU;
 
+  // all deques must exist before any thread starts stealing
+  for (size_t i = 0; i < numThreads; ++i) {
+    m_workers.push_back(new Worker());
+  }
+
   for (size_t i = 0; i < numThreads; ++i) {
     boost::thread *thread = m_threads.create_thread(
-                              boost::bind(&ThreadPool::Execute, this));
+                              boost::bind(&ThreadPool::Execute, this, i));
 
 #ifdef __linux
     if (cpuAffinityOffset >= 0) {
@@ -89,43 +95,102 @@ ThreadPool::ThreadPool(size_t numThreads, int cpuAffinityOffset,
   }
 }
 
-void ThreadPool::Execute()
+ThreadPool::~ThreadPool()
+{
+  Stop();
+  for (size_t i = 0; i < m_workers.size(); ++i) {
+    delete m_workers[i];
+  }
+}
+
+void ThreadPool::Execute(size_t workerInd)
 {
-  do {
+  while (!m_stopped) {
     boost::shared_ptr<Task> task;
-    {
-      // Find a job to perform
+    if (!Pop(workerInd, task)) {
+      // nothing anywhere. Sleep until Submit() or Stop().
+      // m_numSleeping goes up before m_numQueued is checked so that Submit()
+      // either sees a sleeper or we see its task
       boost::mutex::scoped_lock lock(m_mutex);
-      if (m_tasks.empty() && !m_stopped) {
+      ++m_numSleeping;
+      if (m_numQueued == 0 && !m_stopped) {
         m_threadNeeded.wait(lock);
       }
-      if (!m_stopped && !m_tasks.empty()) {
-        task = m_tasks.front();
-        m_tasks.pop();
-      }
+      --m_numSleeping;
+      continue;
     }
+
+    NotifyAvailable();
+
     //Execute job
-    if (task) {
-      // must read from task before run. otherwise task may be deleted by main thread
-      // race condition
-      task->DeleteAfterExecution();
-      task->Run();
+    // must read from task before run. otherwise task may be deleted by main thread
+    // race condition
+    task->DeleteAfterExecution();
+    task->Run();
+  }
+}
+
+bool ThreadPool::Pop(size_t workerInd, boost::shared_ptr<Task> &task)
+{
+  if (Pop(*m_workers[workerInd], task)) {
+    return true;
+  }
+
+  // steal, starting with the next thread along so thieves spread out
+  for (size_t i = 1; i < m_workers.size(); ++i) {
+    size_t victim = (workerInd + i) % m_workers.size();
+    if (Pop(*m_workers[victim], task)) {
+      return true;
     }
+  }
+  return false;
+}
+
+bool ThreadPool::Pop(Worker &worker, boost::shared_ptr<Task> &task)
+{
+  boost::mutex::scoped_lock lock(worker.mutex);
+  if (worker.tasks.empty()) {
+    return false;
+  }
+  task = worker.tasks.front();
+  worker.tasks.pop_front();
+  --m_numQueued;
+  return true;
+}
+
+void ThreadPool::NotifyAvailable()
+{
+  if (m_numWaiting) {
+    boost::mutex::scoped_lock lock(m_mutex);
     m_threadAvailable.notify_all();
-  } while (!m_stopped);
+  }
 }
 
 void ThreadPool::Submit(boost::shared_ptr<Task> task)
 {
-  boost::mutex::scoped_lock lock(m_mutex);
-  if (m_stopping) {
-    throw runtime_error("ThreadPool stopping - unable to accept new jobs");
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (m_stopping) {
+      throw runtime_error("ThreadPool stopping - unable to accept new jobs");
+    }
+    ++m_numWaiting;
+    while (m_queueLimit > 0 && m_numQueued >= m_queueLimit) {
+      m_threadAvailable.wait(lock);
+    }
+    --m_numWaiting;
   }
-  while (m_queueLimit > 0 && m_tasks.size() >= m_queueLimit) {
-    m_threadAvailable.wait(lock);
+
+  Worker &worker = *m_workers[m_nextWorker++ % m_workers.size()];
+  {
+    boost::mutex::scoped_lock lock(worker.mutex);
+    worker.tasks.push_back(task);
+    ++m_numQueued;
+  }
+
+  if (m_numSleeping) {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_threadNeeded.notify_one();
   }
-  m_tasks.push(task);
-  m_threadNeeded.notify_all();
 }
 
 void ThreadPool::Stop(bool processRemainingJobs)
@@ -139,19 +204,20 @@ void ThreadPool::Stop(bool processRemainingJobs)
   if (processRemainingJobs) {
     boost::mutex::scoped_lock lock(m_mutex);
     //wait for queue to drain.
-    while (!m_tasks.empty() && !m_stopped) {
+    ++m_numWaiting;
+    while (m_numQueued && !m_stopped) {
       m_threadAvailable.wait(lock);
     }
+    --m_numWaiting;
   }
   //tell all threads to stop
   {
     boost::mutex::scoped_lock lock(m_mutex);
     m_stopped = true;
+    m_threadNeeded.notify_all();
   }
-  m_threadNeeded.notify_all();
 
   m_threads.join_all();
 }
 
 }
-
@@ -21,8 +21,9 @@
 
 #pragma once
 
+#include <atomic>
+#include <deque>
 #include <iostream>
-#include <queue>
 #include <vector>
 
 #include <boost/shared_ptr.hpp>
@@ -58,6 +59,12 @@ public:
   }
 };
 
+/** Each thread owns a deque of tasks. Submit() deals tasks out round robin
+ * and a thread whose own deque is empty steals from the others, so threads
+ * only contend when they run out of work. Both the owner and thieves take
+ * the oldest task first so tasks still start roughly in submission order,
+ * which keeps the OutputCollector backlog small.
+ */
 class ThreadPool
 {
 public:
@@ -67,9 +74,7 @@ public:
   explicit ThreadPool(size_t numThreads, int cpuAffinityOffset = -1,
                       int cpuAffinityIncr = 1);
 
-  ~ThreadPool() {
-    Stop();
-  }
+  ~ThreadPool();
 
   /**
    * Add a job to the threadpool.
@@ -89,18 +94,40 @@ public:
     m_queueLimit = limit;
   }
 
+  size_t GetNumThreads() const {
+    return m_workers.size();
+  }
+
 private:
+  struct Worker {
+    boost::mutex mutex;
+    std::deque<boost::shared_ptr<Task> > tasks;
+  };
+
   /**
    * The main loop executed by each thread.
    **/
-  void Execute();
+  void Execute(size_t workerInd);
 
-  std::queue<boost::shared_ptr<Task> > m_tasks;
+  // take a task from this thread's deque, else steal one
+  bool Pop(size_t workerInd, boost::shared_ptr<Task> &task);
+  bool Pop(Worker &worker, boost::shared_ptr<Task> &task);
+
+  void NotifyAvailable();
+
+  std::vector<Worker*> m_workers;
   boost::thread_group m_threads;
+
+  // only taken to sleep, wake up or block in Submit()/Stop()
   boost::mutex m_mutex;
   boost::condition_variable m_threadNeeded;
   boost::condition_variable m_threadAvailable;
-  bool m_stopped;
+
+  std::atomic<size_t> m_numQueued;
+  std::atomic<size_t> m_numSleeping;
+  std::atomic<size_t> m_numWaiting; // blocked in Submit() or Stop()
+  std::atomic<size_t> m_nextWorker;
+  std::atomic<bool> m_stopped;
   bool m_stopping;
   size_t m_queueLimit;
 };
@@ -1,3 +1,4 @@
+#include <cstdio>
 #include "Util2.h"
 #include "util/exception.hh"
 
@@ -26,5 +27,37 @@ const std::string ToLower(const std::string& str)
     lc  ;
 }
 
+std::string EscapeJson(const std::string& str)
+{
+  std::string ret;
+  ret.reserve(str.size());
+  for (size_t i = 0; i < str.size(); ++i) {
+    unsigned char c = str[i];
+    switch (c) {
+    case '"':
+      ret += "\\\"";
+      break;
+    case '\\':
+      ret += "\\\\";
+      break;
+    case '\n':
+      ret += "\\n";
+      break;
+    case '\t':
+      ret += "\\t";
+      break;
+    default:
+      if (c < 0x20) {
+        char buf[8];
+        snprintf(buf, sizeof(buf), "\\u%04x", c);
+        ret += buf;
+      } else {
+        ret += c;
+      }
+    }
+  }
+  return ret;
+}
+
 }
 
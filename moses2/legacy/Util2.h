@@ -292,6 +292,9 @@ inline bool FileExists(const std::string& filePath)
 
 const std::string ToLower(const std::string& str);
 
+//! str with the characters JSON doesn't allow in a string literal escaped
+std::string EscapeJson(const std::string& str);
+
 //! delete and remove every element of a collection object such as set, list etc
 template<class COLL>
 void RemoveAllInColl(COLL &coll)
@@ -40,6 +40,8 @@ struct
   bool PrintID;
   bool PrintPassThrough;
 
+  int verbose; // verbosity level of diagnostics on stderr
+
   // transrep = translation reporting
   std::string detailed_transrep_filepath;
   std::string detailed_tree_transrep_filepath;
@@ -16,6 +16,7 @@ SearchOptions()
   , max_partial_trans_opt(DEFAULT_MAX_PART_TRANS_OPT_SIZE)
   , beam_width(DEFAULT_BEAM_WIDTH)
   , timeout(0)
+  , deadline(0)
   , consensus(false)
   , early_discarding_threshold(DEFAULT_EARLY_DISCARDING_THRESHOLD)
   , trans_opt_threshold(DEFAULT_TRANSLATION_OPTION_THRESHOLD)
@@ -39,6 +40,7 @@ init(Parameter const& param)
   param.SetParameter(early_discarding_threshold, "early-discarding-threshold",
                      DEFAULT_EARLY_DISCARDING_THRESHOLD);
   param.SetParameter(timeout, "time-out", 0);
+  param.SetParameter(deadline, "deadline", size_t(0));
   param.SetParameter(max_phrase_length, "max-phrase-length",
                      DEFAULT_MAX_PHRASE_LENGTH);
   param.SetParameter(trans_opt_threshold, "translation-option-threshold",
@@ -96,6 +98,9 @@ update(std::map<std::string,xmlrpc_c::value>const& params)
   si = params.find("time-out");
   if (si != params.end()) timeout = xmlrpc_c::value_int(si->second);
 
+  si = params.find("deadline");
+  if (si != params.end()) deadline = xmlrpc_c::value_int(si->second);
+
   si = params.find("max-phrase-length");
   if (si != params.end()) max_phrase_length = xmlrpc_c::value_int(si->second);
 
@@ -26,6 +26,7 @@ struct
   float beam_width;
 
   int timeout;
+  size_t deadline; // time budget per sentence in ms. 0 = none
 
   bool consensus; //! Use Consensus decoding  (DeNero et al 2009)
 
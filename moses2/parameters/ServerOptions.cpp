@@ -46,6 +46,8 @@ ServerOptions()
   , keepaliveTimeout(15)
   , keepaliveMaxConn(30)
   , timeout(15)
+  , batchSize(1)
+  , batchWait(5)
 { }
 
 ServerOptions::
@@ -72,6 +74,10 @@ init(Parameter const& P)
   P.SetParameter(this->keepaliveMaxConn,"server-keepalive-maxconn", 30);
   P.SetParameter(this->timeout,"server-timeout",15);
 
+  // requests arriving together are decoded together
+  P.SetParameter(this->batchSize,"server-batch-size", size_t(1));
+  P.SetParameter(this->batchWait,"server-batch-wait", size_t(5));
+
   // the stuff below is related to Moses translation sessions
   std::string timeout_spec;
   P.SetParameter(timeout_spec, "session-timeout",std::string("30m"));
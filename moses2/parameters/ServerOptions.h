@@ -26,6 +26,9 @@ struct
   int keepaliveMaxConn;  // this is for the abyss server
   int timeout;           // this is for the abyss server
 
+  size_t batchSize;      // max. requests decoded together
+  size_t batchWait;      // max. ms a request waits for others to batch with
+
   bool init(Parameter const& param);
   ServerOptions(Parameter const& param);
   ServerOptions();
@@ -0,0 +1,167 @@
+/*
+ * RequestBatcher.cpp
+ *
+ *  Created on: 16 Oct 2026
+ */
+#include <string>
+#include <utility>
+#include <boost/foreach.hpp>
+#include <boost/unordered_map.hpp>
+#include "RequestBatcher.h"
+#include "TranslationRequest.h"
+#include "../PhraseBased/ManagerBatch.h"
+#include "../legacy/ThreadPool.h"
+
+using namespace std;
+
+namespace Moses2
+{
+
+namespace
+{
+class TranslationBatch: public Task
+{
+public:
+  TranslationBatch(std::vector<boost::shared_ptr<TranslationRequest> > &requests) {
+    m_requests.swap(requests);
+  }
+
+  virtual void Run() {
+    // the waiting threads must hear of a failure, or they wait forever
+    std::vector<TranslationRequest*> decoded;
+    std::vector<std::pair<TranslationRequest*, const TranslationRequest*> > duplicates;
+    std::string error;
+    try {
+      Decode(decoded, duplicates);
+    } catch (const std::exception &e) {
+      error = std::string("Decoding failed: ") + e.what();
+    } catch (...) {
+      error = "Decoding failed";
+    }
+
+    if (!error.empty()) {
+      BOOST_FOREACH(const boost::shared_ptr<TranslationRequest> &request, m_requests) {
+        request->Fail(error);
+      }
+      return;
+    }
+
+    for (size_t i = 0; i < duplicates.size(); ++i) {
+      duplicates[i].first->RunAs(*duplicates[i].second);
+    }
+    BOOST_FOREACH(TranslationRequest *request, decoded) {
+      request->Finish();
+    }
+  }
+
+protected:
+  std::vector<boost::shared_ptr<TranslationRequest> > m_requests;
+
+  // decodes and outputs the distinct requests. A request that is the same as
+  // an earlier one goes in duplicates, to get a copy of its result
+  void Decode(std::vector<TranslationRequest*> &decoded,
+              std::vector<std::pair<TranslationRequest*, const TranslationRequest*> > &duplicates) {
+    typedef boost::unordered_map<std::string, TranslationRequest*> Distinct;
+    Distinct distinct;
+
+    ManagerBatch batch;
+    BOOST_FOREACH(const boost::shared_ptr<TranslationRequest> &request, m_requests) {
+      std::pair<Distinct::iterator, bool> ret =
+        distinct.insert(Distinct::value_type(request->GetKey(), request.get()));
+      if (ret.second) {
+        batch.Add(request->GetManager());
+        decoded.push_back(request.get());
+      } else {
+        duplicates.push_back(std::make_pair(request.get(), ret.first->second));
+      }
+    }
+
+    batch.Decode();
+
+    // the managers share this thread's pools. Output all of them before
+    // any is deleted
+    BOOST_FOREACH(TranslationRequest *request, decoded) {
+      request->Output();
+    }
+  }
+};
+}
+
+RequestBatcher::RequestBatcher(ThreadPool &pool, size_t maxBatchSize, size_t maxWait)
+  :m_pool(pool)
+  ,m_maxBatchSize(maxBatchSize)
+  ,m_maxWait(maxWait)
+  ,m_stop(false)
+{
+  m_timer = boost::thread(&RequestBatcher::RunTimer, this);
+}
+
+RequestBatcher::~RequestBatcher()
+{
+  boost::shared_ptr<Task> batch;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_stop = true;
+    m_pendingAdded.notify_one();
+  }
+  m_timer.join();
+
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    batch = TakeBatch();
+  }
+  if (batch) {
+    m_pool.Submit(batch);
+  }
+}
+
+void RequestBatcher::Submit(const boost::shared_ptr<TranslationRequest> &request)
+{
+  boost::shared_ptr<Task> batch;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (m_pending.empty()) {
+      m_flushTime = boost::get_system_time() + m_maxWait;
+      m_pendingAdded.notify_one();
+    }
+
+    m_pending.push_back(request);
+    if (m_pending.size() >= m_maxBatchSize) {
+      batch = TakeBatch();
+    }
+  }
+
+  // outside the lock, Submit() may block
+  if (batch) {
+    m_pool.Submit(batch);
+  }
+}
+
+boost::shared_ptr<Task> RequestBatcher::TakeBatch()
+{
+  boost::shared_ptr<Task> ret;
+  if (!m_pending.empty()) {
+    ret.reset(new TranslationBatch(m_pending));
+  }
+  return ret;
+}
+
+void RequestBatcher::RunTimer()
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  while (!m_stop) {
+    if (m_pending.empty()) {
+      m_pendingAdded.wait(lock);
+    } else if (boost::get_system_time() >= m_flushTime) {
+      boost::shared_ptr<Task> batch = TakeBatch();
+      lock.unlock();
+      m_pool.Submit(batch);
+      lock.lock();
+    } else {
+      m_pendingAdded.timed_wait(lock, m_flushTime);
+    }
+  }
+}
+
+}
+
@@ -0,0 +1,62 @@
+/*
+ * RequestBatcher.h
+ *
+ *  Created on: 16 Oct 2026
+ */
+
+#pragma once
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+namespace Moses2
+{
+class ThreadPool;
+class Task;
+class TranslationRequest;
+
+/** Decodes requests that arrive close together as 1 batch. See
+ * server-batch-size.
+ *
+ * Requests are queued until there are maxBatchSize of them, or until the
+ * first has waited maxWait milliseconds. The queue then goes to the thread
+ * pool as 1 task, which decodes its requests together with a ManagerBatch:
+ * the phrase tables look up the source phrases of all of them in 1 pass
+ * and, with search-algorithm 4, the stateful feature functions score the
+ * new hypos of all of them in 1 batch. A request with the same key as an
+ * earlier one in the batch isn't decoded but gets a copy of its result.
+ */
+class RequestBatcher
+{
+public:
+  RequestBatcher(ThreadPool &pool, size_t maxBatchSize, size_t maxWait);
+  ~RequestBatcher();
+
+  void Submit(const boost::shared_ptr<TranslationRequest> &request);
+
+protected:
+  typedef std::vector<boost::shared_ptr<TranslationRequest> > Requests;
+
+  ThreadPool &m_pool;
+  size_t m_maxBatchSize;
+  boost::posix_time::milliseconds m_maxWait;
+
+  boost::mutex m_mutex;
+  boost::condition_variable m_pendingAdded;
+  Requests m_pending;
+  boost::system_time m_flushTime; // when the pending batch must go
+  bool m_stop;
+
+  boost::thread m_timer;
+
+  // the pending requests as a task for the pool. NULL if there are none.
+  // With m_mutex held
+  boost::shared_ptr<Task> TakeBatch();
+
+  // submits batches that have waited long enough
+  void RunTimer();
+};
+
+}
+
@@ -15,11 +15,39 @@ using namespace std;
 namespace Moses2
 {
 
+namespace
+{
+// feature function call counts and cycles so far, see -profile-features
+class ProfileMethod : public xmlrpc_c::method
+{
+public:
+  ProfileMethod(System &system)
+    :m_system(system) {
+    this->_signature = "s:";
+    this->_help = "Returns the feature function profile as JSON";
+  }
+
+  void execute(xmlrpc_c::paramList const& paramList,
+               xmlrpc_c::value *const retvalP) {
+    const FeatureProfiler *profiler = m_system.featureFunctions.GetProfiler();
+    if (profiler == NULL) {
+      throw xmlrpc_c::fault("Profiling is off, run with -profile-features",
+                            xmlrpc_c::fault::CODE_UNSPECIFIED);
+    }
+    *retvalP = xmlrpc_c::value_string(profiler->Report());
+  }
+
+protected:
+  System &m_system;
+};
+}
+
 Server::Server(ServerOptions &server_options, System &system)
   :m_server_options(server_options)
   ,m_translator(new Translator(*this, system))
 {
     m_registry.addMethod("translate", m_translator);
+    m_registry.addMethod("profile", xmlrpc_c::methodPtr(new ProfileMethod(system)));
 }
 
 Server::~Server()
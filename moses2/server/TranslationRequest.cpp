@@ -1,6 +1,8 @@
+#include <sstream>
 #include <boost/foreach.hpp>
 #include "TranslationRequest.h"
 #include "../ManagerBase.h"
+#include "../PhraseBased/Manager.h"
 #include "../System.h"
 
 using namespace std;
@@ -15,11 +17,28 @@ TranslationRequest(xmlrpc_c::paramList const& paramList,
                    const std::string &line,
                    long translationId)
   :TranslationTask(system, line, translationId)
+  ,m_text(line)
   ,m_cond(cond)
   ,m_mutex(mut)
   ,m_done(false)
 {
+  // time budget of this request, instead of the deadline param
+  typedef std::map<std::string, xmlrpc_c::value> params_t;
+  params_t const& params = paramList.getStruct(0);
+  params_t::const_iterator si = params.find("deadline");
+  if (si != params.end()) {
+    m_mgr->GetDeadline().SetBudget(xmlrpc_c::value_int(si->second));
+  }
+}
 
+std::string
+TranslationRequest::
+GetKey() const
+{
+  // everything the translation depends on
+  std::stringstream key;
+  key << m_mgr->GetDeadline().GetBudget() << " " << m_text;
+  return key.str();
 }
 
 boost::shared_ptr<TranslationRequest>
@@ -43,21 +62,82 @@ void
 TranslationRequest::
 Run()
 {
-  m_mgr->Decode();
+  try {
+    m_mgr->Decode();
+    Output();
+  } catch (const std::exception &e) {
+    Fail(std::string("Decoding failed: ") + e.what());
+    return;
+  } catch (...) {
+    Fail("Decoding failed");
+    return;
+  }
+  Finish();
+}
 
+Manager&
+TranslationRequest::
+GetManager()
+{
+  return *static_cast<Manager*>(m_mgr);
+}
+
+void
+TranslationRequest::
+Output()
+{
   string out;
   out = m_mgr->OutputBest();
   m_retData["text"] = xmlrpc_c::value_string(out);
 
-  {
-    boost::lock_guard<boost::mutex> lock(m_mutex);
-    m_done = true;
+  const Deadline &deadline = m_mgr->GetDeadline();
+  if (deadline.GetBudget()) {
+    std::map<std::string, xmlrpc_c::value> beam;
+    beam["budget"] = xmlrpc_c::value_int(deadline.GetBudget());
+    beam["elapsed"] = xmlrpc_c::value_double(deadline.GetElapsed());
+    beam["steps"] = xmlrpc_c::value_int(deadline.GetNumSteps());
+    beam["degraded-steps"] = xmlrpc_c::value_int(deadline.GetNumDegradedSteps());
+    beam["min-beam"] = xmlrpc_c::value_double(deadline.GetMinBeamFactor());
+    beam["avg-beam"] = xmlrpc_c::value_double(deadline.GetAverageBeamFactor());
+    m_retData["deadline"] = xmlrpc_c::value_struct(beam);
   }
-  m_cond.notify_one();
+}
 
+void
+TranslationRequest::
+Finish()
+{
+  SetDone();
   delete m_mgr;
 }
 
+void
+TranslationRequest::
+Fail(const std::string &error)
+{
+  m_error = error;
+  Finish();
+}
+
+void
+TranslationRequest::
+RunAs(const TranslationRequest &other)
+{
+  m_retData = other.m_retData;
+  Finish();
+}
+
+void
+TranslationRequest::
+SetDone()
+{
+  // notify with the lock held. The waiter owns m_cond and may be gone
+  // as soon as it sees m_done
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  m_done = true;
+  m_cond.notify_one();
+}
+
 void TranslationRequest::pack_hypothesis(const Manager& manager, Hypothesis const* h,
     std::string const& key,
     std::map<std::string, xmlrpc_c::value> & dest) const
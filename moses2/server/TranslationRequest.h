@@ -26,7 +26,9 @@ class
 {
 protected:
   std::map<std::string, xmlrpc_c::value> m_retData;
+  std::string m_error; // empty unless decoding failed
   Translator* m_translator;
+  std::string m_text;
 
   boost::condition_variable& m_cond;
   boost::mutex& m_mutex;
@@ -39,6 +41,9 @@ protected:
                      const std::string &line,
                      long translationId);
 
+  void
+  SetDone();
+
   void
   pack_hypothesis(const Manager& manager, Hypothesis const* h,
                   std::string const& key,
@@ -72,9 +77,40 @@ public:
     return m_retData;
   }
 
+  std::string const&
+  GetError() const {
+    return m_error;
+  }
+
   void
   Run();
 
+  // requests with the same key get the same translation
+  std::string
+  GetKey() const;
+
+  // finish with the result of 'other', which has the same key and has
+  // been output
+  void
+  RunAs(const TranslationRequest &other);
+
+  // Run() in steps, for requests decoded in a batch. See RequestBatcher.
+  // The manager is phrase-based
+  Manager&
+  GetManager();
+
+  // once the manager has decoded
+  void
+  Output();
+
+  // hand the result to the waiting thread and delete the manager
+  void
+  Finish();
+
+  // Finish() with an error instead of a result
+  void
+  Fail(const std::string &error);
+
 
 };
 
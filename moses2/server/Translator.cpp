@@ -8,6 +8,8 @@
 #include "Translator.h"
 #include "TranslationRequest.h"
 #include "Server.h"
+#include "RequestBatcher.h"
+#include "../System.h"
 #include "../parameters/ServerOptions.h"
 
 using namespace std;
@@ -26,6 +28,14 @@ Translator::Translator(Server& server, System &system)
   // system.methodHelp RPC.
   this->_signature = "S:S";
   this->_help = "Does translation";
+
+  // a batch shares phrase-table lookups, so it must be phrase-based, and
+  // the candidates of a sentence are in a pt of their own
+  const ServerOptions &opts = server.options();
+  if (opts.batchSize > 1 && system.isPb
+      && system.options.input.input_type != SentenceInputWithCandidates) {
+    m_batcher.reset(new RequestBatcher(m_threadPool, opts.batchSize, opts.batchWait));
+  }
 }
 
 Translator::~Translator()
@@ -57,11 +67,18 @@ void Translator::execute(xmlrpc_c::paramList const& paramList,
   boost::mutex mut;
   boost::shared_ptr<TranslationRequest> task;
   task = TranslationRequest::create(this, paramList,cond,mut, m_system, line, translationId);
-  m_threadPool.Submit(task);
+  if (m_batcher) {
+    m_batcher->Submit(task);
+  } else {
+    m_threadPool.Submit(task);
+  }
   boost::unique_lock<boost::mutex> lock(mut);
   while (!task->IsDone()) {
     cond.wait(lock);
   }
+  if (!task->GetError().empty()) {
+    throw xmlrpc_c::fault(task->GetError(), xmlrpc_c::fault::CODE_INTERNAL);
+  }
   *retvalP = xmlrpc_c::value_struct(task->GetRetData());
 }
 
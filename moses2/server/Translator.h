@@ -10,6 +10,7 @@
 #include <xmlrpc-c/base.hpp>
 #include <xmlrpc-c/registry.hpp>
 #include <xmlrpc-c/server_abyss.hpp>
+#include <boost/scoped_ptr.hpp>
 #include "../legacy/ThreadPool.h"
 
 namespace Moses2
@@ -17,6 +18,7 @@ namespace Moses2
 class Server;
 class System;
 class Manager;
+class RequestBatcher;
 
 class Translator : public xmlrpc_c::method
 {
@@ -33,6 +35,7 @@ protected:
   System &m_system;
   long m_translationId;
   boost::shared_mutex m_accessLock;
+  boost::scoped_ptr<RequestBatcher> m_batcher; // NULL if not batching
 
 };
 
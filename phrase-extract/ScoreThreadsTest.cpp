@@ -0,0 +1,120 @@
+/***********************************************************************
+  Moses - factored phrase-based language decoder
+  Copyright (C) 2026 University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+// Runs the score program given as the first argument with and without
+// --Threads and checks that the phrase tables are byte-identical.
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define  BOOST_TEST_MODULE MosesTrainingScoreThreads
+#include <boost/test/unit_test.hpp>
+
+#include "TestUtil.h"
+
+using namespace MosesTraining;
+using namespace std;
+
+namespace
+{
+
+/* An extract file with enough source phrases to fill several of the blocks
+ * the scorers take in turn, some with several targets, alignments and
+ * repeated lines, and its lexical table.
+ */
+void MakeInput(const TempDir &dir, bool inverse)
+{
+  vector<string> lines;
+  ostringstream lex;
+  for (size_t i = 0; i < 4000; ++i) {
+    ostringstream source, target;
+    source << "s" << i % 701 << " s" << i % 13;
+    target << "t" << i % 503;
+    if (i % 3) {
+      target << " t" << i % 7;
+    }
+    string alignment = i % 3 ? (i % 5 ? " 0-0 1-1" : " 0-1 1-0") : " 0-0 1-0";
+    if (inverse) {
+      alignment = i % 3 ? (i % 5 ? " 0-0 1-1" : " 1-0 0-1") : " 0-0 0-1";
+      lines.push_back(target.str() + " ||| " + source.str() + " |||" + alignment);
+    } else {
+      lines.push_back(source.str() + " ||| " + target.str() + " |||" + alignment);
+    }
+    if (i % 4 == 0) {
+      lines.push_back(lines.back());
+    }
+    lex << "t" << i % 503 << " s" << i % 701 << " 0." << 1 + i % 9 << "\n";
+    lex << "t" << i % 7 << " s" << i % 13 << " 0." << 1 + i % 7 << "\n";
+  }
+  lex << "t1 NULL 0.05\n";
+  sort(lines.begin(), lines.end());
+
+  string extract;
+  for (size_t i = 0; i < lines.size(); ++i) {
+    extract += lines[i] + "\n";
+  }
+  WriteFile(dir / "extract", extract);
+  WriteFile(dir / "lex", lex.str());
+}
+
+string Score(const TempDir &dir, const string &output, const string &args)
+{
+  Run(ProgramArgument(1, "score") + " " + dir / "extract" + " " + dir / "lex" + " "
+      + dir / output + " " + args + " 2> " + dir / (output + ".log"));
+  return ReadFile(dir / output);
+}
+
+void CheckThreads(const string &args, bool inverse)
+{
+  TempDir dir("score_threads_test");
+  MakeInput(dir, inverse);
+  string serial = Score(dir, "pt.serial", args);
+  BOOST_REQUIRE(!serial.empty());
+  for (size_t threads = 2; threads <= 4; ++threads) {
+    ostringstream threadArgs;
+    threadArgs << args << " --Threads " << threads;
+    string threaded = Score(dir, "pt.threaded", threadArgs.str());
+    BOOST_CHECK_MESSAGE(serial == threaded, "--Threads " << threads << " " << args);
+  }
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(direct)
+{
+  CheckThreads("", false);
+}
+
+// the count of counts are summed from all scorers
+BOOST_AUTO_TEST_CASE(direct_good_turing)
+{
+  TempDir dir("score_threads_test");
+  MakeInput(dir, false);
+  string serial = Score(dir, "pt.serial", "--GoodTuring --UnalignedPenalty");
+  string threaded = Score(dir, "pt.threaded", "--GoodTuring --UnalignedPenalty --Threads 3");
+  BOOST_CHECK(serial == threaded);
+  BOOST_CHECK(ReadFile(dir / "pt.serial.coc") == ReadFile(dir / "pt.threaded.coc"));
+}
+
+BOOST_AUTO_TEST_CASE(inverse)
+{
+  CheckThreads("--Inverse", true);
+}
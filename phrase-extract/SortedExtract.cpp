@@ -0,0 +1,237 @@
+/***********************************************************************
+  Moses - factored phrase-based language decoder
+  Copyright (C) 2026 University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#include "SortedExtract.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <boost/lexical_cast.hpp>
+
+#include "util/exception.hh"
+#include "util/stream/io.hh"
+
+namespace MosesTraining
+{
+
+namespace
+{
+const char kMagic[8] = {'m', 'o', 's', 'e', 's', 'e', 'x', '1'};
+
+const std::string kPhraseEnd("|||");
+
+void WriteWords(int fd, Vocabulary &vocab, uint64_t &bytes)
+{
+  std::string words;
+  for (WORD_ID id = 0; id < vocab.lookup.size(); ++id) {
+    words += vocab.getWord(id);
+    words += '\n';
+  }
+  util::WriteOrThrow(fd, words.data(), words.size());
+  bytes = words.size();
+}
+
+void ReadWords(int fd, uint64_t bytes, Vocabulary &vocab)
+{
+  UTIL_THROW_IF2(!vocab.lookup.empty(), "Vocabulary must be empty before reading a sorted extract file");
+  std::string words(bytes, '\0');
+  util::ReadOrThrow(fd, &words[0], bytes);
+  size_t begin = 0;
+  for (size_t end; (end = words.find('\n', begin)) != std::string::npos; begin = end + 1) {
+    vocab.storeIfNew(words.substr(begin, end - begin));
+  }
+}
+}
+
+SortedExtractLayout::SortedExtractLayout(size_t maxPhraseLength)
+  : m_maxPhraseLength(maxPhraseLength)
+{
+  UTIL_THROW_IF2(maxPhraseLength == 0 || maxPhraseLength > 255,
+                 "Sorted extract files support phrases of 1 to 255 words, not " << maxPhraseLength);
+  m_alignmentBytes = (maxPhraseLength * maxPhraseLength + 7) / 8;
+  m_recordSize = sizeof(Fixed) + 2 * maxPhraseLength * sizeof(WORD_ID) + m_alignmentBytes;
+  // keep the next record's fields aligned
+  m_recordSize = (m_recordSize + sizeof(WORD_ID) - 1) / sizeof(WORD_ID) * sizeof(WORD_ID);
+}
+
+void SortedExtractLayout::AlignmentText(const void *record, bool inverse, std::string &out) const
+{
+  const Fixed &fixed = GetFixed(record);
+  size_t outerLength = inverse ? fixed.sourceLength : fixed.targetLength;
+  size_t innerLength = inverse ? fixed.targetLength : fixed.sourceLength;
+  out.clear();
+  for (size_t outer = 0; outer < outerLength; ++outer) {
+    for (size_t inner = 0; inner < innerLength; ++inner) {
+      size_t s = inverse ? outer : inner;
+      size_t t = inverse ? inner : outer;
+      if (IsAligned(record, s, t)) {
+        out += ' ';
+        out += boost::lexical_cast<std::string>(s);
+        out += '-';
+        out += boost::lexical_cast<std::string>(t);
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+int SortedExtractCompare::ComparePhrase(const WORD_ID *first, size_t firstLength,
+                                        const WORD_ID *second, size_t secondLength,
+                                        Vocabulary &vocab)
+{
+  // each word is followed by a space in the text, as is the closing |||
+  for (size_t i = 0; i < firstLength || i < secondLength; ++i) {
+    if (i < firstLength && i < secondLength && first[i] == second[i]) {
+      continue;
+    }
+    const std::string &firstWord = i < firstLength ? vocab.getWord(first[i]) : kPhraseEnd;
+    const std::string &secondWord = i < secondLength ? vocab.getWord(second[i]) : kPhraseEnd;
+    int ret = firstWord.compare(secondWord);
+    if (ret) {
+      return ret;
+    }
+  }
+  return 0;
+}
+
+int SortedExtractCompare::Compare(const void *first, const void *second) const
+{
+  const SortedExtractLayout::Fixed &firstFixed = m_layout.GetFixed(first);
+  const SortedExtractLayout::Fixed &secondFixed = m_layout.GetFixed(second);
+
+  int ret = ComparePhrase(m_layout.Source(first), firstFixed.sourceLength,
+                          m_layout.Source(second), secondFixed.sourceLength,
+                          *m_sourceVocab);
+  if (ret) {
+    return ret;
+  }
+  ret = ComparePhrase(m_layout.Target(first), firstFixed.targetLength,
+                      m_layout.Target(second), secondFixed.targetLength,
+                      *m_targetVocab);
+  if (ret) {
+    return ret;
+  }
+  if (memcmp(m_layout.Alignment(first), m_layout.Alignment(second), m_layout.AlignmentBytes())) {
+    std::string firstAlignment, secondAlignment;
+    m_layout.AlignmentText(first, m_inverse, firstAlignment);
+    m_layout.AlignmentText(second, m_inverse, secondAlignment);
+    return firstAlignment.compare(secondAlignment);
+  }
+  if (firstFixed.sentenceId != secondFixed.sentenceId) {
+    return firstFixed.sentenceId < secondFixed.sentenceId ? -1 : 1;
+  }
+  if (firstFixed.count != secondFixed.count) {
+    return firstFixed.count < secondFixed.count ? -1 : 1;
+  }
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////
+SortedExtractWriter::SortedExtractWriter(const std::string &fileName, size_t maxPhraseLength,
+    Vocabulary &sourceVocab, Vocabulary &targetVocab, bool inverse,
+    const std::string &tempPrefix, size_t memory)
+  : m_fileName(fileName)
+  , m_layout(maxPhraseLength)
+  , m_sourceVocab(sourceVocab)
+  , m_targetVocab(targetVocab)
+  , m_inverse(inverse)
+  , m_chain(util::stream::ChainConfig(m_layout.RecordSize(), 2, memory / 2))
+  , m_pending(false)
+{
+  m_config.temp_prefix = tempPrefix;
+  m_config.total_memory = memory;
+  m_config.buffer_size = std::max<size_t>(memory / 16, m_layout.RecordSize());
+
+  // blocks of the chain are sorted as they fill, the sorted runs merged in Finish()
+  m_chain >> m_stream;
+  m_sort.reset(new util::stream::Sort<SortedExtractCompare>(m_chain, m_config,
+               SortedExtractCompare(m_layout, m_sourceVocab, m_targetVocab, m_inverse)));
+}
+
+void *SortedExtractWriter::NewRecord()
+{
+  if (m_pending) {
+    ++m_stream;
+  }
+  memset(m_stream.Get(), 0, m_layout.RecordSize());
+  m_pending = true;
+  return m_stream.Get();
+}
+
+void SortedExtractWriter::Finish()
+{
+  if (m_pending) {
+    ++m_stream;
+    m_pending = false;
+  }
+  m_stream.Poison();
+  m_chain.Wait(true);
+
+  util::scoped_fd file(util::CreateOrThrow(m_fileName.c_str()));
+
+  SortedExtractHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.maxPhraseLength = m_layout.MaxPhraseLength();
+  header.recordSize = m_layout.RecordSize();
+  header.recordCount = m_sort->Size() / m_layout.RecordSize();
+  util::WriteOrThrow(file.get(), &header, sizeof(header));
+
+  WriteWords(file.get(), m_sourceVocab, header.sourceVocabularyBytes);
+  WriteWords(file.get(), m_targetVocab, header.targetVocabularyBytes);
+
+  util::stream::Chain out(util::stream::ChainConfig(m_layout.RecordSize(), 2, m_config.buffer_size * 2));
+  m_sort->Output(out);
+  out >> util::stream::WriteAndRecycle(file.get());
+  out.Wait();
+  m_sort.reset();
+
+  // now that the vocabulary sizes are known
+  util::SeekOrThrow(file.get(), 0);
+  util::WriteOrThrow(file.get(), &header, sizeof(header));
+}
+
+////////////////////////////////////////////////////////////////////////////
+SortedExtractReader::SortedExtractReader(const std::string &fileName)
+  : m_file(util::OpenReadOrThrow(fileName.c_str()))
+{
+  util::ReadOrThrow(m_file.get(), &m_header, sizeof(m_header));
+  UTIL_THROW_IF2(memcmp(m_header.magic, kMagic, sizeof(kMagic)),
+                 fileName << " is not a sorted extract file");
+  m_layout.reset(new SortedExtractLayout(m_header.maxPhraseLength));
+  UTIL_THROW_IF2(m_layout->RecordSize() != m_header.recordSize,
+                 fileName << " has records of " << m_header.recordSize
+                 << " bytes, expected " << m_layout->RecordSize());
+}
+
+void SortedExtractReader::ReadVocabulary(Vocabulary &sourceVocab, Vocabulary &targetVocab)
+{
+  ReadWords(m_file.get(), m_header.sourceVocabularyBytes, sourceVocab);
+  ReadWords(m_file.get(), m_header.targetVocabularyBytes, targetVocab);
+}
+
+void SortedExtractReader::Start()
+{
+  // 64 MB of read ahead
+  m_chain.reset(new util::stream::Chain(util::stream::ChainConfig(
+                  m_layout->RecordSize(), 2, std::max<size_t>(64 << 20, 2 * m_layout->RecordSize()))));
+  *m_chain >> util::stream::Read(m_file.get()) >> m_stream >> util::stream::kRecycle;
+}
+
+}
@@ -0,0 +1,234 @@
+/***********************************************************************
+  Moses - factored phrase-based language decoder
+  Copyright (C) 2026 University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <boost/scoped_ptr.hpp>
+
+#include "util/file.hh"
+#include "util/stream/chain.hh"
+#include "util/stream/config.hh"
+#include "util/stream/sort.hh"
+#include "util/stream/stream.hh"
+
+#include "tables-core.h"
+
+namespace MosesTraining
+{
+
+/* Binary extract file, written by extract --SortedBinary and read by
+ * score --SortedBinary instead of piping the text through sort.
+ *
+ * Each phrase pair is a fixed-size record of vocabulary ids, so it can be
+ * sorted by util::stream::Sort on the fly while extract is running.  The
+ * file is a SortedExtractHeader, the source and target vocabulary (one word
+ * per line, in id order) and then the sorted records.
+ */
+class SortedExtractLayout
+{
+public:
+  struct Fixed {
+    uint32_t sentenceId;
+    float count;
+    uint8_t sourceLength;
+    uint8_t targetLength;
+    uint16_t reserved;
+  };
+
+  explicit SortedExtractLayout(size_t maxPhraseLength);
+
+  size_t MaxPhraseLength() const {
+    return m_maxPhraseLength;
+  }
+  size_t RecordSize() const {
+    return m_recordSize;
+  }
+  size_t AlignmentBytes() const {
+    return m_alignmentBytes;
+  }
+
+  Fixed &GetFixed(void *record) const {
+    return *static_cast<Fixed*>(record);
+  }
+  const Fixed &GetFixed(const void *record) const {
+    return *static_cast<const Fixed*>(record);
+  }
+  WORD_ID *Source(void *record) const {
+    return reinterpret_cast<WORD_ID*>(static_cast<uint8_t*>(record) + sizeof(Fixed));
+  }
+  const WORD_ID *Source(const void *record) const {
+    return reinterpret_cast<const WORD_ID*>(static_cast<const uint8_t*>(record) + sizeof(Fixed));
+  }
+  WORD_ID *Target(void *record) const {
+    return Source(record) + m_maxPhraseLength;
+  }
+  const WORD_ID *Target(const void *record) const {
+    return Source(record) + m_maxPhraseLength;
+  }
+
+  // alignment points as a bit set, bit t * max + s for point s-t
+  uint8_t *Alignment(void *record) const {
+    return reinterpret_cast<uint8_t*>(Target(record) + m_maxPhraseLength);
+  }
+  const uint8_t *Alignment(const void *record) const {
+    return reinterpret_cast<const uint8_t*>(Target(record) + m_maxPhraseLength);
+  }
+  void AddAlignmentPoint(void *record, size_t s, size_t t) const {
+    size_t bit = t * m_maxPhraseLength + s;
+    Alignment(record)[bit >> 3] |= 1 << (bit & 7);
+  }
+  bool IsAligned(const void *record, size_t s, size_t t) const {
+    size_t bit = t * m_maxPhraseLength + s;
+    return Alignment(record)[bit >> 3] & (1 << (bit & 7));
+  }
+
+  // the alignment as extract writes it after the target phrase, " s-t s-t".
+  // Points are listed by target word, or by source word for the inverse file
+  void AlignmentText(const void *record, bool inverse, std::string &out) const;
+
+private:
+  size_t m_maxPhraseLength;
+  size_t m_alignmentBytes;
+  size_t m_recordSize;
+};
+
+struct SortedExtractHeader {
+  char magic[8];
+  uint32_t maxPhraseLength;
+  uint32_t recordSize;
+  uint64_t recordCount;
+  uint64_t sourceVocabularyBytes;
+  uint64_t targetVocabularyBytes;
+};
+
+/* Orders records like LC_ALL=C sort orders the text lines, so score sees the
+ * phrase pairs, and the alignments of each pair, in the same order.  Words
+ * are only compared as strings when their ids differ.  Pairs with the same
+ * phrases are compared on their alignment text, rebuilt from the bit set.
+ * The bit set doesn't keep the order of the points of one word, so this
+ * matches the text when the alignment file lists them by source position,
+ * as symal does.  Equal lines are ordered by sentence and count.
+ */
+class SortedExtractCompare
+{
+public:
+  SortedExtractCompare(const SortedExtractLayout &layout,
+                       Vocabulary &sourceVocab, Vocabulary &targetVocab, bool inverse)
+    : m_layout(layout), m_sourceVocab(&sourceVocab), m_targetVocab(&targetVocab)
+    , m_inverse(inverse) {
+  }
+
+  bool operator()(const void *first, const void *second) const {
+    return Compare(first, second) < 0;
+  }
+
+  int Compare(const void *first, const void *second) const;
+
+private:
+  static int ComparePhrase(const WORD_ID *first, size_t firstLength,
+                           const WORD_ID *second, size_t secondLength,
+                           Vocabulary &vocab);
+
+  SortedExtractLayout m_layout;
+  Vocabulary *m_sourceVocab, *m_targetVocab;
+  bool m_inverse;
+};
+
+/* Collects records from the extraction and sorts each block in the
+ * background while the next one is filled.  Finish() merges the sorted
+ * blocks into the output file.  The vocabularies may grow in the calling
+ * thread while blocks are sorted, see Vocabulary.
+ */
+class SortedExtractWriter
+{
+public:
+  // inverse: the file is the inverse extract file, target phrase first
+  SortedExtractWriter(const std::string &fileName, size_t maxPhraseLength,
+                      Vocabulary &sourceVocab, Vocabulary &targetVocab, bool inverse,
+                      const std::string &tempPrefix, size_t memory);
+
+  const SortedExtractLayout &GetLayout() const {
+    return m_layout;
+  }
+  Vocabulary &GetSourceVocabulary() {
+    return m_sourceVocab;
+  }
+  Vocabulary &GetTargetVocabulary() {
+    return m_targetVocab;
+  }
+
+  // zeroed record to fill in, added by the next call to NewRecord() or Finish()
+  void *NewRecord();
+
+  void Finish();
+
+private:
+  std::string m_fileName;
+  SortedExtractLayout m_layout;
+  Vocabulary &m_sourceVocab, &m_targetVocab;
+  bool m_inverse;
+  util::stream::SortConfig m_config;
+
+  // declared first, the sorter's worker runs in m_chain
+  boost::scoped_ptr<util::stream::Sort<SortedExtractCompare> > m_sort;
+  util::stream::Chain m_chain;
+  util::stream::Stream m_stream;
+  bool m_pending;
+};
+
+class SortedExtractReader
+{
+public:
+  explicit SortedExtractReader(const std::string &fileName);
+
+  const SortedExtractLayout &GetLayout() const {
+    return *m_layout;
+  }
+
+  // Add the words to empty vocabularies, so the ids in the records can be used as they are.
+  void ReadVocabulary(Vocabulary &sourceVocab, Vocabulary &targetVocab);
+
+  // Start reading records.  Call after ReadVocabulary().
+  void Start();
+
+  operator bool() const {
+    return m_stream;
+  }
+  const void *Get() const {
+    return m_stream.Get();
+  }
+  SortedExtractReader &operator++() {
+    ++m_stream;
+    return *this;
+  }
+
+private:
+  util::scoped_fd m_file;
+  SortedExtractHeader m_header;
+  boost::scoped_ptr<SortedExtractLayout> m_layout;
+
+  boost::scoped_ptr<util::stream::Chain> m_chain;
+  util::stream::Stream m_stream;
+};
+
+}
@@ -0,0 +1,203 @@
+/***********************************************************************
+  Moses - factored phrase-based language decoder
+  Copyright (C) 2026 University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+// Runs the extract and score programs given as arguments on a small corpus,
+// with and without --SortedBinary.  The sorted binary files must hold the
+// lines of the text extract files in LC_ALL=C sort order, and score must
+// make the same phrase tables from both.
+
+#include "SortedExtract.h"
+#include "tables-core.h"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define  BOOST_TEST_MODULE MosesTrainingSortedExtract
+#include <boost/test/unit_test.hpp>
+
+#include "TestUtil.h"
+
+using namespace MosesTraining;
+using namespace std;
+
+namespace
+{
+
+/* Sentences over a few words, so the same phrase pairs come up with
+ * different alignments, some of them long enough for two digit positions.
+ * The points are listed by source position, as symal writes them.
+ */
+void MakeCorpus(const TempDir &dir)
+{
+  const char *sourceWords[] = {"a", "b", "c", "d", "ab", "a-b"};
+  const char *targetWords[] = {"x", "y", "z", "xy", "x.y"};
+  ostringstream source, target, alignment, lex;
+  unsigned int state = 1;
+  for (size_t sentence = 0; sentence < 60; ++sentence) {
+    size_t sourceLength = 1 + sentence % 4, targetLength = 1 + sentence % 3;
+    if (sentence % 10 == 9) {
+      sourceLength = 11 + sentence % 3;
+      targetLength = 12;
+    }
+    vector<string> sourceSentence, targetSentence;
+    for (size_t s = 0; s < sourceLength; ++s) {
+      state = state * 1103515245 + 12345;
+      sourceSentence.push_back(sourceWords[(state >> 16) % 6]);
+      source << (s ? " " : "") << sourceSentence.back();
+    }
+    for (size_t t = 0; t < targetLength; ++t) {
+      state = state * 1103515245 + 12345;
+      targetSentence.push_back(targetWords[(state >> 16) % 5]);
+      target << (t ? " " : "") << targetSentence.back();
+    }
+    bool first = true;
+    for (size_t s = 0; s < sourceLength; ++s) {
+      for (size_t t = 0; t < targetLength; ++t) {
+        state = state * 1103515245 + 12345;
+        // mostly the diagonal, sometimes more or nothing
+        if ((s * targetLength / sourceLength == t && (state >> 16) % 7) || (state >> 16) % 5 == 0) {
+          alignment << (first ? "" : " ") << s << "-" << t;
+          first = false;
+          lex << targetSentence[t] << " " << sourceSentence[s] << " 0.5\n";
+        }
+      }
+    }
+    source << "\n";
+    target << "\n";
+    alignment << "\n";
+  }
+  lex << "x NULL 0.1\n";
+  WriteFile(dir / "corpus.f", source.str());
+  WriteFile(dir / "corpus.e", target.str());
+  WriteFile(dir / "corpus.a", alignment.str());
+  WriteFile(dir / "lex.e2f", lex.str());
+  WriteFile(dir / "lex.f2e", lex.str());
+}
+
+// the lines of the text extract file, sorted like LC_ALL=C sort does
+vector<string> SortedLines(const string &fileName)
+{
+  istringstream in(ReadFile(fileName));
+  vector<string> ret;
+  for (string line; getline(in, line);) {
+    ret.push_back(line);
+  }
+  sort(ret.begin(), ret.end());
+  return ret;
+}
+
+// the records of a sorted extract file, as extract writes them in text
+vector<string> RecordLines(const string &fileName, bool inverse)
+{
+  SortedExtractReader reader(fileName);
+  Vocabulary sourceVocab, targetVocab;
+  reader.ReadVocabulary(sourceVocab, targetVocab);
+  reader.Start();
+  const SortedExtractLayout &layout = reader.GetLayout();
+
+  vector<string> ret;
+  string alignment;
+  for (; reader; ++reader) {
+    const void *record = reader.Get();
+    const SortedExtractLayout::Fixed &fixed = layout.GetFixed(record);
+    string line;
+    for (size_t i = 0; i < fixed.sourceLength; ++i) {
+      line += sourceVocab.getWord(layout.Source(record)[i]) + " ";
+    }
+    line += "||| ";
+    for (size_t i = 0; i < fixed.targetLength; ++i) {
+      line += targetVocab.getWord(layout.Target(record)[i]) + " ";
+    }
+    line += "|||";
+    layout.AlignmentText(record, inverse, alignment);
+    ret.push_back(line + alignment);
+  }
+  return ret;
+}
+
+void CheckSameLines(const vector<string> &expected, const vector<string> &actual)
+{
+  BOOST_REQUIRE_EQUAL(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    BOOST_REQUIRE_MESSAGE(expected[i] == actual[i], "line " << i << ": " << expected[i] << " != " << actual[i]);
+  }
+}
+
+class Extracted
+{
+public:
+  Extracted()
+    : m_dir("sorted_extract_test") {
+    MakeCorpus(m_dir);
+    string common = ProgramArgument(1, "extract") + " " + m_dir / "corpus.e" + " " + m_dir / "corpus.f" + " "
+                    + m_dir / "corpus.a" + " ";
+    Run(common + m_dir / "text" + " 13 2> " + m_dir / "text.log");
+    Run(common + m_dir / "binary" + " 13 --SortedBinary --SortMemory 1 2> " + m_dir / "binary.log");
+  }
+
+  const TempDir &Dir() const {
+    return m_dir;
+  }
+
+private:
+  TempDir m_dir;
+};
+
+}
+
+BOOST_AUTO_TEST_CASE(same_order_as_text)
+{
+  Extracted extracted;
+  const TempDir &dir = extracted.Dir();
+  vector<string> text = SortedLines(dir / "text");
+  BOOST_REQUIRE(!text.empty());
+  CheckSameLines(text, RecordLines(dir / "binary.sorted", false));
+  CheckSameLines(SortedLines(dir / "text.inv"), RecordLines(dir / "binary.inv.sorted", true));
+}
+
+BOOST_AUTO_TEST_CASE(same_phrase_table)
+{
+  Extracted extracted;
+  const TempDir &dir = extracted.Dir();
+  const string score = ProgramArgument(2, "score");
+
+  const char *files[] = {"text", "text.inv"};
+  for (size_t i = 0; i < 2; ++i) {
+    vector<string> lines = SortedLines(dir / files[i]);
+    string sorted;
+    for (size_t j = 0; j < lines.size(); ++j) {
+      sorted += lines[j] + "\n";
+    }
+    WriteFile(dir / (string(files[i]) + ".sorted"), sorted);
+  }
+
+  Run(score + " " + dir / "text.sorted" + " " + dir / "lex.f2e" + " " + dir / "pt.text"
+      + " 2> " + dir / "score.log");
+  Run(score + " " + dir / "binary.sorted" + " " + dir / "lex.f2e" + " " + dir / "pt.binary"
+      + " --SortedBinary 2>> " + dir / "score.log");
+  BOOST_CHECK(ReadFile(dir / "pt.text") == ReadFile(dir / "pt.binary"));
+
+  Run(score + " " + dir / "text.inv.sorted" + " " + dir / "lex.e2f" + " " + dir / "pt.text.inv"
+      + " --Inverse 2>> " + dir / "score.log");
+  Run(score + " " + dir / "binary.inv.sorted" + " " + dir / "lex.e2f" + " " + dir / "pt.binary.inv"
+      + " --Inverse --SortedBinary 2>> " + dir / "score.log");
+  BOOST_CHECK(ReadFile(dir / "pt.text.inv") == ReadFile(dir / "pt.binary.inv"));
+}
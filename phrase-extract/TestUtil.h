@@ -0,0 +1,88 @@
+/***********************************************************************
+  Moses - factored phrase-based language decoder
+  Copyright (C) 2026 University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#pragma once
+
+// Helpers for the tests that run the training programs on files in a
+// temporary directory.  Include after defining BOOST_TEST_MODULE.
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+namespace MosesTraining
+{
+
+// the program given as argument index of the test, as bjam's run passes
+// its input files, or the fallback
+inline std::string ProgramArgument(int index, const char *fallback)
+{
+  if (boost::unit_test::framework::master_test_suite().argc <= index) {
+    return fallback;
+  }
+  return boost::unit_test::framework::master_test_suite().argv[index];
+}
+
+inline std::string ReadFile(const boost::filesystem::path &path)
+{
+  std::ifstream in(path.string().c_str(), std::ios::binary);
+  BOOST_REQUIRE_MESSAGE(in, "cannot read " << path);
+  std::stringstream ret;
+  ret << in.rdbuf();
+  return ret.str();
+}
+
+inline void WriteFile(const boost::filesystem::path &path, const std::string &content)
+{
+  std::ofstream out(path.string().c_str(), std::ios::binary);
+  out << content;
+  BOOST_REQUIRE(out);
+}
+
+inline void Run(const std::string &command)
+{
+  BOOST_REQUIRE_MESSAGE(system(command.c_str()) == 0, "failed: " << command);
+}
+
+// deleted with its contents when it goes out of scope
+class TempDir
+{
+public:
+  explicit TempDir(const std::string &prefix)
+    : m_path(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path(prefix + "_%%%%-%%%%-%%%%")) {
+    boost::filesystem::create_directories(m_path);
+  }
+  ~TempDir() {
+    boost::system::error_code ec;
+    boost::filesystem::remove_all(m_path, ec);
+  }
+  std::string operator/(const std::string &name) const {
+    return (m_path / name).string();
+  }
+
+private:
+  boost::filesystem::path m_path;
+};
+
+}
+
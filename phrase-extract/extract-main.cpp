@@ -12,11 +12,14 @@
 #include <vector>
 #include <limits>
 
+#include <boost/thread/thread.hpp>
+
 #include "tables-core.h"
 #include "InputFileStream.h"
 #include "OutputFileStream.h"
 #include "PhraseExtractionOptions.h"
 #include "SentenceAlignmentWithSyntax.h"
+#include "SortedExtract.h"
 #include "SyntaxNode.h"
 #include "moses/Util.h"
 
@@ -78,14 +81,18 @@ public:
     Moses::OutputFileStream &extractFileInv,
     Moses::OutputFileStream &extractFileOrientation,
     Moses::OutputFileStream &extractFileContext,
-    Moses::OutputFileStream &extractFileContextInv):
+    Moses::OutputFileStream &extractFileContextInv,
+    SortedExtractWriter *sortedExtract,
+    SortedExtractWriter *sortedExtractInv):
     m_sentence(sentence),
     m_options(initoptions),
     m_extractFile(extractFile),
     m_extractFileInv(extractFileInv),
     m_extractFileOrientation(extractFileOrientation),
     m_extractFileContext(extractFileContext),
-    m_extractFileContextInv(extractFileContextInv) {}
+    m_extractFileContextInv(extractFileContextInv),
+    m_sortedExtract(sortedExtract),
+    m_sortedExtractInv(sortedExtractInv) {}
   void Run();
 private:
   vector< string > m_extractedPhrases;
@@ -97,6 +104,7 @@ private:
   void extractBase();
   void extract();
   void addPhrase(int, int, int, int, const std::string &);
+  void addSortedPhrase(int, int, int, int);
   void writePhrasesToFile();
   bool checkPlaceholders(int startE, int endE, int startF, int endF) const;
   bool isPlaceholder(const string &word) const;
@@ -120,6 +128,11 @@ private:
   Moses::OutputFileStream &m_extractFileOrientation;
   Moses::OutputFileStream &m_extractFileContext;
   Moses::OutputFileStream &m_extractFileContextInv;
+  SortedExtractWriter *m_sortedExtract;
+  SortedExtractWriter *m_sortedExtractInv;
+  // word ids of the sentence, for the sorted extract files
+  std::vector< WORD_ID > m_sourceIds;
+  std::vector< WORD_ID > m_targetIds;
 };
 }
 
@@ -131,7 +144,9 @@ int main(int argc, char* argv[])
   if (argc < 6) {
     cerr << "syntax: extract en de align extract max-length [orientation [ --model [wbe|phrase|hier]-[msd|mslr|mono] ] ";
     cerr << "| --OnlyOutputSpanInfo | --NoTTable | --GZOutput | --IncludeSentenceId | --SentenceOffset n | --InstanceWeights filename ";
-    cerr << "| --TargetConstituentConstrained | --TargetConstituentBoundaries ]" << std::endl;
+    cerr << "| --TargetConstituentConstrained | --TargetConstituentBoundaries | --SortedBinary [--SortMemory MB] ]" << std::endl;
+    cerr << "--SortedBinary writes sorted binary files for score --SortedBinary. They are in the order of the text files "
+         << "sorted with LC_ALL=C sort if the alignment lists the points of each word by position, as symal does" << std::endl;
     exit(1);
   }
 
@@ -145,6 +160,8 @@ int main(int argc, char* argv[])
   const char* const &fileNameA = argv[3];
   const string fileNameExtract = string(argv[4]);
   PhraseExtractionOptions options(atoi(argv[5]));
+  bool sortedBinaryFlag = false;
+  size_t sortMemoryMB = 1024;
 
   for(int i=6; i<argc; i++) {
     if (strcmp(argv[i],"--OnlyOutputSpanInfo") == 0) {
@@ -232,6 +249,14 @@ int main(int argc, char* argv[])
       }
 
       options.initAllModelsOutputFlag(true);
+    } else if (strcmp(argv[i], "--SortedBinary") == 0) {
+      sortedBinaryFlag = true;
+    } else if (strcmp(argv[i], "--SortMemory") == 0) {
+      if (i+1 >= argc || argv[i+1][0] < '0' || argv[i+1][0] > '9') {
+        cerr << "extract: syntax error, used switch --SortMemory without a number" << endl;
+        exit(1);
+      }
+      sortMemoryMB = atoi(argv[++i]);
     } else if (strcmp(argv[i], "--Placeholders") == 0) {
       ++i;
       string str = argv[i];
@@ -249,6 +274,19 @@ int main(int argc, char* argv[])
     options.initWordType(REO_MSD);
   }
 
+  // the phrase pairs are sorted in memory and on temporary files instead,
+  // and written as binary records for score --SortedBinary
+  if (sortedBinaryFlag) {
+    if (!options.isTranslationFlag() || options.isOnlyOutputSpanInfo() || options.isGzOutput()
+        || options.isTargetConstituentBoundariesFlag() || options.isTargetConstituentConstrainedFlag()
+        || options.debug) {
+      cerr << "extract: --SortedBinary cannot be combined with --NoTTable, --OnlyOutputSpanInfo, --GZOutput, "
+           << "--TargetConstituentConstrained, --TargetConstituentBoundaries or --Debug" << endl;
+      exit(1);
+    }
+    options.initTranslationFlag(false);
+  }
+
   // open input files
   Moses::InputFileStream eFile(fileNameE);
   Moses::InputFileStream fFile(fileNameF);
@@ -282,6 +320,17 @@ int main(int argc, char* argv[])
     extractFileContextInv.Open(fileNameExtractContextInv.c_str());
   }
 
+  Vocabulary sourceVocab, targetVocab;
+  auto_ptr<SortedExtractWriter> sortedExtract, sortedExtractInv;
+  if (sortedBinaryFlag) {
+    // each sorter gets half of the memory
+    size_t sortMemory = sortMemoryMB << 19;
+    sortedExtract.reset(new SortedExtractWriter(fileNameExtract + ".sorted", options.maxPhraseLength,
+                        sourceVocab, targetVocab, false, fileNameExtract + ".tmp", sortMemory));
+    sortedExtractInv.reset(new SortedExtractWriter(fileNameExtract + ".inv.sorted", options.maxPhraseLength,
+                           targetVocab, sourceVocab, true, fileNameExtract + ".tmp", sortMemory));
+  }
+
   // stats on labels for glue grammar and unknown word label probabilities
   set< string > targetLabelCollection, sourceLabelCollection;
   map< string, int > targetTopLabelCollection, sourceTopLabelCollection;
@@ -322,7 +371,8 @@ int main(int argc, char* argv[])
       if (options.placeholders.size()) {
         sentence.invertAlignment();
       }
-      ExtractTask *task = new ExtractTask(i-1, sentence, options, extractFile , extractFileInv, extractFileOrientation, extractFileContext, extractFileContextInv);
+      ExtractTask *task = new ExtractTask(i-1, sentence, options, extractFile , extractFileInv, extractFileOrientation, extractFileContext, extractFileContextInv,
+                                          sortedExtract.get(), sortedExtractInv.get());
       task->Run();
       delete task;
 
@@ -353,12 +403,32 @@ int main(int argc, char* argv[])
 
   // We've been printing progress dots to stderr.  End the line.
   cerr << endl;
+
+  if (sortedBinaryFlag) {
+    // merge both directions at the same time
+    boost::thread finishInv(&SortedExtractWriter::Finish, sortedExtractInv.get());
+    sortedExtract->Finish();
+    finishInv.join();
+  }
 }
 
 namespace MosesTraining
 {
 void ExtractTask::Run()
 {
+  if (m_sortedExtract) {
+    m_sourceIds.clear();
+    m_targetIds.clear();
+    Vocabulary &sourceVocab = m_sortedExtract->GetSourceVocabulary();
+    Vocabulary &targetVocab = m_sortedExtract->GetTargetVocabulary();
+    for (size_t fi = 0; fi < m_sentence.source.size(); ++fi) {
+      m_sourceIds.push_back(sourceVocab.storeIfNew(m_sentence.source[fi]));
+    }
+    for (size_t ei = 0; ei < m_sentence.target.size(); ++ei) {
+      m_targetIds.push_back(targetVocab.storeIfNew(m_sentence.target[ei]));
+    }
+  }
+
   extract();
   writePhrasesToFile();
   m_extractedPhrases.clear();
@@ -891,6 +961,10 @@ void ExtractTask::addPhrase( int startE, int endE, int startF, int endF,
     return;
   }
 
+  if (m_sortedExtract) {
+    addSortedPhrase(startE, endE, startF, endF);
+  }
+
   ostringstream outextractstr;
   ostringstream outextractstrInv;
   ostringstream outextractstrOrientation;
@@ -1040,6 +1114,42 @@ void ExtractTask::addPhrase( int startE, int endE, int startF, int endF,
 }
 
 
+void ExtractTask::addSortedPhrase( int startE, int endE, int startF, int endF )
+{
+  const SortedExtractLayout &layout = m_sortedExtract->GetLayout();
+  float count = 1.0f;
+  if (m_options.getInstanceWeightsFile().length()) {
+    count = atof(m_sentence.weightString.c_str());
+  }
+
+  void *record = m_sortedExtract->NewRecord();
+  void *recordInv = m_sortedExtractInv->NewRecord();
+  SortedExtractLayout::Fixed &fixed = layout.GetFixed(record);
+  SortedExtractLayout::Fixed &fixedInv = layout.GetFixed(recordInv);
+  fixed.sentenceId = fixedInv.sentenceId = m_sentence.sentenceID;
+  fixed.count = fixedInv.count = count;
+  fixed.sourceLength = fixedInv.targetLength = endF - startF + 1;
+  fixed.targetLength = fixedInv.sourceLength = endE - startE + 1;
+
+  std::copy(m_sourceIds.begin() + startF, m_sourceIds.begin() + endF + 1, layout.Source(record));
+  std::copy(m_targetIds.begin() + startE, m_targetIds.begin() + endE + 1, layout.Target(record));
+  std::copy(m_targetIds.begin() + startE, m_targetIds.begin() + endE + 1, layout.Source(recordInv));
+  std::copy(m_sourceIds.begin() + startF, m_sourceIds.begin() + endF + 1, layout.Target(recordInv));
+
+  if (m_options.isSingleWordHeuristicFlag() && (startE==endE) && (startF==endF)) {
+    layout.AddAlignmentPoint(record, 0, 0);
+    layout.AddAlignmentPoint(recordInv, 0, 0);
+  } else {
+    for(int ei=startE; ei<=endE; ei++) {
+      for(size_t i=0; i<m_sentence.alignedToT[ei].size(); i++) {
+        int fi = m_sentence.alignedToT[ei][i];
+        layout.AddAlignmentPoint(record, fi-startF, ei-startE);
+        layout.AddAlignmentPoint(recordInv, ei-startE, fi-startF);
+      }
+    }
+  }
+}
+
 void ExtractTask::writePhrasesToFile()
 {
 
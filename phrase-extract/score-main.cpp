@@ -26,6 +26,9 @@
 #include <vector>
 #include <algorithm>
 #include <boost/algorithm/string/predicate.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
 #include <boost/unordered_map.hpp>
 
 #include "ScoreFeature.h"
@@ -34,8 +37,10 @@
 #include "score.h"
 #include "InputFileStream.h"
 #include "OutputFileStream.h"
+#include "SortedExtract.h"
 
 #include "moses/Util.h"
+#include "util/stream/chain.hh"
 
 using namespace boost::algorithm;
 using namespace MosesTraining;
@@ -96,6 +101,10 @@ std::vector<float> orientationClassPriorsR2L(4,0); // mono swap dleft dright
 Vocabulary vcbT;
 Vocabulary vcbS;
 
+// count of counts and the label sets are updated while scoring, which may
+// happen on several threads at once
+boost::mutex statisticsMutex;
+
 } // namespace
 
 
@@ -112,6 +121,236 @@ void writeLeftHandSideLabelCounts( const boost::unordered_map<std::string,float>
 void writeLabelSet( const std::set<std::string> &labelSet, const std::string &fileName );
 void processPhrasePairs( std::vector< ExtractionPhrasePair* > &phrasePairsWithSameSource, std::ostream &phraseTableFile,
                          const ScoreFeatureManager& featureManager, const MaybeLog& maybeLogProb );
+
+namespace
+{
+
+// Phrase pairs with the same source, and the phrase table lines scored from them
+struct SourceGroup {
+  std::vector< ExtractionPhrasePair* > phrasePairs;
+  std::string output;
+};
+
+/* With --Threads, the main thread parses the extract file and passes
+ * SourceGroups down a chain of numThreads scorers followed by a writer.
+ * Each block is scored by one scorer, chosen round robin, and passed through
+ * untouched by the others.  The chain keeps the blocks in order, so the
+ * phrase table comes out as in the serial run.
+ */
+class GroupScorer
+{
+public:
+  GroupScorer(size_t index, size_t numScorers,
+              const ScoreFeatureManager &featureManager, const MaybeLog &maybeLogProb)
+    : m_index(index), m_numScorers(numScorers)
+    , m_featureManager(featureManager), m_maybeLogProb(maybeLogProb) {
+  }
+
+  void Run(const util::stream::ChainPosition &position) {
+    size_t blockIndex = 0;
+    for (util::stream::Link link(position); link; ++link, ++blockIndex) {
+      if (blockIndex % m_numScorers != m_index) {
+        continue;
+      }
+      SourceGroup **begin = static_cast<SourceGroup**>(link->Get());
+      SourceGroup **end = static_cast<SourceGroup**>(const_cast<void*>(link->ValidEnd()));
+      for (SourceGroup **group = begin; group != end; ++group) {
+        std::ostringstream out;
+        processPhrasePairs( (*group)->phrasePairs, out, m_featureManager, m_maybeLogProb );
+        (*group)->output = out.str();
+        for ( std::vector< ExtractionPhrasePair* >::const_iterator iter=(*group)->phrasePairs.begin();
+              iter!=(*group)->phrasePairs.end(); ++iter) {
+          delete *iter;
+        }
+        (*group)->phrasePairs.clear();
+      }
+    }
+  }
+
+private:
+  size_t m_index, m_numScorers;
+  const ScoreFeatureManager &m_featureManager;
+  const MaybeLog &m_maybeLogProb;
+};
+
+class GroupWriter
+{
+public:
+  explicit GroupWriter(std::ostream &phraseTableFile)
+    : m_phraseTableFile(phraseTableFile) {
+  }
+
+  void Run(const util::stream::ChainPosition &position) {
+    for (util::stream::Link link(position); link; ++link) {
+      SourceGroup **begin = static_cast<SourceGroup**>(link->Get());
+      SourceGroup **end = static_cast<SourceGroup**>(const_cast<void*>(link->ValidEnd()));
+      for (SourceGroup **group = begin; group != end; ++group) {
+        m_phraseTableFile << (*group)->output;
+        delete *group;
+      }
+    }
+  }
+
+private:
+  std::ostream &m_phraseTableFile;
+};
+
+// Hands each finished source group either to the chain or, single threaded,
+// straight to processPhrasePairs().
+class GroupSink
+{
+public:
+  GroupSink(size_t numThreads, std::ostream &phraseTableFile,
+            const ScoreFeatureManager &featureManager, const MaybeLog &maybeLogProb)
+    : m_phraseTableFile(phraseTableFile)
+    , m_featureManager(featureManager), m_maybeLogProb(maybeLogProb)
+    , m_inBlock(0) {
+    if (numThreads <= 1) {
+      return;
+    }
+    const size_t groupsPerBlock = 256;
+    const size_t numBlocks = 4 * numThreads;
+    m_chain.reset(new util::stream::Chain(util::stream::ChainConfig(
+                    sizeof(SourceGroup*), numBlocks, numBlocks * groupsPerBlock * sizeof(SourceGroup*))));
+    *m_chain >> m_head;
+    for (size_t i = 0; i < numThreads; ++i) {
+      *m_chain >> GroupScorer(i, numThreads, featureManager, maybeLogProb);
+    }
+    *m_chain >> GroupWriter(phraseTableFile) >> util::stream::kRecycle;
+  }
+
+  // takes ownership of the phrase pairs and clears phrasePairs
+  void Add(std::vector< ExtractionPhrasePair* > &phrasePairs) {
+    if (!m_chain) {
+      processPhrasePairs( phrasePairs, m_phraseTableFile, m_featureManager, m_maybeLogProb );
+      for ( std::vector< ExtractionPhrasePair* >::const_iterator iter=phrasePairs.begin();
+            iter!=phrasePairs.end(); ++iter) {
+        delete *iter;
+      }
+      phrasePairs.clear();
+      return;
+    }
+
+    SourceGroup *group = new SourceGroup();
+    group->phrasePairs.swap(phrasePairs);
+    static_cast<SourceGroup**>(m_head->Get())[m_inBlock++] = group;
+    if (m_inBlock * sizeof(SourceGroup*) == m_chain->BlockSize()) {
+      m_head->SetValidSize(m_chain->BlockSize());
+      ++m_head;
+      m_inBlock = 0;
+    }
+  }
+
+  // flush and wait for the writer
+  void Finish() {
+    if (!m_chain) {
+      return;
+    }
+    if (m_inBlock) {
+      m_head->SetValidSize(m_inBlock * sizeof(SourceGroup*));
+      ++m_head;
+      m_inBlock = 0;
+    }
+    m_head.Poison();
+    m_chain->Wait();
+  }
+
+private:
+  std::ostream &m_phraseTableFile;
+  const ScoreFeatureManager &m_featureManager;
+  const MaybeLog &m_maybeLogProb;
+
+  boost::scoped_ptr<util::stream::Chain> m_chain;
+  util::stream::Link m_head;
+  size_t m_inBlock;
+};
+
+// The extract file, as text lines or, with --SortedBinary, as records of word ids
+class ExtractReader
+{
+public:
+  ExtractReader(const std::string &fileName, bool sortedBinary)
+    : m_started(false) {
+    if (sortedBinary) {
+      m_sorted.reset(new SortedExtractReader(fileName));
+      // the records can then use the ids as they are
+      m_sorted->ReadVocabulary(vcbS, vcbT);
+      m_sorted->Start();
+      m_lastRecord.resize(m_sorted->GetLayout().RecordSize());
+      return;
+    }
+    m_text.reset(new Moses::InputFileStream(fileName));
+    if (m_text->fail()) {
+      std::cerr << "ERROR: could not open extract file " << fileName << std::endl;
+      exit(1);
+    }
+  }
+
+  bool Next() {
+    if (m_text) {
+      m_lastLine.swap(m_line);
+      return !getline(*m_text, m_line).fail();
+    }
+    if (m_started) {
+      memcpy(&m_lastRecord[0], m_sorted->Get(), m_lastRecord.size());
+      ++*m_sorted;
+    }
+    m_started = true;
+    return *m_sorted;
+  }
+
+  // identical to the previous line or record
+  bool SameAsLast() const {
+    if (m_text) {
+      return m_line == m_lastLine;
+    }
+    return memcmp(&m_lastRecord[0], m_sorted->Get(), m_lastRecord.size()) == 0;
+  }
+
+  void Process( int lineID, bool includeSentenceIdFlag, int &sentenceId,
+                PHRASE *phraseSource, PHRASE *phraseTarget, ALIGNMENT *targetToSourceAlignment,
+                std::string &additionalPropertiesString,
+                float &count, float &pcfgSum ) const {
+    if (m_text) {
+      processLine( std::string(m_line),
+                   lineID, includeSentenceIdFlag, sentenceId,
+                   phraseSource, phraseTarget, targetToSourceAlignment,
+                   additionalPropertiesString,
+                   count, pcfgSum );
+      return;
+    }
+
+    const SortedExtractLayout &layout = m_sorted->GetLayout();
+    const void *record = m_sorted->Get();
+    const SortedExtractLayout::Fixed &fixed = layout.GetFixed(record);
+    sentenceId = fixed.sentenceId;
+    count = fixed.count;
+    pcfgSum = 0.0f;
+    additionalPropertiesString.clear();
+
+    phraseSource->assign( layout.Source(record), layout.Source(record) + fixed.sourceLength );
+    phraseTarget->assign( layout.Target(record), layout.Target(record) + fixed.targetLength );
+    targetToSourceAlignment->clear();
+    targetToSourceAlignment->resize( fixed.targetLength );
+    for (size_t t = 0; t < fixed.targetLength; ++t) {
+      for (size_t s = 0; s < fixed.sourceLength; ++s) {
+        if (layout.IsAligned(record, s, t)) {
+          targetToSourceAlignment->at(t).insert(s);
+        }
+      }
+    }
+  }
+
+private:
+  boost::scoped_ptr<Moses::InputFileStream> m_text;
+  std::string m_line, m_lastLine;
+
+  boost::scoped_ptr<SortedExtractReader> m_sorted;
+  std::vector<char> m_lastRecord;
+  bool m_started;
+};
+
+}
 void outputPhrasePair(const ExtractionPhrasePair &phrasePair, float, int, std::ostream &phraseTableFile, const ScoreFeatureManager &featureManager, const MaybeLog &maybeLog );
 double computeLexicalTranslation( const PHRASE *phraseSource, const PHRASE *phraseTarget, const ALIGNMENT *alignmentTargetToSource );
 double computeUnalignedPenalty( const ALIGNMENT *alignmentTargetToSource );
@@ -154,8 +393,12 @@ int main(int argc, char* argv[])
               "[--TargetSyntacticPreferences] "
               "[--UnpairedExtractFormat] "
               "[--ConditionOnTargetLHS] "
-              "[--CrossedNonTerm]"
+              "[--CrossedNonTerm] "
+              "[--Threads num] "
+              "[--SortedBinary]"
               << std::endl;
+    std::cerr << "--SortedBinary reads the files of extract --SortedBinary. The phrase table is the same as from the "
+              << "sorted text files if the alignment lists the points of each word by position, as symal does" << std::endl;
     std::cerr << featureManager.usage() << std::endl;
     exit(1);
   }
@@ -172,6 +415,8 @@ int main(int argc, char* argv[])
   std::string fileNameLeftHandSideTargetSyntacticPreferencesLabelCounts;
   std::string fileNameLeftHandSideRuleTargetTargetSyntacticPreferencesLabelCounts;
   std::string fileNamePhraseOrientationPriors;
+  size_t numThreads = 1;
+  bool sortedBinaryFlag = false;
   // All unknown args are passed to feature manager.
   std::vector<std::string> featureArgs;
 
@@ -290,6 +535,16 @@ int main(int argc, char* argv[])
     } else if (strcmp(argv[i],"--TargetConstituentBoundaries") == 0) {
       targetConstituentBoundariesFlag = true;
       std::cerr << "including target constituent boundaries information" << std::endl;
+    } else if (strcmp(argv[i],"--SortedBinary") == 0) {
+      sortedBinaryFlag = true;
+      std::cerr << "reading sorted binary extract file" << std::endl;
+    } else if (strcmp(argv[i],"--Threads") == 0) {
+      if (i+1==argc) {
+        std::cerr << "ERROR: specify number of threads!" << std::endl;
+        exit(1);
+      }
+      numThreads = std::max(1, std::atoi( argv[++i] ));
+      std::cerr << "scoring with " << numThreads << " threads" << std::endl;
     } else {
       featureArgs.push_back(argv[i]);
       ++i;
@@ -302,6 +557,23 @@ int main(int argc, char* argv[])
 
   MaybeLog maybeLogProb(logProbFlag, negLogProb);
 
+  // the left-hand side label counts are summed in hash maps, whose float sums
+  // and output order depend on the order the phrase pairs were scored in
+  if (numThreads > 1 && !inverseFlag
+      && (sourceSyntaxLabelCountsLHSFlag || targetSyntacticPreferencesFlag)) {
+    std::cerr << "left-hand side label counts can only be collected by a single thread. Ignoring --Threads" << std::endl;
+    numThreads = 1;
+  }
+
+  if (sortedBinaryFlag && hierarchicalFlag) {
+    std::cerr << "ERROR: sorted binary extract files hold phrase pairs, not hierarchical rules" << std::endl;
+    exit(1);
+  }
+
+  // sorted phrase extraction file
+  // (first, as a binary extract file brings its vocabulary)
+  ExtractReader extractInput(fileNameExtract, sortedBinaryFlag);
+
   // configure extra features
   if (!inverseFlag) {
     featureManager.configure(featureArgs);
@@ -326,14 +598,6 @@ int main(int argc, char* argv[])
     loadOrientationPriors(fileNamePhraseOrientationPriors,orientationClassPriorsL2R,orientationClassPriorsR2L);
   }
 
-  // sorted phrase extraction file
-  Moses::InputFileStream extractFile(fileNameExtract);
-
-  if (extractFile.fail()) {
-    std::cerr << "ERROR: could not open extract file " << fileNameExtract << std::endl;
-    exit(1);
-  }
-
   // output file: phrase translation table
   std::ostream *phraseTableFile;
 
@@ -350,8 +614,9 @@ int main(int argc, char* argv[])
     phraseTableFile = outputFile;
   }
 
+  GroupSink groupSink(numThreads, *phraseTableFile, featureManager, maybeLogProb);
+
   // loop through all extracted phrase translations
-  std::string line, lastLine;
   ExtractionPhrasePair *phrasePair = NULL;
   std::vector< ExtractionPhrasePair* > phrasePairsWithSameSource;
   std::vector< ExtractionPhrasePair* > phrasePairsWithSameSourceAndTarget; // required for hierarchical rules only, as non-terminal alignments might make the phrases incompatible
@@ -363,16 +628,15 @@ int main(int argc, char* argv[])
   float tmpCount=0.0f, tmpPcfgSum=0.0f;
 
   int i=0;
-  if ( getline(extractFile, line) ) {
+  if ( extractInput.Next() ) {
     ++i;
     tmpPhraseSource = new PHRASE();
     tmpPhraseTarget = new PHRASE();
     tmpTargetToSourceAlignment = new ALIGNMENT();
-    processLine( std::string(line),
-                 i, featureManager.includeSentenceId(), tmpSentenceId,
-                 tmpPhraseSource, tmpPhraseTarget, tmpTargetToSourceAlignment,
-                 tmpAdditionalPropertiesString,
-                 tmpCount, tmpPcfgSum);
+    extractInput.Process( i, featureManager.includeSentenceId(), tmpSentenceId,
+                          tmpPhraseSource, tmpPhraseTarget, tmpTargetToSourceAlignment,
+                          tmpAdditionalPropertiesString,
+                          tmpCount, tmpPcfgSum);
     phrasePair = new ExtractionPhrasePair( tmpPhraseSource, tmpPhraseTarget,
                                            tmpTargetToSourceAlignment,
                                            tmpCount, tmpPcfgSum );
@@ -382,10 +646,9 @@ int main(int argc, char* argv[])
     if ( hierarchicalFlag ) {
       phrasePairsWithSameSourceAndTarget.push_back( phrasePair );
     }
-    lastLine = line;
   }
 
-  while ( getline(extractFile, line) ) {
+  while ( extractInput.Next() ) {
 
     // Print progress dots to stderr.
     if ( ++i % 100000 == 0 ) {
@@ -393,22 +656,19 @@ int main(int argc, char* argv[])
     }
 
     // identical to last line? just add count
-    if (line == lastLine) {
+    if (extractInput.SameAsLast()) {
       phrasePair->IncrementPrevious(tmpCount,tmpPcfgSum);
       continue;
-    } else {
-      lastLine = line;
     }
 
     tmpPhraseSource = new PHRASE();
     tmpPhraseTarget = new PHRASE();
     tmpTargetToSourceAlignment = new ALIGNMENT();
     tmpAdditionalPropertiesString.clear();
-    processLine( std::string(line),
-                 i, featureManager.includeSentenceId(), tmpSentenceId,
-                 tmpPhraseSource, tmpPhraseTarget, tmpTargetToSourceAlignment,
-                 tmpAdditionalPropertiesString,
-                 tmpCount, tmpPcfgSum);
+    extractInput.Process( i, featureManager.includeSentenceId(), tmpSentenceId,
+                          tmpPhraseSource, tmpPhraseTarget, tmpTargetToSourceAlignment,
+                          tmpAdditionalPropertiesString,
+                          tmpCount, tmpPcfgSum);
 
     bool matchesPrevious = false;
     bool sourceMatch = true;
@@ -447,12 +707,7 @@ int main(int argc, char* argv[])
 
       if ( !phrasePairsWithSameSource.empty() &&
            !sourceMatch ) {
-        processPhrasePairs( phrasePairsWithSameSource, *phraseTableFile, featureManager, maybeLogProb );
-        for ( std::vector< ExtractionPhrasePair* >::const_iterator iter=phrasePairsWithSameSource.begin();
-              iter!=phrasePairsWithSameSource.end(); ++iter) {
-          delete *iter;
-        }
-        phrasePairsWithSameSource.clear();
+        groupSink.Add( phrasePairsWithSameSource );
         if ( hierarchicalFlag ) {
           phrasePairsWithSameSourceAndTarget.clear();
         }
@@ -482,12 +737,10 @@ int main(int argc, char* argv[])
   // We've been printing progress dots to stderr.  End the line.
   std::cerr << std::endl;
 
-  processPhrasePairs( phrasePairsWithSameSource, *phraseTableFile, featureManager, maybeLogProb );
-  for ( std::vector< ExtractionPhrasePair* >::const_iterator iter=phrasePairsWithSameSource.begin();
-        iter!=phrasePairsWithSameSource.end(); ++iter) {
-    delete *iter;
+  if ( !phrasePairsWithSameSource.empty() ) {
+    groupSink.Add( phrasePairsWithSameSource );
   }
-  phrasePairsWithSameSource.clear();
+  groupSink.Finish();
 
 
   phraseTableFile->flush();
@@ -725,6 +978,7 @@ void outputPhrasePair(const ExtractionPhrasePair &phrasePair,
 
   // collect count of count statistics
   if (goodTuringFlag || kneserNeyFlag) {
+    boost::lock_guard<boost::mutex> lock(statisticsMutex);
     totalDistinct++;
     int countInt = count + 0.99999;
     if ((countInt <= COC_MAX) &&
@@ -874,7 +1128,10 @@ void outputPhrasePair(const ExtractionPhrasePair &phrasePair,
 
   // parts-of-speech
   if (partsOfSpeechFlag && !inverseFlag) {
-    phrasePair.UpdateVocabularyFromValueTokens("POS", partsOfSpeechSet);
+    {
+      boost::lock_guard<boost::mutex> lock(statisticsMutex);
+      phrasePair.UpdateVocabularyFromValueTokens("POS", partsOfSpeechSet);
+    }
     const std::string *bestPartOfSpeech = phrasePair.FindBestPropertyValue("POS");
     if (bestPartOfSpeech) {
       phraseTableFile << " {{POS " << *bestPartOfSpeech << "}}";
@@ -890,6 +1147,7 @@ void outputPhrasePair(const ExtractionPhrasePair &phrasePair,
     }
     // source syntax labels
     if (sourceSyntaxLabelsFlag) {
+      boost::lock_guard<boost::mutex> lock(statisticsMutex);
       std::string sourceLabelCounts;
       sourceLabelCounts = phrasePair.CollectAllLabelsSeparateLHSAndRHS("SourceLabels",
                           sourceLabelSet,
@@ -907,6 +1165,7 @@ void outputPhrasePair(const ExtractionPhrasePair &phrasePair,
     }
     // target syntactic preferences labels
     if (targetSyntacticPreferencesFlag) {
+      boost::lock_guard<boost::mutex> lock(statisticsMutex);
       std::string targetSyntacticPreferencesLabelCounts;
       targetSyntacticPreferencesLabelCounts = phrasePair.CollectAllLabelsSeparateLHSAndRHS("TargetPreferences",
                                               targetSyntacticPreferencesLabelSet,
@@ -1172,7 +1431,7 @@ double computeLexicalTranslation( const PHRASE *phraseSource, const PHRASE *phra
 {
   // lexical translation probability
   double lexScore = 1.0;
-  int null = vcbS.getWordID("NULL");
+  WORD_ID null = lexTable.null;
   // all target words have to be explained
   for(size_t ti=0; ti<alignmentTargetToSource->size(); ti++) {
     const std::set< size_t > & srcIndices = alignmentTargetToSource->at(ti);
@@ -1221,6 +1480,7 @@ void LexicalTable::load( const std::string &fileName )
     WORD_ID wordS = vcbS.storeIfNew( token[1] );
     ltable[ wordS ][ wordT ] = prob;
   }
+  null = vcbS.getWordID("NULL");
   std::cerr << std::endl;
 }
 
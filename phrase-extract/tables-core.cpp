@@ -11,6 +11,21 @@ using namespace std;
 namespace MosesTraining
 {
 
+Vocabulary::Vocabulary()
+  : m_size( 0 )
+{
+  for ( size_t i = 0; i < MAX_BLOCKS; ++i ) {
+    m_blocks[ i ] = NULL;
+  }
+}
+
+Vocabulary::~Vocabulary()
+{
+  for ( size_t i = 0; i < MAX_BLOCKS; ++i ) {
+    delete [] m_blocks[ i ];
+  }
+}
+
 WORD_ID Vocabulary::storeIfNew( const WORD& word )
 {
   map<WORD, WORD_ID>::iterator i = lookup.find( word );
@@ -18,9 +33,16 @@ WORD_ID Vocabulary::storeIfNew( const WORD& word )
   if( i != lookup.end() )
     return i->second;
 
-  WORD_ID id = vocab.size();
-  vocab.push_back( word );
+  WORD_ID id = lookup.size();
+  size_t blockInd, offset;
+  locate( id, blockInd, offset );
+  WORD *&block = m_blocks[ blockInd ];
+  if ( block == NULL ) {
+    block = new WORD[ blockInd ? FIRST_BLOCK_SIZE << ( blockInd - 1 ) : FIRST_BLOCK_SIZE ];
+  }
+  block[ offset ] = word;
   lookup[ word ] = id;
+  m_size.store( id + 1, std::memory_order_release );
   return id;
 }
 
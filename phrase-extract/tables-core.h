@@ -3,31 +3,70 @@
 #ifndef _TABLES_H
 #define _TABLES_H
 
+#include <atomic>
 #include <iostream>
 #include <fstream>
 #include <cassert>
 #include <cstdlib>
 #include <string>
+#include <vector>
 #include <queue>
 #include <map>
 #include <cmath>
 
+#include "util/exception.hh"
+
 namespace MosesTraining
 {
 
 typedef std::string WORD;
 typedef unsigned int WORD_ID;
 
+// Words are kept in blocks that never move.  The first block holds
+// FIRST_BLOCK_SIZE words and each later one as many as all before it, so a
+// small vocabulary stays small.  storeIfNew() publishes a word with a release
+// store of the size once it is in place, and getWord() reads the size with an
+// acquire load, so getWord() on a known id may run concurrently with one
+// thread calling storeIfNew() (see score).
 class Vocabulary
 {
 public:
+  Vocabulary();
+  ~Vocabulary();
   std::map<WORD, WORD_ID>  lookup;
-  std::vector< WORD > vocab;
   WORD_ID storeIfNew( const WORD& );
   WORD_ID getWordID( const WORD& );
   inline WORD &getWord( const WORD_ID id ) {
-    return vocab[ id ];
+    // pairs with the release store in storeIfNew()
+    UTIL_THROW_IF2( id >= m_size.load( std::memory_order_acquire ),
+                    "Word id " << id << " is not in the vocabulary" );
+    size_t block, offset;
+    locate( id, block, offset );
+    return m_blocks[ block ][ offset ];
+  }
+private:
+  static const size_t FIRST_BLOCK_BITS = 10;
+  static const size_t FIRST_BLOCK_SIZE = 1 << FIRST_BLOCK_BITS;
+  // enough for every WORD_ID
+  static const size_t MAX_BLOCKS = 33 - FIRST_BLOCK_BITS;
+  // a block is allocated whole, when its first word is stored
+  WORD *m_blocks[ MAX_BLOCKS ];
+  std::atomic< WORD_ID > m_size;
+
+  // block k > 0 holds the ids from FIRST_BLOCK_SIZE << (k - 1)
+  static void locate( WORD_ID id, size_t &block, size_t &offset ) {
+    if ( id < FIRST_BLOCK_SIZE ) {
+      block = 0;
+      offset = id;
+      return;
+    }
+    size_t highBit = 31 - __builtin_clz( id );
+    block = highBit - FIRST_BLOCK_BITS + 1;
+    offset = id - ( WORD_ID( 1 ) << highBit );
   }
+
+  Vocabulary( const Vocabulary& );
+  void operator=( const Vocabulary& );
 };
 
 typedef std::vector< WORD_ID > PHRASE;
@@ -0,0 +1,2 @@
+#!/bin/sh
+./bjam -j2 -q lm//model_test
@@ -160,6 +160,7 @@ StringPiece FirstToken(StringPiece str) {
   }
   return StringPiece(str.data(), i - str.data());
 }
+} // namespace
 
 const char *ParseNumber(StringPiece str, float &out) {
   int count;
@@ -187,7 +188,6 @@ const char *ParseNumber(StringPiece str, unsigned long int &out) {
   UTIL_THROW_IF_ARG(errno || (end == str.data()), ParseNumberException, (FirstToken(str)), "unsigned long int");
   return end;
 }
-} // namespace
 
 template <class T> T FilePiece::ReadNumber() {
   SkipSpaces();
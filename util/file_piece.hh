@@ -24,6 +24,13 @@ class ParseNumberException : public Exception {
 
 extern const bool kSpaces[256];
 
+// Parse the number at the beginning of str the same way FilePiece's Read*
+// functions do, ignoring anything after it.  Returns the end of the number.
+const char *ParseNumber(StringPiece str, float &out);
+const char *ParseNumber(StringPiece str, double &out);
+const char *ParseNumber(StringPiece str, long int &out);
+const char *ParseNumber(StringPiece str, unsigned long int &out);
+
 // Memory backing the returned StringPiece may vanish on the next call.
 class FilePiece {
   public:
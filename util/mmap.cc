@@ -12,6 +12,9 @@
 #include <iostream>
 
 #include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -25,6 +28,10 @@
 #include <unistd.h>
 #endif
 
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
 namespace util {
 
 std::size_t SizePage() {
@@ -236,6 +243,58 @@ void HugeMalloc(std::size_t size, bool zeroed, scoped_memory &to) {
   UTIL_THROW_IF(!to.get(), ErrnoException, "Failed to allocate " << size << " bytes");
 }
 
+namespace {
+
+#if defined(__linux__) && defined(SYS_mbind)
+// Parse /sys/devices/system/node/online, e.g. "0-1,3", into a bitmask.
+bool OnlineNodes(unsigned long *mask, std::size_t mask_bits) {
+  std::FILE *f = std::fopen("/sys/devices/system/node/online", "r");
+  if (!f) return false;
+  char buf[256];
+  bool ret = std::fgets(buf, sizeof(buf), f) != NULL;
+  std::fclose(f);
+  if (!ret) return false;
+
+  const std::size_t kLongBits = sizeof(unsigned long) * 8;
+  std::size_t count = 0;
+  for (char *range = std::strtok(buf, ",\n"); range; range = std::strtok(NULL, ",\n")) {
+    unsigned long first, last;
+    int got = std::sscanf(range, "%lu-%lu", &first, &last);
+    if (got < 1) return false;
+    if (got == 1) last = first;
+    for (unsigned long node = first; node <= last && node < mask_bits; ++node, ++count) {
+      mask[node / kLongBits] |= 1UL << (node % kLongBits);
+    }
+  }
+  return count > 1;
+}
+#endif
+
+/* Set an interleave policy on memory that hasn't been touched yet, so the
+ * kernel places its pages round robin on the online NUMA nodes.  Best effort:
+ * a machine with one node or a kernel without NUMA support is left alone.
+ * Raw syscall so we don't depend on libnuma.
+ */
+void InterleaveNodes(void *base, std::size_t size) {
+#if defined(__linux__) && defined(SYS_mbind)
+  const int kMPolInterleave = 3; // MPOL_INTERLEAVE in linux/mempolicy.h
+  const std::size_t kMaxNodes = 1024;
+  unsigned long mask[kMaxNodes / (sizeof(unsigned long) * 8)];
+  memset(mask, 0, sizeof(mask));
+  if (!OnlineNodes(mask, kMaxNodes)) return;
+
+  // mbind wants a page aligned start.  The partial page before belongs to malloc anyway.
+  uintptr_t begin = RoundUpPow2(reinterpret_cast<uintptr_t>(base), static_cast<uintptr_t>(SizePage()));
+  uintptr_t end = reinterpret_cast<uintptr_t>(base) + size;
+  if (end <= begin) return;
+  if (syscall(SYS_mbind, begin, end - begin, kMPolInterleave, mask, kMaxNodes + 1, 0)) {
+    std::cerr << "Warning: failed to interleave memory across NUMA nodes: " << strerror(errno) << std::endl;
+  }
+#endif
+}
+
+} // namespace
+
 #ifdef __linux__
 const std::size_t kTransitionHuge = std::max<std::size_t>(1ULL << 21, SizePage());
 #endif // __linux__
@@ -320,6 +379,12 @@ void MapRead(LoadMethod method, int fd, uint64_t offset, std::size_t size, scope
       HugeMalloc(size, false, out);
       ParallelRead(fd, out.get(), size, offset);
       break;
+    case READ_INTERLEAVE:
+      HugeMalloc(size, false, out);
+      InterleaveNodes(out.get(), size);
+      SeekOrThrow(fd, offset);
+      ReadOrThrow(fd, out.get(), size);
+      break;
   }
 }
 
@@ -135,10 +135,15 @@ typedef enum {
   POPULATE_OR_LAZY,
   // Populate on Linux.  malloc and read on non-Linux.
   POPULATE_OR_READ,
-  // malloc and read.
+  // malloc and read.  On Linux the memory comes from HugeMalloc, so large
+  // files are backed by huge pages where the kernel allows.
   READ,
   // malloc and read in parallel (recommended for Lustre)
   PARALLEL_READ,
+  // As READ, but the pages are interleaved across the NUMA nodes we may
+  // allocate from, so threads on every socket see the same average latency.
+  // Same as READ on single-node machines and outside Linux.
+  READ_INTERLEAVE,
 } LoadMethod;
 
 void MapRead(LoadMethod method, int fd, uint64_t offset, std::size_t size, scoped_memory &out);
@@ -0,0 +1,148 @@
+#include "util/perfect_hash.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace util {
+
+namespace {
+
+// Average keys per bucket.  Fewer means more space for pilots, more means
+// longer searches for them.
+const uint64_t kKeysPerBucket = 4;
+
+// Pilots fit in 16 bits.
+const uint32_t kPilots = 1 << 16;
+
+// Seeds to try before giving up.  One almost always works.
+const uint64_t kSeeds = 32;
+
+uint64_t RoundUp8(uint64_t bytes) {
+  return (bytes + 7) & ~static_cast<uint64_t>(7);
+}
+
+// The seed then pilots come before the remapping array.
+uint64_t RemapOffset(uint64_t buckets) {
+  return sizeof(uint64_t) + RoundUp8(buckets * sizeof(uint16_t));
+}
+
+} // namespace
+
+uint64_t PerfectHash::Buckets(uint64_t entries) {
+  return entries / kKeysPerBucket + 1;
+}
+
+// About 3% more than the entries, so the last buckets to be placed find room.
+uint64_t PerfectHash::Slots(uint64_t entries) {
+  return entries + entries / 32 + 1;
+}
+
+uint64_t PerfectHash::Size(uint64_t entries) {
+  const uint8_t bits = BitsMask::ByMax(entries ? entries - 1 : 0).bits;
+  // ReadInt57 reads 8 bytes at a time, so pad.
+  return RemapOffset(Buckets(entries)) + RoundUp8(((Slots(entries) - entries) * bits + 7) / 8 + sizeof(uint64_t));
+}
+
+PerfectHash::PerfectHash(const void *start, uint64_t entries)
+  : entries_(entries), buckets_(Buckets(entries)), slots_(Slots(entries)),
+    seed_(*static_cast<const uint64_t*>(start)),
+    pilots_(reinterpret_cast<const uint16_t*>(static_cast<const uint64_t*>(start) + 1)),
+    remap_(static_cast<const uint8_t*>(start) + RemapOffset(buckets_)),
+    remap_bits_(BitsMask::ByMax(entries ? entries - 1 : 0)) {}
+
+void PerfectHash::Build(const uint64_t *begin, const uint64_t *end, void *start) {
+  const uint64_t entries = end - begin;
+  uint64_t *seed = static_cast<uint64_t*>(start);
+  uint16_t *pilots = reinterpret_cast<uint16_t*>(seed + 1);
+  uint8_t *remap = static_cast<uint8_t*>(start) + RemapOffset(Buckets(entries));
+  for (uint64_t attempt = 0; attempt < kSeeds; ++attempt) {
+    // WriteInt57 assumes zeros and empty buckets keep their pilot.
+    memset(start, 0, Size(entries));
+    *seed = Mix(attempt + 1);
+    if (TryBuild(begin, end, *seed, pilots, remap)) return;
+  }
+  UTIL_THROW(Exception, "Failed to find a perfect hash function for " << entries << " keys after " << kSeeds << " seeds.  This should not happen.");
+}
+
+bool PerfectHash::TryBuild(const uint64_t *begin, const uint64_t *end, uint64_t seed, uint16_t *pilots, void *remap) {
+  const uint64_t entries = end - begin, buckets = Buckets(entries), slots = Slots(entries);
+
+  // Counting sort of the hashed keys by bucket.  Bucket b is
+  // [offsets[b], offsets[b + 1]) in hashed.
+  std::vector<uint64_t> offsets(buckets + 1, 0);
+  for (const uint64_t *i = begin; i != end; ++i) {
+    ++offsets[Mix(*i ^ seed) % buckets + 1];
+  }
+  uint64_t largest = 0;
+  for (uint64_t b = 0; b < buckets; ++b) {
+    largest = std::max(largest, offsets[b + 1]);
+    offsets[b + 1] += offsets[b];
+  }
+  std::vector<uint64_t> hashed(entries);
+  {
+    std::vector<uint64_t> fill(offsets.begin(), offsets.end() - 1);
+    for (const uint64_t *i = begin; i != end; ++i) {
+      const uint64_t hash = Mix(*i ^ seed);
+      hashed[fill[hash % buckets]++] = hash;
+    }
+  }
+
+  // Mix is a bijection, so keys are the same if and only if their hashes are.
+  for (uint64_t b = 0; b < buckets; ++b) {
+    std::vector<uint64_t>::iterator bucket_begin = hashed.begin() + offsets[b], bucket_end = hashed.begin() + offsets[b + 1];
+    std::sort(bucket_begin, bucket_end);
+    UTIL_THROW_IF(std::adjacent_find(bucket_begin, bucket_end) != bucket_end, PerfectHashDuplicateException, "Duplicate key in a perfect hash of " << entries << " keys.");
+  }
+
+  // Place the largest buckets first while the table is empty.
+  std::vector<uint64_t> order;
+  order.reserve(buckets);
+  {
+    std::vector<std::vector<uint64_t> > by_size(largest + 1);
+    for (uint64_t b = 0; b < buckets; ++b) {
+      const uint64_t size = offsets[b + 1] - offsets[b];
+      if (size) by_size[size].push_back(b);
+    }
+    for (uint64_t size = largest; size; --size) {
+      order.insert(order.end(), by_size[size].begin(), by_size[size].end());
+    }
+  }
+
+  std::vector<bool> taken(slots, false);
+  std::vector<uint64_t> placed;
+  for (std::vector<uint64_t>::const_iterator b = order.begin(); b != order.end(); ++b) {
+    const uint64_t *bucket_begin = &hashed[offsets[*b]], *bucket_end = bucket_begin + (offsets[*b + 1] - offsets[*b]);
+    uint32_t pilot;
+    for (pilot = 0; pilot < kPilots; ++pilot) {
+      placed.clear();
+      const uint64_t *i;
+      for (i = bucket_begin; i != bucket_end; ++i) {
+        const uint64_t slot = Slot(*i, pilot) % slots;
+        if (taken[slot]) break;
+        placed.push_back(slot);
+      }
+      if (i != bucket_end) continue;
+      // Keys in the same bucket can collide with each other.
+      std::sort(placed.begin(), placed.end());
+      if (std::adjacent_find(placed.begin(), placed.end()) == placed.end()) break;
+    }
+    if (pilot == kPilots) return false;
+    pilots[*b] = static_cast<uint16_t>(pilot);
+    for (std::vector<uint64_t>::const_iterator i = placed.begin(); i != placed.end(); ++i) {
+      taken[*i] = true;
+    }
+  }
+
+  // There are as many keys past the end as there are holes before it.
+  const BitsMask bits(BitsMask::ByMax(entries ? entries - 1 : 0));
+  uint64_t hole = 0;
+  for (uint64_t slot = entries; slot < slots; ++slot) {
+    if (!taken[slot]) continue;
+    while (taken[hole]) ++hole;
+    WriteInt57(remap, (slot - entries) * bits.bits, bits.bits, hole++);
+  }
+  return true;
+}
+
+} // namespace util
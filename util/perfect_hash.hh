@@ -0,0 +1,95 @@
+#ifndef UTIL_PERFECT_HASH_H
+#define UTIL_PERFECT_HASH_H
+
+#include "util/bit_packing.hh"
+#include "util/exception.hh"
+#include "util/prefetch.hh"
+
+#include <cstddef>
+
+#include <stdint.h>
+
+namespace util {
+
+/* Thrown when the keys given to PerfectHash::Build are not distinct. */
+class PerfectHashDuplicateException : public Exception {
+  public:
+    PerfectHashDuplicateException() throw() {}
+    ~PerfectHashDuplicateException() throw() {}
+};
+
+/* Minimal perfect hash function for a fixed set of distinct 64-bit keys, in
+ * the style of PTHash (Pibiri and Trani, SIGIR 2021).  Keys are split into
+ * buckets by hash.  Each bucket has a 16-bit pilot, chosen by Build, that
+ * moves all its keys to unused slots of a table slightly larger than the key
+ * count.  Keys that land past the last index are sent to the unused indices
+ * below it by a bit-packed remapping array.  That's about 4 bits per key.
+ *
+ * Keys that were not passed to Build get an arbitrary index, so callers
+ * should store something with each index to reject them.
+ *
+ * This is a view of memory written by Build, so it can be mmapped.
+ */
+class PerfectHash {
+  public:
+    // Bytes needed to hash entries keys.  A multiple of 8.
+    static uint64_t Size(uint64_t entries);
+
+    // Must be assigned to later.
+    PerfectHash() : entries_(0) {}
+
+    // Use memory written by Build for entries keys.
+    PerfectHash(const void *start, uint64_t entries);
+
+    // Write a hash function for [begin, end) to start, which has
+    // Size(end - begin) bytes.  Throws PerfectHashDuplicateException if a key
+    // appears twice.
+    static void Build(const uint64_t *begin, const uint64_t *end, void *start);
+
+    // In [0, entries) and unique for each key passed to Build.
+    uint64_t operator()(uint64_t key) const {
+      const uint64_t hashed = Mix(key ^ seed_);
+      const uint64_t slot = Slot(hashed, pilots_[hashed % buckets_]) % slots_;
+      if (slot < entries_) return slot;
+      return ReadInt57(remap_, (slot - entries_) * remap_bits_.bits, remap_bits_.bits, remap_bits_.mask);
+    }
+
+    // The pilot is the only memory access that depends on just the key.
+    void Prefetch(uint64_t key) const {
+      PrefetchRead(pilots_ + Mix(key ^ seed_) % buckets_);
+    }
+
+    uint64_t Entries() const { return entries_; }
+
+  private:
+    // MurmurHash3's 64-bit finalizer, which is a bijection.
+    static uint64_t Mix(uint64_t value) {
+      value ^= value >> 33;
+      value *= 0xff51afd7ed558ccdULL;
+      value ^= value >> 33;
+      value *= 0xc4ceb9fe1a85ec53ULL;
+      value ^= value >> 33;
+      return value;
+    }
+
+    // Before reducing modulo the table size.  Mixing again matters: with a
+    // plain xor, keys that agree modulo a small table would always collide.
+    static uint64_t Slot(uint64_t hashed, uint64_t pilot) {
+      return Mix(hashed ^ (pilot * 0x9e3779b97f4a7c15ULL));
+    }
+
+    static uint64_t Buckets(uint64_t entries);
+    static uint64_t Slots(uint64_t entries);
+
+    // Try one seed, returning false if some bucket has no pilot.
+    static bool TryBuild(const uint64_t *begin, const uint64_t *end, uint64_t seed, uint16_t *pilots, void *remap);
+
+    uint64_t entries_, buckets_, slots_, seed_;
+    const uint16_t *pilots_;
+    const void *remap_;
+    BitsMask remap_bits_;
+};
+
+} // namespace util
+
+#endif // UTIL_PERFECT_HASH_H
@@ -0,0 +1,54 @@
+#include "util/perfect_hash.hh"
+
+#include "util/murmur_hash.hh"
+
+#define BOOST_TEST_MODULE PerfectHashTest
+#include <boost/test/unit_test.hpp>
+#include <boost/scoped_array.hpp>
+#include <cstring>
+#include <vector>
+#include <stdint.h>
+
+namespace util {
+namespace {
+
+void CheckMinimalPerfect(uint64_t count) {
+  std::vector<uint64_t> keys;
+  for (uint64_t i = 0; i < count; ++i) {
+    keys.push_back(MurmurHash64A(&i, sizeof(uint64_t)));
+  }
+  const uint64_t size = PerfectHash::Size(count);
+  BOOST_CHECK_EQUAL(static_cast<uint64_t>(0), size % 8);
+  boost::scoped_array<char> mem(new char[size]);
+  memset(mem.get(), 0xff, size);
+  PerfectHash::Build(keys.empty() ? NULL : &keys[0], keys.empty() ? NULL : &keys[0] + keys.size(), mem.get());
+
+  PerfectHash hash(mem.get(), count);
+  BOOST_CHECK_EQUAL(count, hash.Entries());
+  std::vector<bool> seen(count, false);
+  for (std::vector<uint64_t>::const_iterator i = keys.begin(); i != keys.end(); ++i) {
+    uint64_t index = hash(*i);
+    BOOST_REQUIRE(index < count);
+    BOOST_REQUIRE(!seen[index]);
+    seen[index] = true;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(small) {
+  for (uint64_t count = 0; count < 100; ++count) {
+    CheckMinimalPerfect(count);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(large) {
+  CheckMinimalPerfect(200000);
+}
+
+BOOST_AUTO_TEST_CASE(duplicate) {
+  uint64_t keys[4] = {3, 98, 2000, 98};
+  boost::scoped_array<char> mem(new char[PerfectHash::Size(4)]);
+  BOOST_CHECK_THROW(PerfectHash::Build(keys, keys + 4, mem.get()), PerfectHashDuplicateException);
+}
+
+} // namespace
+} // namespace util
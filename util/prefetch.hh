@@ -0,0 +1,18 @@
+#ifndef UTIL_PREFETCH_H
+#define UTIL_PREFETCH_H
+
+namespace util {
+
+/* Hint that the cache line containing address will be read soon.  Used to
+ * overlap several independent lookups that would otherwise each wait on
+ * DRAM.  A no-op on compilers without __builtin_prefetch.
+ */
+inline void PrefetchRead(const void *address) {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(address, 0, 3);
+#endif
+}
+
+} // namespace util
+
+#endif // UTIL_PREFETCH_H
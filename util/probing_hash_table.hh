@@ -3,6 +3,7 @@
 
 #include "util/exception.hh"
 #include "util/mmap.hh"
+#include "util/prefetch.hh"
 
 #include <algorithm>
 #include <cstddef>
@@ -203,6 +204,11 @@ template <class EntryT, class HashT, class EqualT = std::equal_to<typename Entry
       }
     }
 
+    // Start loading the bucket that Find(key) will probe first.
+    template <class Key> void Prefetch(const Key key) const {
+      PrefetchRead(Ideal(key));
+    }
+
     template <class Key> bool Find(const Key key, ConstIterator &out) const {
       out = Ideal(key);
       return FindFromIdeal(key, out);